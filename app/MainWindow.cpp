@@ -9,6 +9,7 @@
 #include "MapCoordControlWidget.h"
 #include "MapPanControlWidget.h"
 #include "MapRenderSettingsWidget.h"
+#include "MapSearchWidget.h"
 #include "MapZoomControlWidget.h"
 
 using Bach::MainWindow;
@@ -32,6 +33,7 @@ MainWindow::MainWindow(MapWidget* mapWidgetIn) : mapWidget{ mapWidgetIn }
     zoomControls = new MapZoomControlWidget(mapWidget);
     panControls = new MapPanControlWidget(mapWidget);
     renderControls = new MapRenderSettingsWidget(mapWidget);
+    searchControls = new MapSearchWidget(mapWidget);
 
     // Set up the menu that lets the user enter manual coordinates and
     // connect them to the map widget.
@@ -101,4 +103,10 @@ void MainWindow::updateControlsPositions()
             width() - renderControls->width(),
             0);
     }
+    // Position the search field at the top, between the other controls.
+    if (searchControls != nullptr) {
+        searchControls->move(
+            (width() - searchControls->width()) / 2,
+            0);
+    }
 }
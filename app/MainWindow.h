@@ -26,6 +26,7 @@ private:
     QWidget* zoomControls = nullptr;
     QWidget* panControls = nullptr;
     QWidget* renderControls = nullptr;
+    QWidget* searchControls = nullptr;
 
     void updateControlsPositions();
 
@@ -3,11 +3,14 @@
 
 // Qt headers.
 #include <QCheckBox>
+#include <QFileDialog>
+#include <QMessageBox>
 #include <QPushButton>
 #include <QVBoxLayout>
 
 // Other header files.
 #include "MapRenderSettingsWidget.h"
+#include "Tracing.h"
 
 using Bach::MapRenderSettingsWidget;
 
@@ -26,6 +29,21 @@ static QString getShowingDebugBtnLabel(const MapWidget* mapWidget)
     return name;
 }
 
+/*!
+ * \brief getShowingMetricsBtnLabel creates a string to label the metrics overlay button.
+ * \param mapWidget The QWidget to render to.
+ * \return the generated label string.
+ */
+static QString getShowingMetricsBtnLabel(const MapWidget* mapWidget)
+{
+    auto name = QString("Showing metrics ");
+    if (mapWidget->isShowingMetrics())
+        name += "on";
+    else
+        name += "off";
+    return name;
+}
+
 /*!
  * \brief getRenderingTileBtnLabel creates a string to label the toggle rendering tile button.
  * \param mapWidget The QWidget to render to.
@@ -68,6 +86,19 @@ MapRenderSettingsWidget::MapRenderSettingsWidget(MapWidget* mapWidget) : QWidget
             debugBtn->setText(name);
         });
 
+    // Set up the toggle metrics overlay button.
+    QString metricsBtnName = getShowingMetricsBtnLabel(mapWidget);
+    QPushButton *metricsBtn = new QPushButton(metricsBtnName, this);
+    layout->addWidget(metricsBtn);
+    QObject::connect(
+        metricsBtn,
+        &QPushButton::clicked,
+        mapWidget,
+        [=]() {
+            mapWidget->toggleIsShowingMetrics();
+            metricsBtn->setText(getShowingMetricsBtnLabel(mapWidget));
+        });
+
     // Set up the toggle map tile type button.
     QString renderBtnName = getRenderingTileBtnLabel(mapWidget);
     QPushButton *renderBtn = new QPushButton(renderBtnName, this);
@@ -118,4 +149,72 @@ MapRenderSettingsWidget::MapRenderSettingsWidget(MapWidget* mapWidget) : QWidget
         [=](Qt::CheckState boxIsChecked) {
             mapWidget->setShouldDrawText(boxIsChecked == Qt::Checked);
         });
+
+    // Set up checkbox for animated zooming.
+    QCheckBox *animatedZoomCheckbox = new QCheckBox("Animated zoom", this);
+    animatedZoomCheckbox->setCheckState(mapWidget->isAnimatedZoomEnabled() ? Qt::Checked : Qt::Unchecked);
+    layout->addWidget(animatedZoomCheckbox);
+    QObject::connect(
+        animatedZoomCheckbox,
+        &QCheckBox::checkStateChanged,
+        mapWidget,
+        [=](Qt::CheckState boxIsChecked) {
+            mapWidget->setAnimatedZoomEnabled(boxIsChecked == Qt::Checked);
+        });
+
+    // Set up checkbox for repeating the world horizontally.
+    QCheckBox *wrapWorldCheckbox = new QCheckBox("Wrap world", this);
+    wrapWorldCheckbox->setCheckState(mapWidget->isWrappingWorld() ? Qt::Checked : Qt::Unchecked);
+    layout->addWidget(wrapWorldCheckbox);
+    QObject::connect(
+        wrapWorldCheckbox,
+        &QCheckBox::checkStateChanged,
+        mapWidget,
+        [=](Qt::CheckState boxIsChecked) {
+            mapWidget->setWrapWorld(boxIsChecked == Qt::Checked);
+        });
+
+    // Set up the checkboxes that control how the map is rendered while it is being moved.
+    // Each checkbox changes a single field of the MapWidget's policy.
+    auto addInteractionPolicyCheckbox = [=](
+        const QString &label,
+        bool MapWidget::InteractionRenderPolicy::*field)
+    {
+        QCheckBox *checkbox = new QCheckBox(label, this);
+        checkbox->setCheckState(mapWidget->getInteractionRenderPolicy().*field ? Qt::Checked : Qt::Unchecked);
+        layout->addWidget(checkbox);
+        QObject::connect(
+            checkbox,
+            &QCheckBox::checkStateChanged,
+            mapWidget,
+            [=](Qt::CheckState boxIsChecked) {
+                MapWidget::InteractionRenderPolicy policy = mapWidget->getInteractionRenderPolicy();
+                policy.*field = boxIsChecked == Qt::Checked;
+                mapWidget->setInteractionRenderPolicy(policy);
+            });
+    };
+    addInteractionPolicyCheckbox("Fast rendering while moving", &MapWidget::InteractionRenderPolicy::enabled);
+    addInteractionPolicyCheckbox("Hide text while moving", &MapWidget::InteractionRenderPolicy::hideText);
+    addInteractionPolicyCheckbox("No antialiasing while moving", &MapWidget::InteractionRenderPolicy::disableAntialiasing);
+    addInteractionPolicyCheckbox("Simplify geometry while moving", &MapWidget::InteractionRenderPolicy::simplifyGeometry);
+    addInteractionPolicyCheckbox("Dynamic resolution while moving", &MapWidget::InteractionRenderPolicy::dynamicResolution);
+
+    // Set up the button that saves the recorded trace spans to a file.
+    QPushButton *saveTraceBtn = new QPushButton("Save trace...", this);
+    layout->addWidget(saveTraceBtn);
+    QObject::connect(
+        saveTraceBtn,
+        &QPushButton::clicked,
+        this,
+        [=]() {
+            QString path = QFileDialog::getSaveFileName(
+                this,
+                "Save trace",
+                "trace.json",
+                "Chrome trace (*.json)");
+            if (path.isEmpty())
+                return;
+            if (!Bach::Tracing::writeChromeTrace(path))
+                QMessageBox::warning(this, "Save trace", "Unable to write the trace file.");
+        });
 }
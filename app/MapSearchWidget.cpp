@@ -0,0 +1,112 @@
+// Copyright (c) 2024 Cecilia Norevik Bratlie, Nils Petter Skålerud, Eimen Oueslati
+// SPDX-License-Identifier: MIT
+
+// Qt header files.
+#include <QVBoxLayout>
+
+// Other header files.
+#include "MapSearchWidget.h"
+
+using Bach::MapSearchWidget;
+
+/*!
+ * \brief calcAllowedEdits picks how many typing errors to allow in a search.
+ *
+ * Short queries match too many names when errors are allowed, so they only match by prefix.
+ *
+ * \param queryLength The number of letters typed.
+ * \return The number of edits to allow.
+ */
+static int calcAllowedEdits(qsizetype queryLength)
+{
+    if (queryLength < 4)
+        return 0;
+    if (queryLength < 8)
+        return 1;
+    return 2;
+}
+
+/*!
+ * \brief MapSearchWidget::MapSearchWidget
+ * Sets up the search field and the list of results below it.
+ *
+ * \param mapWidget The QWidget to place this widget on top of.
+ */
+MapSearchWidget::MapSearchWidget(MapWidget* mapWidgetIn) :
+    QWidget(mapWidgetIn),
+    mapWidget{ mapWidgetIn }
+{
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    setLayout(layout);
+
+    searchField = new QLineEdit(this);
+    searchField->setPlaceholderText("Find place...");
+    searchField->setClearButtonEnabled(true);
+    searchField->setMinimumWidth(250);
+    layout->addWidget(searchField);
+
+    resultList = new QListWidget(this);
+    resultList->hide();
+    layout->addWidget(resultList);
+
+    QObject::connect(
+        searchField,
+        &QLineEdit::textEdited,
+        this,
+        &MapSearchWidget::updateResults);
+    // Pressing enter goes to the best match.
+    QObject::connect(
+        searchField,
+        &QLineEdit::returnPressed,
+        this,
+        [this]() { goToResult(0); });
+    QObject::connect(
+        resultList,
+        &QListWidget::itemClicked,
+        this,
+        [this](QListWidgetItem *item) { goToResult(resultList->row(item)); });
+
+    adjustSize();
+}
+
+/*!
+ * \brief MapSearchWidget::updateResults searches for the text and shows the places found.
+ *
+ * \param text The text in the search field.
+ */
+void MapSearchWidget::updateResults(const QString &text)
+{
+    results.clear();
+    resultList->clear();
+    if (mapWidget->searchLabelsFn && !text.trimmed().isEmpty()) {
+        results = mapWidget->searchLabelsFn(
+            text,
+            calcAllowedEdits(text.trimmed().size()),
+            maxResults);
+    }
+
+    for (const Bach::LabelSearchResult &result : results)
+        resultList->addItem(QString("%1 (%2)").arg(result.name, result.sourceLayer));
+
+    // Size the list after its content so it doesn't cover more of the map than needed.
+    resultList->setVisible(!results.isEmpty());
+    if (!results.isEmpty()) {
+        resultList->setFixedHeight(
+            resultList->sizeHintForRow(0) * results.size() + 2 * resultList->frameWidth());
+    }
+    adjustSize();
+}
+
+/*!
+ * \brief MapSearchWidget::goToResult moves the viewport to one of the places found.
+ *
+ * \param index The row of the place in the result list.
+ */
+void MapSearchWidget::goToResult(int index)
+{
+    if (index < 0 || index >= results.size())
+        return;
+    const Bach::LabelSearchResult &result = results[index];
+    mapWidget->setViewport(result.worldX, result.worldY, result.zoom);
+    mapWidget->setFocus();
+}
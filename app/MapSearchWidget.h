@@ -0,0 +1,46 @@
+// Copyright (c) 2024 Cecilia Norevik Bratlie, Nils Petter Skålerud, Eimen Oueslati
+// SPDX-License-Identifier: MIT
+
+#ifndef MAPSEARCHWIDGET_H
+#define MAPSEARCHWIDGET_H
+
+// Qt header files.
+#include <QLineEdit>
+#include <QListWidget>
+#include <QWidget>
+
+// Other header files.
+#include "MapWidget.h"
+
+namespace Bach {
+/*!
+ * \class MapSearchWidget
+ * \brief The MapSearchWidget class is a search field that finds places
+ * by name in the loaded tiles, and moves the MapWidget's viewport to them.
+ *
+ * The results are updated for every letter typed. Only tiles that are already
+ * in memory are searched, so places far from what has been shown are not found.
+ */
+class MapSearchWidget : public QWidget
+{
+    Q_OBJECT
+
+private:
+    // Largest number of places shown in the result list.
+    static constexpr int maxResults = 8;
+
+    MapWidget* mapWidget = nullptr;
+    QLineEdit* searchField = nullptr;
+    QListWidget* resultList = nullptr;
+    // The places shown in the result list, in the same order.
+    QVector<Bach::LabelSearchResult> results;
+
+    void updateResults(const QString &text);
+    void goToResult(int index);
+
+public:
+    MapSearchWidget(MapWidget* parent);
+};
+}
+
+#endif // MAPSEARCHWIDGET_H
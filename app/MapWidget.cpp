@@ -2,26 +2,21 @@
 // SPDX-License-Identifier: MIT
 
 // Qt header files.
+#include <QApplication>
 #include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QImage>
 #include <QKeyEvent>
 #include <QtMath>
 #include <QPainter>
 #include <QtMath>
+#include <QToolTip>
 #include <QWheelEvent>
 
 // Other header files.
 #include "MapWidget.h"
 #include "Rendering.h"
-
-/*!
- * \brief The TileType enum determines what tile type to render.
- *
- *  Supported types: VectorTile, ImageTile
- */
-enum class TileType {
-    VectorTile,
-    ImageTile, // Can be png, jpg, or other types.
-};
+#include "Tracing.h"
 
 
 /*!
@@ -35,6 +30,77 @@ MapWidget::MapWidget(QWidget *parent) : QWidget(parent)
     // Establish and install the keypress filter.
     this->keyPressFilter = std::make_unique<KeyPressFilter>(this);
     QCoreApplication::instance()->installEventFilter(this->keyPressFilter.get());
+
+    // When the user stops moving the map, render a full-quality frame.
+    interactionIdleTimer.setSingleShot(true);
+    QObject::connect(
+        &interactionIdleTimer,
+        &QTimer::timeout,
+        this,
+        [this]() {
+            interacting = false;
+            // The next interaction starts at full resolution again.
+            dynamicRenderScale = 1.0;
+            update();
+        });
+
+    // Set up the zoom animation. Each frame of the animation only scales the last
+    // presented frame, so no tiles are rendered at the intermediate zoom levels.
+    zoomAnimation.setDuration(150);
+    zoomAnimation.setEasingCurve(QEasingCurve::OutCubic);
+    QObject::connect(
+        &zoomAnimation,
+        &QVariantAnimation::valueChanged,
+        this,
+        [this](const QVariant &value) {
+            viewportZoomLevel = value.toDouble();
+            update();
+        });
+    QObject::connect(
+        &zoomAnimation,
+        &QVariantAnimation::finished,
+        this,
+        [this]() {
+            waitingForZoomTiles = true;
+            zoomTilesTimeoutTimer.start();
+            startCrossfadeIfZoomTilesLoaded();
+            update();
+        });
+
+    // If the tiles of the target zoom level take too long to load,
+    // we crossfade to whatever is loaded instead of showing the snapshot forever.
+    zoomTilesTimeoutTimer.setSingleShot(true);
+    zoomTilesTimeoutTimer.setInterval(1000);
+    QObject::connect(
+        &zoomTilesTimeoutTimer,
+        &QTimer::timeout,
+        this,
+        [this]() {
+            if (!waitingForZoomTiles)
+                return;
+            waitingForZoomTiles = false;
+            crossfadeAnimation.start();
+            update();
+        });
+
+    // Once the tiles are loaded, the new frame is rendered and the snapshot fades out on top of it.
+    crossfadeAnimation.setDuration(150);
+    crossfadeAnimation.setStartValue(0.0);
+    crossfadeAnimation.setEndValue(1.0);
+    QObject::connect(
+        &crossfadeAnimation,
+        &QVariantAnimation::valueChanged,
+        this,
+        [this]() { update(); });
+    QObject::connect(
+        &crossfadeAnimation,
+        &QVariantAnimation::finished,
+        this,
+        [this]() {
+            zoomSnapshot = {};
+            crossfadeFrame = {};
+            update();
+        });
 }
 
 /*!
@@ -63,6 +129,16 @@ MapWidget::~MapWidget()
  */
 void MapWidget::keyPressEvent(QKeyEvent* event)
 {
+    const QList<int> navigationKeys = {
+        Qt::Key::Key_Up,
+        Qt::Key::Key_Down,
+        Qt::Key::Key_Left,
+        Qt::Key::Key_Right,
+        Qt::Key::Key_W,
+        Qt::Key::Key_S };
+    if (navigationKeys.contains(event->key()))
+        markInteraction();
+
     if (event->key() == Qt::Key::Key_Up)
         panUp();
     else if (event->key() == Qt::Key::Key_Down)
@@ -86,8 +162,12 @@ void MapWidget::keyPressEvent(QKeyEvent* event)
  */
 void MapWidget::mousePressEvent(QMouseEvent *event)
 {
-    if (event->buttons() == Qt::MouseButton::LeftButton)
+    if (event->buttons() == Qt::MouseButton::LeftButton) {
         mouseStartPosition = event->pos();
+        mousePressPosition = event->pos();
+        // Holding shift selects a region instead of moving the map.
+        selectingRegion = event->modifiers() & Qt::ShiftModifier;
+    }
 
 }
 
@@ -96,11 +176,28 @@ void MapWidget::mousePressEvent(QMouseEvent *event)
  *
  * The function can reset the mouseStartPosition variable to the point {-1, -1}.
  *
+ * If the left mouse button was released without the map being dragged,
+ * the features under the cursor are shown. If a region was being selected,
+ * the features inside it are summarized.
+ *
  * \param event is the event that fires if mouse buttons are released.
  */
 void MapWidget::mouseReleaseEvent(QMouseEvent *event)
 {
     // mouseStartPosition = {-1,-1};
+    if (event->button() != Qt::MouseButton::LeftButton)
+        return;
+    if (selectingRegion) {
+        selectingRegion = false;
+        if (!selectionRect.isEmpty())
+            showFeaturesInRegion(selectionRect);
+        selectionRect = {};
+        update();
+        return;
+    }
+    const int dragDistance = (event->pos() - mousePressPosition).manhattanLength();
+    if (dragDistance <= QApplication::startDragDistance())
+        showFeaturesAt(event->pos());
 }
 
 /*!
@@ -114,8 +211,17 @@ void MapWidget::mouseReleaseEvent(QMouseEvent *event)
  */
 void MapWidget::mouseMoveEvent(QMouseEvent *event)
 {
+    // While selecting a region, the map stays still.
+    if (selectingRegion && (event->buttons() & Qt::LeftButton)) {
+        selectionRect = QRect(mousePressPosition, event->pos()).normalized();
+        update();
+        return;
+    }
+
     // Check if the left mouse button is pressed
     if (event->buttons() & Qt::LeftButton) {
+        markInteraction();
+        stopZoomForPan();
         mouseCurrentPosition = event->pos();
 
         // Calculate the difference between the current and original mouse position.
@@ -156,6 +262,7 @@ void MapWidget::mouseMoveEvent(QMouseEvent *event)
         // Move to the map to the new position.
         x = new_x_norm;
         y = new_y_norm;
+        wrapViewportX();
 
         // Store the current mouse position before re-rendering.
         mouseStartPosition = mouseCurrentPosition;
@@ -184,6 +291,8 @@ void MapWidget::wheelEvent(QWheelEvent *event) {
         QPoint numPixels = event->pixelDelta();
         QPoint numDegrees = event->angleDelta() / 8;
 
+        markInteraction();
+
         // Check if degrees or pixels were used to record/measure scrolling.
         // A positive y value means the wheel was moved vertically away from the user.
         // A negative y value means the wheel was moved vertically towards the user.
@@ -208,6 +317,42 @@ void MapWidget::wheelEvent(QWheelEvent *event) {
 
 void MapWidget::paintEvent(QPaintEvent *event)
 {
+    BACH_TRACE_SCOPE("MapWidget::paintEvent");
+
+    // Each tile that loads after the zoom animation triggers a repaint,
+    // so this is where we find out that the target tiles are ready.
+    if (waitingForZoomTiles)
+        startCrossfadeIfZoomTilesLoaded();
+
+    const bool isZooming = zoomAnimation.state() == QAbstractAnimation::Running;
+    const bool isCrossfading = crossfadeAnimation.state() == QAbstractAnimation::Running;
+
+    // While the zoom animation runs, and until the target tiles are loaded, we only scale the snapshot.
+    // The tiles of the target zoom level are loaded in the background.
+    if ((isZooming || waitingForZoomTiles) && !zoomSnapshot.image.isNull()) {
+        QPainter widgetPainter(this);
+        widgetPainter.fillRect(rect(), palette().color(QPalette::Window));
+        paintSnapshot(widgetPainter, zoomSnapshot, 1.0);
+        paintMetricsOverlay(widgetPainter);
+        return;
+    }
+
+    // The new frame only needs to be rendered once during the crossfade.
+    // After that we only blend the two images.
+    const bool crossfadeFrameIsCurrent =
+        !crossfadeFrame.image.isNull() &&
+        crossfadeFrame.x == x &&
+        crossfadeFrame.y == y &&
+        crossfadeFrame.zoom == getViewportZoomLevel() &&
+        crossfadeFrame.size == size();
+    if (isCrossfading && crossfadeFrameIsCurrent && !zoomSnapshot.image.isNull()) {
+        QPainter widgetPainter(this);
+        widgetPainter.drawImage(rect(), crossfadeFrame.image);
+        paintSnapshot(widgetPainter, zoomSnapshot, 1.0 - crossfadeAnimation.currentValue().toDouble());
+        paintMetricsOverlay(widgetPainter);
+        return;
+    }
+
     QVector<TileCoord> visibleTiles = calcVisibleTiles();
     std::set<TileCoord> tilesRequested{ visibleTiles.begin(), visibleTiles.end()};
     // This signal should run every time a new tile is loaded later.
@@ -220,16 +365,157 @@ void MapWidget::paintEvent(QPaintEvent *event)
     // Request tiles.
     QScopedPointer<Bach::RequestTilesResult> requestResult = requestTilesFn(
         tilesRequested,
-        signalFn);
+        signalFn,
+        getRenderedTileTypes());
+
+    QPainter widgetPainter(this);
+
+    QElapsedTimer frameTimer;
+    frameTimer.start();
+
+    const double renderScale = getRenderScale();
+    if (renderScale < 1.0 || isCrossfading || isInteracting()) {
+        // Render into an image, then draw it onto the widget. The image can have
+        // fewer pixels than the widget, in which case it is upscaled.
+        const QImage frame = renderFrameImage(*requestResult, renderScale, &lastRenderedFeatures);
+        widgetPainter.setRenderHint(QPainter::SmoothPixmapTransform);
+        widgetPainter.drawImage(rect(), frame);
+
+        // Keep the frame around, so a zoom can start by scaling it
+        // and the rest of the crossfade only blends images.
+        presentedFrame = { frame, x, y, getViewportZoomLevel(), size() };
+        if (isCrossfading)
+            crossfadeFrame = presentedFrame;
+    } else {
+        // Idle frames are drawn straight onto the widget, and there is no image to keep.
+        presentedFrame = {};
+        paintMap(widgetPainter, *requestResult, &lastRenderedFeatures);
+    }
+
+    // Fade out the zoom snapshot on top of the new frame.
+    if (isCrossfading && !zoomSnapshot.image.isNull())
+        paintSnapshot(widgetPainter, zoomSnapshot, 1.0 - crossfadeAnimation.currentValue().toDouble());
+
+    paintSelectionOverlay(widgetPainter);
+    paintMetricsOverlay(widgetPainter);
+
+    updateDynamicRenderScale(frameTimer.nsecsElapsed() / 1000000.0, renderScale);
+
+    // Startup is measured until the first frame that has every visible tile.
+    if (Bach::isStartupInProgress()) {
+        Bach::recordStartupPhase("first paint");
+        const qsizetype tilesShown = isRenderingVector()
+            ? requestResult->vectorMap().size()
+            : requestResult->rasterImageMap().size();
+        if (tilesShown >= (qsizetype)tilesRequested.size()) {
+            Bach::recordStartupPhase("first complete frame");
+            Bach::finishStartup();
+            qInfo().noquote() << Bach::formatStartupReport();
+        }
+    }
+}
+
+/*!
+ * \brief MapWidget::paintMetricsOverlay
+ * Draws the performance metrics in the top-left corner of the widget,
+ * if the metrics overlay is turned on.
+ *
+ * \param painter The painter to draw with.
+ */
+void MapWidget::paintMetricsOverlay(QPainter &painter) const
+{
+    if (!isShowingMetrics())
+        return;
 
-    QPainter painter(this);
+    const Bach::RenderMetrics renderMetrics = Bach::getRenderMetrics();
+    const QString text = tileLoaderMetricsFn
+        ? Bach::formatMetricsOverlayText(tileLoaderMetricsFn(), renderMetrics)
+        : Bach::formatMetricsOverlayText(renderMetrics);
 
+    painter.save();
+    painter.resetTransform();
+    QFont font = painter.font();
+    font.setStyleHint(QFont::Monospace);
+    painter.setFont(font);
+
+    // Draw the text on a translucent box so it stays readable on top of any map.
+    const int margin = 8;
+    QRect textRect = painter.fontMetrics().boundingRect(
+        QRect(0, 0, width(), height()),
+        Qt::AlignLeft | Qt::AlignTop,
+        text);
+    textRect.translate(margin, margin);
+    painter.fillRect(textRect.adjusted(-4, -4, 4, 4), QColor(0, 0, 0, 160));
+    painter.setPen(Qt::white);
+    painter.drawText(textRect, Qt::AlignLeft | Qt::AlignTop, text);
+    painter.restore();
+}
+
+/*!
+ * \brief MapWidget::renderFrameImage
+ * Paints the map into an offscreen image.
+ *
+ * The painter's window stays at the logical size of the widget, so all
+ * the rendering functions see the same viewport as they would otherwise.
+ *
+ * \param requestResult The tiles and stylesheet to paint.
+ * \param renderScale The resolution of the image, relative to the full resolution of the widget.
+ * \param renderedFeaturesOut If not null, filled with the features drawn.
+ * \return The image.
+ */
+QImage MapWidget::renderFrameImage(
+    const Bach::RequestTilesResult &requestResult,
+    double renderScale,
+    Bach::RenderedFeatureSet *renderedFeaturesOut) const
+{
+    const QSize internalSize =
+        (QSizeF(size()) * devicePixelRatioF() * renderScale)
+            .toSize()
+            .expandedTo({ 1, 1 });
+    QImage frame(internalSize, QImage::Format_ARGB32_Premultiplied);
+    frame.fill(palette().color(QPalette::Window));
+    QPainter framePainter(&frame);
+    framePainter.setWindow(rect());
+    framePainter.setViewport(frame.rect());
+    paintMap(framePainter, requestResult, renderedFeaturesOut);
+    return frame;
+}
+
+/*!
+ * \brief MapWidget::paintMap
+ * Paints the visible tiles into the painter.
+ *
+ * The painter's window is used as the size of the viewport, so the painter can
+ * point to a surface with a different resolution than the widget.
+ *
+ * \param painter The painter to paint the map with.
+ * \param requestResult The tiles and stylesheet to paint.
+ * \param renderedFeaturesOut If not null, filled with the features drawn. Cleared when rendering raster tiles.
+ */
+void MapWidget::paintMap(
+    QPainter &painter,
+    const Bach::RequestTilesResult &requestResult,
+    Bach::RenderedFeatureSet *renderedFeaturesOut) const
+{
     if (isRenderingVector()) {
         // Set up the paint settings based on the MapWidget configuration.
         Bach::PaintVectorTileSettings paintSettings = Bach::PaintVectorTileSettings::getDefault();
         paintSettings.drawFill = isRenderingFill();
         paintSettings.drawLines = isRenderingLines();
         paintSettings.drawText = isRenderingText();
+        paintSettings.wrapWorld = isWrappingWorld();
+
+        // While the user is moving the map, we leave out the expensive parts of rendering.
+        // A full-quality frame follows once the idle timer fires.
+        const InteractionRenderPolicy &policy = getInteractionRenderPolicy();
+        if (isInteracting() && policy.enabled) {
+            if (policy.hideText)
+                paintSettings.drawText = false;
+            if (policy.disableAntialiasing)
+                paintSettings.forceNoAntialiasing = true;
+            if (policy.simplifyGeometry)
+                paintSettings.minFeatureSizePixels = policy.minFeatureSizePixels;
+        }
 
         // Then run the function to paint all vector tiles into this MapWidget.
         Bach::paintVectorTiles(
@@ -238,20 +524,24 @@ void MapWidget::paintEvent(QPaintEvent *event)
             y,
             getViewportZoomLevel(),
             getMapZoomLevel(),
-            requestResult->vectorMap(),
-            requestResult->styleSheet(),
+            requestResult.vectorMap(),
+            requestResult.styleSheet(),
             paintSettings,
-            isShowingDebug());
+            isShowingDebug(),
+            renderedFeaturesOut);
     } else {
+        if (renderedFeaturesOut != nullptr)
+            renderedFeaturesOut->clear();
         Bach::paintRasterTiles(
             painter,
             x,
             y,
             getViewportZoomLevel(),
             getMapZoomLevel(),
-            requestResult->rasterImageMap(),
-            requestResult->styleSheet(),
-            isShowingDebug());
+            requestResult.rasterImageMap(),
+            requestResult.styleSheet(),
+            isShowingDebug(),
+            isWrappingWorld());
     }
 }
 
@@ -281,6 +571,42 @@ int MapWidget::getMapZoomLevel() const
         getViewportZoomLevel());
 }
 
+/*!
+ * \internal
+ * \brief calcVisibleTilesForViewport
+ * Calculates the tiles to load for a viewport.
+ *
+ * When the world wraps, a tile visible in several copies of the world is only
+ * returned once, since every copy is drawn from the same tile data.
+ *
+ * \return The coordinates of the tiles, without duplicates.
+ */
+static QVector<TileCoord> calcVisibleTilesForViewport(
+    double vpX,
+    double vpY,
+    double vpAspect,
+    double vpZoom,
+    int mapZoom,
+    bool wrapWorld)
+{
+    if (!wrapWorld)
+        return Bach::calcVisibleTiles(vpX, vpY, vpAspect, vpZoom, mapZoom);
+
+    const QVector<Bach::WrappedTileCoord> wrappedTiles = Bach::calcVisibleTilesWrapped(
+        vpX,
+        vpY,
+        vpAspect,
+        vpZoom,
+        mapZoom);
+    QVector<TileCoord> out;
+    std::set<TileCoord> added;
+    for (const Bach::WrappedTileCoord &tile : wrappedTiles) {
+        if (added.insert(tile.coord).second)
+            out.push_back(tile.coord);
+    }
+    return out;
+}
+
 /*!
  * \brief MapWidget::calcVisibleTiles
  * Calculates which tiles to be displayed in the viewport.
@@ -289,12 +615,147 @@ int MapWidget::getMapZoomLevel() const
  */
 QVector<TileCoord> MapWidget::calcVisibleTiles() const
 {
-    return Bach::calcVisibleTiles(
+    return calcVisibleTilesForViewport(
         x,
         y,
         (double)width() / height(),
         getViewportZoomLevel(),
-        getMapZoomLevel());
+        getMapZoomLevel(),
+        isWrappingWorld());
+}
+
+/*!
+ * \brief MapWidget::queryRenderedFeaturesAt
+ * Finds the features drawn in the last frame around a position in the widget.
+ *
+ * \param pos The position in the widget, in logical pixels.
+ * \param radiusPixels How far from the position a feature can be.
+ * \return The features found, topmost layer style first. Empty when rendering raster tiles.
+ */
+QVector<Bach::RenderedFeatureHit> MapWidget::queryRenderedFeaturesAt(QPoint pos, double radiusPixels) const
+{
+    if (!isRenderingVector())
+        return {};
+
+    // Only the tiles that are already loaded are needed, so we don't pass a callback.
+    const QVector<TileCoord> visibleTiles = calcVisibleTiles();
+    QScopedPointer<Bach::RequestTilesResult> requestResult = requestTilesFn(
+        { visibleTiles.begin(), visibleTiles.end() },
+        nullptr,
+        TileTypeFlag::Vector);
+
+    QVector<Bach::RenderedFeatureHit> hits = Bach::queryRenderedFeaturesAt(
+        pos,
+        radiusPixels,
+        width(),
+        height(),
+        x,
+        y,
+        getViewportZoomLevel(),
+        getMapZoomLevel(),
+        requestResult->vectorMap(),
+        requestResult->styleSheet(),
+        &lastRenderedFeatures,
+        isWrappingWorld());
+    for (Bach::RenderedFeatureHit &hit : hits)
+        hit.feature = nullptr;
+    return hits;
+}
+
+/*!
+ * \brief MapWidget::showFeaturesAt
+ * Shows a tooltip with the layer and attributes of the features drawn at a position.
+ *
+ * \param pos The position in the widget, in logical pixels.
+ */
+void MapWidget::showFeaturesAt(QPoint pos)
+{
+    const QVector<Bach::RenderedFeatureHit> hits = queryRenderedFeaturesAt(pos, featureQueryRadiusPixels);
+    if (hits.isEmpty()) {
+        QToolTip::hideText();
+        return;
+    }
+
+    // Only the topmost features are listed, the tooltip would get too large otherwise.
+    const int maxListed = 5;
+    QStringList lines;
+    for (int i = 0; i < hits.size() && i < maxListed; i++) {
+        const Bach::RenderedFeatureHit &hit = hits[i];
+        lines << QString("%1 (%2)").arg(hit.styleLayerId, hit.sourceLayer);
+        for (const auto &[key, value] : hit.attributes.asKeyValueRange())
+            lines << QString("    %1: %2").arg(key, value.toString());
+    }
+    if (hits.size() > maxListed)
+        lines << QString("%1 more...").arg(hits.size() - maxListed);
+
+    QToolTip::showText(mapToGlobal(pos), lines.join('\n'), this);
+}
+
+/*!
+ * \brief MapWidget::paintSelectionOverlay
+ * Draws the region being selected, if any.
+ *
+ * \param painter The painter to draw with.
+ */
+void MapWidget::paintSelectionOverlay(QPainter &painter) const
+{
+    if (!selectingRegion || selectionRect.isEmpty())
+        return;
+
+    painter.save();
+    painter.setPen(QPen(palette().color(QPalette::Highlight), 1, Qt::DashLine));
+    QColor fillColor = palette().color(QPalette::Highlight);
+    fillColor.setAlpha(40);
+    painter.setBrush(fillColor);
+    painter.drawRect(selectionRect);
+    painter.restore();
+}
+
+/*!
+ * \brief MapWidget::showFeaturesInRegion
+ * Shows a tooltip with the number of features each layer style drew inside the region.
+ *
+ * \param region The region in the widget, in logical pixels.
+ */
+void MapWidget::showFeaturesInRegion(const QRect &region)
+{
+    if (!isRenderingVector())
+        return;
+
+    // Only the tiles that are already loaded are needed, so we don't pass a callback.
+    const QVector<TileCoord> visibleTiles = calcVisibleTiles();
+    QScopedPointer<Bach::RequestTilesResult> requestResult = requestTilesFn(
+        { visibleTiles.begin(), visibleTiles.end() },
+        nullptr,
+        TileTypeFlag::Vector);
+
+    // The results are only counted, so none of them are kept.
+    QMap<QString, int> countPerLayerStyle;
+    int totalCount = 0;
+    Bach::queryRenderedFeatures(
+        QRectF{ region },
+        {},
+        width(),
+        height(),
+        x,
+        y,
+        getViewportZoomLevel(),
+        getMapZoomLevel(),
+        requestResult->vectorMap(),
+        requestResult->styleSheet(),
+        &lastRenderedFeatures,
+        [&](const Bach::RenderedFeatureHit &hit) {
+            countPerLayerStyle[hit.styleLayerId]++;
+            totalCount++;
+            return true;
+        },
+        isWrappingWorld());
+
+    QStringList lines;
+    lines << QString("%1 features selected").arg(totalCount);
+    for (const auto &[styleLayerId, count] : countPerLayerStyle.asKeyValueRange())
+        lines << QString("    %1: %2").arg(styleLayerId).arg(count);
+    QToolTip::showText(mapToGlobal(region.center()), lines.join('\n'), this);
 }
 
 /*!
@@ -317,13 +778,177 @@ double MapWidget::getPanStepAmount() const
  */
 void MapWidget::genericZoom(bool magnify)
 {
-    if (magnify)
-        viewportZoomLevel += 0.1;
-    else
-        viewportZoomLevel -= 0.1;
+    const double zoomStep = magnify ? 0.1 : -0.1;
+
+    if (!isAnimatedZoomEnabled()) {
+        viewportZoomLevel += zoomStep;
+        update();
+        return;
+    }
+
+    // Zoom steps that arrive while the animation is running, or while we wait for its tiles,
+    // extend it from where it currently is and keep scaling the same snapshot.
+    const bool continuesZoom =
+        (zoomAnimation.state() == QAbstractAnimation::Running || waitingForZoomTiles) &&
+        !zoomSnapshot.image.isNull();
+    if (!continuesZoom) {
+        crossfadeAnimation.stop();
+        crossfadeFrame = {};
+        // Nothing is rendered here, we scale the frame that is already on screen.
+        zoomSnapshot = presentedFrame;
+        targetViewportZoomLevel = viewportZoomLevel;
+
+        // The frame on screen was drawn straight onto the widget, so there is nothing to animate from.
+        // We zoom at once instead. The frame for it is kept, so the next steps are animated.
+        if (zoomSnapshot.image.isNull()) {
+            viewportZoomLevel += zoomStep;
+            markInteraction();
+            update();
+            return;
+        }
+    }
+    waitingForZoomTiles = false;
+    zoomTilesTimeoutTimer.stop();
+    targetViewportZoomLevel += zoomStep;
+
+    zoomAnimation.stop();
+    zoomAnimation.setStartValue(viewportZoomLevel);
+    zoomAnimation.setEndValue(targetViewportZoomLevel);
+    zoomAnimation.start();
+
+    markInteraction();
+    requestZoomTargetTiles();
+}
+
+/*!
+ * \brief MapWidget::requestZoomTargetTiles
+ * Requests the tiles that will be visible once the zoom animation is done,
+ * so they can load while the animation is running.
+ */
+void MapWidget::requestZoomTargetTiles()
+{
+    if (!requestTilesFn)
+        return;
+
+    const int targetMapZoom = Bach::calcMapZoomLevelForTileSizePixels(
+        width(),
+        height(),
+        targetViewportZoomLevel);
+    const QVector<TileCoord> targetTiles = calcVisibleTilesForViewport(
+        x,
+        y,
+        (double)width() / height(),
+        targetViewportZoomLevel,
+        targetMapZoom,
+        isWrappingWorld());
+    zoomTargetTiles = { targetTiles.begin(), targetTiles.end() };
+
+    // We don't need the result here, the tiles are picked up from the
+    // cache when the frame at the target zoom level is rendered.
+    QScopedPointer<Bach::RequestTilesResult> requestResult = requestTilesFn(
+        zoomTargetTiles,
+        [this](TileCoord) { update(); },
+        getRenderedTileTypes());
+}
+
+/*!
+ * \brief MapWidget::startCrossfadeIfZoomTilesLoaded
+ * Starts fading in the new zoom level once the tiles requested by
+ * requestZoomTargetTiles are all loaded. Until then the snapshot is drawn.
+ */
+void MapWidget::startCrossfadeIfZoomTilesLoaded()
+{
+    if (!waitingForZoomTiles)
+        return;
+
+    if (requestTilesFn && !zoomTargetTiles.empty()) {
+        // Without a callback, only the tiles that are already loaded are returned.
+        QScopedPointer<Bach::RequestTilesResult> requestResult = requestTilesFn(
+            zoomTargetTiles,
+            nullptr,
+            getRenderedTileTypes());
+        const qsizetype tilesLoaded = isRenderingVector()
+            ? requestResult->vectorMap().size()
+            : requestResult->rasterImageMap().size();
+        if (tilesLoaded < (qsizetype)zoomTargetTiles.size())
+            return;
+    }
+
+    waitingForZoomTiles = false;
+    zoomTilesTimeoutTimer.stop();
+    crossfadeAnimation.start();
     update();
 }
 
+/*!
+ * \brief MapWidget::stopZoomAnimation
+ * Stops the zoom animation and the crossfade, without animating to the target zoom level.
+ */
+void MapWidget::stopZoomAnimation()
+{
+    zoomAnimation.stop();
+    crossfadeAnimation.stop();
+    zoomTilesTimeoutTimer.stop();
+    waitingForZoomTiles = false;
+    zoomSnapshot = {};
+    crossfadeFrame = {};
+}
+
+/*!
+ * \brief MapWidget::stopZoomForPan
+ * Ends the zoom at its target zoom level when the user pans.
+ *
+ * The snapshot only covers the viewport the zoom started at, so it would leave
+ * blank areas once the map is moved. The next frame is rendered instead.
+ */
+void MapWidget::stopZoomForPan()
+{
+    if (zoomAnimation.state() == QAbstractAnimation::Running)
+        viewportZoomLevel = targetViewportZoomLevel;
+    stopZoomAnimation();
+}
+
+/*!
+ * \brief MapWidget::paintSnapshot
+ * Draws a previously rendered frame where its content belongs in the current viewport.
+ *
+ * \param painter The painter to draw with.
+ * \param snapshot The frame to draw.
+ * \param opacity The opacity to draw the frame with, range [0, 1].
+ */
+void MapWidget::paintSnapshot(QPainter &painter, const FrameSnapshot &snapshot, double opacity) const
+{
+    if (snapshot.image.isNull() || snapshot.size.isEmpty() || height() == 0)
+        return;
+
+    // Size of the current viewport and of the snapshot's viewport, in world-normalized coordinates.
+    const auto [currentWidthNorm, currentHeightNorm] = Bach::calcViewportSizeNorm(
+        getViewportZoomLevel(),
+        (double)width() / height());
+    const auto [snapshotWidthNorm, snapshotHeightNorm] = Bach::calcViewportSizeNorm(
+        snapshot.zoom,
+        (double)snapshot.size.width() / snapshot.size.height());
+
+    // Find where the corners of the snapshot end up in the current viewport, in widget pixels.
+    const double left =
+        ((snapshot.x - snapshotWidthNorm / 2.0) - (x - currentWidthNorm / 2.0))
+        / currentWidthNorm * width();
+    const double top =
+        ((snapshot.y - snapshotHeightNorm / 2.0) - (y - currentHeightNorm / 2.0))
+        / currentHeightNorm * height();
+    const QRectF targetRect {
+        left,
+        top,
+        snapshotWidthNorm / currentWidthNorm * width(),
+        snapshotHeightNorm / currentHeightNorm * height() };
+
+    painter.save();
+    painter.setOpacity(opacity);
+    painter.setRenderHint(QPainter::SmoothPixmapTransform);
+    painter.drawImage(targetRect, snapshot.image);
+    painter.restore();
+}
+
 /*!
  * \brief MapWidget::zoomIn
  * Zooms in a single step.
@@ -348,6 +973,7 @@ void MapWidget::zoomOut()
  */
 void MapWidget::panUp()
 {
+    stopZoomForPan();
     auto amount = getPanStepAmount();
     y -= amount;
     update();
@@ -359,6 +985,7 @@ void MapWidget::panUp()
  */
 void MapWidget::panDown()
 {
+    stopZoomForPan();
     auto amount = getPanStepAmount();
     y += amount;
     update();
@@ -370,8 +997,10 @@ void MapWidget::panDown()
  */
 void MapWidget::panLeft()
 {
+    stopZoomForPan();
     auto amount = getPanStepAmount();
     x -= amount;
+    wrapViewportX();
     update();
 }
 
@@ -381,8 +1010,10 @@ void MapWidget::panLeft()
  */
 void MapWidget::panRight()
 {
+    stopZoomForPan();
     auto amount = getPanStepAmount();
     x += amount;
+    wrapViewportX();
     update();
 }
 
@@ -396,12 +1027,16 @@ void MapWidget::panRight()
  */
 void MapWidget::setViewport(double xIn, double yIn, double zoomIn)
 {
+    // An explicit viewport overrides any running zoom animation.
+    stopZoomAnimation();
+
     bool change = false;
     if (x != xIn || y != yIn || viewportZoomLevel != zoomIn)
         change = true;
     x = xIn;
     y = yIn;
     viewportZoomLevel = zoomIn;
+    wrapViewportX();
     if (change) {
         update();
     }
@@ -467,6 +1102,135 @@ void MapWidget::setShouldDrawText(bool drawText)
     update();
 }
 
+/*!
+ * \brief MapWidget::setWrapWorld
+ * Controls if the world repeats horizontally, so the map continues past the antimeridian.
+ *
+ * \param wrap indicates if the world should repeat (true) or not (false).
+ */
+void MapWidget::setWrapWorld(bool wrap)
+{
+    wrapWorld = wrap;
+    wrapViewportX();
+    update();
+}
+
+/*!
+ * \brief MapWidget::wrapViewportX
+ * Moves the center of the viewport back into the original copy of the world,
+ * when the world wraps. The view doesn't change, since every copy looks the same.
+ *
+ * The stored frames are moved along with it, so they are still drawn in the right place.
+ */
+void MapWidget::wrapViewportX()
+{
+    if (!isWrappingWorld())
+        return;
+    const double shift = std::floor(x);
+    if (shift == 0)
+        return;
+    x -= shift;
+    crossfadeFrame.x -= shift;
+    zoomSnapshot.x -= shift;
+    presentedFrame.x -= shift;
+}
+
+/*!
+ * \brief MapWidget::markInteraction
+ * Marks that the user is currently moving the map,
+ * and restarts the timer that renders a full-quality frame once the user is idle.
+ */
+void MapWidget::markInteraction()
+{
+    interacting = true;
+    interactionIdleTimer.start(interactionRenderPolicy.idleDelayMs);
+}
+
+/*!
+ * \brief MapWidget::getRenderScale
+ * Gets the internal resolution the next frame will be rendered at,
+ * relative to the full resolution of the widget.
+ *
+ * This is always 1 unless the user is moving the map and dynamic resolution is enabled.
+ *
+ * \return The render scale in the range (0, 1].
+ */
+double MapWidget::getRenderScale() const
+{
+    const InteractionRenderPolicy &policy = getInteractionRenderPolicy();
+    if (isInteracting() && policy.enabled && policy.dynamicResolution)
+        return dynamicRenderScale;
+    return 1.0;
+}
+
+/*!
+ * \brief MapWidget::updateDynamicRenderScale
+ * Picks the internal resolution to use for the next frame while the user is moving the map.
+ *
+ * The rendering cost is roughly proportional to the number of pixels,
+ * so the scale of each axis is adjusted by the square root of how far off the target frame time we were.
+ * The scale only grows back slowly, to avoid jumping back and forth between resolutions.
+ *
+ * \param frameTimeMs How long the last frame took to render, in milliseconds.
+ * \param renderScaleUsed The render scale the last frame was rendered at.
+ */
+void MapWidget::updateDynamicRenderScale(double frameTimeMs, double renderScaleUsed)
+{
+    const InteractionRenderPolicy &policy = getInteractionRenderPolicy();
+    // Frames rendered while idle are always at full resolution, and are allowed to be slow.
+    if (!isInteracting() || !policy.enabled || !policy.dynamicResolution)
+        return;
+    if (frameTimeMs <= 0 || policy.targetFrameTimeMs <= 0)
+        return;
+
+    double newScale = renderScaleUsed;
+    if (frameTimeMs > policy.targetFrameTimeMs) {
+        newScale = renderScaleUsed * qSqrt(policy.targetFrameTimeMs / frameTimeMs);
+    } else if (frameTimeMs < policy.targetFrameTimeMs * 0.5) {
+        newScale = renderScaleUsed * 1.1;
+    }
+    dynamicRenderScale = qBound(policy.minRenderScale, newScale, 1.0);
+}
+
+/*!
+ * \brief MapWidget::setAnimatedZoomEnabled
+ * Controls whether zooming animates between zoom levels.
+ *
+ * \param enabled If true, zooming is animated.
+ */
+void MapWidget::setAnimatedZoomEnabled(bool enabled)
+{
+    animatedZoom = enabled;
+    if (!enabled) {
+        if (zoomAnimation.state() == QAbstractAnimation::Running)
+            viewportZoomLevel = targetViewportZoomLevel;
+        stopZoomAnimation();
+    }
+    update();
+}
+
+/*!
+ * \brief MapWidget::setInteractionRenderPolicy
+ * Controls how the map is rendered while the user is moving it.
+ *
+ * \param policy The new policy.
+ */
+void MapWidget::setInteractionRenderPolicy(const InteractionRenderPolicy &policy)
+{
+    interactionRenderPolicy = policy;
+    update();
+}
+
+/*!
+ * \brief MapWidget::toggleIsShowingMetrics
+ * Shows or hides the performance metrics overlay.
+ */
+void MapWidget::toggleIsShowingMetrics()
+{
+    showMetrics = !showMetrics;
+    update();
+}
+
 /*!
  * \brief MapWidget::toggleIsShowingDebug
  * Toggles if the debug menu and lines should be shown or not.
@@ -484,5 +1248,6 @@ void MapWidget::toggleIsShowingDebug()
 void MapWidget::toggleIsRenderingVectorTile()
 {
     renderVectorTile = !renderVectorTile;
+    // The next frame requests the tile type that is now shown.
     update();
 }
@@ -6,6 +6,9 @@
 
 // Qt header files.
 #include <QScopedPointer>
+#include <QImage>
+#include <QTimer>
+#include <QVariantAnimation>
 #include <QWidget>
 
 // STL header files.
@@ -13,8 +16,12 @@
 #include <set>
 
 // Other header files.
+#include "LabelSearchIndex.h"
+#include "Metrics.h"
+#include "Rendering.h"
 #include "RequestTilesResult.h"
 #include "TileCoord.h"
+#include "Utilities.h"
 
 /*!
  * \class MapWidget
@@ -48,6 +55,34 @@ public:
         MapWidget *mapWidget = nullptr;
     };
 
+    /*!
+     * \brief The InteractionRenderPolicy struct controls how the map is rendered
+     * while the user is dragging, scrolling or using the keyboard to move it.
+     *
+     * Frames rendered during an interaction can leave out expensive work.
+     * Once the user has been idle for idleDelayMs, a full-quality frame is rendered.
+     */
+    struct InteractionRenderPolicy {
+        // If false, every frame is rendered at full quality.
+        bool enabled = true;
+        // Skip text rendering while moving.
+        bool hideText = true;
+        // Turn antialiasing off while moving.
+        bool disableAntialiasing = true;
+        // Skip features smaller than minFeatureSizePixels while moving.
+        bool simplifyGeometry = true;
+        double minFeatureSizePixels = 2.0;
+        // How long after the last input the full-quality frame is rendered, in milliseconds.
+        int idleDelayMs = 150;
+        // Render at a reduced internal resolution while moving, and upscale the result.
+        // The resolution is picked based on how long the previous frames took.
+        bool dynamicResolution = true;
+        // The frame time the dynamic resolution tries to stay below, in milliseconds.
+        double targetFrameTimeMs = 16.0;
+        // The lowest internal resolution allowed, relative to the full resolution.
+        double minRenderScale = 0.5;
+    };
+
 private:
     // Handle to the installed event-filter.
     std::unique_ptr<KeyPressFilter> keyPressFilter = nullptr;
@@ -71,6 +106,12 @@ private:
     // Controls whether debug lines should be shown.
     bool showDebug = false;
 
+    // Controls whether the performance metrics overlay should be shown.
+    bool showMetrics = false;
+
+    // Draws the performance metrics on top of the map.
+    void paintMetricsOverlay(QPainter &painter) const;
+
     // If set to true, we should be rendering vector graphics.
     // If set to false, we should be rendering raster graphics.
     bool renderVectorTile = true;
@@ -84,6 +125,128 @@ private:
     // If true, render line-elements.
     bool renderText = true;
 
+    // If true, the world repeats horizontally.
+    bool wrapWorld = false;
+
+    // Keeps the center of the viewport inside [0, 1) in the X direction while the world wraps.
+    void wrapViewportX();
+
+    // Controls how frames are rendered while the user is moving the map.
+    InteractionRenderPolicy interactionRenderPolicy;
+
+    // True while the user is moving the map, until the idle timer fires.
+    bool interacting = false;
+
+    // Fires once the user has stopped moving the map, to render a full-quality frame.
+    QTimer interactionIdleTimer;
+
+    // Marks that the user is moving the map and restarts the idle timer.
+    void markInteraction();
+
+    // Internal resolution used while moving the map, relative to the full resolution.
+    // Range [minRenderScale, 1].
+    double dynamicRenderScale = 1.0;
+
+    // Adjusts dynamicRenderScale based on how long the last frame took to render.
+    void updateDynamicRenderScale(double frameTimeMs, double renderScaleUsed);
+
+    // Paints the map into the painter, using the painter's window as the viewport size.
+    // The features drawn are recorded into renderedFeaturesOut, if not null.
+    void paintMap(
+        QPainter &painter,
+        const Bach::RequestTilesResult &requestResult,
+        Bach::RenderedFeatureSet *renderedFeaturesOut) const;
+
+    // Paints the map into an image with renderScale times the pixels of the widget.
+    QImage renderFrameImage(
+        const Bach::RequestTilesResult &requestResult,
+        double renderScale,
+        Bach::RenderedFeatureSet *renderedFeaturesOut) const;
+
+    // The tiles and features drawn in the last frame, used to answer feature queries.
+    Bach::RenderedFeatureSet lastRenderedFeatures;
+
+    // Where the left mouse button was last pressed, used to tell clicks apart from drags.
+    QPoint mousePressPosition = {-1, -1};
+
+    // How far from the cursor a clicked feature can be, in pixels.
+    static constexpr double featureQueryRadiusPixels = 4.0;
+
+    // Shows a tooltip describing the features drawn at the position.
+    void showFeaturesAt(QPoint pos);
+
+    // True while the user is dragging out a selection with shift and the left mouse button.
+    bool selectingRegion = false;
+
+    // The region being selected, in widget pixels.
+    QRect selectionRect;
+
+    // Draws the region being selected on top of the map.
+    void paintSelectionOverlay(QPainter &painter) const;
+
+    // Shows a tooltip summarizing the features drawn inside the region.
+    void showFeaturesInRegion(const QRect &region);
+
+    // A rendered frame together with the viewport it was rendered with.
+    struct FrameSnapshot {
+        QImage image;
+        double x = 0;
+        double y = 0;
+        double zoom = 0;
+        // Logical size of the widget when the frame was rendered.
+        QSize size;
+    };
+
+    // If true, zooming animates between zoom levels by scaling the last frame.
+    bool animatedZoom = true;
+
+    // The new frame shown during the crossfade, so it is only rendered once.
+    // Only stored while the crossfade runs.
+    FrameSnapshot crossfadeFrame;
+
+    // The frame that is scaled while the zoom animation runs,
+    // and faded out once the new frame is rendered.
+    FrameSnapshot zoomSnapshot;
+
+    // The last frame drawn while the user was moving the map, so a zoom can start
+    // by scaling it instead of rendering. Cleared when a frame is drawn straight onto the widget.
+    FrameSnapshot presentedFrame;
+
+    // The zoom level the running zoom animation ends at.
+    double targetViewportZoomLevel = 0;
+
+    // Animates viewportZoomLevel towards targetViewportZoomLevel.
+    QVariantAnimation zoomAnimation;
+
+    // Fades from zoomSnapshot to the newly rendered frame, once the zoom animation is done
+    // and the tiles of the target zoom level are loaded.
+    QVariantAnimation crossfadeAnimation;
+
+    // True from the end of the zoom animation until the crossfade starts.
+    // The snapshot is drawn in the meantime.
+    bool waitingForZoomTiles = false;
+
+    // The tiles that will be visible once the zoom animation is done.
+    std::set<TileCoord> zoomTargetTiles;
+
+    // Starts the crossfade even if some of the target tiles never load.
+    QTimer zoomTilesTimeoutTimer;
+
+    // Starts the crossfade if every tile in zoomTargetTiles is loaded.
+    void startCrossfadeIfZoomTilesLoaded();
+
+    // Stops the zoom animation and the crossfade, and drops their frames.
+    void stopZoomAnimation();
+
+    // Jumps to the target zoom level and drops the snapshot, since it doesn't cover a panned viewport.
+    void stopZoomForPan();
+
+    // Draws the snapshot where its content belongs in the current viewport.
+    void paintSnapshot(QPainter &painter, const FrameSnapshot &snapshot, double opacity) const;
+
+    // Requests the tiles of the target zoom level, so they load while the zoom animation runs.
+    void requestZoomTargetTiles();
+
 public:
     MapWidget(QWidget *parent = nullptr);
     ~MapWidget();
@@ -125,6 +288,10 @@ public:
      */
     double getViewportZoomLevel() const;
 
+    // Center of the viewport in world-normalized coordinates, range [0, 1].
+    double getViewportX() const { return x; }
+    double getViewportY() const { return y; }
+
     /* Returns the zoom level of the map based on the widget's
      * current viewport configuration.
      *
@@ -137,6 +304,12 @@ public:
      */
     QVector<TileCoord> calcVisibleTiles() const;
 
+    /* Finds the features drawn in the last frame around a position in the widget.
+     * The feature pointers of the hits are cleared, since the tiles are
+     * released before this returns.
+     */
+    QVector<Bach::RenderedFeatureHit> queryRenderedFeaturesAt(QPoint pos, double radiusPixels) const;
+
     /* Returns how long the viewport counts as one step
      * during panning.
      *
@@ -155,27 +328,65 @@ public:
      *
      * \param Second parameter is a callback to signal when a tile is loaded later.
      *        For this widget, it will signal the widget to redraw itself with the new result.
+     *
+     * \param Third parameter is the tile types to return and load. The widget
+     *        only requests the type it is rendering.
      */
     using RequestTilesFnT =
         QScopedPointer<Bach::RequestTilesResult>(
             const std::set<TileCoord>&,
-            std::function<void(TileCoord)>);
+            std::function<void(TileCoord)>,
+            TileTypes);
     std::function<RequestTilesFnT> requestTilesFn;
 
+    /*! Returns the current metrics of the tile loading.
+     *
+     * Optional. If not set, the metrics overlay only shows the renderer's metrics.
+     */
+    std::function<Bach::TileLoaderMetrics()> tileLoaderMetricsFn;
+
+    /*! Searches the names of the loaded tiles.
+     *
+     * Optional. If not set, the search field finds nothing.
+     *
+     * \param First parameter is the start of the name to look for.
+     * \param Second parameter is the number of typing errors to allow.
+     * \param Third parameter is the largest number of results to return.
+     */
+    using SearchLabelsFnT =
+        QVector<Bach::LabelSearchResult>(const QString&, int, int);
+    std::function<SearchLabelsFnT> searchLabelsFn;
+
     // Handle what should be rendered or not to the viewport.
     bool isShowingDebug() const { return showDebug; }
+    bool isShowingMetrics() const { return showMetrics; }
     bool isRenderingVector() const { return renderVectorTile; }
+    TileTypes getRenderedTileTypes() const
+    {
+        return renderVectorTile ? TileTypeFlag::Vector : TileTypeFlag::Raster;
+    }
     bool isRenderingFill() const { return renderFill; }
     void setShouldDrawFill(bool);
     bool isRenderingLines() const { return renderLines; }
     void setShouldDrawLines(bool);
     bool isRenderingText() const { return renderText; }
     void setShouldDrawText(bool);
+    bool isWrappingWorld() const { return wrapWorld; }
+    void setWrapWorld(bool);
+    bool isInteracting() const { return interacting; }
+    double getRenderScale() const;
+    bool isAnimatedZoomEnabled() const { return animatedZoom; }
+    void setAnimatedZoomEnabled(bool);
+    const InteractionRenderPolicy &getInteractionRenderPolicy() const { return interactionRenderPolicy; }
+    void setInteractionRenderPolicy(const InteractionRenderPolicy &);
 
 public slots:
     // Swap between debug and regular mode in the GUI.
     void toggleIsShowingDebug();
 
+    // Show or hide the performance metrics overlay.
+    void toggleIsShowingMetrics();
+
     // Swap between the vector and raster tile loading mode.
     void toggleIsRenderingVectorTile();
 
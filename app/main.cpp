@@ -7,8 +7,15 @@
 
 // Other header files.
 #include "MainWindow.h"
+#include "Metrics.h"
 #include "TileLoader.h"
 #include "Utilities.h"
+#include "WarmStart.h"
+
+// Largest estimated memory of the decoded vector tiles kept in memory.
+constexpr qint64 vectorMemoryBudgetBytes = 512 * 1024 * 1024;
+// Largest number of tiles preloaded from the last session.
+constexpr int maxWarmStartTiles = 128;
 
 // Helper function to let the program shut down easily if there are errors
 // during startup and initialisation.
@@ -27,8 +34,13 @@
 // The main program.
 int main(int argc, char *argv[])
 {
+    // Measure every phase until the first frame that shows all the visible tiles.
+    // The MapWidget records the last two phases and prints the report.
+    Bach::beginStartup();
+
     QApplication a(argc, argv);
     QCoreApplication::setApplicationName("qt_thesis_app");
+    Bach::recordStartupPhase("create application");
 
     // Print the cache folder to the terminal.
     qDebug() << "Current file cache can be found in: " << Bach::TileLoader::getGeneralCacheFolder();
@@ -40,6 +52,7 @@ int main(int argc, char *argv[])
         qWarning() << "Reading of the MapTiler key failed. " <<
             "App will attempt to only use local cache.";
     }
+    Bach::recordStartupPhase("read key");
 
     // The style sheet type to load (can be many different types).
     MapType mapType = MapType::BasicV2;
@@ -51,14 +64,7 @@ int main(int argc, char *argv[])
         earlyShutdown("Unable to load stylesheet from disk/web.");
     }
     const QJsonDocument &styleSheetJson = styleSheetJsonResult.value();
-
-    // Parse the stylesheet into data that can be rendered.
-    std::optional<StyleSheet> parsedStyleSheetResult = StyleSheet::fromJson(styleSheetJson);
-    // If the stylesheet can't be parsed, there is nothing to render. Shut down.
-    if (!parsedStyleSheetResult.has_value()) {
-        earlyShutdown("Unable to parse stylesheet JSON into a parsed StyleSheet object.");
-    }
-    StyleSheet &styleSheet = parsedStyleSheetResult.value();
+    Bach::recordStartupPhase("load stylesheet");
 
     // Load useful links from the stylesheet.
     // This only matters if one is online and has a MapTiler key.
@@ -79,31 +85,88 @@ int main(int argc, char *argv[])
             pngUrlTemplate = rasterUrlTemplateResult.link;
         }
     }
+    Bach::recordStartupPhase("resolve URL templates");
 
     // Create TileLoader based on whether one can access online data or not.
+    // The stylesheet is parsed afterwards, so the TileLoader can load the
+    // tiles of the last session while the parsing runs.
     std::unique_ptr<Bach::TileLoader> tileLoaderPtr;
     if (useWeb) {
         tileLoaderPtr = Bach::TileLoader::fromTileUrlTemplate(
             pbfUrlTemplate,
             pngUrlTemplate,
-            std::move(styleSheet));
+            StyleSheet{});
     } else {
-        tileLoaderPtr = Bach::TileLoader::newLocalOnly(std::move(styleSheet));
+        tileLoaderPtr = Bach::TileLoader::newLocalOnly(StyleSheet{});
     }
     Bach::TileLoader &tileLoader = *tileLoaderPtr;
+    // Tiles that are no longer shown are evicted once the decoded
+    // vector tiles use more than this.
+    tileLoader.setVectorMemoryBudget(vectorMemoryBudgetBytes);
+    // The map type is fixed, so the disk cache only needs the layers its stylesheet uses.
+    // Every attribute of those layers is kept, since the feature queries show them.
+    Bach::TileContentUsage tileContentUsage = Bach::TileContentUsage::fromStyleSheetJson(styleSheetJson);
+    tileContentUsage.keepAllAttributes = true;
+    tileLoader.setTileContentUsage(std::move(tileContentUsage));
+    Bach::recordStartupPhase("create TileLoader");
+
+    // Start loading the tiles that were shown when the application was last closed.
+    const QString warmStartPath = Bach::getWarmStartFilePath();
+    const std::optional<Bach::WarmStartState> warmStart = Bach::readWarmStartFile(warmStartPath);
+    if (warmStart.has_value())
+        tileLoader.preloadTiles_Vector(warmStart->tiles);
+    Bach::recordStartupPhase("start warm start preload");
+
+    // Parse the stylesheet into data that can be rendered.
+    std::optional<StyleSheet> parsedStyleSheetResult = StyleSheet::fromJson(styleSheetJson);
+    // If the stylesheet can't be parsed, there is nothing to render. Shut down.
+    if (!parsedStyleSheetResult.has_value()) {
+        earlyShutdown("Unable to parse stylesheet JSON into a parsed StyleSheet object.");
+    }
+    tileLoader.setStyleSheet(std::move(parsedStyleSheetResult.value()));
+    Bach::recordStartupPhase("parse stylesheet");
 
     // Creates the Widget that displays the map.
     auto *mapWidget = new MapWidget;
+    if (warmStart.has_value())
+        mapWidget->setViewport(warmStart->x, warmStart->y, warmStart->zoom);
     // Set up the function that forwards requests from the
     // MapWidget into the TileLoader. This lambda does the
-    // two components together.
-    mapWidget->requestTilesFn = [&](auto tileList, auto tileLoadedCallback) {
-        return tileLoader.requestTiles(tileList, tileLoadedCallback, true);
+    // two components together. Every MapWidget registers its own
+    // view, so more of them can share the same TileLoader.
+    const Bach::TileLoader::ViewId mapViewId = tileLoader.registerView();
+    mapWidget->requestTilesFn = [&, mapViewId](auto tileList, auto tileLoadedCallback, auto tileTypes) {
+        return tileLoader.requestTiles(mapViewId, tileList, tileLoadedCallback, true, tileTypes);
+    };
+    // Lets the metrics overlay show the state of the TileLoader.
+    mapWidget->tileLoaderMetricsFn = [&]() {
+        return tileLoader.getMetrics();
+    };
+    // Lets the search field find places in the loaded tiles.
+    mapWidget->searchLabelsFn = [&](const QString &query, int maxEdits, int maxResults) {
+        return tileLoader.getLabelSearchIndex().findFuzzy(query, maxEdits, maxResults);
     };
 
     // Main window setup
     auto app = Bach::MainWindow(mapWidget);
     app.show();
-
-    return a.exec();
+    Bach::recordStartupPhase("create window");
+
+    const int exitCode = a.exec();
+
+    // Remember what was shown, so the next start can open at the same place.
+    Bach::WarmStartState newWarmStart;
+    newWarmStart.x = mapWidget->getViewportX();
+    newWarmStart.y = mapWidget->getViewportY();
+    newWarmStart.zoom = mapWidget->getViewportZoomLevel();
+    newWarmStart.tiles = Bach::orderWarmStartTiles(
+        mapWidget->calcVisibleTiles(),
+        newWarmStart.x,
+        newWarmStart.y,
+        tileLoader.getRecentVectorTiles(maxWarmStartTiles),
+        maxWarmStartTiles);
+    if (!Bach::writeWarmStartFile(warmStartPath, newWarmStart))
+        qWarning() << "Unable to write the warm start file to" << warmStartPath;
+
+    return exitCode;
 }
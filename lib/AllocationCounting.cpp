@@ -0,0 +1,185 @@
+// Copyright (c) 2024 Cecilia Norevik Bratlie, Nils Petter Skålerud, Eimen Oueslati
+// SPDX-License-Identifier: MIT
+
+// STL header files
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Other header files
+#include "AllocationCounting.h"
+
+namespace Bach::AllocationCounting {
+    /*!
+     * \internal
+     * \brief The AtomicCounts class holds the live counters of a phase.
+     *
+     * These are constant-initialized, so they can be used by operator new
+     * before any static constructors have run.
+     */
+    struct AtomicCounts {
+        std::atomic<quint64> allocations = 0;
+        std::atomic<quint64> bytes = 0;
+    };
+
+    static std::array<AtomicCounts, (int)Phase::Count> counts;
+
+    // The phase of each thread. A plain enum, so reading it never allocates.
+    static thread_local Phase threadPhase = Phase::Other;
+
+    static void countAllocation(std::size_t size)
+    {
+        AtomicCounts &phaseCounts = counts[(int)threadPhase];
+        phaseCounts.allocations.fetch_add(1, std::memory_order_relaxed);
+        phaseCounts.bytes.fetch_add(size, std::memory_order_relaxed);
+    }
+}
+
+namespace AllocationCounting = Bach::AllocationCounting;
+
+/*!
+ * \brief isCompiledIn
+ * \return Whether allocations are being counted in this build.
+ */
+bool AllocationCounting::isCompiledIn()
+{
+#if defined(BACH_ALLOCATION_COUNTING_ENABLED) && BACH_ALLOCATION_COUNTING_ENABLED
+    return true;
+#else
+    return false;
+#endif
+}
+
+/*!
+ * \brief phaseName
+ * \return The name of the phase, for use in reports.
+ */
+const char* AllocationCounting::phaseName(Phase phase)
+{
+    switch (phase) {
+    case Phase::Other:
+        return "other";
+    case Phase::Decode:
+        return "decode";
+    case Phase::Request:
+        return "request";
+    case Phase::Render:
+        return "render";
+    case Phase::Labels:
+        return "labels";
+    default:
+        return "unknown";
+    }
+}
+
+AllocationCounting::Phase AllocationCounting::currentPhase()
+{
+    return threadPhase;
+}
+
+void AllocationCounting::setCurrentPhase(Phase phase)
+{
+    threadPhase = phase;
+}
+
+/*!
+ * \brief getCounts reads the allocations counted for a phase since the last reset.
+ *
+ * \threadsafe
+ */
+AllocationCounting::Counts AllocationCounting::getCounts(Phase phase)
+{
+    Counts out;
+    const AtomicCounts &phaseCounts = counts[(int)phase];
+    out.allocations = phaseCounts.allocations.load(std::memory_order_relaxed);
+    out.bytes = phaseCounts.bytes.load(std::memory_order_relaxed);
+    return out;
+}
+
+/*!
+ * \brief reset sets the counts of every phase back to zero.
+ *
+ * \threadsafe
+ */
+void AllocationCounting::reset()
+{
+    for (AtomicCounts &phaseCounts : counts) {
+        phaseCounts.allocations.store(0, std::memory_order_relaxed);
+        phaseCounts.bytes.store(0, std::memory_order_relaxed);
+    }
+}
+
+#if defined(BACH_ALLOCATION_COUNTING_ENABLED) && BACH_ALLOCATION_COUNTING_ENABLED
+
+/*
+ * Replacements for the global operator new and operator delete.
+ *
+ * The aligned overloads are not replaced. They are rarely used by Qt or by us,
+ * and the default ones don't go through these functions, so they stay consistent.
+ */
+
+static void* countedAllocate(std::size_t size)
+{
+    AllocationCounting::countAllocation(size);
+    // malloc(0) is allowed to return null, but operator new must not.
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+void* operator new(std::size_t size)
+{
+    void *ptr = countedAllocate(size);
+    if (ptr == nullptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new[](std::size_t size)
+{
+    void *ptr = countedAllocate(size);
+    if (ptr == nullptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    return countedAllocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return countedAllocate(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, const std::nothrow_t&) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, const std::nothrow_t&) noexcept
+{
+    std::free(ptr);
+}
+
+#endif
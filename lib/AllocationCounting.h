@@ -0,0 +1,98 @@
+// Copyright (c) 2024 Cecilia Norevik Bratlie, Nils Petter Skålerud, Eimen Oueslati
+// SPDX-License-Identifier: MIT
+
+#ifndef ALLOCATIONCOUNTING_H
+#define ALLOCATIONCOUNTING_H
+
+// Qt header files
+#include <QtTypes>
+
+/*
+ * Counts heap allocations per phase of the library, for benchmark and test builds.
+ *
+ * When BACH_ALLOCATION_COUNTING_ENABLED is defined to 1, which is controlled by the
+ * BACH_ENABLE_ALLOCATION_COUNTING CMake option, the global operator new and operator delete
+ * are replaced by versions that count every allocation and its size. Each allocation is
+ * counted towards the phase of the allocating thread, set with BACH_ALLOCATION_PHASE.
+ *
+ * Only allocations done through operator new are counted. This includes QPainterPath,
+ * QMap and QVariant data, but not the buffers of QList and QString, which Qt allocates
+ * with malloc directly.
+ *
+ * When counting is compiled out, BACH_ALLOCATION_PHASE expands to nothing
+ * and all counts are zero.
+ */
+
+namespace Bach::AllocationCounting {
+    /*!
+     * \brief The Phase enum lists the phases allocations are counted towards.
+     */
+    enum class Phase : int {
+        // Anything outside of the other phases.
+        Other,
+        // Parsing vector tiles and decoding raster tiles.
+        Decode,
+        // Looking up tiles and queueing them for loading in the TileLoader.
+        Request,
+        // Painting tiles, excluding labels.
+        Render,
+        // Collecting, laying out, placing and painting labels.
+        Labels,
+        Count
+    };
+
+    /*!
+     * \brief The Counts class holds the allocations counted for a phase.
+     */
+    struct Counts {
+        quint64 allocations = 0;
+        quint64 bytes = 0;
+    };
+
+    bool isCompiledIn();
+    const char* phaseName(Phase phase);
+
+    Phase currentPhase();
+    void setCurrentPhase(Phase phase);
+
+    Counts getCounts(Phase phase);
+    void reset();
+
+    /*!
+     * \brief The ScopedPhase class sets the phase of the current thread
+     * until it is destroyed, then restores the previous phase.
+     *
+     * Should be created through the BACH_ALLOCATION_PHASE macro.
+     */
+    class ScopedPhase {
+    public:
+        explicit ScopedPhase(Phase phase) :
+            previous{ currentPhase() }
+        {
+            setCurrentPhase(phase);
+        }
+        ScopedPhase(const ScopedPhase&) = delete;
+        ScopedPhase& operator=(const ScopedPhase&) = delete;
+        ~ScopedPhase() { setCurrentPhase(previous); }
+
+    private:
+        Phase previous;
+    };
+}
+
+#define BACH_ALLOCATION_CONCAT_IMPL(a, b) a##b
+#define BACH_ALLOCATION_CONCAT(a, b) BACH_ALLOCATION_CONCAT_IMPL(a, b)
+
+#if defined(BACH_ALLOCATION_COUNTING_ENABLED) && BACH_ALLOCATION_COUNTING_ENABLED
+/*!
+ * \brief BACH_ALLOCATION_PHASE counts the allocations of the current thread towards
+ * \a phase until the end of the current scope.
+ */
+#define BACH_ALLOCATION_PHASE(phase) \
+    const Bach::AllocationCounting::ScopedPhase BACH_ALLOCATION_CONCAT(bachAllocationPhase_, __LINE__){ \
+        Bach::AllocationCounting::Phase::phase }
+#else
+#define BACH_ALLOCATION_PHASE(phase) do {} while (false)
+#endif
+
+#endif // ALLOCATIONCOUNTING_H
@@ -10,7 +10,7 @@
  */
 
 // This maps expression keywords to their corresponding functions.
-QMap<QString, QVariant(*)(const QJsonArray&, const AbstractLayerFeature*, int mapZoomLevel, float vpZoomLevel)> Evaluator::m_expressionMap;
+QMap<QString, QVariant(*)(const QJsonArray&, const AbstractLayerFeature*, double mapZoomLevel, float vpZoomLevel)> Evaluator::m_expressionMap;
 
 /*!
  * \brief Evaluator::resolveExpression
@@ -20,20 +20,25 @@ QMap<QString, QVariant(*)(const QJsonArray&, const AbstractLayerFeature*, int ma
  * \param expression The QJson array containing the expression to be resolved.
  * \param feature The feature on which expression operation will be performed (if aplicable)
  * \param mapZoomLevel The zoom level that will be used to resolve expressions that require a zoom parameter.
+ * Can be fractional, in which case "interpolate" expressions are interpolated continuously between the stops.
  * \param vpZoomLevel The viewport zoom level.
- * Currently not used for any expression (Can be used for smoother interpolation).
+ * Currently not used for any expression.
  *
  * \return a QVariant containing the result of the evaluation, or an invalid QVariant if the expression was invalid.
  */
 QVariant Evaluator::resolveExpression(
     const QJsonArray &expression,
     const AbstractLayerFeature* feature,
-    int mapZoomLevel,
+    double mapZoomLevel,
     float vpZoomLevel)
 {
-    // This will check only the first time the function is called after the program starts.
-    if (m_expressionMap.isEmpty())
-        setupExpressionMap();
+    // The map is set up the first time the function is called after the program starts.
+    // A function-local static is initialized exactly once, even when labels are resolved
+    // from several rendering threads at the same time.
+    static const bool expressionMapReady = (setupExpressionMap(), true);
+    Q_UNUSED(expressionMapReady);
+    // Only use const lookups from here on, the map is shared between threads.
+    const auto &expressionMap = m_expressionMap;
 
     // Check for valid expression.
     if (expression.empty())
@@ -44,16 +49,16 @@ QVariant Evaluator::resolveExpression(
 
     if (operation == "!=") {
         // This check is made since all operations can have an OPTIONAL "!" sign for negation except "!=" operation.
-        return m_expressionMap["!="](expression, feature, mapZoomLevel, vpZoomLevel);
+        return expressionMap.value("!=")(expression, feature, mapZoomLevel, vpZoomLevel);
     } else {
         if (operation.startsWith("!")) {
             // Check if the operation contains a negation sign.
-            if (m_expressionMap.contains(operation.sliced(1)))
+            if (expressionMap.contains(operation.sliced(1)))
                 // In case the expression is negated, remove the "!" sign to get the operation keyword.
-                return m_expressionMap[operation.sliced(1)](expression, feature, mapZoomLevel, vpZoomLevel);
+                return expressionMap.value(operation.sliced(1))(expression, feature, mapZoomLevel, vpZoomLevel);
         } else {
-            if (m_expressionMap.contains(operation))
-                return m_expressionMap[operation](expression, feature, mapZoomLevel, vpZoomLevel);
+            if (expressionMap.contains(operation))
+                return expressionMap.value(operation)(expression, feature, mapZoomLevel, vpZoomLevel);
         }
     }
     // Return an invalid QVariant in case the expression was invalid or not supported.
@@ -91,7 +96,7 @@ void Evaluator::setupExpressionMap()
  * \return a QVariant conatining the value of the feature's property or an invalid(NULL)
  * QVariant if the feature does not contain the specified property.
  */
-QVariant Evaluator::get(const QJsonArray & array, const AbstractLayerFeature *feature, int mapZoomLevel, float vpZoomLevel)
+QVariant Evaluator::get(const QJsonArray & array, const AbstractLayerFeature *feature, double mapZoomLevel, float vpZoomLevel)
 {
     QString property = array.at(1).toString();
     if(feature->featureMetaData.contains(property))
@@ -111,7 +116,7 @@ QVariant Evaluator::get(const QJsonArray & array, const AbstractLayerFeature *fe
  *
  * \return a QVariant containing True if the feature's metadata include the property, or False otherwise.
  */
-QVariant Evaluator::has(const QJsonArray &array, const AbstractLayerFeature *feature, int mapZoomLevel, float vpZoomLevel)
+QVariant Evaluator::has(const QJsonArray &array, const AbstractLayerFeature *feature, double mapZoomLevel, float vpZoomLevel)
 {
     QString property = array.at(1).toString();
     return feature->featureMetaData.contains(property);
@@ -128,7 +133,7 @@ QVariant Evaluator::has(const QJsonArray &array, const AbstractLayerFeature *fea
  *
  * \return  a QVariant containing true if the property is in the range of values or false otherwise.
  */
-QVariant Evaluator::in(const QJsonArray &array, const AbstractLayerFeature *feature, int mapZoomLevel, float vpZoomLevel)
+QVariant Evaluator::in(const QJsonArray &array, const AbstractLayerFeature *feature, double mapZoomLevel, float vpZoomLevel)
 {
     QString keyword = array.at(1).toString();
     if (feature->featureMetaData.contains(keyword)){
@@ -183,7 +188,7 @@ static QString getType(const AbstractLayerFeature *feature)
  * \param vpZoomLevel The viewport zoom level.
  * \return return a QVariant containing true if the two compared elements are true or false otherwise.
  */
-QVariant Evaluator::compare(const QJsonArray &array, const AbstractLayerFeature *feature, int mapZoomLevel, float vpZoomLevel)
+QVariant Evaluator::compare(const QJsonArray &array, const AbstractLayerFeature *feature, double mapZoomLevel, float vpZoomLevel)
 {
     QVariant operand1;
     QVariant operand2;
@@ -226,7 +231,7 @@ QVariant Evaluator::compare(const QJsonArray &array, const AbstractLayerFeature
  * \param vpZoomLevel
  * \return a QVariant containing the true if the first value is greated than the other one or false otherwise
  */
-QVariant Evaluator::greater(const QJsonArray &array, const AbstractLayerFeature *feature, int mapZoomLevel, float vpZoomLevel)
+QVariant Evaluator::greater(const QJsonArray &array, const AbstractLayerFeature *feature, double mapZoomLevel, float vpZoomLevel)
 {
     QVariant operand1;
     QVariant operand2;
@@ -263,7 +268,7 @@ QVariant Evaluator::greater(const QJsonArray &array, const AbstractLayerFeature
  * \param vpZoomLevel The viewport zoom level.
  * \return a QVariant containing true if all the inner expressions are true or returns false otehrwise
  */
-QVariant Evaluator::all(const QJsonArray &array, const AbstractLayerFeature *feature, int mapZoomLevel, float vpZoomLevel)
+QVariant Evaluator::all(const QJsonArray &array, const AbstractLayerFeature *feature, double mapZoomLevel, float vpZoomLevel)
 {
     // Loop over all the expressions and check that they evaluate to true.
     for (int i = 1; i <= array.size() - 1; i++){
@@ -286,7 +291,7 @@ QVariant Evaluator::all(const QJsonArray &array, const AbstractLayerFeature *fea
  * \param vpZoomLevel The viewport zoom level.
  * \return a QVariant containing the output for the input that evalueated to true, or the fallback value
  */
-QVariant Evaluator::case_(const QJsonArray &array, const AbstractLayerFeature *feature, int mapZoomLevel, float vpZoomLevel)
+QVariant Evaluator::case_(const QJsonArray &array, const AbstractLayerFeature *feature, double mapZoomLevel, float vpZoomLevel)
 {
     // Loop over the array elements from 1 to n - 1
     // (element 0 contains the operation keyword and element n contains the fallback value)
@@ -314,7 +319,7 @@ QVariant Evaluator::case_(const QJsonArray &array, const AbstractLayerFeature *f
  * \param vpZoomLevel The viewport zoom level.
  * \return a QVariant containing the value of the first non-null expression, or an invalid QVariant if non exist.
  */
-QVariant Evaluator::coalesce(const QJsonArray &array, const AbstractLayerFeature *feature, int mapZoomLevel, float vpZoomLevel)
+QVariant Evaluator::coalesce(const QJsonArray &array, const AbstractLayerFeature *feature, double mapZoomLevel, float vpZoomLevel)
 {
     // Loop over the expression array and return the first valid QVariant.
     for(int i = 1; i <= array.size() - 1; i++){
@@ -332,7 +337,7 @@ QVariant Evaluator::coalesce(const QJsonArray &array, const AbstractLayerFeature
  * \return a QVariant containing the value of the output whos label matches the input,
  * or the fallback value if not labels match.
  */
-QVariant Evaluator::match(const QJsonArray &array, const AbstractLayerFeature *feature, int mapZoomLevel, float vpZoomLevel)
+QVariant Evaluator::match(const QJsonArray &array, const AbstractLayerFeature *feature, double mapZoomLevel, float vpZoomLevel)
 {
     // Extract the label to be used for the checks.
     QJsonArray expression = array.at(1).toArray();
@@ -366,11 +371,11 @@ QVariant Evaluator::match(const QJsonArray &array, const AbstractLayerFeature *f
  *
  * \param stop1 a QPair containing the x and y for the first stop point.
  * \param stop2 a QPair containing the x and y for the second stop point.
- * \param currentZoom an int containing the value to be used in the interpolation.
+ * \param currentZoom the value to be used in the interpolation. Can be fractional.
  *
  * \return a float containing the result of the interpolation.
  */
-static float lerp(QPair<float, float> stop1, QPair<float, float> stop2, int currentZoom)
+static float lerp(QPair<float, float> stop1, QPair<float, float> stop2, double currentZoom)
 {
     float lerpedValue = stop1.second + (currentZoom - stop1.first)*(stop2.second - stop1.second)/(stop2.first - stop1.first);
     return lerpedValue;
@@ -390,7 +395,7 @@ static float lerp(QPair<float, float> stop1, QPair<float, float> stop2, int curr
 QVariant Evaluator::interpolate(
     const QJsonArray &array,
     const AbstractLayerFeature *feature,
-    int mapZoomLevel,
+    double mapZoomLevel,
     float vpZoomLevel)
 {
     // Loop over the values array starting at index 3 and find the two pairs that the value falls between.
@@ -435,11 +440,34 @@ QVariant Evaluator::interpolate(
     }
 }
 
+/*!
+ * \brief Evaluator::isZoomOnly
+ * Checks if an expression only depends on the zoom level, and not on the data of the feature.
+ *
+ * Such expressions give the same result for every feature, so they only need to be resolved
+ * once per zoom level. The check is conservative, only "interpolate" expressions over
+ * ["zoom"] whose outputs are numbers or zoom-only expressions are accepted.
+ *
+ * \param expression The QJson array containing the expression.
+ *
+ * \return true if the expression can be resolved without a feature.
+ */
+bool Evaluator::isZoomOnly(const QJsonArray &expression)
+{
+    if (expression.size() < 5 || expression.at(0).toString() != "interpolate")
+        return false;
+    if (expression.at(2).toArray() != QJsonArray{ "zoom" })
+        return false;
 
-
-
-
-
-
-
-
+    // The stops start at index 3, as pairs of input and output.
+    for (int i = 4; i < expression.size(); i += 2) {
+        const QJsonValue output = expression.at(i);
+        if (output.isArray()) {
+            if (!isZoomOnly(output.toArray()))
+                return false;
+        } else if (!output.isDouble()) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -18,21 +18,22 @@ class Evaluator
 {
 private:
     static void setupExpressionMap();
-    static QMap<QString, QVariant(*)(const QJsonArray&, const AbstractLayerFeature*, int mapZoomLevel, float vpZoomeLevel)> m_expressionMap;
-    static QVariant all(const QJsonArray& array, const AbstractLayerFeature* feature, int mapZoomLevel, float vpZoomeLevel);
-    static QVariant case_(const QJsonArray& array, const AbstractLayerFeature* feature, int mapZoomLevel, float vpZoomeLevel);
-    static QVariant coalesce(const QJsonArray& array, const AbstractLayerFeature* feature, int mapZoomLevel, float vpZoomeLevel);
-    static QVariant compare(const QJsonArray& array, const AbstractLayerFeature* feature, int mapZoomLevel, float vpZoomeLevel);
-    static QVariant get(const QJsonArray& array, const AbstractLayerFeature* feature, int mapZoomLevel, float vpZoomeLevel);
-    static QVariant greater(const QJsonArray& array, const AbstractLayerFeature* feature, int mapZoomLevel, float vpZoomeLevel);
-    static QVariant has(const QJsonArray& array, const AbstractLayerFeature* feature, int mapZoomLevel, float vpZoomeLevel);
-    static QVariant in(const QJsonArray& array, const AbstractLayerFeature* feature, int mapZoomLevel, float vpZoomeLevel);
-    static QVariant interpolate(const QJsonArray& array, const AbstractLayerFeature* feature, int mapZoomLevel, float vpZoomeLevel);
-    static QVariant match(const QJsonArray& array, const AbstractLayerFeature* feature, int mapZoomLevel, float vpZoomeLevel);
+    static QMap<QString, QVariant(*)(const QJsonArray&, const AbstractLayerFeature*, double mapZoomLevel, float vpZoomeLevel)> m_expressionMap;
+    static QVariant all(const QJsonArray& array, const AbstractLayerFeature* feature, double mapZoomLevel, float vpZoomeLevel);
+    static QVariant case_(const QJsonArray& array, const AbstractLayerFeature* feature, double mapZoomLevel, float vpZoomeLevel);
+    static QVariant coalesce(const QJsonArray& array, const AbstractLayerFeature* feature, double mapZoomLevel, float vpZoomeLevel);
+    static QVariant compare(const QJsonArray& array, const AbstractLayerFeature* feature, double mapZoomLevel, float vpZoomeLevel);
+    static QVariant get(const QJsonArray& array, const AbstractLayerFeature* feature, double mapZoomLevel, float vpZoomeLevel);
+    static QVariant greater(const QJsonArray& array, const AbstractLayerFeature* feature, double mapZoomLevel, float vpZoomeLevel);
+    static QVariant has(const QJsonArray& array, const AbstractLayerFeature* feature, double mapZoomLevel, float vpZoomeLevel);
+    static QVariant in(const QJsonArray& array, const AbstractLayerFeature* feature, double mapZoomLevel, float vpZoomeLevel);
+    static QVariant interpolate(const QJsonArray& array, const AbstractLayerFeature* feature, double mapZoomLevel, float vpZoomeLevel);
+    static QVariant match(const QJsonArray& array, const AbstractLayerFeature* feature, double mapZoomLevel, float vpZoomeLevel);
 
 public:
     Evaluator(){};
-    static QVariant resolveExpression(const QJsonArray& expression, const AbstractLayerFeature* feature, int mapZoomLevel, float vpZoomeLevel);
+    static QVariant resolveExpression(const QJsonArray& expression, const AbstractLayerFeature* feature, double mapZoomLevel, float vpZoomeLevel);
+    static bool isZoomOnly(const QJsonArray& expression);
 };
 
 #endif // EVALUATOR_H
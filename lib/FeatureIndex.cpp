@@ -0,0 +1,369 @@
+// Copyright (c) 2024 Cecilia Norevik Bratlie, Nils Petter Skålerud, Eimen Oueslati
+// SPDX-License-Identifier: MIT
+
+// Qt header files
+#include <QPainterPath>
+#include <QtMath>
+
+// STL header files
+#include <algorithm>
+#include <limits>
+
+// Other header files
+#include "FeatureIndex.h"
+#include "Tracing.h"
+
+/*!
+ * \internal
+ * \brief calcPathBounds calculates the bounding box of a path.
+ *
+ * The bounding box is calculated by reading the elements of the path directly,
+ * because the cached bounds of a QPainterPath are not safe to compute while
+ * other threads are reading the same path.
+ */
+static std::optional<QRectF> calcPathBounds(const QPainterPath &path)
+{
+    if (path.elementCount() == 0)
+        return std::nullopt;
+
+    QPainterPath::Element first = path.elementAt(0);
+    double minX = first.x;
+    double maxX = first.x;
+    double minY = first.y;
+    double maxY = first.y;
+    for (int i = 1; i < path.elementCount(); i++) {
+        QPainterPath::Element element = path.elementAt(i);
+        minX = qMin(minX, element.x);
+        maxX = qMax(maxX, element.x);
+        minY = qMin(minY, element.y);
+        maxY = qMax(maxY, element.y);
+    }
+    return QRectF{ QPointF{ minX, minY }, QPointF{ maxX, maxY } };
+}
+
+/*!
+ * \brief Bach::calcFeatureBounds calculates the bounding box of a feature's geometry.
+ *
+ * \param feature The feature to measure.
+ * \return The bounding box in tile coordinates, or nothing for features without geometry.
+ */
+std::optional<QRectF> Bach::calcFeatureBounds(const AbstractLayerFeature &feature)
+{
+    switch (feature.type()) {
+    case AbstractLayerFeature::featureType::polygon:
+        return calcPathBounds(static_cast<const PolygonFeature&>(feature).polygon());
+    case AbstractLayerFeature::featureType::line:
+        return calcPathBounds(static_cast<const LineFeature&>(feature).line());
+    case AbstractLayerFeature::featureType::point: {
+        const QList<QPoint> points = static_cast<const PointFeature&>(feature).points();
+        if (points.isEmpty())
+            return std::nullopt;
+        QRectF out{ points.first(), points.first() };
+        for (QPoint point : points) {
+            out.setLeft(qMin(out.left(), (qreal)point.x()));
+            out.setRight(qMax(out.right(), (qreal)point.x()));
+            out.setTop(qMin(out.top(), (qreal)point.y()));
+            out.setBottom(qMax(out.bottom(), (qreal)point.y()));
+        }
+        return out;
+    }
+    case AbstractLayerFeature::featureType::unknown:
+        break;
+    }
+    return std::nullopt;
+}
+
+/*!
+ * \internal
+ * \brief distanceToSegment
+ * \return The distance from the point to the line segment between a and b.
+ */
+static double distanceToSegment(QPointF point, QPointF a, QPointF b)
+{
+    const QPointF ab = b - a;
+    const double lengthSquared = QPointF::dotProduct(ab, ab);
+    double t = 0;
+    if (lengthSquared > 0)
+        t = std::clamp(QPointF::dotProduct(point - a, ab) / lengthSquared, 0.0, 1.0);
+    const QPointF closest = a + t * ab;
+    return qHypot(point.x() - closest.x(), point.y() - closest.y());
+}
+
+/*!
+ * \internal
+ * \brief calcPathDistance calculates the distance from a point to the outline of a path.
+ *
+ * \param closeSubpaths If true, every subpath is treated as a closed ring,
+ * and a point inside the path using the odd-even rule has a distance of zero.
+ */
+static double calcPathDistance(const QPainterPath &path, QPointF point, bool closeSubpaths)
+{
+    double minDistance = std::numeric_limits<double>::infinity();
+    bool inside = false;
+
+    auto visitSegment = [&](QPointF a, QPointF b) {
+        minDistance = qMin(minDistance, distanceToSegment(point, a, b));
+        // Count the crossings of a ray going to the right of the point.
+        if (closeSubpaths && (a.y() > point.y()) != (b.y() > point.y())) {
+            const double crossingX = a.x() + (point.y() - a.y()) * (b.x() - a.x()) / (b.y() - a.y());
+            if (point.x() < crossingX)
+                inside = !inside;
+        }
+    };
+
+    QPointF subpathStart;
+    QPointF previous;
+    for (int i = 0; i < path.elementCount(); i++) {
+        QPainterPath::Element element = path.elementAt(i);
+        const QPointF current = element;
+        if (element.isMoveTo()) {
+            if (closeSubpaths && i > 0 && previous != subpathStart)
+                visitSegment(previous, subpathStart);
+            subpathStart = current;
+        } else {
+            visitSegment(previous, current);
+        }
+        previous = current;
+    }
+    if (closeSubpaths && path.elementCount() > 0 && previous != subpathStart)
+        visitSegment(previous, subpathStart);
+
+    return inside ? 0 : minDistance;
+}
+
+/*!
+ * \brief Bach::calcFeatureDistance calculates how far a point is from a feature's geometry.
+ *
+ * \param feature The feature to measure against.
+ * \param point The point, in tile coordinates.
+ * \return The distance in tile coordinates. Zero if the point is inside a polygon,
+ * and infinity for features without geometry.
+ */
+double Bach::calcFeatureDistance(const AbstractLayerFeature &feature, QPointF point)
+{
+    switch (feature.type()) {
+    case AbstractLayerFeature::featureType::polygon:
+        return calcPathDistance(static_cast<const PolygonFeature&>(feature).polygon(), point, true);
+    case AbstractLayerFeature::featureType::line:
+        return calcPathDistance(static_cast<const LineFeature&>(feature).line(), point, false);
+    case AbstractLayerFeature::featureType::point: {
+        double minDistance = std::numeric_limits<double>::infinity();
+        for (QPoint featurePoint : static_cast<const PointFeature&>(feature).points())
+            minDistance = qMin(minDistance, qHypot(point.x() - featurePoint.x(), point.y() - featurePoint.y()));
+        return minDistance;
+    }
+    case AbstractLayerFeature::featureType::unknown:
+        break;
+    }
+    return std::numeric_limits<double>::infinity();
+}
+
+/*!
+ * \internal
+ * \brief segmentsIntersect
+ * \return True if the line segment between a1 and a2 crosses or touches
+ * the line segment between b1 and b2.
+ */
+static bool segmentsIntersect(QPointF a1, QPointF a2, QPointF b1, QPointF b2)
+{
+    auto cross = [](QPointF o, QPointF a, QPointF b) {
+        return (a.x() - o.x()) * (b.y() - o.y()) - (a.y() - o.y()) * (b.x() - o.x());
+    };
+    auto onSegment = [](QPointF a, QPointF b, QPointF p) {
+        return
+            qMin(a.x(), b.x()) <= p.x() && p.x() <= qMax(a.x(), b.x()) &&
+            qMin(a.y(), b.y()) <= p.y() && p.y() <= qMax(a.y(), b.y());
+    };
+
+    const double d1 = cross(b1, b2, a1);
+    const double d2 = cross(b1, b2, a2);
+    const double d3 = cross(a1, a2, b1);
+    const double d4 = cross(a1, a2, b2);
+    if (((d1 > 0 && d2 < 0) || (d1 < 0 && d2 > 0)) && ((d3 > 0 && d4 < 0) || (d3 < 0 && d4 > 0)))
+        return true;
+    return
+        (d1 == 0 && onSegment(b1, b2, a1)) ||
+        (d2 == 0 && onSegment(b1, b2, a2)) ||
+        (d3 == 0 && onSegment(a1, a2, b1)) ||
+        (d4 == 0 && onSegment(a1, a2, b2));
+}
+
+/*!
+ * \internal
+ * \brief pathIntersectsPolygon
+ * \return True if any vertex of the path is inside the polygon,
+ * or any segment of the path crosses the outline of the polygon.
+ */
+static bool pathIntersectsPolygon(const QPainterPath &path, const QPolygonF &polygon, bool closeSubpaths)
+{
+    auto segmentCrossesPolygon = [&](QPointF a, QPointF b) {
+        for (int i = 0; i < polygon.size(); i++) {
+            if (segmentsIntersect(a, b, polygon[i], polygon[(i + 1) % polygon.size()]))
+                return true;
+        }
+        return false;
+    };
+
+    QPointF subpathStart;
+    QPointF previous;
+    for (int i = 0; i < path.elementCount(); i++) {
+        QPainterPath::Element element = path.elementAt(i);
+        const QPointF current = element;
+        if (polygon.containsPoint(current, Qt::OddEvenFill))
+            return true;
+        if (element.isMoveTo()) {
+            if (closeSubpaths && i > 0 && segmentCrossesPolygon(previous, subpathStart))
+                return true;
+            subpathStart = current;
+        } else if (segmentCrossesPolygon(previous, current)) {
+            return true;
+        }
+        previous = current;
+    }
+    return closeSubpaths && path.elementCount() > 0 && segmentCrossesPolygon(previous, subpathStart);
+}
+
+/*!
+ * \brief Bach::featureIntersectsPolygon determines if a feature's geometry overlaps a polygon.
+ *
+ * \param feature The feature to test.
+ * \param polygon The polygon, in tile coordinates. Uses the odd-even rule.
+ * \return True if any part of the feature is inside the polygon, or the polygon
+ * is inside a polygon feature.
+ */
+bool Bach::featureIntersectsPolygon(const AbstractLayerFeature &feature, const QPolygonF &polygon)
+{
+    if (polygon.isEmpty())
+        return false;
+
+    switch (feature.type()) {
+    case AbstractLayerFeature::featureType::polygon:
+        return
+            pathIntersectsPolygon(static_cast<const PolygonFeature&>(feature).polygon(), polygon, true) ||
+            calcFeatureDistance(feature, polygon.first()) == 0;
+    case AbstractLayerFeature::featureType::line:
+        return pathIntersectsPolygon(static_cast<const LineFeature&>(feature).line(), polygon, false);
+    case AbstractLayerFeature::featureType::point:
+        for (QPoint point : static_cast<const PointFeature&>(feature).points()) {
+            if (polygon.containsPoint(point, Qt::OddEvenFill))
+                return true;
+        }
+        return false;
+    case AbstractLayerFeature::featureType::unknown:
+        break;
+    }
+    return false;
+}
+
+/*!
+ * \internal
+ * \brief Bach::TileFeatureIndex::calcCellRange
+ * \return The range of grid cells that the rectangle overlaps. Parts of the rectangle
+ * outside the tile are clamped to the cells along the edge.
+ */
+Bach::TileFeatureIndex::CellRange Bach::TileFeatureIndex::calcCellRange(const QRectF &rect)
+{
+    const double cellSize = extent / gridSize;
+    auto toCell = [&](double value) {
+        return std::clamp((int)qFloor(value / cellSize), 0, gridSize - 1);
+    };
+    return {
+        toCell(rect.left()),
+        toCell(rect.top()),
+        toCell(rect.right()),
+        toCell(rect.bottom()) };
+}
+
+/*!
+ * \brief Bach::TileFeatureIndex::build builds the spatial index of a tile.
+ *
+ * Features without geometry are left out.
+ *
+ * \param tile The tile to index. Must outlive the index.
+ * \return The index.
+ */
+Bach::TileFeatureIndex Bach::TileFeatureIndex::build(const VectorTile &tile)
+{
+    BACH_TRACE_SCOPE("FeatureIndex::build");
+    TileFeatureIndex out;
+
+    for (const auto &[layerName, layer] : tile.m_layers) {
+        for (const std::unique_ptr<AbstractLayerFeature> &feature : layer->m_features) {
+            const std::optional<QRectF> bounds = calcFeatureBounds(*feature);
+            if (!bounds.has_value())
+                continue;
+            out.entries.push_back({ layer.get(), feature.get(), bounds.value() });
+        }
+    }
+
+    // The cells are packed into a single array. We first count the entries
+    // of each cell, then place them.
+    const int cellCount = gridSize * gridSize;
+    out.cellStarts.assign(cellCount + 1, 0);
+    for (const FeatureIndexEntry &entry : out.entries) {
+        const CellRange range = calcCellRange(entry.bounds);
+        for (int cellY = range.minY; cellY <= range.maxY; cellY++) {
+            for (int cellX = range.minX; cellX <= range.maxX; cellX++)
+                out.cellStarts[cellY * gridSize + cellX + 1]++;
+        }
+    }
+    for (int i = 0; i < cellCount; i++)
+        out.cellStarts[i + 1] += out.cellStarts[i];
+
+    out.cellEntries.resize(out.cellStarts[cellCount]);
+    std::vector<int> cellFill { out.cellStarts.begin(), out.cellStarts.end() - 1 };
+    for (int entryIndex = 0; entryIndex < (int)out.entries.size(); entryIndex++) {
+        const CellRange range = calcCellRange(out.entries[entryIndex].bounds);
+        for (int cellY = range.minY; cellY <= range.maxY; cellY++) {
+            for (int cellX = range.minX; cellX <= range.maxX; cellX++)
+                out.cellEntries[cellFill[cellY * gridSize + cellX]++] = entryIndex;
+        }
+    }
+
+    return out;
+}
+
+/*!
+ * \brief Bach::TileFeatureIndex::query finds the features whose bounding box
+ * overlaps a rectangle.
+ *
+ * Each feature is reported once, even if it is stored in several cells.
+ * Only the bounding boxes are compared, so the geometry itself might not overlap.
+ *
+ * \param rect The rectangle to search, in tile coordinates.
+ * \param fn Called for every feature found.
+ */
+void Bach::TileFeatureIndex::query(
+    const QRectF &rect,
+    const std::function<void(const FeatureIndexEntry&)> &fn) const
+{
+    if (entries.empty())
+        return;
+
+    const CellRange queryRange = calcCellRange(rect);
+    for (int cellY = queryRange.minY; cellY <= queryRange.maxY; cellY++) {
+        for (int cellX = queryRange.minX; cellX <= queryRange.maxX; cellX++) {
+            const int cell = cellY * gridSize + cellX;
+            for (int i = cellStarts[cell]; i < cellStarts[cell + 1]; i++) {
+                const FeatureIndexEntry &entry = entries[cellEntries[i]];
+
+                // An entry stored in several cells is only reported from the first cell
+                // that both the entry and the query overlap.
+                const CellRange entryRange = calcCellRange(entry.bounds);
+                const int firstCellX = qMax(entryRange.minX, queryRange.minX);
+                const int firstCellY = qMax(entryRange.minY, queryRange.minY);
+                if (firstCellX != cellX || firstCellY != cellY)
+                    continue;
+
+                // Compared by hand, since QRectF does not count empty rectangles as overlapping.
+                const bool overlaps =
+                    entry.bounds.left() <= rect.right() &&
+                    entry.bounds.right() >= rect.left() &&
+                    entry.bounds.top() <= rect.bottom() &&
+                    entry.bounds.bottom() >= rect.top();
+                if (overlaps)
+                    fn(entry);
+            }
+        }
+    }
+}
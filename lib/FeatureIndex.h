@@ -0,0 +1,77 @@
+// Copyright (c) 2024 Cecilia Norevik Bratlie, Nils Petter Skålerud, Eimen Oueslati
+// SPDX-License-Identifier: MIT
+
+#ifndef FEATUREINDEX_H
+#define FEATUREINDEX_H
+
+// Qt header files
+#include <QPointF>
+#include <QPolygonF>
+#include <QRectF>
+
+// STL header files
+#include <functional>
+#include <optional>
+#include <vector>
+
+// Other header files
+#include "VectorTiles.h"
+
+namespace Bach {
+    /*!
+     * \brief The FeatureIndexEntry class holds a single feature of a tile
+     * together with the bounding box of its geometry.
+     */
+    struct FeatureIndexEntry {
+        const TileLayer *layer = nullptr;
+        const AbstractLayerFeature *feature = nullptr;
+        // Bounding box of the geometry, in tile coordinates.
+        QRectF bounds;
+    };
+
+    /*!
+     * \class
+     * \brief The TileFeatureIndex class is a spatial index over the features of a single tile.
+     *
+     * The tile is split into a uniform grid, and every feature is stored in the cells its
+     * bounding box overlaps. Geometry outside the tile is stored in the cells along the edge.
+     *
+     * Coordinates are in the 4096 extent of the tile, the same as the renderer uses.
+     * The index points into the tile it was built from, and is only valid as long as that tile is.
+     */
+    class TileFeatureIndex {
+    public:
+        // Size of the tile coordinate space the renderer draws geometry in.
+        static constexpr double extent = 4096.0;
+        // Number of grid cells along each side of the tile.
+        static constexpr int gridSize = 16;
+
+        static TileFeatureIndex build(const VectorTile &tile);
+
+        void query(
+            const QRectF &rect,
+            const std::function<void(const FeatureIndexEntry&)> &fn) const;
+
+        qsizetype entryCount() const { return (qsizetype)entries.size(); }
+
+    private:
+        struct CellRange {
+            int minX = 0;
+            int minY = 0;
+            int maxX = 0;
+            int maxY = 0;
+        };
+        static CellRange calcCellRange(const QRectF &rect);
+
+        std::vector<FeatureIndexEntry> entries;
+        // The entries of cell i are cellEntries[cellStarts[i]] to cellEntries[cellStarts[i + 1]].
+        std::vector<int> cellStarts;
+        std::vector<int> cellEntries;
+    };
+
+    std::optional<QRectF> calcFeatureBounds(const AbstractLayerFeature &feature);
+    double calcFeatureDistance(const AbstractLayerFeature &feature, QPointF point);
+    bool featureIntersectsPolygon(const AbstractLayerFeature &feature, const QPolygonF &polygon);
+}
+
+#endif // FEATUREINDEX_H
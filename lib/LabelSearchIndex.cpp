@@ -0,0 +1,449 @@
+// Copyright (c) 2024 Cecilia Norevik Bratlie, Nils Petter Skålerud, Eimen Oueslati
+// SPDX-License-Identifier: MIT
+
+// Qt header files
+#include <QHash>
+#include <QMutexLocker>
+#include <QtMath>
+
+// STL header files
+#include <algorithm>
+
+// Other header files
+#include "FeatureIndex.h"
+#include "LabelSearchIndex.h"
+#include "Rendering.h"
+#include "Tracing.h"
+
+using Bach::LabelSearchIndex;
+using Bach::LabelSearchResult;
+using Bach::TileLabels;
+
+// Largest number of edits the fuzzy lookup accepts.
+static constexpr int maxFuzzyEdits = 3;
+
+/*!
+ * \brief LabelSearchIndex::normalizeName turns a name into the form it is compared in.
+ *
+ * The name is case folded, accents are removed and repeated whitespace is collapsed.
+ * Letters that are not written with an accent, like 'ø', are kept as they are.
+ *
+ * \param name The name to normalize.
+ * \return The normalized name.
+ */
+QString LabelSearchIndex::normalizeName(const QString &name)
+{
+    const QString decomposed = name.normalized(QString::NormalizationForm_KD);
+    QString out;
+    out.reserve(decomposed.size());
+    for (QChar c : decomposed) {
+        if (!c.isMark())
+            out.append(c);
+    }
+    return out.toCaseFolded().simplified();
+}
+
+/*!
+ * \brief LabelSearchIndex::collectLabels finds the names of all the features in a tile.
+ *
+ * Every attribute whose key starts with "name" is collected. Features with the same
+ * name in the same layer, like the pieces of a road, become a single label
+ * that covers all of them.
+ *
+ * \param tile The tile to read.
+ * \return The labels of the tile.
+ */
+TileLabels LabelSearchIndex::collectLabels(const VectorTile &tile)
+{
+    BACH_TRACE_SCOPE("LabelSearchIndex::collectLabels");
+    TileLabels out;
+    // Index into out.labels of each normalized name and layer.
+    QHash<QPair<QString, QString>, int> labelIndices;
+
+    for (const auto &[layerName, layer] : tile.m_layers) {
+        for (const auto &feature : layer->m_features) {
+            if (feature->featureMetaData.isEmpty())
+                continue;
+
+            std::optional<QRectF> bounds;
+            for (auto it = feature->featureMetaData.cbegin(); it != feature->featureMetaData.cend(); it++) {
+                if (!it.key().startsWith("name"))
+                    continue;
+                const QString name = it.value().toString();
+                const QString key = normalizeName(name);
+                if (key.isEmpty())
+                    continue;
+
+                // Only measure the geometry of features that have a name.
+                if (!bounds.has_value()) {
+                    bounds = Bach::calcFeatureBounds(*feature);
+                    if (!bounds.has_value())
+                        break;
+                }
+
+                const QPair<QString, QString> labelKey{ key, layerName };
+                auto indexIt = labelIndices.find(labelKey);
+                if (indexIt == labelIndices.end()) {
+                    labelIndices.insert(labelKey, out.labels.size());
+                    out.labels.push_back({ key, name, layerName, bounds.value() });
+                } else {
+                    TileLabels::Label &label = out.labels[indexIt.value()];
+                    label.bounds = label.bounds.united(bounds.value());
+                }
+            }
+        }
+    }
+    return out;
+}
+
+/*!
+ * \brief LabelSearchIndex::insertTile adds the labels of a tile to the index.
+ *
+ * A tile that is already in the index is replaced.
+ *
+ * \param coord The coordinate of the tile.
+ * \param labels The labels of the tile, from collectLabels.
+ */
+void LabelSearchIndex::insertTile(TileCoord coord, TileLabels &&labels)
+{
+    QMutexLocker locker(lock.get());
+    removeTileWithoutLock(coord);
+
+    QVector<QString> &keys = tileKeys[coord];
+    keys.reserve(labels.labels.size());
+    for (TileLabels::Label &label : labels.labels) {
+        names[label.key].push_back({
+            coord,
+            std::move(label.name),
+            std::move(label.sourceLayer),
+            label.bounds });
+        keys.push_back(std::move(label.key));
+    }
+}
+
+/*!
+ * \brief LabelSearchIndex::removeTile removes all the labels of a tile from the index.
+ *
+ * Does nothing if the tile is not in the index.
+ *
+ * \param coord The coordinate of the tile.
+ */
+void LabelSearchIndex::removeTile(TileCoord coord)
+{
+    QMutexLocker locker(lock.get());
+    removeTileWithoutLock(coord);
+}
+
+/*!
+ * \internal
+ * \brief LabelSearchIndex::removeTileWithoutLock removes the labels of a tile.
+ *
+ * The lock must be held.
+ */
+void LabelSearchIndex::removeTileWithoutLock(TileCoord coord)
+{
+    auto tileIt = tileKeys.find(coord);
+    if (tileIt == tileKeys.end())
+        return;
+
+    for (const QString &key : tileIt->second) {
+        auto nameIt = names.find(key);
+        if (nameIt == names.end())
+            continue;
+        QVector<Occurrence> &occurrences = nameIt->second;
+        occurrences.removeIf([&](const Occurrence &occurrence) {
+            return occurrence.tileCoord == coord;
+        });
+        if (occurrences.isEmpty())
+            names.erase(nameIt);
+    }
+    tileKeys.erase(tileIt);
+}
+
+/*!
+ * \brief LabelSearchIndex::clear removes all tiles from the index.
+ */
+void LabelSearchIndex::clear()
+{
+    QMutexLocker locker(lock.get());
+    names.clear();
+    tileKeys.clear();
+}
+
+/*!
+ * \brief LabelSearchIndex::nameCount returns the number of distinct normalized names in the index.
+ */
+qsizetype LabelSearchIndex::nameCount() const
+{
+    QMutexLocker locker(lock.get());
+    return (qsizetype)names.size();
+}
+
+/*!
+ * \brief LabelSearchIndex::tileCount returns the number of tiles in the index.
+ */
+qsizetype LabelSearchIndex::tileCount() const
+{
+    QMutexLocker locker(lock.get());
+    return (qsizetype)tileKeys.size();
+}
+
+/*!
+ * \brief LabelSearchIndex::findPrefix finds the places whose name starts with the query.
+ *
+ * \param query The start of the name. Compared in its normalized form.
+ * \param maxResults The largest number of results to return.
+ * \return The places, exact matches and shorter names first.
+ */
+QVector<LabelSearchResult> LabelSearchIndex::findPrefix(const QString &query, int maxResults) const
+{
+    BACH_TRACE_SCOPE("LabelSearchIndex::findPrefix");
+    const QString normalizedQuery = normalizeName(query);
+    if (normalizedQuery.isEmpty() || maxResults <= 0)
+        return {};
+
+    QMutexLocker locker(lock.get());
+    QVector<Candidate> candidates;
+    // The names are sorted, so all the names with this prefix follow each other.
+    for (auto it = names.lower_bound(normalizedQuery); it != names.end(); it++) {
+        if (!it->first.startsWith(normalizedQuery))
+            break;
+        candidates.push_back({ &it->first, 0 });
+    }
+    return createResults(candidates, normalizedQuery, maxResults);
+}
+
+/*!
+ * \internal
+ * \brief LabelSearchIndex::collectFuzzyCandidates finds the names that start with something
+ * at most maxEdits edits away from the query.
+ *
+ * The sorted names are walked like a trie. Names that share their first letters share
+ * the rows of the edit distance table for those letters, and once a row is above the
+ * limit, every name that starts with those letters is skipped at once.
+ *
+ * The lock must be held.
+ *
+ * \param query The normalized query, at most maxFuzzyQueryLength letters.
+ * \param maxEdits The largest number of edits allowed.
+ * \param candidatesOut The matching names are added to this list.
+ */
+void LabelSearchIndex::collectFuzzyCandidates(const QString &query, int maxEdits, QVector<Candidate> &candidatesOut) const
+{
+    const int queryLength = query.size();
+    // Letters of a name past this point can not bring the distance below the limit.
+    const int maxNameLength = queryLength + maxEdits;
+    const int rowSize = queryLength + 1;
+
+    // Row m holds the edit distances between each start of the query and the first m letters
+    // of the name. The columns are the letters of the query.
+    QVector<int> rows((maxNameLength + 1) * rowSize);
+    // The distance of the best start of the name among its first m letters.
+    QVector<int> bestDistances(maxNameLength + 1);
+    for (int i = 0; i <= queryLength; i++)
+        rows[i] = i;
+    bestDistances[0] = queryLength;
+
+    // The name the rows were last filled in for, and how many of its letters they cover.
+    const QString *rowsKey = nullptr;
+    int rowsLength = 0;
+
+    auto it = names.begin();
+    while (it != names.end()) {
+        const QString &key = it->first;
+        const int keyLength = qMin((int)key.size(), maxNameLength);
+
+        // Reuse the rows of the letters this name shares with the previous one.
+        int length = 0;
+        if (rowsKey != nullptr) {
+            const int sharedLength = qMin(rowsLength, keyLength);
+            while (length < sharedLength && (*rowsKey)[length] == key[length])
+                length++;
+        }
+
+        bool skipPrefix = false;
+        while (length < keyLength) {
+            const int *previous = rows.constData() + length * rowSize;
+            int *current = rows.data() + (length + 1) * rowSize;
+            const QChar nameChar = key[length];
+            current[0] = length + 1;
+            int rowMin = current[0];
+            for (int i = 1; i <= queryLength; i++) {
+                const int substitution = previous[i - 1] + (query[i - 1] == nameChar ? 0 : 1);
+                current[i] = qMin(substitution, qMin(previous[i], current[i - 1]) + 1);
+                rowMin = qMin(rowMin, current[i]);
+            }
+            length++;
+            bestDistances[length] = qMin(bestDistances[length - 1], current[queryLength]);
+
+            // The distance never goes down from one row to the next, so longer names
+            // starting with these letters can only match through a shorter start.
+            if (rowMin > maxEdits) {
+                skipPrefix = bestDistances[length] > maxEdits;
+                break;
+            }
+        }
+        rowsKey = &key;
+        rowsLength = length;
+
+        if (!skipPrefix) {
+            if (bestDistances[length] <= maxEdits)
+                candidatesOut.push_back({ &key, bestDistances[length] });
+            it++;
+            continue;
+        }
+
+        // None of the names that start with these letters can match,
+        // so we jump past all of them.
+        QString prefixEnd = key.left(length);
+        if (prefixEnd.back().unicode() == 0xFFFF) {
+            it++;
+            continue;
+        }
+        prefixEnd.back() = QChar(prefixEnd.back().unicode() + 1);
+        it = names.lower_bound(prefixEnd);
+    }
+}
+
+/*!
+ * \brief LabelSearchIndex::findFuzzy finds the places whose name starts with something close to the query.
+ *
+ * Tolerates typing errors, a name matches if it starts with something that is at most
+ * maxEdits inserted, removed or replaced letters away from the query.
+ *
+ * The closest matches always come first, so we search with one edit more at a time,
+ * and stop as soon as there are enough names to fill the results.
+ *
+ * \param query The start of the name. Compared in its normalized form.
+ * \param maxEdits The largest number of edits allowed, at most 3.
+ * \param maxResults The largest number of results to return.
+ * \return The places, the closest matches first.
+ */
+QVector<LabelSearchResult> LabelSearchIndex::findFuzzy(const QString &query, int maxEdits, int maxResults) const
+{
+    BACH_TRACE_SCOPE("LabelSearchIndex::findFuzzy");
+    const QString normalizedQuery = normalizeName(query).left(maxFuzzyQueryLength);
+    if (normalizedQuery.isEmpty() || maxResults <= 0)
+        return {};
+    maxEdits = std::clamp(maxEdits, 0, maxFuzzyEdits);
+    if (maxEdits == 0)
+        return findPrefix(normalizedQuery, maxResults);
+
+    QMutexLocker locker(lock.get());
+    QVector<Candidate> candidates;
+    for (int edits = 0; edits <= maxEdits; edits++) {
+        // Every name gives at least one result, and names with fewer edits are ranked first.
+        candidates.clear();
+        collectFuzzyCandidates(normalizedQuery, edits, candidates);
+        if (candidates.size() >= maxResults)
+            break;
+    }
+    return createResults(candidates, normalizedQuery, maxResults);
+}
+
+/*!
+ * \internal
+ * \brief calcWorldBounds converts bounds in tile coordinates to world-normalized coordinates.
+ */
+static QRectF calcWorldBounds(TileCoord coord, const QRectF &tileBounds)
+{
+    const double tileCount = 1 << coord.zoom;
+    const double scale = 1.0 / (Bach::TileFeatureIndex::extent * tileCount);
+    return QRectF{
+        coord.x / tileCount + tileBounds.x() * scale,
+        coord.y / tileCount + tileBounds.y() * scale,
+        tileBounds.width() * scale,
+        tileBounds.height() * scale };
+}
+
+/*!
+ * \internal
+ * \brief LabelSearchIndex::createResults turns the matching names into places.
+ *
+ * A name can exist in several tiles and zoom levels. Only the highest zoom level the
+ * name is loaded at is used, since it is the most precise. Within it, the pieces in
+ * neighbouring tiles are joined, so a long road becomes one result while streets
+ * with the same name in different towns stay apart.
+ *
+ * The lock must be held.
+ */
+QVector<LabelSearchResult> LabelSearchIndex::createResults(
+    QVector<Candidate> &candidates,
+    const QString &query,
+    int maxResults) const
+{
+    auto isBetter = [&](const Candidate &a, const Candidate &b) {
+        if (a.editDistance != b.editDistance)
+            return a.editDistance < b.editDistance;
+        const bool aExact = *a.key == query;
+        const bool bExact = *b.key == query;
+        if (aExact != bExact)
+            return aExact;
+        if (a.key->size() != b.key->size())
+            return a.key->size() < b.key->size();
+        return *a.key < *b.key;
+    };
+    // Every name gives at least one result, so only the best names need sorting.
+    const qsizetype sortedCount = qMin(candidates.size(), (qsizetype)maxResults);
+    std::partial_sort(candidates.begin(), candidates.begin() + sortedCount, candidates.end(), isBetter);
+
+    QVector<LabelSearchResult> out;
+    for (qsizetype i = 0; i < sortedCount && out.size() < maxResults; i++) {
+        const Candidate &candidate = candidates[i];
+        const QVector<Occurrence> &occurrences = names.at(*candidate.key);
+
+        int highestZoom = 0;
+        for (const Occurrence &occurrence : occurrences)
+            highestZoom = qMax(highestZoom, occurrence.tileCoord.zoom);
+
+        // Groups of occurrences in touching tiles of the same layer.
+        struct Cluster {
+            const Occurrence *first = nullptr;
+            QVector<TileCoord> tiles;
+            QRectF worldBounds;
+        };
+        QVector<Cluster> clusters;
+        for (const Occurrence &occurrence : occurrences) {
+            if (occurrence.tileCoord.zoom != highestZoom)
+                continue;
+            const QRectF worldBounds = calcWorldBounds(occurrence.tileCoord, occurrence.bounds);
+
+            auto touches = [&](const Cluster &cluster) {
+                if (cluster.first->sourceLayer != occurrence.sourceLayer)
+                    return false;
+                for (TileCoord tile : cluster.tiles) {
+                    if (qAbs(tile.x - occurrence.tileCoord.x) <= 1 && qAbs(tile.y - occurrence.tileCoord.y) <= 1)
+                        return true;
+                }
+                return false;
+            };
+            auto clusterIt = std::find_if(clusters.begin(), clusters.end(), touches);
+            if (clusterIt == clusters.end()) {
+                clusters.push_back({ &occurrence, { occurrence.tileCoord }, worldBounds });
+            } else {
+                clusterIt->tiles.push_back(occurrence.tileCoord);
+                clusterIt->worldBounds = clusterIt->worldBounds.united(worldBounds);
+            }
+        }
+
+        for (const Cluster &cluster : clusters) {
+            if (out.size() >= maxResults)
+                break;
+            LabelSearchResult result;
+            result.name = cluster.first->name;
+            result.sourceLayer = cluster.first->sourceLayer;
+            result.tileCoord = cluster.first->tileCoord;
+            const QPointF center = cluster.worldBounds.center();
+            result.worldX = center.x();
+            result.worldY = center.y();
+            // Fit the place in the viewport with some margin. Points get
+            // a bit closer than the tile they were found in.
+            const double span = qMax(cluster.worldBounds.width(), cluster.worldBounds.height());
+            const double zoom = span > 0 ? std::log2(1.0 / span) - 0.5 : highestZoom + 2.0;
+            result.zoom = std::clamp(zoom, 0.0, (double)Bach::maxZoomLevel);
+            result.editDistance = candidate.editDistance;
+            out.push_back(std::move(result));
+        }
+    }
+    return out;
+}
@@ -0,0 +1,118 @@
+// Copyright (c) 2024 Cecilia Norevik Bratlie, Nils Petter Skålerud, Eimen Oueslati
+// SPDX-License-Identifier: MIT
+
+#ifndef LABELSEARCHINDEX_H
+#define LABELSEARCHINDEX_H
+
+// Qt header files
+#include <QMutex>
+#include <QRectF>
+#include <QString>
+#include <QVector>
+
+// STL header files
+#include <map>
+#include <memory>
+
+// Other header files
+#include "TileCoord.h"
+#include "VectorTiles.h"
+
+namespace Bach {
+    /*!
+     * \brief The LabelSearchResult class is a single place found by the LabelSearchIndex.
+     */
+    struct LabelSearchResult {
+        // The name as it is written in the tile.
+        QString name;
+        QString sourceLayer;
+        // The tile the name was found in. Found in several tiles, this is the first one.
+        TileCoord tileCoord;
+        // Center of the place in world-normalized coordinates.
+        // Can be passed straight to MapWidget::setViewport.
+        double worldX = 0;
+        double worldY = 0;
+        // Viewport zoom level that shows the whole place.
+        double zoom = 0;
+        // Number of edits between the query and the start of the name. 0 for prefix matches.
+        int editDistance = 0;
+    };
+
+    /*!
+     * \brief The TileLabels class holds the names found in a single tile.
+     *
+     * Collected without any lock held, so the tile can be parsed and measured
+     * on a worker thread before it is inserted into the LabelSearchIndex.
+     */
+    struct TileLabels {
+        struct Label {
+            // Normalized name, used as the search key.
+            QString key;
+            QString name;
+            QString sourceLayer;
+            // Bounds of all features with this name in the layer, in tile coordinates.
+            QRectF bounds;
+        };
+        QVector<Label> labels;
+    };
+
+    /*!
+     * \class
+     * \brief The LabelSearchIndex class is a text index over the names of the loaded vector tiles.
+     *
+     * Tiles are added and removed one at a time as they enter and leave the tile memory.
+     * Every attribute whose key starts with "name" is indexed, so both the local and the
+     * latin names can be searched for.
+     *
+     * Names are case folded and stripped of accents before they are compared.
+     * The names are kept sorted, so prefix lookups only visit the matching names, and fuzzy
+     * lookups skip every name that starts with letters that are already too far from the query.
+     *
+     * \threadsafe
+     */
+    class LabelSearchIndex {
+    public:
+        // Longest query the fuzzy lookup compares. Longer queries are cut.
+        static constexpr int maxFuzzyQueryLength = 64;
+
+        static TileLabels collectLabels(const VectorTile &tile);
+        static QString normalizeName(const QString &name);
+
+        void insertTile(TileCoord coord, TileLabels &&labels);
+        void removeTile(TileCoord coord);
+        void clear();
+
+        QVector<LabelSearchResult> findPrefix(const QString &query, int maxResults) const;
+        QVector<LabelSearchResult> findFuzzy(const QString &query, int maxEdits, int maxResults) const;
+
+        qsizetype nameCount() const;
+        qsizetype tileCount() const;
+
+    private:
+        struct Occurrence {
+            TileCoord tileCoord;
+            QString name;
+            QString sourceLayer;
+            QRectF bounds;
+        };
+
+        struct Candidate {
+            const QString *key = nullptr;
+            int editDistance = 0;
+        };
+
+        void removeTileWithoutLock(TileCoord coord);
+        void collectFuzzyCandidates(const QString &query, int maxEdits, QVector<Candidate> &candidatesOut) const;
+        QVector<LabelSearchResult> createResults(QVector<Candidate> &candidates, const QString &query, int maxResults) const;
+
+        // All the places of each normalized name, sorted by the name.
+        std::map<QString, QVector<Occurrence>> names;
+        // The keys inserted by each tile, so the tile can be removed again.
+        std::map<TileCoord, QVector<QString>> tileKeys;
+
+        // We use unique-ptr here to let us use the lock in const methods.
+        std::unique_ptr<QMutex> lock = std::make_unique<QMutex>();
+    };
+}
+
+#endif // LABELSEARCHINDEX_H
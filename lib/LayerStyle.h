@@ -14,8 +14,10 @@
 #include <QPen>
 #include <QString>
 #include <QtTypes>
-#include <vector>
+#include <cmath>
 #include <optional>
+#include <type_traits>
+#include <vector>
 
 /*
  *  All the layers styles follow the maptiler layer style specification :
@@ -55,6 +57,8 @@ class BackgroundStyle : public AbstractLayerStyle
 private:
     QVariant m_backgroundColor;
     QVariant m_backgroundOpacity;
+    // Exponential base used to interpolate between numeric "stops".
+    double m_backgroundOpacityBase = 1;
 
 public:
     static std::unique_ptr<BackgroundStyle> fromJson(const QJsonObject &json);
@@ -64,8 +68,8 @@ public:
         return LayerType::background;
     }
 
-    QVariant getColorAtZoom(int zoomLevel) const;
-    QVariant getOpacityAtZoom(int zoomLevel) const;
+    QVariant getColorAtZoom(double zoomLevel) const;
+    QVariant getOpacityAtZoom(double zoomLevel) const;
 };
 
 class FillLayerStyle : public AbstractLayerStyle
@@ -74,6 +78,8 @@ private:
     QVariant m_fillColor;
     QVariant m_fillOpacity;
     QVariant m_fillOutlineColor;
+    // Exponential base used to interpolate between numeric "stops".
+    double m_fillOpacityBase = 1;
 
 public:
     static std::unique_ptr<FillLayerStyle> fromJson(const QJsonObject &json);
@@ -83,9 +89,9 @@ public:
         return LayerType::fill;
     }
 
-    QVariant getFillColorAtZoom(int zoomLevel) const;
-    QVariant getFillOpacityAtZoom(int zoomLevel) const;
-    QVariant getFillOutLineColorAtZoom(int zoomLevel) const;
+    QVariant getFillColorAtZoom(double zoomLevel) const;
+    QVariant getFillOpacityAtZoom(double zoomLevel) const;
+    QVariant getFillOutLineColorAtZoom(double zoomLevel) const;
 
     bool m_antialias;
 };
@@ -98,6 +104,9 @@ private:
     QVariant m_lineColor;
     QVariant m_lineOpacity;
     QVariant m_lineWidth;
+    // Exponential bases used to interpolate between numeric "stops".
+    double m_lineOpacityBase = 1;
+    double m_lineWidthBase = 1;
 
 public:
     static std::unique_ptr<LineLayerStyle> fromJson(const QJsonObject &json);
@@ -106,9 +115,9 @@ public:
         return AbstractLayerStyle::LayerType::line;
     }
 
-    QVariant getLineColorAtZoom(int zoomLevel) const;
-    QVariant getLineOpacityAtZoom(int zoomLevel) const;
-    QVariant getLineWidthAtZoom(int zoomLevel) const;
+    QVariant getLineColorAtZoom(double zoomLevel) const;
+    QVariant getLineOpacityAtZoom(double zoomLevel) const;
+    QVariant getLineWidthAtZoom(double zoomLevel) const;
 
     Qt::PenJoinStyle getJoinStyle() const;
     Qt::PenCapStyle getCapStyle() const;
@@ -125,6 +134,12 @@ private:
     QVariant m_symbolSpacing;
     QVariant m_textLetterSpacing;
     QVariant m_textMaxAngle;
+    // Exponential bases used to interpolate between numeric "stops".
+    double m_textSizeBase = 1;
+    double m_textOpacityBase = 1;
+    double m_symbolSpacingBase = 1;
+    double m_textLetterSpacingBase = 1;
+    double m_textMaxAngleBase = 1;
 
 public:
     static std::unique_ptr<SymbolLayerStyle> fromJson(const QJsonObject &json);
@@ -133,12 +148,12 @@ public:
         return AbstractLayerStyle::LayerType::symbol;
     }
 
-    QVariant getTextSizeAtZoom(int zoomLevel) const;
-    QVariant getTextColorAtZoom(int zoomLevel) const;
-    QVariant getTextOpacityAtZoom(int zoomLevel) const;
-    QVariant getSymbolSpacingAtZoom(int zoomLevel) const;
-    QVariant getTextMaxAngleAtZoom(int zoomLevel) const;
-    QVariant getTextLetterSpacingAtZoom(int zoomLevel) const;
+    QVariant getTextSizeAtZoom(double zoomLevel) const;
+    QVariant getTextColorAtZoom(double zoomLevel) const;
+    QVariant getTextOpacityAtZoom(double zoomLevel) const;
+    QVariant getSymbolSpacingAtZoom(double zoomLevel) const;
+    QVariant getTextMaxAngleAtZoom(double zoomLevel) const;
+    QVariant getTextLetterSpacingAtZoom(double zoomLevel) const;
 
     QVariant m_textField;
     QStringList m_textFont;
@@ -180,16 +195,44 @@ public:
     std::vector<std::unique_ptr<AbstractLayerStyle>> m_layerStyles;
 };
 
+/*!
+ * \brief getStopOutput returns the value of a property with "stops" at a zoom level.
+ *
+ * Numeric values are interpolated between the two stops around the zoom level,
+ * exponentially with the given base. A base of 1 interpolates linearly.
+ * Other values, like colors, are not interpolated and take the value of the stop below.
+ *
+ * \param list The stops, as pairs of zoom level and value, sorted by zoom level.
+ * \param currentZoom The zoom level to get the value at. Can be fractional.
+ * \param base The "base" of the stops, controls how fast the value changes towards the next stop.
+ * \return The value at the zoom level.
+ */
 template <class T>
-inline T getStopOutput(QList<QPair<int, T>> list, int currentZoom)
+inline T getStopOutput(const QList<QPair<int, T>> &list, double currentZoom, double base = 1)
 {
     if (currentZoom <= list.begin()->first) {
         return list.begin()->second;
     }
 
-    for(int i = 0; i < list.size(); i++)
+    for(int i = 1; i < list.size(); i++)
     {
-        if (currentZoom <= list[i].first) {
+        if (currentZoom > list[i].first)
+            continue;
+
+        if constexpr (std::is_arithmetic_v<T>) {
+            const double zoomRange = list[i].first - list[i-1].first;
+            const double zoomProgress = currentZoom - list[i-1].first;
+            double t = 1;
+            if (zoomRange > 0 && base == 1)
+                t = zoomProgress / zoomRange;
+            else if (zoomRange > 0)
+                t = (std::pow(base, zoomProgress) - 1) / (std::pow(base, zoomRange) - 1);
+            const double value = list[i-1].second + t * (list[i].second - list[i-1].second);
+            if constexpr (std::is_integral_v<T>)
+                return (T)std::lround(value);
+            else
+                return (T)value;
+        } else {
             return list[i-1].second;
         }
     }
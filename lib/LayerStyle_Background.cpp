@@ -90,6 +90,7 @@ std::unique_ptr<BackgroundStyle> BackgroundStyle::fromJson(const QJsonObject &js
                 // Append a QPair with <zoomStop, opacityStop> to `stops`.
                 stops.append(QPair<int, float>(zoomStop, opacityStop));
             }
+            returnLayer->m_backgroundOpacityBase = backgroundOpacity.toObject().value("base").toDouble(1);
             returnLayer->m_backgroundOpacity.setValue(stops);
         } else if (backgroundOpacity.isArray()) {
             // Case where the property is an expression.
@@ -111,7 +112,7 @@ std::unique_ptr<BackgroundStyle> BackgroundStyle::fromJson(const QJsonObject &js
  * \param zoomLevel is the zoom level for which to calculate the color.
  * \return a QVariant containing a QColor or QJsonArray with color information.
  */
-QVariant BackgroundStyle::getColorAtZoom(int zoomLevel) const
+QVariant BackgroundStyle::getColorAtZoom(double zoomLevel) const
 {
     if (m_backgroundColor.isNull()) {
         // The default color in case no color is provided by the style sheet.
@@ -137,7 +138,7 @@ QVariant BackgroundStyle::getColorAtZoom(int zoomLevel) const
  * \param zoomLevel is the zoom level for which to calculate the opacity.
  * \return a QVariant containing a float or QJsonArray with opacity information.
  */
-QVariant BackgroundStyle::getOpacityAtZoom(int zoomLevel) const
+QVariant BackgroundStyle::getOpacityAtZoom(double zoomLevel) const
 {
     if (m_backgroundOpacity.isNull()) {
         // The default opacity in case no opacity is provided by the style sheet.
@@ -147,7 +148,7 @@ QVariant BackgroundStyle::getOpacityAtZoom(int zoomLevel) const
         QList<QPair<int, float>> stops = m_backgroundOpacity.value<QList<QPair<int, float>>>();
         if (stops.size() == 0)
             return QVariant(1);
-        return QVariant(getStopOutput(stops, zoomLevel));
+        return QVariant(getStopOutput(stops, zoomLevel, m_backgroundOpacityBase));
     } else {
         return m_backgroundColor;
     }
@@ -68,6 +68,7 @@ std::unique_ptr<FillLayerStyle> FillLayerStyle::fromJson(const QJsonObject &json
                 float opacityStop = stop.toArray().last().toDouble();
                 stops.append(QPair<int, float>(zoomStop, opacityStop));
             }
+            returnLayer->m_fillOpacityBase = fillOpacity.toObject().value("base").toDouble(1);
             returnLayer->m_fillOpacity.setValue(stops);
         } else if (fillOpacity.isArray()) {
             // Case where the property is an expression.
@@ -114,7 +115,7 @@ std::unique_ptr<FillLayerStyle> FillLayerStyle::fromJson(const QJsonObject &json
  * \param zoomLevel is the zoom level for which to calculate the color.
  * \return a QVariant containing either a QColor or a QJsonArray with the data.
  */
-QVariant FillLayerStyle::getFillColorAtZoom(int zoomLevel) const
+QVariant FillLayerStyle::getFillColorAtZoom(double zoomLevel) const
 {
     if (m_fillColor.isNull()) {
         // The default color in case no color is provided by the style sheet.
@@ -136,7 +137,7 @@ QVariant FillLayerStyle::getFillColorAtZoom(int zoomLevel) const
  * \param zoomLevel is the zoom level for which to calculate the opacity.
  * \return a QVariant containing either a float or a QJsonArray with the layer opacity information.
  */
-QVariant FillLayerStyle::getFillOpacityAtZoom(int zoomLevel) const
+QVariant FillLayerStyle::getFillOpacityAtZoom(double zoomLevel) const
 {
     if (m_fillOpacity.isNull()) {
         // The default opacity in case no opacity is provided by the style sheet.
@@ -147,7 +148,7 @@ QVariant FillLayerStyle::getFillOpacityAtZoom(int zoomLevel) const
         if (stops.size() == 0) {
             return QVariant(1);
         }
-        return QVariant(getStopOutput(stops, zoomLevel));
+        return QVariant(getStopOutput(stops, zoomLevel, m_fillOpacityBase));
     } else {
         return m_fillOpacity;
     }
@@ -163,7 +164,7 @@ QVariant FillLayerStyle::getFillOpacityAtZoom(int zoomLevel) const
  * \param zoomLevel is the zoom level for which to calculate the color.
  * \return a QVariant containing either a Qcolor or a QJsonArray with color data.
  */
-QVariant FillLayerStyle::getFillOutLineColorAtZoom(int zoomLevel) const
+QVariant FillLayerStyle::getFillOutLineColorAtZoom(double zoomLevel) const
 {
     if (m_antialias == false)
         //The outline requires the antialising to be true.
@@ -72,6 +72,7 @@ std::unique_ptr<LineLayerStyle> LineLayerStyle::fromJson(const QJsonObject &json
                 float opacityStop = stop.toArray().last().toDouble();
                 stops.append(QPair<int , float>(zoomStop, opacityStop));
             }
+            returnLayer->m_lineOpacityBase = lineOpacity.toObject().value("base").toDouble(1);
             returnLayer->m_lineOpacity.setValue(stops);
         }else if (lineOpacity.isArray()) {
             // Case where the property is an expression.
@@ -95,6 +96,7 @@ std::unique_ptr<LineLayerStyle> LineLayerStyle::fromJson(const QJsonObject &json
                 int widthStop = stop.toArray().last().toInt();
                 stops.append(QPair<int, int>(zoomStop, widthStop));
             }
+            returnLayer->m_lineWidthBase = lineWidth.toObject().value("base").toDouble(1);
             returnLayer->m_lineWidth.setValue(stops);
         } else if (lineWidth.isArray()) {
             // Case where the property is an expression.
@@ -116,7 +118,7 @@ std::unique_ptr<LineLayerStyle> LineLayerStyle::fromJson(const QJsonObject &json
  * \param zoomLevel is the zoom level for which to calculate the color.
  * \return a QVariant containing either a QColor or a QJsonArray with data.
  */
-QVariant LineLayerStyle::getLineColorAtZoom(int zoomLevel) const
+QVariant LineLayerStyle::getLineColorAtZoom(double zoomLevel) const
 {
     if (m_lineColor.isNull()) {
         // The default color in case no color is provided by the style sheet.
@@ -142,7 +144,7 @@ QVariant LineLayerStyle::getLineColorAtZoom(int zoomLevel) const
  * \param zoomLevel is the zoom level for which to calculate the opacity.
  * \return the opacity for the given zoom level.
  */
-QVariant LineLayerStyle::getLineOpacityAtZoom(int zoomLevel) const
+QVariant LineLayerStyle::getLineOpacityAtZoom(double zoomLevel) const
 {
     if (m_lineOpacity.isNull()) {
         // The default opacity in case no opacity is provided by the style sheet.
@@ -152,7 +154,7 @@ QVariant LineLayerStyle::getLineOpacityAtZoom(int zoomLevel) const
         QList<QPair<int, float>> stops = m_lineOpacity.value<QList<QPair<int, float>>>();
         if (stops.size() == 0)
             return QVariant(1);
-        return QVariant(getStopOutput(stops, zoomLevel));
+        return QVariant(getStopOutput(stops, zoomLevel, m_lineOpacityBase));
     } else {
         return m_lineOpacity;
     }
@@ -167,7 +169,7 @@ QVariant LineLayerStyle::getLineOpacityAtZoom(int zoomLevel) const
  * \param zoomLevel is the zoom level for which to calculate the line width.
  * \return a QVariant containing either a float or a QJsonArray with the
  */
-QVariant LineLayerStyle::getLineWidthAtZoom(int zoomLevel) const
+QVariant LineLayerStyle::getLineWidthAtZoom(double zoomLevel) const
 {
     if (m_lineWidth.isNull()) {
         // The default width in case no width is provided by the style sheet.
@@ -177,7 +179,7 @@ QVariant LineLayerStyle::getLineWidthAtZoom(int zoomLevel) const
         QList<QPair<int, int>> stops = m_lineWidth.value<QList<QPair<int, int>>>();
         if (stops.size() == 0)
             return QVariant(1);
-        return QVariant(getStopOutput(stops, zoomLevel));
+        return QVariant(getStopOutput(stops, zoomLevel, m_lineWidthBase));
     } else {
         return m_lineWidth;
     }
@@ -37,6 +37,7 @@ std::unique_ptr<SymbolLayerStyle> SymbolLayerStyle::fromJson(const QJsonObject &
                 int sizeStop = stop.toArray().last().toInt();
                 stops.append(QPair<int, int>(zoomStop, sizeStop));
             }
+            returnLayer->m_textSizeBase = textSize.toObject().value("base").toDouble(1);
             returnLayer->m_textSize.setValue(stops);
         } else if (textSize.isArray()) {
             // Case where the property is an expression.
@@ -58,6 +59,7 @@ std::unique_ptr<SymbolLayerStyle> SymbolLayerStyle::fromJson(const QJsonObject &
                 int angleStop = stop.toArray().last().toInt();
                 stops.append(QPair<int, int>(zoomStop, angleStop));
             }
+            returnLayer->m_textMaxAngleBase = textSize.toObject().value("base").toDouble(1);
             returnLayer->m_textMaxAngle.setValue(stops);
         } else if (textSize.isArray()){
             // Case where the property is an expression.
@@ -80,6 +82,7 @@ std::unique_ptr<SymbolLayerStyle> SymbolLayerStyle::fromJson(const QJsonObject &
                 int sizeStop = stop.toArray().last().toInt();
                 stops.append(QPair<int, int>(zoomStop, sizeStop));
             }
+            returnLayer->m_symbolSpacingBase = textSize.toObject().value("base").toDouble(1);
             returnLayer->m_symbolSpacing.setValue(stops);
         } else if (textSize.isArray()){
             // Case where the property is an expression.
@@ -101,6 +104,7 @@ std::unique_ptr<SymbolLayerStyle> SymbolLayerStyle::fromJson(const QJsonObject &
                 float spaceStop = stop.toArray().last().toInt();
                 stops.append(QPair<int, float>(zoomStop, spaceStop));
             }
+            returnLayer->m_textLetterSpacingBase = textSize.toObject().value("base").toDouble(1);
             returnLayer->m_textLetterSpacing.setValue(stops);
         } else if (textSize.isArray()){
             // Case where the property is an expression.
@@ -174,6 +178,7 @@ std::unique_ptr<SymbolLayerStyle> SymbolLayerStyle::fromJson(const QJsonObject &
                 float opacityStop = stop.toArray().last().toDouble();
                 stops.append(QPair<int, float>(zoomStop, opacityStop));
             }
+            returnLayer->m_textOpacityBase = textOpacity.toObject().value("base").toDouble(1);
             returnLayer->m_textOpacity.setValue(stops);
         } else if (textOpacity.isArray()) {
             // Case where the property is an expression.
@@ -209,7 +214,7 @@ std::unique_ptr<SymbolLayerStyle> SymbolLayerStyle::fromJson(const QJsonObject &
  * \param zoomLevel is the zoom level for which to calculate the size.
  * \return a QVariant containing either a float or a QJsonArray with data.
  */
-QVariant SymbolLayerStyle::getTextSizeAtZoom(int zoomLevel) const
+QVariant SymbolLayerStyle::getTextSizeAtZoom(double zoomLevel) const
 {
     if (m_textSize.isNull()) {
         // The default size in case no size is provided by the style sheet.
@@ -219,7 +224,7 @@ QVariant SymbolLayerStyle::getTextSizeAtZoom(int zoomLevel) const
         QList<QPair<int, int>> stops = m_textSize.value<QList<QPair<int, int>>>();
         if (stops.size() == 0)
             return QVariant(16);
-        return QVariant(getStopOutput(stops, zoomLevel));
+        return QVariant(getStopOutput(stops, zoomLevel, m_textSizeBase));
     } else {
         return QVariant(m_textSize);
     }
@@ -234,19 +239,19 @@ QVariant SymbolLayerStyle::getTextSizeAtZoom(int zoomLevel) const
  * \param zoomLevel is the zoom level for which to calculate the size.
  * \return a QVariant containing either an int or a QJsonArray with data.
  */
-QVariant SymbolLayerStyle::getSymbolSpacingAtZoom(int zoomLevel) const
+QVariant SymbolLayerStyle::getSymbolSpacingAtZoom(double zoomLevel) const
 {
-    if (m_textSize.isNull()){
-        // The default size in case no size is provided by the style sheet.
+    if (m_symbolSpacing.isNull()){
+        // The default spacing in case no spacing is provided by the style sheet.
         return QVariant(250);
-    } else if (m_textSize.typeId() != QMetaType::Type::Int
-               && m_textSize.typeId() != QMetaType::Type::QJsonArray){
-        QList<QPair<int, int>> stops = m_textSize.value<QList<QPair<int, int>>>();
+    } else if (m_symbolSpacing.typeId() != QMetaType::Type::Int
+               && m_symbolSpacing.typeId() != QMetaType::Type::QJsonArray){
+        QList<QPair<int, int>> stops = m_symbolSpacing.value<QList<QPair<int, int>>>();
         if (stops.size() == 0)
             return QVariant(250);
-        return QVariant(getStopOutput(stops, zoomLevel));
+        return QVariant(getStopOutput(stops, zoomLevel, m_symbolSpacingBase));
     } else {
-        return QVariant(m_textSize);
+        return QVariant(m_symbolSpacing);
     }
 }
 
@@ -260,7 +265,7 @@ QVariant SymbolLayerStyle::getSymbolSpacingAtZoom(int zoomLevel) const
  * \param zoomLevel is the zoom level for which to calculate the size.
  * \return a QVariant containing either an int or a QJsonArray with data.
  */
-QVariant SymbolLayerStyle::getTextMaxAngleAtZoom(int zoomLevel) const
+QVariant SymbolLayerStyle::getTextMaxAngleAtZoom(double zoomLevel) const
 {
     if (m_textMaxAngle.isNull()){
         // The default size in case no size is provided by the style sheet.
@@ -270,7 +275,7 @@ QVariant SymbolLayerStyle::getTextMaxAngleAtZoom(int zoomLevel) const
         QList<QPair<int, int>> stops = m_textMaxAngle.value<QList<QPair<int, int>>>();
         if (stops.size() == 0)
             return QVariant(45);
-        return QVariant(getStopOutput(stops, zoomLevel));
+        return QVariant(getStopOutput(stops, zoomLevel, m_textMaxAngleBase));
     } else {
         return QVariant(m_textMaxAngle);
     }
@@ -286,7 +291,7 @@ QVariant SymbolLayerStyle::getTextMaxAngleAtZoom(int zoomLevel) const
  * \param zoomLevel is the zoom level for which to calculate the size.
  * \return a QVariant containing either a float or a QJsonArray with data.
  */
-QVariant SymbolLayerStyle::getTextLetterSpacingAtZoom(int zoomLevel) const
+QVariant SymbolLayerStyle::getTextLetterSpacingAtZoom(double zoomLevel) const
 {
     if (m_textLetterSpacing.isNull()){
         // The default size in case no size is provided by the style sheet.
@@ -296,7 +301,7 @@ QVariant SymbolLayerStyle::getTextLetterSpacingAtZoom(int zoomLevel) const
         QList<QPair<int, float>> stops = m_textLetterSpacing.value<QList<QPair<int, float>>>();
         if (stops.size() == 0)
             return QVariant(0);
-        return QVariant(getStopOutput(stops, zoomLevel));
+        return QVariant(getStopOutput(stops, zoomLevel, m_textLetterSpacingBase));
     } else {
         return QVariant(m_textLetterSpacing);
     }
@@ -308,7 +313,7 @@ QVariant SymbolLayerStyle::getTextLetterSpacingAtZoom(int zoomLevel) const
  * \param zoomLevel is the zoom level for which to calculate the color.
  * \return a QVariant with either QColor or a QJsonArray with data.
  */
-QVariant SymbolLayerStyle::getTextColorAtZoom(int zoomLevel) const
+QVariant SymbolLayerStyle::getTextColorAtZoom(double zoomLevel) const
 {
     if(m_textColor.isNull()) {
         // The default color in case no color is provided by the style sheet.
@@ -334,7 +339,7 @@ QVariant SymbolLayerStyle::getTextColorAtZoom(int zoomLevel) const
  * \param zoomLevel is the zoom level for which to calculate the opacity.
  * \return a QVariant containing either a float or a QJsonArray with the data.
  */
-QVariant SymbolLayerStyle::getTextOpacityAtZoom(int zoomLevel) const
+QVariant SymbolLayerStyle::getTextOpacityAtZoom(double zoomLevel) const
 {
     if (m_textOpacity.isNull()) {
         // The default color in case no color is provided by the style sheet.
@@ -344,7 +349,7 @@ QVariant SymbolLayerStyle::getTextOpacityAtZoom(int zoomLevel) const
         QList<QPair<int, float>> stops = m_textOpacity.value<QList<QPair<int, float>>>();
         if (stops.size() == 0)
             return QVariant(1);
-        return QVariant(getStopOutput(stops, zoomLevel));
+        return QVariant(getStopOutput(stops, zoomLevel, m_textOpacityBase));
     } else {
         return QVariant(m_textOpacity);
     }
@@ -0,0 +1,344 @@
+// Copyright (c) 2024 Cecilia Norevik Bratlie, Nils Petter Skålerud, Eimen Oueslati
+// SPDX-License-Identifier: MIT
+
+// Qt header files
+#include <QMutexLocker>
+
+// STL header files
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <deque>
+
+// Other header files
+#include "Metrics.h"
+#include "Tracing.h"
+
+/*!
+ * \brief Bach::HistogramSnapshot::meanMs
+ * \return The mean of all samples, in milliseconds.
+ */
+double Bach::HistogramSnapshot::meanMs() const
+{
+    if (count == 0)
+        return 0;
+    return (double)totalNs / count / 1000000.0;
+}
+
+/*!
+ * \brief Bach::HistogramSnapshot::percentileMs estimates a percentile of the samples.
+ *
+ * The result is the upper bound of the bucket the percentile falls into,
+ * so it is only accurate to within a factor of two.
+ *
+ * \param percent The percentile, range [0, 100].
+ * \return The estimated percentile, in milliseconds.
+ */
+double Bach::HistogramSnapshot::percentileMs(double percent) const
+{
+    if (count == 0)
+        return 0;
+    const quint64 rank = (quint64)std::ceil(percent / 100.0 * count);
+    quint64 seen = 0;
+    for (int i = 0; i < buckets.size(); i++) {
+        seen += buckets[i];
+        if (seen >= rank)
+            return std::ldexp(1.0, i + 1) / 1000.0;
+    }
+    return std::ldexp(1.0, buckets.size()) / 1000.0;
+}
+
+/*!
+ * \brief Bach::TimeHistogram::record adds a sample to the histogram.
+ * \param durationNs The duration, in nanoseconds.
+ *
+ * \threadsafe
+ */
+void Bach::TimeHistogram::record(qint64 durationNs)
+{
+    const qint64 durationUs = durationNs / 1000;
+    int bucket = 0;
+    while (bucket < bucketCount - 1 && (qint64(1) << (bucket + 1)) <= durationUs)
+        bucket++;
+    buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    totalNs.fetch_add(durationNs, std::memory_order_relaxed);
+}
+
+/*!
+ * \brief Bach::TimeHistogram::snapshot copies the current state of the histogram.
+ *
+ * \threadsafe
+ */
+Bach::HistogramSnapshot Bach::TimeHistogram::snapshot() const
+{
+    HistogramSnapshot out;
+    out.buckets.resize(bucketCount);
+    for (int i = 0; i < bucketCount; i++)
+        out.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+    out.count = count.load(std::memory_order_relaxed);
+    out.totalNs = totalNs.load(std::memory_order_relaxed);
+    return out;
+}
+
+namespace Bach {
+    /*!
+     * \internal
+     * \brief The RenderCounters class holds the live counters of the renderer.
+     */
+    struct RenderCounters {
+        QMutex lock;
+        quint64 framesRendered = 0;
+        // When the frames of the last second ended, oldest first.
+        std::deque<qint64> recentFrameEndsNs;
+        TimeHistogram frameTime;
+    };
+
+    static RenderCounters &getRenderCounters()
+    {
+        static RenderCounters counters;
+        return counters;
+    }
+
+    /*!
+     * \internal
+     * \brief The StartupTimeline class holds the phases of startup recorded so far.
+     */
+    struct StartupTimeline {
+        QMutex lock;
+        bool inProgress = false;
+        // When startup began, from metricsNowNs.
+        qint64 beginNs = 0;
+        // When the previous phase ended, from metricsNowNs. The next phase starts here.
+        qint64 lastMarkNs = 0;
+        QVector<StartupPhase> phases;
+    };
+
+    static StartupTimeline &getStartupTimeline()
+    {
+        static StartupTimeline timeline;
+        return timeline;
+    }
+}
+
+/*!
+ * \brief Bach::beginStartup starts measuring the phases of startup.
+ *
+ * Should be called as early as possible. Phases are only recorded between
+ * the calls to beginStartup and finishStartup.
+ *
+ * \threadsafe
+ */
+void Bach::beginStartup()
+{
+    StartupTimeline &timeline = getStartupTimeline();
+    QMutexLocker lock { &timeline.lock };
+    timeline.inProgress = true;
+    timeline.beginNs = metricsNowNs();
+    timeline.lastMarkNs = timeline.beginNs;
+    timeline.phases.clear();
+}
+
+/*!
+ * \brief Bach::recordStartupPhase records that a phase of startup has ended.
+ * The phase started when the previous phase ended.
+ *
+ * Each name is only recorded the first time, so this can be called on every frame
+ * to record the first one. The phase is also recorded as a trace span.
+ *
+ * \param name The name of the phase. Must be a string literal.
+ * \return True if the phase was recorded.
+ *
+ * \threadsafe
+ */
+bool Bach::recordStartupPhase(const char *name)
+{
+    StartupTimeline &timeline = getStartupTimeline();
+    QMutexLocker lock { &timeline.lock };
+    if (!timeline.inProgress)
+        return false;
+    const bool alreadyRecorded = std::any_of(
+        timeline.phases.begin(),
+        timeline.phases.end(),
+        [&](const StartupPhase &phase) { return phase.name == QLatin1String(name); });
+    if (alreadyRecorded)
+        return false;
+
+    const qint64 now = metricsNowNs();
+    timeline.phases.append({ name, timeline.lastMarkNs - timeline.beginNs, now - timeline.beginNs });
+    if (Tracing::isEnabled()) {
+        const qint64 traceNow = Tracing::nowNs();
+        Tracing::recordSpan(name, traceNow - (now - timeline.lastMarkNs), traceNow);
+    }
+    timeline.lastMarkNs = now;
+    return true;
+}
+
+/*!
+ * \brief Bach::finishStartup stops recording phases of startup.
+ *
+ * \threadsafe
+ */
+void Bach::finishStartup()
+{
+    StartupTimeline &timeline = getStartupTimeline();
+    QMutexLocker lock { &timeline.lock };
+    timeline.inProgress = false;
+}
+
+/*!
+ * \brief Bach::isStartupInProgress
+ * \return True if beginStartup has been called and finishStartup has not.
+ *
+ * \threadsafe
+ */
+bool Bach::isStartupInProgress()
+{
+    StartupTimeline &timeline = getStartupTimeline();
+    QMutexLocker lock { &timeline.lock };
+    return timeline.inProgress;
+}
+
+/*!
+ * \brief Bach::getStartupPhases
+ * \return The phases of startup recorded so far, in the order they ended.
+ *
+ * \threadsafe
+ */
+QVector<Bach::StartupPhase> Bach::getStartupPhases()
+{
+    StartupTimeline &timeline = getStartupTimeline();
+    QMutexLocker lock { &timeline.lock };
+    return timeline.phases;
+}
+
+/*!
+ * \brief Bach::formatStartupReport builds a human-readable report of the startup phases.
+ * \return The text, with one phase per line followed by the total.
+ */
+QString Bach::formatStartupReport()
+{
+    const QVector<StartupPhase> phases = getStartupPhases();
+    QStringList lines;
+    lines << "Startup:";
+    for (const StartupPhase &phase : phases) {
+        lines << QString("  %1: %2 ms")
+                     .arg(phase.name, -24)
+                     .arg(phase.durationMs(), 0, 'f', 1);
+    }
+    const double totalMs = phases.isEmpty() ? 0 : phases.last().endNs / 1000000.0;
+    lines << QString("  %1: %2 ms").arg("total", -24).arg(totalMs, 0, 'f', 1);
+    return lines.join('\n');
+}
+
+/*!
+ * \brief Bach::metricsNowNs returns a monotonic timestamp to use with the metrics functions.
+ * \return The timestamp, in nanoseconds.
+ */
+qint64 Bach::metricsNowNs()
+{
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+}
+
+/*!
+ * \brief Bach::recordRenderedFrame records that a frame has been rendered.
+ *
+ * \param startNs When the frame started rendering, from metricsNowNs.
+ * \param endNs When the frame finished rendering, from metricsNowNs.
+ *
+ * \threadsafe
+ */
+void Bach::recordRenderedFrame(qint64 startNs, qint64 endNs)
+{
+    constexpr qint64 oneSecondNs = 1000000000;
+
+    RenderCounters &counters = getRenderCounters();
+    counters.frameTime.record(endNs - startNs);
+
+    QMutexLocker lock { &counters.lock };
+    counters.framesRendered++;
+    counters.recentFrameEndsNs.push_back(endNs);
+    while (!counters.recentFrameEndsNs.empty() && counters.recentFrameEndsNs.front() < endNs - oneSecondNs)
+        counters.recentFrameEndsNs.pop_front();
+}
+
+/*!
+ * \brief Bach::getRenderMetrics reads the current metrics of the renderer.
+ *
+ * \threadsafe
+ */
+Bach::RenderMetrics Bach::getRenderMetrics()
+{
+    constexpr qint64 oneSecondNs = 1000000000;
+
+    RenderCounters &counters = getRenderCounters();
+    RenderMetrics out;
+    out.frameTime = counters.frameTime.snapshot();
+
+    QMutexLocker lock { &counters.lock };
+    out.framesRendered = counters.framesRendered;
+    // Only count frames that ended within the last second from now,
+    // so the number drops to zero when nothing is being rendered.
+    const qint64 now = metricsNowNs();
+    out.framesPerSecond = (double)std::count_if(
+        counters.recentFrameEndsNs.begin(),
+        counters.recentFrameEndsNs.end(),
+        [&](qint64 frameEnd) { return frameEnd >= now - oneSecondNs; });
+    return out;
+}
+
+/*!
+ * \brief Bach::formatMetricsOverlayText builds the text shown in the metrics overlay.
+ * \return The text, with one metric per line.
+ */
+QString Bach::formatMetricsOverlayText(const RenderMetrics &renderMetrics)
+{
+    QStringList lines;
+    lines << QString("FPS: %1").arg(renderMetrics.framesPerSecond, 0, 'f', 0);
+    lines << QString("Frame time: mean %1 ms, p95 < %2 ms")
+                 .arg(renderMetrics.frameTime.meanMs(), 0, 'f', 1)
+                 .arg(renderMetrics.frameTime.percentileMs(95), 0, 'f', 1);
+    return lines.join('\n');
+}
+
+/*!
+ * \brief Bach::formatMetricsOverlayText builds the text shown in the metrics overlay.
+ * \return The text, with one metric per line.
+ */
+QString Bach::formatMetricsOverlayText(
+    const TileLoaderMetrics &tileLoaderMetrics,
+    const RenderMetrics &renderMetrics)
+{
+    const TileLoaderMetrics &m = tileLoaderMetrics;
+    auto toMiB = [](qint64 bytes) { return bytes / (1024.0 * 1024.0); };
+
+    QStringList lines;
+    lines << formatMetricsOverlayText(renderMetrics);
+    lines << QString("Memory: %1 hits, %2 pending, %3 misses")
+                 .arg(m.memoryHits)
+                 .arg(m.memoryPending)
+                 .arg(m.memoryMisses);
+    lines << QString("Disk: %1 hits, %2 misses")
+                 .arg(m.diskHits)
+                 .arg(m.diskMisses);
+    lines << QString("Network: %1 in flight, %2 done, %3 failed")
+                 .arg(m.networkInFlight)
+                 .arg(m.networkCompleted)
+                 .arg(m.networkFailed);
+    lines << QString("Queues: %1 waiting, %2 disk, %3 decoding")
+                 .arg(m.queuedJobs)
+                 .arg(m.activeDiskLoads)
+                 .arg(m.activeDecodes);
+    lines << QString("Vector: %1 tiles, %2 MiB, %3 evicted")
+                 .arg(m.vectorTilesResident)
+                 .arg(toMiB(m.vectorBytesResident), 0, 'f', 1)
+                 .arg(m.vectorTilesEvicted);
+    lines << QString("Raster: %1 tiles, %2 MiB")
+                 .arg(m.rasterTilesResident)
+                 .arg(toMiB(m.rasterBytesResident), 0, 'f', 1);
+    lines << QString("Decode: vector mean %1 ms, raster mean %2 ms")
+                 .arg(m.vectorDecodeTime.meanMs(), 0, 'f', 1)
+                 .arg(m.rasterDecodeTime.meanMs(), 0, 'f', 1);
+    return lines.join('\n');
+}
@@ -0,0 +1,168 @@
+// Copyright (c) 2024 Cecilia Norevik Bratlie, Nils Petter Skålerud, Eimen Oueslati
+// SPDX-License-Identifier: MIT
+
+#ifndef METRICS_H
+#define METRICS_H
+
+// Qt header files
+#include <QString>
+#include <QVector>
+#include <QtTypes>
+
+// STL header files
+#include <array>
+#include <atomic>
+
+namespace Bach {
+    /*!
+     * \brief The HistogramSnapshot class is a copy of a TimeHistogram at a point in time.
+     *
+     * Bucket i holds the samples in the range [2^i, 2^(i+1)) microseconds.
+     * Bucket 0 also holds everything below one microsecond.
+     */
+    struct HistogramSnapshot {
+        QVector<quint64> buckets;
+        quint64 count = 0;
+        qint64 totalNs = 0;
+
+        double meanMs() const;
+        double percentileMs(double percent) const;
+    };
+
+    /*!
+     * \brief The TimeHistogram class records durations into log2-sized buckets.
+     *
+     * Recording is lock-free, so it can be used from any thread on hot paths.
+     */
+    class TimeHistogram {
+    public:
+        static constexpr int bucketCount = 24;
+
+        void record(qint64 durationNs);
+        HistogramSnapshot snapshot() const;
+
+    private:
+        std::array<std::atomic<quint64>, bucketCount> buckets = {};
+        std::atomic<quint64> count = 0;
+        std::atomic<qint64> totalNs = 0;
+    };
+
+    /*!
+     * \brief The ScopedGauge class increments a gauge while it is alive.
+     * Used to count how many jobs are in a given stage.
+     */
+    class ScopedGauge {
+    public:
+        explicit ScopedGauge(std::atomic<int> &gauge) : gauge{ gauge } { gauge++; }
+        ScopedGauge(const ScopedGauge&) = delete;
+        ScopedGauge& operator=(const ScopedGauge&) = delete;
+        ~ScopedGauge() { gauge--; }
+
+    private:
+        std::atomic<int> &gauge;
+    };
+
+    /*!
+     * \brief The TileLoaderMetrics class holds the metrics of a TileLoader at a point in time.
+     */
+    struct TileLoaderMetrics {
+        // Requested tiles that were ready in memory.
+        quint64 memoryHits = 0;
+        // Requested tiles that were already being loaded.
+        quint64 memoryPending = 0;
+        // Requested tiles that were not in memory, and had to be loaded.
+        quint64 memoryMisses = 0;
+
+        // Tiles that were found in the disk cache.
+        quint64 diskHits = 0;
+        // Tiles that were not found in the disk cache.
+        quint64 diskMisses = 0;
+
+        // Number of network requests that have been sent but not yet answered.
+        int networkInFlight = 0;
+        quint64 networkCompleted = 0;
+        quint64 networkFailed = 0;
+
+        // Number of load jobs waiting for a worker thread.
+        int queuedJobs = 0;
+        // Number of tiles currently being read from disk.
+        int activeDiskLoads = 0;
+        // Number of tiles currently being decoded.
+        int activeDecodes = 0;
+
+        // Number of tiles that are loaded and ready to render, per tile type.
+        int vectorTilesResident = 0;
+        int rasterTilesResident = 0;
+        // Estimated memory used by the decoded vector tiles that are loaded.
+        // See TileLoader::getVectorMemoryUsage for a breakdown.
+        qint64 vectorBytesResident = 0;
+        // Size of the decoded raster images that are loaded.
+        qint64 rasterBytesResident = 0;
+        // Vector tiles removed from memory to stay within the memory budget.
+        quint64 vectorTilesEvicted = 0;
+
+        HistogramSnapshot vectorDecodeTime;
+        HistogramSnapshot rasterDecodeTime;
+    };
+
+    /*!
+     * \brief The TileLoaderCounters class holds the live counters a TileLoader updates.
+     * Use TileLoader::getMetrics to read them.
+     */
+    struct TileLoaderCounters {
+        std::atomic<quint64> memoryHits = 0;
+        std::atomic<quint64> memoryPending = 0;
+        std::atomic<quint64> memoryMisses = 0;
+        std::atomic<quint64> diskHits = 0;
+        std::atomic<quint64> diskMisses = 0;
+        std::atomic<int> networkInFlight = 0;
+        std::atomic<quint64> networkCompleted = 0;
+        std::atomic<quint64> networkFailed = 0;
+        std::atomic<int> queuedJobs = 0;
+        std::atomic<int> activeDiskLoads = 0;
+        std::atomic<int> activeDecodes = 0;
+        std::atomic<qint64> vectorBytesResident = 0;
+        std::atomic<qint64> rasterBytesResident = 0;
+        std::atomic<quint64> vectorTilesEvicted = 0;
+        TimeHistogram vectorDecodeTime;
+        TimeHistogram rasterDecodeTime;
+    };
+
+    /*!
+     * \brief The RenderMetrics class holds the metrics of the renderer at a point in time.
+     */
+    struct RenderMetrics {
+        quint64 framesRendered = 0;
+        // Frames per second, measured over the last second.
+        double framesPerSecond = 0;
+        HistogramSnapshot frameTime;
+    };
+
+    /*!
+     * \brief The StartupPhase class holds how long one phase of startup took.
+     */
+    struct StartupPhase {
+        QString name;
+        // Relative to when startup began, in nanoseconds.
+        qint64 startNs = 0;
+        qint64 endNs = 0;
+
+        double durationMs() const { return (endNs - startNs) / 1000000.0; }
+    };
+
+    void beginStartup();
+    bool recordStartupPhase(const char *name);
+    void finishStartup();
+    bool isStartupInProgress();
+    QVector<StartupPhase> getStartupPhases();
+    QString formatStartupReport();
+
+    void recordRenderedFrame(qint64 startNs, qint64 endNs);
+    RenderMetrics getRenderMetrics();
+    qint64 metricsNowNs();
+
+    QString formatMetricsOverlayText(const TileLoaderMetrics &tileLoaderMetrics, const RenderMetrics &renderMetrics);
+    QString formatMetricsOverlayText(const RenderMetrics &renderMetrics);
+}
+
+#endif // METRICS_H
@@ -2,13 +2,24 @@
 // SPDX-License-Identifier: MIT
 
 // STL header files
+#include <algorithm>
+#include <atomic>
 #include <functional>
+#include <QFontDatabase>
+#include <QHash>
+#include <QScopeGuard>
+#include <QSemaphore>
 #include <QTextLayout>
 #include <QTextCharFormat>
+#include <QThreadPool>
 
 // Other header files
+#include "AllocationCounting.h"
 #include "Evaluator.h"
+#include "FeatureIndex.h"
+#include "Metrics.h"
 #include "Rendering.h"
+#include "Tracing.h"
 
 /*!
  * \internal
@@ -59,9 +70,11 @@ public:
      * Calculates the on-screen position information of a specific tile.
      *
      * \param coord The cooardinates of the tile wanted.
+     * \param worldCopy Which horizontal copy of the world the tile is placed in,
+     * see Bach::WrappedTileCoord. 0 is the original.
      * \return The TileScreenPlacement with the correct data.
      */
-    TileScreenPlacement calcTileSizeData(TileCoord coord) const {
+    TileScreenPlacement calcTileSizeData(TileCoord coord, int worldCopy = 0) const {
         // Calculate where the top-left origin of the world map is relative to the viewport.
         double worldOriginX = vpX * WorldmapScale() - 0.5;
         double worldOriginY = vpY * WorldmapScale() - 0.5;
@@ -75,7 +88,8 @@ public:
         }
 
         // The position of this tile expressed in world-normalized coordinates.
-        double posNormX = (coord.x * TileSizeNorm()) - worldOriginX;
+        // Each copy of the world is shifted by the width of the world map.
+        double posNormX = (coord.x * TileSizeNorm()) + (worldCopy * WorldmapScale()) - worldOriginX;
         double posNormY = (coord.y * TileSizeNorm()) - worldOriginY;
 
         TileScreenPlacement out;
@@ -136,9 +150,137 @@ Bach::PaintVectorTileSettings Bach::PaintVectorTileSettings::getDefault()
     out.drawFill = true;
     out.drawLines = true;
     out.drawText = true;
+    out.generateLabelsInParallel = true;
+    out.suppressDuplicateLabels = true;
     return out;
 }
 
+/*!
+ * \brief Bach::resolveStyleProperty resolves a property of a layer style for a single feature.
+ *
+ * Properties that were resolved for the whole frame are taken from zoomValues,
+ * other expressions are resolved for the feature at the zoom level of the frame.
+ * Values that are not expressions are returned as they are.
+ *
+ * \param property The property, as returned by the layer style for the map zoom level.
+ * \param propertyId Which property it is, used to look it up in zoomValues.
+ * \param feature The feature to resolve expressions for.
+ * \param mapZoom The map zoom level, used when zoomValues is null.
+ * \param vpZoom The zoom level of the viewport.
+ * \param zoomValues The properties of the layer style resolved for the frame. Can be null.
+ * \return The resolved property.
+ */
+QVariant Bach::resolveStyleProperty(
+    const QVariant &property,
+    ZoomProperty propertyId,
+    const AbstractLayerFeature &feature,
+    int mapZoom,
+    double vpZoom,
+    const ZoomPropertyValues *zoomValues)
+{
+    if (zoomValues != nullptr && zoomValues->value(propertyId).isValid())
+        return zoomValues->value(propertyId);
+    if (property.typeId() != QMetaType::Type::QJsonArray)
+        return property;
+
+    return Evaluator::resolveExpression(
+        property.toJsonArray(),
+        &feature,
+        zoomValues != nullptr ? zoomValues->zoom : mapZoom,
+        vpZoom);
+}
+
+/*!
+ * \brief Bach::ZoomPropertyCache::create resolves the properties of every layer style
+ * that only depend on the zoom level.
+ *
+ * Properties with "stops" are taken from the layer style at the same zoom level,
+ * so numeric stops are interpolated instead of stepping at whole zoom levels.
+ * Expressions that depend on the feature are left out.
+ *
+ * \param styleSheet The stylesheet the frame is painted with.
+ * \param zoom The zoom level to resolve the properties at. Can be fractional.
+ * \return The cache, with an entry for every layer style.
+ */
+Bach::ZoomPropertyCache Bach::ZoomPropertyCache::create(
+    const StyleSheet &styleSheet,
+    double zoom)
+{
+    BACH_TRACE_SCOPE("Rendering::createZoomPropertyCache");
+    ZoomPropertyCache out;
+    out.layerValues.resize(styleSheet.m_layerStyles.size());
+    for (int i = 0; i < (int)styleSheet.m_layerStyles.size(); i++) {
+        ZoomPropertyValues &values = out.layerValues[i];
+        values.zoom = zoom;
+        auto resolve = [&](ZoomProperty propertyId, const QVariant &property) {
+            if (property.typeId() != QMetaType::Type::QJsonArray) {
+                values.values[(int)propertyId] = property;
+                return;
+            }
+            const QJsonArray expression = property.toJsonArray();
+            if (Evaluator::isZoomOnly(expression))
+                values.values[(int)propertyId] = Evaluator::resolveExpression(expression, nullptr, zoom, zoom);
+        };
+
+        const AbstractLayerStyle *abstractLayerStyle = styleSheet.m_layerStyles[i].get();
+        if (abstractLayerStyle->type() == AbstractLayerStyle::LayerType::fill) {
+            const auto &layerStyle = *static_cast<const FillLayerStyle*>(abstractLayerStyle);
+            resolve(ZoomProperty::FillColor, layerStyle.getFillColorAtZoom(zoom));
+            resolve(ZoomProperty::FillOpacity, layerStyle.getFillOpacityAtZoom(zoom));
+        } else if (abstractLayerStyle->type() == AbstractLayerStyle::LayerType::line) {
+            const auto &layerStyle = *static_cast<const LineLayerStyle*>(abstractLayerStyle);
+            resolve(ZoomProperty::LineColor, layerStyle.getLineColorAtZoom(zoom));
+            resolve(ZoomProperty::LineOpacity, layerStyle.getLineOpacityAtZoom(zoom));
+            resolve(ZoomProperty::LineWidth, layerStyle.getLineWidthAtZoom(zoom));
+        } else if (abstractLayerStyle->type() == AbstractLayerStyle::LayerType::symbol) {
+            const auto &layerStyle = *static_cast<const SymbolLayerStyle*>(abstractLayerStyle);
+            resolve(ZoomProperty::TextColor, layerStyle.getTextColorAtZoom(zoom));
+            resolve(ZoomProperty::TextSize, layerStyle.getTextSizeAtZoom(zoom));
+            resolve(ZoomProperty::TextOpacity, layerStyle.getTextOpacityAtZoom(zoom));
+            resolve(ZoomProperty::TextMaxAngle, layerStyle.getTextMaxAngleAtZoom(zoom));
+            resolve(ZoomProperty::TextLetterSpacing, layerStyle.getTextLetterSpacingAtZoom(zoom));
+            resolve(ZoomProperty::SymbolSpacing, layerStyle.getSymbolSpacingAtZoom(zoom));
+        }
+    }
+    return out;
+}
+
+/*!
+ * \brief Bach::ZoomPropertyCache::find returns the properties of a layer style.
+ *
+ * \param styleLayerIndex The position of the layer style in the stylesheet.
+ * \return The properties, or null if the index is outside the stylesheet.
+ */
+const Bach::ZoomPropertyValues *Bach::ZoomPropertyCache::find(int styleLayerIndex) const
+{
+    if (styleLayerIndex < 0 || styleLayerIndex >= layerValues.size())
+        return nullptr;
+    return &layerValues[styleLayerIndex];
+}
+
+/*!
+ * \internal
+ * \brief calcStyleZoom
+ * Calculates the zoom level style expressions are resolved at during a frame.
+ *
+ * This is the fractional map zoom level of the viewport, so properties change
+ * smoothly while zooming. If the map zoom level the frame is painted at was not picked
+ * from the viewport size, the map zoom level is used as it is.
+ *
+ * \param vpWidth The width of the viewport in pixels.
+ * \param vpHeight The height of the viewport in pixels.
+ * \param vpZoom Zoom level of the viewport.
+ * \param mapZoom Zoom level of the map.
+ * \return The zoom level, which rounds to mapZoom.
+ */
+static double calcStyleZoom(int vpWidth, int vpHeight, double vpZoom, int mapZoom)
+{
+    const double fractionalZoom = Bach::calcFractionalMapZoomLevel(vpWidth, vpHeight, vpZoom);
+    if (std::clamp((int)round(fractionalZoom), 0, Bach::maxZoomLevel) != mapZoom)
+        return mapZoom;
+    return fractionalZoom;
+}
+
 /*!
  * \internal
  * \threadsafe
@@ -224,6 +366,43 @@ static bool includeFeature(
         vpZoom).toBool();
 }
 
+/*!
+ * \brief isFeatureTooSmall determines if a feature is too small on screen to be worth drawing.
+ *
+ * The bounding box is calculated by reading the elements of the path directly,
+ * because the cached bounds of a QPainterPath are not safe to compute while
+ * other threads are reading the same path.
+ *
+ * \param path The geometry of the feature, in tile coordinates.
+ * \param tileWidthPixels The width of the tile in pixels.
+ * \param minSizePixels The minimum size in pixels. Zero means no feature is too small.
+ * \return True if the feature is smaller than minSizePixels in both directions.
+ */
+static bool isFeatureTooSmall(
+    const QPainterPath &path,
+    double tileWidthPixels,
+    double minSizePixels)
+{
+    if (minSizePixels <= 0 || path.elementCount() == 0)
+        return false;
+
+    QPainterPath::Element first = path.elementAt(0);
+    double minX = first.x;
+    double maxX = first.x;
+    double minY = first.y;
+    double maxY = first.y;
+    for (int i = 1; i < path.elementCount(); i++) {
+        QPainterPath::Element element = path.elementAt(i);
+        minX = qMin(minX, element.x);
+        maxX = qMax(maxX, element.x);
+        minY = qMin(minY, element.y);
+        maxY = qMax(maxY, element.y);
+    }
+    // The geometry is expressed in the 4096 extent of the tile.
+    const double scale = tileWidthPixels / 4096.0;
+    return (maxX - minX) * scale < minSizePixels && (maxY - minY) * scale < minSizePixels;
+}
+
 /*!
  * \brief paintVectorLayer_Fill
  * Call the polygon rendering function on all the layer's features that pass the layerStyle filter
@@ -236,6 +415,11 @@ static bool includeFeature(
  * \param mapZoom The map zoom level being rendered.
  * \param vpZoom The zoom level of the viewport.
  * \param geometryTransform the transform to be used to map the features into the correct position.
+ * \param tileWidthPixels The width of the tile in pixels.
+ * \param settings
+ * \param styleLayerIndex the index of the layerStyle within the stylesheet.
+ * \param zoomValues the properties of the layerStyle resolved for the frame.
+ * \param renderedFeaturesOut If not null, every feature drawn is added to it.
  */
 static void paintVectorLayer_Fill(
     QPainter &painter,
@@ -243,8 +427,14 @@ static void paintVectorLayer_Fill(
     const TileLayer& layer,
     double vpZoom,
     int mapZoom,
-    QTransform geometryTransform)
+    QTransform geometryTransform,
+    double tileWidthPixels,
+    const Bach::PaintVectorTileSettings &settings,
+    int styleLayerIndex,
+    const Bach::ZoomPropertyValues *zoomValues,
+    Bach::RenderedFeatureSet *renderedFeaturesOut)
 {
+    BACH_TRACE_SCOPE("Rendering::paintVectorLayer_Fill");
     // Iterate over all the features, and filter out anything that is not fill.
     for (const std::unique_ptr<AbstractLayerFeature> &abstractFeature : layer.m_features) {
         if (abstractFeature->type() != AbstractLayerFeature::featureType::polygon)
@@ -252,13 +442,27 @@ static void paintVectorLayer_Fill(
 
         const auto &feature = *static_cast<const PolygonFeature*>(abstractFeature.get());
 
+        if (isFeatureTooSmall(feature.polygon(), tileWidthPixels, settings.minFeatureSizePixels))
+            continue;
+
         if (!includeFeature(layerStyle, feature, mapZoom, vpZoom))
             continue;
 
         // Render the feature in question.
         painter.save();
-        Bach::paintSingleTileFeature_Polygon({&painter, &layerStyle, &feature, mapZoom, vpZoom, geometryTransform});
+        Bach::paintSingleTileFeature_Polygon({
+            &painter,
+            &layerStyle,
+            &feature,
+            mapZoom,
+            vpZoom,
+            geometryTransform,
+            settings.forceNoAntialiasing,
+            zoomValues });
         painter.restore();
+
+        if (renderedFeaturesOut != nullptr)
+            renderedFeaturesOut->features.insert({ &feature, styleLayerIndex });
     }
 }
 
@@ -274,6 +478,11 @@ static void paintVectorLayer_Fill(
  * \param mapZoom The map zoom level being rendered.
  * \param vpZoom The zoom level of the viewport.
  * \param geometryTransform the transform to be used to map the features into the correct position.
+ * \param tileWidthPixels The width of the tile in pixels.
+ * \param settings
+ * \param styleLayerIndex the index of the layerStyle within the stylesheet.
+ * \param zoomValues the properties of the layerStyle resolved for the frame.
+ * \param renderedFeaturesOut If not null, every feature drawn is added to it.
  */
 static void paintVectorLayer_Line(
     QPainter &painter,
@@ -281,52 +490,59 @@ static void paintVectorLayer_Line(
     const TileLayer& layer,
     double vpZoom,
     int mapZoom,
-    QTransform geometryTransform)
+    QTransform geometryTransform,
+    double tileWidthPixels,
+    const Bach::PaintVectorTileSettings &settings,
+    int styleLayerIndex,
+    const Bach::ZoomPropertyValues *zoomValues,
+    Bach::RenderedFeatureSet *renderedFeaturesOut)
 {
+    BACH_TRACE_SCOPE("Rendering::paintVectorLayer_Line");
     // Iterate over all the features, and filter out anything that is not line.
     for (const std::unique_ptr<AbstractLayerFeature> &abstractFeature : layer.m_features) {
         if (abstractFeature->type() != AbstractLayerFeature::featureType::line)
             continue;
         const auto &feature = *static_cast<const LineFeature*>(abstractFeature.get());
 
+        if (isFeatureTooSmall(feature.line(), tileWidthPixels, settings.minFeatureSizePixels))
+            continue;
+
         // Tests whether the feature should be rendered at all based on possible expression.
         if (!includeFeature(layerStyle, feature, mapZoom, vpZoom))
             continue;
 
         // Render the feature in question.
         painter.save();
-        Bach::paintSingleTileFeature_Line({&painter, &layerStyle, &feature, mapZoom, vpZoom, geometryTransform});
+        Bach::paintSingleTileFeature_Line({&painter, &layerStyle, &feature, mapZoom, vpZoom, geometryTransform, zoomValues});
         painter.restore();
+
+        if (renderedFeaturesOut != nullptr)
+            renderedFeaturesOut->features.insert({ &feature, styleLayerIndex });
     }
 }
 
 /*!
- * \brief processVectorLayer_Point
- * Call the text processing function on all the layer's features that pass the layerStyle filter.
- * For normal text, the processing function is called after that the features have been ordered according to the rank property.
- * This will update the vpTextList list with the text that passes the global collision filtering.
- * \param painter
- * The painter object to paint into.
- * It assumes the painter object has had its origin moved to the tiles origin, and is unscaled.
+ * \brief collectLabelRequests_Layer
+ * Creates label requests for all the layer's features that pass the layerStyle filter.
+ * Curved text is created from line features, and normal text from point features.
+ *
+ * This function does not touch any painter or shared state and can be run on any thread.
+ *
  * \param layerStyle the layerStyle to be used to filter/style this layer's features.
+ * \param styleLayerIndex the index of the layerStyle within the stylesheet.
  * \param layer the TileLayer containing the features to be rendered.
  * \param mapZoom The map zoom level being rendered.
  * \param vpZoom The zoom level of the viewport.
+ * \param tileWidthPixels The width of the tile in pixels.
+ * \param tileOriginX the x component of the tile's origin (used for text collistion detection)
+ * \param tileOriginY the y component of the tile's origin (used for text collistion detection)
  * \param geometryTransform the transform to be used to map the features into the correct position.
- * \param forceNoChangeFontType If set to true, the text font
- * rendered will be the one currently set by the QPainter object.
- * If set to false, it will try to use the font suggested by the stylesheet.
- * \param labelRects The list containing the bounding rectangles for all the text features that  have
- * been processed. This bounding rects have view port coordinates rather than tile coordinates, which means
- * that the collision detection will check for all the text in the map widget and not only the text in the current tile.
- * \param vpTextList a list of structs that contain all the texts that passed the collision filtering along with all the
- * details necessary to render the text.
- * \param vpCurvedTextList a list of structs that contain all the curved texts that passed the collision filtering along with all the
- * details necessary to render the text.
- */
-static void processVectorLayer_Point(
-    QPainter &painter,
+ * \param zoomValues the properties of the layerStyle resolved for the frame.
+ * \param requests The list the label requests are appended to.
+ */
+static void collectLabelRequests_Layer(
     const SymbolLayerStyle &layerStyle,
+    int styleLayerIndex,
     const TileLayer& layer,
     double vpZoom,
     int mapZoom,
@@ -334,60 +550,318 @@ static void processVectorLayer_Point(
     int tileOriginX,
     int tileOriginY,
     QTransform geometryTransform,
-    bool forceNoChangeFontType,
-    QVector<QRect> &labelRects,
-    QVector<Bach::vpGlobalText> &vpTextList,
-    QVector<Bach::vpGlobalCurvedText> &vpCurvedTextList)
+    const Bach::ZoomPropertyValues *zoomValues,
+    QVector<Bach::LabelRequest> &requests)
 {
-    QVector<QPair<int, PointFeature>> labels; //Used to order text rendering operation based on "rank" property.
-    // Iterate over all the features, and filter out anything that is not point.
+    // Iterate over all the features, and filter out anything that is not point or line.
     for (const std::unique_ptr<AbstractLayerFeature> &abstractFeature : layer.m_features) {
+        std::optional<Bach::LabelRequest> request;
         if (abstractFeature->type() == AbstractLayerFeature::featureType::line){
             const LineFeature &feature = *static_cast<const LineFeature*>(abstractFeature.get());
-            //Bach::paintSingleTileFeature_Point_Curved({&painter, &layerStyle, &feature, mapZoom, vpZoom, geometryTransform});
-            Bach::processSingleTileFeature_Point_Curved(
-                {&painter, &layerStyle, &feature, mapZoom, vpZoom, geometryTransform},
+            request = Bach::createLabelRequest_PointCurved(
+                {nullptr, &layerStyle, &feature, mapZoom, vpZoom, geometryTransform, zoomValues},
                 tileWidthPixels,
                 tileOriginX,
-                tileOriginY,
-                labelRects,
-                vpCurvedTextList);
+                tileOriginY);
         } else if (abstractFeature->type() == AbstractLayerFeature::featureType::point){
             //For normal text (continents /countries / cities / places / ...)
             const PointFeature &feature = *static_cast<const PointFeature*>(abstractFeature.get());
             // Tests whether the feature should be rendered at all based on possible expression.
             if (!includeFeature(layerStyle, feature, mapZoom, vpZoom))
                 continue;
+            request = Bach::createLabelRequest_Point(
+                {nullptr, &layerStyle, &feature, mapZoom, vpZoom, geometryTransform, zoomValues},
+                tileWidthPixels,
+                tileOriginX,
+                tileOriginY);
+        }
 
-            //Add the feature along with its "rank" (if present, defaults to 100) to the labels map.
-            if (feature.featureMetaData.contains("rank"))
-                labels.append(QPair<int, PointFeature>(feature.featureMetaData["rank"].toInt(), feature));
-            else
-                labels.append(QPair<int, PointFeature>(100, feature));
+        if (request.has_value()) {
+            request->styleLayerIndex = styleLayerIndex;
+            requests.append(std::move(request.value()));
         }
     }
+}
 
-    //Sort the labels map in increasing order based on the laber's "rank"
-    std::stable_sort(labels.begin(), labels.end(), [](const QPair<int, PointFeature>& a, const QPair<int, PointFeature>& b) {
-        return a.first < b.first;
+/*!
+ * \brief collectLabelRequests_Tile
+ * Creates the label requests of every visible symbol layer in a single tile.
+ *
+ * This function does not touch any painter or shared state and can be run on any thread.
+ *
+ * \param tileData The vector-data for this tile.
+ * \param mapZoom The map zoom level being rendered.
+ * \param vpZoom The zoom level of the viewport.
+ * \param styleSheet
+ * \param zoomProperties The properties of the layer styles resolved for the frame.
+ * \param tileScreenPlacement The position and size of the tile within the viewport.
+ * \return The label requests of this tile, in layer style and feature order.
+ */
+static QVector<Bach::LabelRequest> collectLabelRequests_Tile(
+    const VectorTile &tileData,
+    int mapZoom,
+    double vpZoom,
+    const StyleSheet &styleSheet,
+    const Bach::ZoomPropertyCache &zoomProperties,
+    TileScreenPlacement tileScreenPlacement)
+{
+    BACH_TRACE_SCOPE("Rendering::collectLabelRequests_Tile");
+    BACH_ALLOCATION_PHASE(Labels);
+    QVector<Bach::LabelRequest> requests;
+
+    QTransform geometryTransform;
+    geometryTransform.scale(
+        tileScreenPlacement.pixelWidth,
+        tileScreenPlacement.pixelWidth);
+
+    for (int i = 0; i < (int)styleSheet.m_layerStyles.size(); i++) {
+        const AbstractLayerStyle *abstractLayerStyle = styleSheet.m_layerStyles[i].get();
+        if (abstractLayerStyle->type() != AbstractLayerStyle::LayerType::symbol)
+            continue;
+        if (!isLayerShown(*abstractLayerStyle, mapZoom))
+            continue;
+
+        // Check if this layer style has an associated layer in the tile.
+        auto layerIt = tileData.m_layers.find(abstractLayerStyle->m_sourceLayer);
+        if (layerIt == tileData.m_layers.end())
+            continue;
+
+        collectLabelRequests_Layer(
+            *static_cast<const SymbolLayerStyle*>(abstractLayerStyle),
+            i,
+            *layerIt->second,
+            vpZoom,
+            mapZoom,
+            tileScreenPlacement.pixelWidth,
+            tileScreenPlacement.pixelPosX,
+            tileScreenPlacement.pixelPosY,
+            geometryTransform,
+            zoomProperties.find(i),
+            requests);
+    }
+    return requests;
+}
+
+/*!
+ * \brief Bach::prioritizeLabelRequests
+ * Merges the label requests of all tiles into a single queue, ordered by priority.
+ *
+ * Labels of earlier layer styles come first, and within a layer style labels are ordered
+ * by their "rank" across all tiles. Labels that are otherwise equal keep the tile and feature order,
+ * so the result never depends on the order worker threads finished in.
+ *
+ * \param tileRequests The label requests of each tile, in tile order.
+ * \return The requests, in the order they should be placed.
+ */
+QVector<Bach::LabelRequest> Bach::prioritizeLabelRequests(
+    const QVector<QVector<Bach::LabelRequest>> &tileRequests)
+{
+    BACH_TRACE_SCOPE("Rendering::prioritizeLabelRequests");
+    BACH_ALLOCATION_PHASE(Labels);
+    QVector<Bach::LabelRequest> queue;
+    for (const QVector<Bach::LabelRequest> &requests : tileRequests)
+        queue.append(requests);
+
+    std::stable_sort(queue.begin(), queue.end(), [](const Bach::LabelRequest &a, const Bach::LabelRequest &b) {
+        if (a.styleLayerIndex != b.styleLayerIndex)
+            return a.styleLayerIndex < b.styleLayerIndex;
+        return a.rank < b.rank;
     });
+    return queue;
+}
 
-    //Loop over the ordered label map and add the text that passes the collision filter to the vpTextList list.
-    for (const auto &pair : labels){
-        painter.save();
-        Bach::processSingleTileFeature_Point(
-            {&painter, &layerStyle, &pair.second, mapZoom, vpZoom, geometryTransform},
-            tileWidthPixels,
-            tileOriginX,
-            tileOriginY,
-            forceNoChangeFontType,
-            labelRects,
-            vpTextList);
-        painter.restore();
+/*!
+ * \brief Bach::findPossibleDuplicateLabels
+ * Finds the label requests that can be dropped as duplicates when they are placed.
+ *
+ * A request can only be a duplicate of a placed label of higher priority. A request
+ * that has no request earlier in the queue with the same layer style and text within its
+ * duplicate distance can therefore never be dropped, and is safe to lay out right away.
+ * Only the flagged requests need to wait for the placement to find out if they are shown.
+ *
+ * This only compares text and anchors, no text layout is done.
+ *
+ * \param queue The label requests, in the order they will be placed.
+ * \return A flag for each request in the queue, set if the request may turn out to be a duplicate.
+ */
+QVector<bool> Bach::findPossibleDuplicateLabels(const QVector<LabelRequest> &queue)
+{
+    BACH_TRACE_SCOPE("Rendering::findPossibleDuplicateLabels");
+    BACH_ALLOCATION_PHASE(Labels);
+    QVector<bool> possibleDuplicates(queue.size(), false);
+    QHash<QPair<int, QString>, QVector<QPointF>> earlierAnchors;
+    for (int i = 0; i < (int)queue.size(); i++) {
+        const LabelRequest &request = queue[i];
+        QVector<QPointF> &anchors = earlierAnchors[{ request.styleLayerIndex, request.text }];
+        const double minDistanceSquared = request.duplicateDistance * request.duplicateDistance;
+        possibleDuplicates[i] = std::any_of(anchors.begin(), anchors.end(), [&](const QPointF &anchor) {
+            QPointF diff = anchor - request.anchor;
+            return QPointF::dotProduct(diff, diff) < minDistanceSquared;
+        });
+        anchors.append(request.anchor);
+    }
+    return possibleDuplicates;
+}
+
+/*!
+ * \internal
+ * \brief The PlacedLabelAnchors class remembers where labels have been placed,
+ * so duplicates of them can be skipped.
+ *
+ * Labels are grouped by layer style and text. Only placed labels are recorded,
+ * so a label that failed layout or collided does not hide its duplicates.
+ */
+struct PlacedLabelAnchors {
+    QHash<QPair<int, QString>, QVector<QPointF>> anchors;
+
+    /*!
+     * \brief isDuplicate checks if a label with the same text and layer style has been
+     * placed closer than the symbol spacing of the request.
+     */
+    bool isDuplicate(const Bach::LabelRequest &request) const
+    {
+        auto it = anchors.find({ request.styleLayerIndex, request.text });
+        if (it == anchors.end())
+            return false;
+        const double minDistanceSquared = request.duplicateDistance * request.duplicateDistance;
+        return std::any_of(it->begin(), it->end(), [&](const QPointF &anchor) {
+            QPointF diff = anchor - request.anchor;
+            return QPointF::dotProduct(diff, diff) < minDistanceSquared;
+        });
+    }
+
+    void add(const Bach::LabelRequest &request)
+    {
+        anchors[{ request.styleLayerIndex, request.text }].append(request.anchor);
+    }
+};
+
+/*!
+ * \brief createLabelCandidate
+ * Lays out the text of a single label request.
+ *
+ * This function does not touch any painter or shared state and can be run on any thread.
+ *
+ * \param request The label to lay out.
+ * \param painterFont The font set by the QPainter object before rendering started.
+ * \param forceNoChangeFontType If set to true, the font set by the QPainter is used for all text.
+ * \return The laid out label, or std::nullopt if the text could not be laid out.
+ */
+static std::optional<Bach::LabelCandidate> createLabelCandidate(
+    const Bach::LabelRequest &request,
+    const QFont &painterFont,
+    bool forceNoChangeFontType)
+{
+    // Not traced, there is one call per label. See the "Rendering::layoutLabels" span.
+    BACH_ALLOCATION_PHASE(Labels);
+    if (request.isCurved) {
+        return Bach::createLabelCandidate_PointCurved(
+            {
+                nullptr,
+                request.layerStyle,
+                static_cast<const LineFeature*>(request.feature),
+                request.mapZoom,
+                request.vpZoom,
+                request.transformIn,
+                request.zoomValues },
+            request.text,
+            request.tileSize,
+            request.tileOriginX,
+            request.tileOriginY);
+    } else {
+        return Bach::createLabelCandidate_Point(
+            {
+                nullptr,
+                request.layerStyle,
+                static_cast<const PointFeature*>(request.feature),
+                request.mapZoom,
+                request.vpZoom,
+                request.transformIn,
+                request.zoomValues },
+            request.text,
+            request.tileSize,
+            request.tileOriginX,
+            request.tileOriginY,
+            painterFont,
+            forceNoChangeFontType);
     }
-    labels.clear();
 }
 
+/*!
+ * \internal
+ *
+ * \brief The ParallelJobs class runs a function for a range of item indices
+ * on a QThreadPool.
+ *
+ * The jobs are started with start(), and the caller is free to do other work
+ * until it calls finish(). The calling thread then takes part in the remaining work,
+ * and waits for the jobs that are still running. Jobs that never got to start
+ * are taken back from the thread pool, so this can not deadlock even if the
+ * thread pool is busy.
+ */
+class ParallelJobs {
+    QThreadPool &threadPool;
+    std::function<void(int)> itemFn;
+    int itemCount = 0;
+    std::atomic<int> nextItem { 0 };
+    QSemaphore jobsDone;
+    QVector<QRunnable*> jobs;
+
+    // Runs items until there are none left.
+    void runItems()
+    {
+        for (int i = nextItem++; i < itemCount; i = nextItem++)
+            itemFn(i);
+    }
+
+public:
+    ParallelJobs(QThreadPool &threadPool, int itemCount, std::function<void(int)> itemFn) :
+        threadPool{ threadPool },
+        itemFn{ std::move(itemFn) },
+        itemCount{ itemCount } {}
+
+    ParallelJobs(const ParallelJobs&) = delete;
+
+    ~ParallelJobs()
+    {
+        finish();
+    }
+
+    /*!
+     * \brief start queues up to one job per thread in the thread pool.
+     */
+    void start()
+    {
+        int jobCount = qMin(itemCount, threadPool.maxThreadCount());
+        for (int i = 0; i < jobCount; i++) {
+            QRunnable *job = QRunnable::create([this]() {
+                runItems();
+                jobsDone.release();
+            });
+            job->setAutoDelete(false);
+            jobs.append(job);
+            threadPool.start(job);
+        }
+    }
+
+    /*!
+     * \brief finish runs any remaining items on the calling thread
+     * and returns once every item is done.
+     */
+    void finish()
+    {
+        runItems();
+        for (QRunnable *job : jobs) {
+            // If the job was never started, it will never signal the semaphore.
+            if (threadPool.tryTake(job))
+                jobsDone.release();
+        }
+        jobsDone.acquire(jobs.size());
+        qDeleteAll(jobs);
+        jobs.clear();
+    }
+};
+
 /*!
  * \brief paintText
  * Loop over all the text elements that passed the collision filter and render them on screen.
@@ -400,6 +874,7 @@ static void paintText(
     QVector<Bach::vpGlobalText> &vpTextList,
     Bach::PaintVectorTileSettings params)
 {
+    BACH_ALLOCATION_PHASE(Labels);
 
     QPen pen;
     QTextCharFormat charFormat;
@@ -410,7 +885,9 @@ static void paintText(
     for(auto const &globalText : vpTextList){
         painter.save();
         //Remove any translations/scaling previously done on the painter's transform.
-        painter.resetTransform();
+        //The window/viewport mapping is kept, so that text also follows when
+        //the map is rendered at a different resolution than its logical size.
+        painter.setWorldTransform(QTransform());
         painter.setClipping(false);
         //move the painter to the origin of the tile that the text belongs to since the coordinates
         //of each text element is relative to its parent tile rather than the viewport.
@@ -454,6 +931,7 @@ static void paintText_Curved(
     QPainter &painter,
     QVector<Bach::vpGlobalCurvedText> &vpCurvedTextList)
 {
+    BACH_ALLOCATION_PHASE(Labels);
 
     QPen pen;
     QTextCharFormat charFormat;
@@ -463,7 +941,9 @@ static void paintText_Curved(
     for(auto const &globalText : vpCurvedTextList){
         painter.save();
         //Remove any translations/scaling previously done on the painter's transform.
-        painter.resetTransform();
+        //The window/viewport mapping is kept, so that text also follows when
+        //the map is rendered at a different resolution than its logical size.
+        painter.setWorldTransform(QTransform());
         painter.setClipping(false);
         //move the painter to the origin of the tile that the text belongs to since the coordinates
         //of each text element is relative to its parent tile rather than the viewport.
@@ -502,6 +982,142 @@ static void paintText_Curved(
 }
 
 
+/*!
+ * \internal
+ * \brief coversWholeTile checks if a polygon is a rectangle that covers the whole tile.
+ *
+ * Tiles with a single fill, like ocean tiles, have a rectangle reaching into
+ * the buffer around the tile. The elements of the path are read directly,
+ * for the same reason as in isFeatureTooSmall.
+ *
+ * \param path The geometry of the polygon, in tile coordinates.
+ * \param extent The size of the tile in tile coordinates.
+ * \return True if the polygon covers every point of the tile.
+ */
+static bool coversWholeTile(const QPainterPath &path, int extent)
+{
+    // Gather the corners of the ring, skipping repeated points and the closing point.
+    QVector<QPointF> corners;
+    for (int i = 0; i < path.elementCount(); i++) {
+        const QPainterPath::Element element = path.elementAt(i);
+        // More than one ring means there is a hole or a second polygon.
+        if (i > 0 && element.isMoveTo())
+            return false;
+        const QPointF point { element.x, element.y };
+        if (corners.isEmpty() || corners.last() != point)
+            corners.push_back(point);
+    }
+    if (corners.size() == 5 && corners.first() == corners.last())
+        corners.removeLast();
+    if (corners.size() != 4)
+        return false;
+
+    // Every edge has to be horizontal or vertical for the ring to be a rectangle.
+    for (int i = 0; i < 4; i++) {
+        const QPointF a = corners[i];
+        const QPointF b = corners[(i + 1) % 4];
+        if (a.x() != b.x() && a.y() != b.y())
+            return false;
+    }
+    double minX = corners[0].x();
+    double maxX = minX;
+    double minY = corners[0].y();
+    double maxY = minY;
+    for (QPointF corner : corners) {
+        minX = qMin(minX, corner.x());
+        maxX = qMax(maxX, corner.x());
+        minY = qMin(minY, corner.y());
+        maxY = qMax(maxY, corner.y());
+    }
+    return minX <= 0 && minY <= 0 && maxX >= extent && maxY >= extent;
+}
+
+/*!
+ * \brief Bach::analyzeSolidTile checks if a tile renders as a single color.
+ *
+ * This is the case when the last feature drawn is an opaque polygon covering the
+ * whole tile. Everything drawn before it is hidden, and nothing is drawn on top.
+ * Text is not part of the analysis, since it is drawn separately from the tiles.
+ *
+ * The result depends on the layer styles shown at the map zoom level, and on
+ * the filters and colors, which are resolved with the map zoom level.
+ *
+ * \param tileData The tile to analyze.
+ * \param styleSheet The stylesheet the tile is rendered with.
+ * \param mapZoom The map zoom level the tile is rendered at.
+ * \return The analysis. Not solid if anything but a single color is drawn.
+ */
+Bach::SolidTileInfo Bach::analyzeSolidTile(
+    const VectorTile &tileData,
+    const StyleSheet &styleSheet,
+    int mapZoom)
+{
+    BACH_TRACE_SCOPE("Rendering::analyzeSolidTile");
+    SolidTileInfo out;
+    for (int i = 0; i < (int)styleSheet.m_layerStyles.size(); i++) {
+        const AbstractLayerStyle *abstractLayerStyle = styleSheet.m_layerStyles[i].get();
+        if (!isLayerShown(*abstractLayerStyle, mapZoom))
+            continue;
+        const AbstractLayerStyle::LayerType layerType = abstractLayerStyle->type();
+        if (layerType != AbstractLayerStyle::LayerType::fill && layerType != AbstractLayerStyle::LayerType::line)
+            continue;
+        auto layerIt = tileData.m_layers.find(abstractLayerStyle->m_sourceLayer);
+        if (layerIt == tileData.m_layers.end())
+            continue;
+        const TileLayer &layer = *layerIt->second;
+
+        for (const std::unique_ptr<AbstractLayerFeature> &abstractFeature : layer.m_features) {
+            if (layerType == AbstractLayerStyle::LayerType::fill) {
+                if (abstractFeature->type() != AbstractLayerFeature::featureType::polygon)
+                    continue;
+                if (!includeFeature(*abstractLayerStyle, *abstractFeature, mapZoom, mapZoom))
+                    continue;
+
+                const auto &feature = *static_cast<const PolygonFeature*>(abstractFeature.get());
+                const auto &layerStyle = *static_cast<const FillLayerStyle*>(abstractLayerStyle);
+                const QColor color = getFillColor(layerStyle, feature, mapZoom, mapZoom);
+                if (color.alpha() == 255 && coversWholeTile(feature.polygon(), layer.extent())) {
+                    out = { true, color, &feature, i };
+                } else {
+                    // Drawn on top of what is below, so the tile has more than one color.
+                    out = {};
+                }
+            } else {
+                if (abstractFeature->type() != AbstractLayerFeature::featureType::line)
+                    continue;
+                if (!includeFeature(*abstractLayerStyle, *abstractFeature, mapZoom, mapZoom))
+                    continue;
+                out = {};
+            }
+        }
+    }
+    return out;
+}
+
+/*!
+ * \brief Bach::getSolidTileInfo gets the solid tile analysis of a tile.
+ *
+ * The analysis is run the first time a tile is rendered with a stylesheet
+ * at a map zoom level, and is cached in the tile.
+ *
+ * \threadsafe
+ *
+ * \param tileData The tile to analyze.
+ * \param styleSheet The stylesheet the tile is rendered with.
+ * \param mapZoom The map zoom level the tile is rendered at.
+ * \return The analysis.
+ */
+Bach::SolidTileInfo Bach::getSolidTileInfo(
+    const VectorTile &tileData,
+    const StyleSheet &styleSheet,
+    int mapZoom)
+{
+    return tileData.solidTileInfo(
+        &styleSheet,
+        mapZoom,
+        [&]() { return analyzeSolidTile(tileData, styleSheet, mapZoom); });
+}
+
 /*!
  * \internal
  *
@@ -510,7 +1126,8 @@ static void paintText_Curved(
  *
  * This is called repeatedly from the 'paintTiles' function.
  *
- * This does not handle background color.
+ * This does not handle background color or text,
+ * labels are laid out separately by collectLabelCandidates_Tile.
  *
  * \param tileData The vector-data for this tile.
  *
@@ -521,12 +1138,10 @@ static void paintText_Curved(
  * \param mapZoom The map zoom level being rendered.
  * \param vpZoom The zoom level of the viewport.
  * \param styleSheet
- * \param tileWidthPixels The width of the tile in pixels.
- * \param tileOriginX the x component of the tile's origin (used for text collistion detection)
- * \param tileOriginY the y component of the tile's origin (used for text collistion detection)
+ * \param zoomProperties The properties of the layer styles resolved for the frame.
+ * \param tileScreenPlacement The position and size of the tile within the viewport.
  * \param settings
- * \param labelRects the list containing all the bounding rectangle for previously processed text feratures (used for text collistion detection)
- * \param vpTextList the list containing all the text elements for all the tiles currently visible on the view port
+ * \param renderedFeaturesOut If not null, every feature drawn is added to it.
  */
 static void paintVectorTile(
     const VectorTile &tileData,
@@ -534,12 +1149,36 @@ static void paintVectorTile(
     int mapZoom,
     double vpZoom,
     const StyleSheet &styleSheet,
+    const Bach::ZoomPropertyCache &zoomProperties,
     TileScreenPlacement tileScreenPlacement,
     const Bach::PaintVectorTileSettings &settings,
-    QVector<QRect> &labelRects,
-    QVector<Bach::vpGlobalText> &vpTextList,
-    QVector<Bach::vpGlobalCurvedText> &vpCurvedTextList)
+    Bach::RenderedFeatureSet *renderedFeaturesOut)
 {
+    BACH_TRACE_SCOPE("Rendering::paintVectorTile");
+    BACH_ALLOCATION_PHASE(Render);
+
+    // Tiles covered by a single polygon, like ocean tiles at low zoom levels,
+    // are filled without going through the layer styles.
+    if (settings.drawFill) {
+        const Bach::SolidTileInfo solidTile = Bach::getSolidTileInfo(tileData, styleSheet, mapZoom);
+        // The analysis is cached per map zoom level, so the color is resolved again
+        // at the zoom level of the frame. A color that fades out is drawn normally.
+        const QColor solidColor = !solidTile.isSolid ? QColor{} : Bach::getFillColor(
+            *static_cast<const FillLayerStyle*>(styleSheet.m_layerStyles[solidTile.styleLayerIndex].get()),
+            *solidTile.feature,
+            mapZoom,
+            vpZoom,
+            zoomProperties.find(solidTile.styleLayerIndex));
+        if (solidTile.isSolid && solidColor.alpha() == 255) {
+            painter.fillRect(
+                QRectF{ 0, 0, tileScreenPlacement.pixelWidth, tileScreenPlacement.pixelWidth },
+                solidColor);
+            if (renderedFeaturesOut != nullptr)
+                renderedFeaturesOut->features.insert({ solidTile.feature, solidTile.styleLayerIndex });
+            return;
+        }
+    }
+
     QTransform geometryTransform;
     geometryTransform.scale(
         tileScreenPlacement.pixelWidth,
@@ -547,10 +1186,13 @@ static void paintVectorTile(
 
     // We start by iterating over each layer style, it determines the order
     // at which we draw the elements of the map.
-    for (const std::unique_ptr<AbstractLayerStyle> &abstractLayerStylePtr : styleSheet.m_layerStyles) {
-        const AbstractLayerStyle *abstractLayerStyle = abstractLayerStylePtr.get();
+    for (int i = 0; i < (int)styleSheet.m_layerStyles.size(); i++) {
+        const AbstractLayerStyle *abstractLayerStyle = styleSheet.m_layerStyles[i].get();
         if (!isLayerShown(*abstractLayerStyle, mapZoom))
             continue;
+        // Text is laid out separately from the geometry.
+        if (abstractLayerStyle->type() == AbstractLayerStyle::LayerType::symbol)
+            continue;
 
         // Check if this layer style has an associated layer in the tile.
         auto layerIt = tileData.m_layers.find(abstractLayerStyle->m_sourceLayer);
@@ -560,7 +1202,7 @@ static void paintVectorTile(
         // If we find it, we dereference it to access it's data.
         const TileLayer& layer = *layerIt->second;
 
-        // We do different types of rendering based on whether the layer is a polygon, line, or symbol(text).
+        // We do different types of rendering based on whether the layer is a polygon or line.
         if (abstractLayerStyle->type() == AbstractLayerStyle::LayerType::fill) {
             if (!settings.drawFill)
                 continue;
@@ -570,7 +1212,12 @@ static void paintVectorTile(
                 layer,
                 vpZoom,
                 mapZoom,
-                geometryTransform);
+                geometryTransform,
+                tileScreenPlacement.pixelWidth,
+                settings,
+                i,
+                zoomProperties.find(i),
+                renderedFeaturesOut);
 
         } else if (abstractLayerStyle->type() == AbstractLayerStyle::LayerType::line) {
             if (!settings.drawLines)
@@ -581,24 +1228,12 @@ static void paintVectorTile(
                 layer,
                 vpZoom,
                 mapZoom,
-                geometryTransform);
-        } else if(abstractLayerStyle->type() == AbstractLayerStyle::LayerType::symbol){
-            if (!settings.drawText)
-                continue;
-            processVectorLayer_Point(
-                painter,
-                *static_cast<const SymbolLayerStyle*>(abstractLayerStyle),
-                layer,
-                vpZoom,
-                mapZoom,
-                tileScreenPlacement.pixelWidth,
-                tileScreenPlacement.pixelPosX,
-                tileScreenPlacement.pixelPosY,
                 geometryTransform,
-                settings.forceNoChangeFontType,
-                labelRects,
-                vpTextList,
-                vpCurvedTextList);
+                tileScreenPlacement.pixelWidth,
+                settings,
+                i,
+                zoomProperties.find(i),
+                renderedFeaturesOut);
         }
     }
 }
@@ -647,6 +1282,72 @@ static void drawBackgroundColor(
     }
 }
 
+/*!
+ * \internal
+ * \brief calcVisibleTilePlacements
+ * Calculates the set of tiles that fit in the viewport, along with where each of them
+ * should be placed on screen.
+ *
+ * \param vpWidth The width of the viewport in pixels.
+ * \param vpHeight The height of the viewport in pixels.
+ * \param vpX center-coordinate X of the viewport in world-normalized coordinates.
+ * \param vpY center-coordinate Y of the viewport in world-normalized coordinates.
+ * \param vpZoom Zoom level of the viewport.
+ * \param mapZoom Zoom level of the map.
+ * \param wrapWorld If true, the world repeats horizontally. A tile visible in several
+ * copies of the world is returned once for each copy, with the same coordinate.
+ * \return The visible tiles in the order they are painted.
+ */
+static QVector<QPair<TileCoord, TileScreenPlacement>> calcVisibleTilePlacements(
+    int vpWidth,
+    int vpHeight,
+    double vpX,
+    double vpY,
+    double vpZoom,
+    int mapZoom,
+    bool wrapWorld)
+{
+    TilePosCalculator tilePosCalc = TilePosCalculator::create(
+        vpWidth,
+        vpHeight,
+        vpX,
+        vpY,
+        vpZoom,
+        mapZoom);
+
+    // Aspect ratio of the viewport.
+    double vpAspect = (double)vpWidth / (double)vpHeight;
+
+    QVector<QPair<TileCoord, TileScreenPlacement>> out;
+    if (wrapWorld) {
+        // Only the placement differs between the copies of a tile,
+        // so they all look up the same tile data.
+        const QVector<Bach::WrappedTileCoord> visibleTiles = Bach::calcVisibleTilesWrapped(
+            vpX,
+            vpY,
+            vpAspect,
+            vpZoom,
+            mapZoom);
+        out.reserve(visibleTiles.size());
+        for (const Bach::WrappedTileCoord &tile : visibleTiles)
+            out.append({ tile.coord, tilePosCalc.calcTileSizeData(tile.coord, tile.worldCopy) });
+        return out;
+    }
+
+    // Calculate the set of visible tiles that fit in the viewport.
+    QVector<TileCoord> visibleTiles = Bach::calcVisibleTiles(
+        vpX,
+        vpY,
+        vpAspect,
+        vpZoom,
+        mapZoom);
+
+    out.reserve(visibleTiles.size());
+    for (TileCoord tileCoord : visibleTiles)
+        out.append({ tileCoord, tilePosCalc.calcTileSizeData(tileCoord) });
+    return out;
+}
+
 /*!
  * \internal
  * \brief A helper class for painting vector-tiles and raster-tiles while reusing code.
@@ -661,6 +1362,8 @@ static void drawBackgroundColor(
  * \param vpZoom Zoom level of the viewport.
  * \param mapZoom Zoom level of the map.
  * \param paintSingleTileFn The function to call to draw a single tile.
+ * \param wrapWorld If true, the world repeats horizontally.
+ * The function is called once for every visible copy of a tile.
  */
 static void paintTilesGeneric(
     QPainter &painter,
@@ -670,7 +1373,8 @@ static void paintTilesGeneric(
     int mapZoom,
     const std::function<void(TileCoord, TileScreenPlacement)> &paintSingleTileFn,
     const StyleSheet &styleSheet,
-    bool drawDebug)
+    bool drawDebug,
+    bool wrapWorld)
 {
     // Start by drawing the background color on the entire canvas.
     drawBackgroundColor(painter, styleSheet, mapZoom);
@@ -679,29 +1383,16 @@ static void paintTilesGeneric(
     int vpWidth = painter.window().width();
     int vpHeight = painter.window().height();
 
-    TilePosCalculator tilePosCalc = TilePosCalculator::create(
+    // Iterate over all possible tiles that can possibly fit in this viewport.
+    const auto visibleTiles = calcVisibleTilePlacements(
         vpWidth,
         vpHeight,
         vpX,
         vpY,
         vpZoom,
-        mapZoom);
-
-    // Aspect ratio of the viewport.
-    double vpAspect = (double)vpWidth / (double)vpHeight;
-    // Calculate the set of visible tiles that fit in the viewport.
-    QVector<TileCoord> visibleTiles = Bach::calcVisibleTiles(
-        vpX,
-        vpY,
-        vpAspect,
-        vpZoom,
-        mapZoom);
-
-    // Iterate over all possible tiles that can possibly fit in this viewport.
-
-    for (TileCoord tileCoord : visibleTiles) {
-        TileScreenPlacement tilePlacement = tilePosCalc.calcTileSizeData(tileCoord);
-
+        mapZoom,
+        wrapWorld);
+    for (const auto &[tileCoord, tilePlacement] : visibleTiles) {
         painter.save();
 
         // We move the origin point of the painter to the top-left of the tile.
@@ -745,6 +1436,8 @@ static void paintTilesGeneric(
  * \param tileContainer contains all the tile-data available at this point in time.
  * \param styleSheet contains layer styling data.
  * \param drawDebug determines if debug lines should be drawn or not.
+ * \param renderedFeaturesOut If not null, it is cleared and filled with the tiles
+ * and features drawn in this frame. Used to answer feature queries.
  */
 void Bach::paintVectorTiles(
     QPainter &painter,
@@ -755,11 +1448,60 @@ void Bach::paintVectorTiles(
     const QMap<TileCoord, const VectorTile*> &tileContainer,
     const StyleSheet &styleSheet,
     const PaintVectorTileSettings &settings,
-    bool drawDebug)
+    bool drawDebug,
+    RenderedFeatureSet *renderedFeaturesOut)
 {
+    BACH_TRACE_SCOPE("Rendering::paintVectorTiles");
+    BACH_ALLOCATION_PHASE(Render);
+    const qint64 frameStartNs = Bach::metricsNowNs();
+    auto recordFrame = qScopeGuard([&]() { Bach::recordRenderedFrame(frameStartNs, Bach::metricsNowNs()); });
+    if (renderedFeaturesOut != nullptr)
+        renderedFeaturesOut->clear();
     QVector<QRect> labelRects;
     QVector<Bach::vpGlobalText> vpTextList;
     QVector<Bach::vpGlobalCurvedText> vpCurvedTextList;
+
+    // Properties that only depend on the zoom level are resolved once for the whole frame,
+    // at the fractional zoom level so they change smoothly while zooming.
+    const ZoomPropertyCache zoomProperties = ZoomPropertyCache::create(
+        styleSheet,
+        calcStyleZoom(painter.window().width(), painter.window().height(), viewportZoom, mapZoom));
+
+    // The label requests of each tile are gathered independently of the other tiles,
+    // either on worker threads while the geometry is painted, or on this thread afterwards.
+    const auto visibleTiles = calcVisibleTilePlacements(
+        painter.window().width(),
+        painter.window().height(),
+        vpX,
+        vpY,
+        viewportZoom,
+        mapZoom,
+        settings.wrapWorld);
+    QVector<QVector<Bach::LabelRequest>> tileLabelRequests(visibleTiles.size());
+    // Each job writes to its own element, we use the raw pointer so that
+    // no thread ever calls a non-const member of the container.
+    QVector<Bach::LabelRequest> *tileLabelRequestsData = tileLabelRequests.data();
+    auto collectTileLabelsFn = [&](int index) {
+        const auto &[tileCoord, tilePlacement] = visibleTiles[index];
+        auto tileIt = tileContainer.find(tileCoord);
+        if (tileIt == tileContainer.end())
+            return;
+
+        tileLabelRequestsData[index] = collectLabelRequests_Tile(
+            **tileIt,
+            mapZoom,
+            viewportZoom,
+            styleSheet,
+            zoomProperties,
+            tilePlacement);
+    };
+    ParallelJobs labelRequestJobs(
+        *QThreadPool::globalInstance(),
+        settings.drawText ? (int)visibleTiles.size() : 0,
+        collectTileLabelsFn);
+    if (settings.generateLabelsInParallel)
+        labelRequestJobs.start();
+
     auto paintSingleTileFn = [&](TileCoord tileCoord, TileScreenPlacement tilePlacement) {
         // See if the tile being rendered has any tile-data associated with it.
         auto tileIt = tileContainer.find(tileCoord);
@@ -767,17 +1509,18 @@ void Bach::paintVectorTiles(
             return;
 
         const VectorTile &tileData = **tileIt;
+        if (renderedFeaturesOut != nullptr)
+            renderedFeaturesOut->tiles.insert(tileCoord, &tileData);
         paintVectorTile(
             tileData,
             painter,
             mapZoom,
             viewportZoom,
             styleSheet,
+            zoomProperties,
             tilePlacement,
             settings,
-            labelRects,
-            vpTextList,
-            vpCurvedTextList);
+            renderedFeaturesOut);
     };
 
     paintTilesGeneric(
@@ -788,16 +1531,544 @@ void Bach::paintVectorTiles(
         mapZoom,
         paintSingleTileFn,
         styleSheet,
-        drawDebug);
+        drawDebug,
+        settings.wrapWorld);
+
+    // Gather whatever label requests are left and wait for the worker threads.
+    labelRequestJobs.finish();
+
+    // All the labels of the viewport are laid out and placed through a single queue ordered by priority.
+    const QVector<Bach::LabelRequest> labelQueue = Bach::prioritizeLabelRequests(tileLabelRequests);
+    // Requests that may be dropped as duplicates are not laid out up front.
+    // They are laid out during placement, and only if no duplicate of them was placed.
+    const QVector<bool> possibleDuplicates = settings.suppressDuplicateLabels
+        ? Bach::findPossibleDuplicateLabels(labelQueue)
+        : QVector<bool>(labelQueue.size(), false);
+    QVector<std::optional<Bach::LabelCandidate>> labelCandidates(labelQueue.size());
+    std::optional<Bach::LabelCandidate> *labelCandidatesData = labelCandidates.data();
+    const QFont painterFont = painter.font();
+    ParallelJobs labelLayoutJobs(
+        *QThreadPool::globalInstance(),
+        (int)labelQueue.size(),
+        [&](int index) {
+            if (possibleDuplicates[index])
+                return;
+            labelCandidatesData[index] = createLabelCandidate(
+                labelQueue[index],
+                painterFont,
+                settings.forceNoChangeFontType);
+        });
+    // Text layout uses the font engine, which some platforms only allow on the GUI thread.
+    // On those the labels are laid out here instead, which gives the same result.
+    {
+        BACH_TRACE_SCOPE("Rendering::layoutLabels");
+        if (settings.generateLabelsInParallel && QFontDatabase::supportsThreadedFontRendering())
+            labelLayoutJobs.start();
+        labelLayoutJobs.finish();
+    }
+
+    // The collision detection is done in queue order, so the labels that get placed
+    // do not depend on which thread finished first. A possible duplicate is only dropped
+    // if a label it duplicates was actually placed, so a label that fails to be placed
+    // can still be shown by a duplicate.
+    {
+        BACH_TRACE_SCOPE("Rendering::placeLabels");
+        BACH_ALLOCATION_PHASE(Labels);
+        PlacedLabelAnchors placedAnchors;
+        for (int i = 0; i < (int)labelCandidates.size(); i++) {
+            const Bach::LabelRequest &request = labelQueue[i];
+            if (possibleDuplicates[i]) {
+                if (placedAnchors.isDuplicate(request))
+                    continue;
+                labelCandidates[i] = createLabelCandidate(
+                    request,
+                    painterFont,
+                    settings.forceNoChangeFontType);
+            }
+            const std::optional<Bach::LabelCandidate> &candidate = labelCandidates[i];
+            if (!candidate.has_value())
+                continue;
+            const bool placed = Bach::placeLabelCandidate(candidate.value(), labelRects, vpTextList, vpCurvedTextList);
+            if (!placed)
+                continue;
+            if (settings.suppressDuplicateLabels)
+                placedAnchors.add(request);
+            if (renderedFeaturesOut != nullptr)
+                renderedFeaturesOut->features.insert({ request.feature, request.styleLayerIndex });
+        }
+    }
 
     //After rendering all the other layers , we render all the text that should be currently visible on the viewport.
-    paintText(painter, vpTextList, settings);
-    paintText_Curved(painter, vpCurvedTextList);
+    {
+        BACH_TRACE_SCOPE("Rendering::paintLabels");
+        paintText(painter, vpTextList, settings);
+        paintText_Curved(painter, vpCurvedTextList);
+    }
+}
+
+/*!
+ * \brief Bach::RenderedFeatureSet::clear removes every recorded tile and feature.
+ */
+void Bach::RenderedFeatureSet::clear()
+{
+    tiles.clear();
+    features.clear();
+}
+
+/*!
+ * \brief Bach::RenderedFeatureSet::containsTile
+ * \return True if the tile was drawn, using this exact tile data.
+ */
+bool Bach::RenderedFeatureSet::containsTile(TileCoord coord, const VectorTile *tile) const
+{
+    auto it = tiles.find(coord);
+    return it != tiles.end() && *it == tile;
+}
+
+/*!
+ * \brief Bach::RenderedFeatureSet::contains
+ * \return True if the feature was drawn by the layer style with the given index.
+ */
+bool Bach::RenderedFeatureSet::contains(const AbstractLayerFeature *feature, int styleLayerIndex) const
+{
+    return features.contains({ feature, styleLayerIndex });
+}
+
+/*!
+ * \internal
+ * \brief mapShownLayerStylesBySourceLayer
+ * Finds the layer styles that are shown at a map zoom level, grouped by the tile layer they draw.
+ *
+ * \return For every source layer, the indices of its layer styles in the stylesheet.
+ */
+static QHash<QString, QVector<int>> mapShownLayerStylesBySourceLayer(
+    const StyleSheet &styleSheet,
+    int mapZoom)
+{
+    QHash<QString, QVector<int>> out;
+    for (int i = 0; i < (int)styleSheet.m_layerStyles.size(); i++) {
+        const AbstractLayerStyle &layerStyle = *styleSheet.m_layerStyles[i];
+        if (layerStyle.type() == AbstractLayerStyle::LayerType::background)
+            continue;
+        if (!isLayerShown(layerStyle, mapZoom))
+            continue;
+        out[layerStyle.m_sourceLayer].append(i);
+    }
+    return out;
+}
+
+/*!
+ * \internal
+ * \brief isDrawnByLayerStyle determines if a layer style draws a feature.
+ *
+ * If the features of the frame were recorded, the recording is used so that the
+ * answer matches what was drawn. Otherwise the layer style's filter is evaluated.
+ *
+ * \return True if the feature is drawn by the layer style.
+ */
+static bool isDrawnByLayerStyle(
+    const AbstractLayerStyle &layerStyle,
+    int styleLayerIndex,
+    const AbstractLayerFeature &feature,
+    int mapZoom,
+    double vpZoom,
+    const Bach::RenderedFeatureSet *renderedFeatures)
+{
+    if (renderedFeatures != nullptr)
+        return renderedFeatures->contains(&feature, styleLayerIndex);
+
+    using LayerType = AbstractLayerStyle::LayerType;
+    using FeatureType = AbstractLayerFeature::featureType;
+    bool typeMatches = false;
+    switch (layerStyle.type()) {
+    case LayerType::fill:
+        typeMatches = feature.type() == FeatureType::polygon;
+        break;
+    case LayerType::line:
+        typeMatches = feature.type() == FeatureType::line;
+        break;
+    case LayerType::symbol:
+        typeMatches = feature.type() == FeatureType::point || feature.type() == FeatureType::line;
+        break;
+    default:
+        break;
+    }
+    return typeMatches && includeFeature(layerStyle, feature, mapZoom, vpZoom);
+}
+
+/*!
+ * \internal
+ * \brief calcViewportToTileTransform
+ * \return The transform from viewport pixels to the coordinates of a tile.
+ */
+static QTransform calcViewportToTileTransform(TileScreenPlacement tilePlacement)
+{
+    const double tileUnitsPerPixel = Bach::TileFeatureIndex::extent / tilePlacement.pixelWidth;
+    QTransform out;
+    out.scale(tileUnitsPerPixel, tileUnitsPerPixel);
+    out.translate(-tilePlacement.pixelPosX, -tilePlacement.pixelPosY);
+    return out;
+}
+
+/*!
+ * \internal
+ * \brief calcTileSearchRect
+ * Moves a rectangle in the viewport into the coordinates of a tile, and clips it to the tile.
+ * Each tile is clipped to its own area when painted, so only that area is searched.
+ *
+ * \return The rectangle in tile coordinates, or nothing if it is outside the tile.
+ */
+static std::optional<QRectF> calcTileSearchRect(const QRectF &vpRect, TileScreenPlacement tilePlacement)
+{
+    const QRectF tileRect = calcViewportToTileTransform(tilePlacement).mapRect(vpRect);
+    const QPointF searchMin {
+        qMax(tileRect.left(), 0.0),
+        qMax(tileRect.top(), 0.0) };
+    const QPointF searchMax {
+        qMin(tileRect.right(), Bach::TileFeatureIndex::extent),
+        qMin(tileRect.bottom(), Bach::TileFeatureIndex::extent) };
+    if (searchMin.x() > searchMax.x() || searchMin.y() > searchMax.y())
+        return std::nullopt;
+    return QRectF{ searchMin, searchMax };
+}
+
+/*!
+ * \internal
+ * \brief createRenderedFeatureHit fills in a hit from an entry of a tile's index.
+ */
+static Bach::RenderedFeatureHit createRenderedFeatureHit(
+    TileCoord tileCoord,
+    const Bach::FeatureIndexEntry &entry,
+    const AbstractLayerStyle &layerStyle,
+    int styleLayerIndex,
+    double distancePixels)
+{
+    Bach::RenderedFeatureHit hit;
+    hit.tileCoord = tileCoord;
+    hit.sourceLayer = entry.layer->name();
+    hit.styleLayerId = layerStyle.m_id;
+    hit.styleLayerIndex = styleLayerIndex;
+    hit.feature = entry.feature;
+    hit.featureType = entry.feature->type();
+    hit.attributes = entry.feature->featureMetaData;
+    hit.distancePixels = distancePixels;
+    return hit;
+}
+
+/*!
+ * \brief Bach::queryRenderedFeaturesAt finds the rendered features at a point in the viewport.
+ *
+ * The features are found through the spatial index of each tile, which is built
+ * the first time a tile is queried.
+ *
+ * The viewport parameters should be the same as the ones the frame was painted with.
+ *
+ * \param vpPos The point to search around, in viewport pixels.
+ * \param radiusPixels How far from the point a feature can be, in pixels.
+ * \param vpWidth The width of the viewport in pixels.
+ * \param vpHeight The height of the viewport in pixels.
+ * \param vpX center-coordinate X of the viewport in world-normalized coordinates.
+ * \param vpY center-coordinate Y of the viewport in world-normalized coordinates.
+ * \param viewportZoom Zoom level of the viewport.
+ * \param mapZoom Zoom level of the map.
+ * \param tileContainer The tile data to search.
+ * \param styleSheet The stylesheet the frame was painted with.
+ * \param renderedFeatures The features recorded by paintVectorTiles. If null, the filters of
+ * the stylesheet are evaluated instead, which ignores the PaintVectorTileSettings and label collisions.
+ * \param wrapWorld Should match PaintVectorTileSettings::wrapWorld of the frame.
+ * \return One hit per feature and layer style that drew it, topmost layer style first.
+ */
+QVector<Bach::RenderedFeatureHit> Bach::queryRenderedFeaturesAt(
+    QPointF vpPos,
+    double radiusPixels,
+    int vpWidth,
+    int vpHeight,
+    double vpX,
+    double vpY,
+    double viewportZoom,
+    int mapZoom,
+    const QMap<TileCoord, const VectorTile*> &tileContainer,
+    const StyleSheet &styleSheet,
+    const RenderedFeatureSet *renderedFeatures,
+    bool wrapWorld)
+{
+    BACH_TRACE_SCOPE("Rendering::queryRenderedFeaturesAt");
+    QVector<RenderedFeatureHit> hits;
+
+    const QHash<QString, QVector<int>> layerStyleIndices = mapShownLayerStylesBySourceLayer(styleSheet, mapZoom);
+    const auto visibleTiles = calcVisibleTilePlacements(
+        vpWidth,
+        vpHeight,
+        vpX,
+        vpY,
+        viewportZoom,
+        mapZoom,
+        wrapWorld);
+    for (const auto &[tileCoord, tilePlacement] : visibleTiles) {
+        auto tileIt = tileContainer.find(tileCoord);
+        if (tileIt == tileContainer.end())
+            continue;
+        const VectorTile &tileData = **tileIt;
+        if (renderedFeatures != nullptr && !renderedFeatures->containsTile(tileCoord, &tileData))
+            continue;
+
+        const std::optional<QRectF> searchRect = calcTileSearchRect(
+            QRectF{ vpPos - QPointF{ radiusPixels, radiusPixels }, vpPos + QPointF{ radiusPixels, radiusPixels } },
+            tilePlacement);
+        if (!searchRect.has_value())
+            continue;
+
+        // Move the point into the coordinates of this tile.
+        const double tileUnitsPerPixel = TileFeatureIndex::extent / tilePlacement.pixelWidth;
+        const QPointF tilePos = calcViewportToTileTransform(tilePlacement).map(vpPos);
+
+        tileData.featureIndex().query(searchRect.value(), [&](const FeatureIndexEntry &entry) {
+            auto stylesIt = layerStyleIndices.find(entry.layer->name());
+            if (stylesIt == layerStyleIndices.end())
+                return;
+
+            // The distance is only calculated once a layer style is found that draws the feature.
+            std::optional<double> distancePixels;
+            for (int styleLayerIndex : *stylesIt) {
+                const AbstractLayerStyle &layerStyle = *styleSheet.m_layerStyles[styleLayerIndex];
+                if (!isDrawnByLayerStyle(layerStyle, styleLayerIndex, *entry.feature, mapZoom, viewportZoom, renderedFeatures))
+                    continue;
+                if (!distancePixels.has_value())
+                    distancePixels = calcFeatureDistance(*entry.feature, tilePos) / tileUnitsPerPixel;
+                if (distancePixels.value() > radiusPixels)
+                    return;
+
+                hits.append(createRenderedFeatureHit(
+                    tileCoord,
+                    entry,
+                    layerStyle,
+                    styleLayerIndex,
+                    distancePixels.value()));
+            }
+        });
+    }
+
+    std::stable_sort(hits.begin(), hits.end(), [](const RenderedFeatureHit &a, const RenderedFeatureHit &b) {
+        if (a.styleLayerIndex != b.styleLayerIndex)
+            return a.styleLayerIndex > b.styleLayerIndex;
+        return a.distancePixels < b.distancePixels;
+    });
+    return hits;
+}
+
+/*!
+ * \internal
+ * \brief queryRenderedFeaturesInSelection
+ * Shared implementation of the queryRenderedFeatures overloads.
+ *
+ * \param selectionIsRect If true, the selection is a rectangle and features whose
+ * bounding box is inside it are reported without looking at their geometry.
+ */
+static void queryRenderedFeaturesInSelection(
+    const QPolygonF &vpSelection,
+    bool selectionIsRect,
+    const QStringList &styleLayerIds,
+    int vpWidth,
+    int vpHeight,
+    double vpX,
+    double vpY,
+    double viewportZoom,
+    int mapZoom,
+    const QMap<TileCoord, const VectorTile*> &tileContainer,
+    const StyleSheet &styleSheet,
+    const Bach::RenderedFeatureSet *renderedFeatures,
+    const Bach::RenderedFeatureCallbackFn &fn,
+    bool wrapWorld)
+{
+    BACH_TRACE_SCOPE("Rendering::queryRenderedFeatures");
+    if (vpSelection.isEmpty())
+        return;
+
+    QHash<QString, QVector<int>> layerStyleIndices = mapShownLayerStylesBySourceLayer(styleSheet, mapZoom);
+    if (!styleLayerIds.isEmpty()) {
+        for (QVector<int> &indices : layerStyleIndices) {
+            indices.removeIf([&](int i) {
+                return !styleLayerIds.contains(styleSheet.m_layerStyles[i]->m_id);
+            });
+        }
+    }
+
+    // Features that reach the edge of a tile can be split across several tiles.
+    // The parts share the id of the feature, so we remember which ones have been reported.
+    // Features inside a single tile can't be reported twice, so they are not stored.
+    QSet<QPair<int, quint64>> reportedSplitFeatures;
+    auto touchesTileEdge = [](const QRectF &bounds) {
+        return
+            bounds.left() <= 0 ||
+            bounds.top() <= 0 ||
+            bounds.right() >= Bach::TileFeatureIndex::extent ||
+            bounds.bottom() >= Bach::TileFeatureIndex::extent;
+    };
+
+    bool stopped = false;
+    const QRectF vpSelectionBounds = vpSelection.boundingRect();
+    const auto visibleTiles = calcVisibleTilePlacements(
+        vpWidth,
+        vpHeight,
+        vpX,
+        vpY,
+        viewportZoom,
+        mapZoom,
+        wrapWorld);
+    for (const auto &[tileCoord, tilePlacement] : visibleTiles) {
+        if (stopped)
+            return;
+        auto tileIt = tileContainer.find(tileCoord);
+        if (tileIt == tileContainer.end())
+            continue;
+        const VectorTile &tileData = **tileIt;
+        if (renderedFeatures != nullptr && !renderedFeatures->containsTile(tileCoord, &tileData))
+            continue;
+
+        const std::optional<QRectF> searchRect = calcTileSearchRect(vpSelectionBounds, tilePlacement);
+        if (!searchRect.has_value())
+            continue;
+        const QPolygonF tileSelection = calcViewportToTileTransform(tilePlacement).map(vpSelection);
+
+        tileData.featureIndex().query(searchRect.value(), [&](const Bach::FeatureIndexEntry &entry) {
+            if (stopped)
+                return;
+            auto stylesIt = layerStyleIndices.find(entry.layer->name());
+            if (stylesIt == layerStyleIndices.end())
+                return;
+
+            // The geometry is only tested once a layer style is found that draws the feature.
+            std::optional<bool> intersects;
+            for (int styleLayerIndex : *stylesIt) {
+                const AbstractLayerStyle &layerStyle = *styleSheet.m_layerStyles[styleLayerIndex];
+                if (!isDrawnByLayerStyle(layerStyle, styleLayerIndex, *entry.feature, mapZoom, viewportZoom, renderedFeatures))
+                    continue;
+                if (!intersects.has_value()) {
+                    intersects =
+                        (selectionIsRect && searchRect->contains(entry.bounds)) ||
+                        Bach::featureIntersectsPolygon(*entry.feature, tileSelection);
+                }
+                if (!intersects.value())
+                    return;
+
+                const quint64 featureId = entry.feature->id();
+                if (featureId != 0 && touchesTileEdge(entry.bounds)) {
+                    if (reportedSplitFeatures.contains({ styleLayerIndex, featureId }))
+                        continue;
+                    reportedSplitFeatures.insert({ styleLayerIndex, featureId });
+                }
+
+                if (!fn(createRenderedFeatureHit(tileCoord, entry, layerStyle, styleLayerIndex, 0))) {
+                    stopped = true;
+                    return;
+                }
+            }
+        });
+    }
+}
+
+/*!
+ * \brief Bach::queryRenderedFeatures finds the rendered features inside a selection in the viewport.
+ *
+ * Results are passed to the callback as they are found, tile by tile, so large selections
+ * don't need to hold every result in memory. A feature split across several tiles is only
+ * reported once, as long as the tiles give it an id. Features without an id are reported once per tile.
+ * When the world wraps, a feature is reported once for every copy of the world the selection covers.
+ *
+ * The viewport parameters should be the same as the ones the frame was painted with.
+ *
+ * \param vpSelection The selection, in viewport pixels. Uses the odd-even rule.
+ * \param styleLayerIds Only features drawn by these layer styles are reported.
+ * If empty, every layer style is included.
+ * \param vpWidth The width of the viewport in pixels.
+ * \param vpHeight The height of the viewport in pixels.
+ * \param vpX center-coordinate X of the viewport in world-normalized coordinates.
+ * \param vpY center-coordinate Y of the viewport in world-normalized coordinates.
+ * \param viewportZoom Zoom level of the viewport.
+ * \param mapZoom Zoom level of the map.
+ * \param tileContainer The tile data to search.
+ * \param styleSheet The stylesheet the frame was painted with.
+ * \param renderedFeatures The features recorded by paintVectorTiles. If null, the filters of
+ * the stylesheet are evaluated instead.
+ * \param fn Called once per feature and layer style that drew it. Returning false stops the query.
+ * \param wrapWorld Should match PaintVectorTileSettings::wrapWorld of the frame.
+ */
+void Bach::queryRenderedFeatures(
+    const QPolygonF &vpSelection,
+    const QStringList &styleLayerIds,
+    int vpWidth,
+    int vpHeight,
+    double vpX,
+    double vpY,
+    double viewportZoom,
+    int mapZoom,
+    const QMap<TileCoord, const VectorTile*> &tileContainer,
+    const StyleSheet &styleSheet,
+    const RenderedFeatureSet *renderedFeatures,
+    const RenderedFeatureCallbackFn &fn,
+    bool wrapWorld)
+{
+    queryRenderedFeaturesInSelection(
+        vpSelection,
+        false,
+        styleLayerIds,
+        vpWidth,
+        vpHeight,
+        vpX,
+        vpY,
+        viewportZoom,
+        mapZoom,
+        tileContainer,
+        styleSheet,
+        renderedFeatures,
+        fn,
+        wrapWorld);
+}
+
+/*!
+ * \brief Bach::queryRenderedFeatures finds the rendered features inside a rectangle in the viewport.
+ *
+ * Same as the overload taking a polygon, but features whose bounding box is
+ * inside the rectangle are reported without testing their geometry.
+ */
+void Bach::queryRenderedFeatures(
+    const QRectF &vpRect,
+    const QStringList &styleLayerIds,
+    int vpWidth,
+    int vpHeight,
+    double vpX,
+    double vpY,
+    double viewportZoom,
+    int mapZoom,
+    const QMap<TileCoord, const VectorTile*> &tileContainer,
+    const StyleSheet &styleSheet,
+    const RenderedFeatureSet *renderedFeatures,
+    const RenderedFeatureCallbackFn &fn,
+    bool wrapWorld)
+{
+    queryRenderedFeaturesInSelection(
+        QPolygonF{ vpRect },
+        true,
+        styleLayerIds,
+        vpWidth,
+        vpHeight,
+        vpX,
+        vpY,
+        viewportZoom,
+        mapZoom,
+        tileContainer,
+        styleSheet,
+        renderedFeatures,
+        fn,
+        wrapWorld);
 }
 
 /*!
  *  \brief paintRasterTiles
  *  Paints all tiles into a painter object, using raster-graphics.
+ *
+ *  If wrapWorld is true, the world repeats horizontally and
+ *  every copy of a tile is drawn from the same image.
  */
 void Bach::paintRasterTiles(
     QPainter &painter,
@@ -807,8 +2078,13 @@ void Bach::paintRasterTiles(
     int mapZoomLevel,
     const QMap<TileCoord, const QImage*> &tileContainer,
     const StyleSheet &styleSheet,
-    bool drawDebug)
+    bool drawDebug,
+    bool wrapWorld)
 {
+    BACH_TRACE_SCOPE("Rendering::paintRasterTiles");
+    BACH_ALLOCATION_PHASE(Render);
+    const qint64 frameStartNs = Bach::metricsNowNs();
+    auto recordFrame = qScopeGuard([&]() { Bach::recordRenderedFrame(frameStartNs, Bach::metricsNowNs()); });
     auto paintSingleTileFn = [&](TileCoord tileCoord, TileScreenPlacement tilePlacement) {
         // See if the tile being rendered has any tile-data associated with it.
         auto tileIt = tileContainer.find(tileCoord);
@@ -832,5 +2108,6 @@ void Bach::paintRasterTiles(
         mapZoomLevel,
         paintSingleTileFn,
         styleSheet,
-        drawDebug);
+        drawDebug,
+        wrapWorld);
 }
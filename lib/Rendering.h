@@ -8,6 +8,13 @@
 #include <QMap>
 #include <QPainter>
 #include <QPair>
+#include <QSet>
+#include <QStringList>
+
+// STL header files
+#include <array>
+#include <functional>
+#include <optional>
 
 // Other header files
 #include "LayerStyle.h"
@@ -28,6 +35,53 @@ namespace Bach {
      */
     const int defaultDesiredTileSizePixels = 512;
 
+    /*!
+     * \internal
+     * \brief The ZoomProperty enum lists the style properties that can be
+     * resolved once per frame, see ZoomPropertyValues.
+     */
+    enum class ZoomProperty {
+        FillColor,
+        FillOpacity,
+        LineColor,
+        LineOpacity,
+        LineWidth,
+        TextColor,
+        TextSize,
+        TextOpacity,
+        TextMaxAngle,
+        TextLetterSpacing,
+        SymbolSpacing,
+        Count,
+    };
+
+    /*!
+     * \internal
+     * \brief The ZoomPropertyValues class holds the properties of a single
+     * layer style, resolved at the zoom level of a frame.
+     *
+     * Only properties that only depend on the zoom level are held, every feature
+     * would resolve them to the same value. Expressions that depend on the feature
+     * are left invalid and are resolved for each feature.
+     *
+     * Only for internal use.
+     */
+    struct ZoomPropertyValues {
+        // The zoom level the properties are resolved at. Can be fractional.
+        double zoom = 0;
+        std::array<QVariant, (int)ZoomProperty::Count> values;
+
+        const QVariant &value(ZoomProperty property) const { return values[(int)property]; }
+    };
+
+    QVariant resolveStyleProperty(
+        const QVariant &property,
+        ZoomProperty propertyId,
+        const AbstractLayerFeature &feature,
+        int mapZoom,
+        double vpZoom,
+        const ZoomPropertyValues *zoomValues);
+
     /*!
      * \internal
      * \brief The PaintingDetailsPolygon class
@@ -42,6 +96,8 @@ namespace Bach {
         int mapZoom{};
         double vpZoom{};
         QTransform transformIn;
+        bool forceNoAntialiasing = false;
+        const ZoomPropertyValues *zoomValues = nullptr;
     };
 
     /*!
@@ -58,6 +114,7 @@ namespace Bach {
         int mapZoom{};
         double vpZoom{};
         QTransform transformIn;
+        const ZoomPropertyValues *zoomValues = nullptr;
     };
 
     /*!
@@ -74,6 +131,7 @@ namespace Bach {
         int mapZoom{};
         double vpZoom{};
         QTransform transformIn;
+        const ZoomPropertyValues *zoomValues = nullptr;
     };
 
     /*!
@@ -90,6 +148,7 @@ namespace Bach {
         int mapZoom{};
         double vpZoom{};
         QTransform transformIn;
+        const ZoomPropertyValues *zoomValues = nullptr;
     };
 
     /*!
@@ -142,6 +201,62 @@ namespace Bach {
         int outlineSize;
     };
 
+    /*!
+     * \internal
+     * \brief The LabelRequest class
+     * Describes a label that should be shown, before any text layout has been done.
+     *
+     * Requests are cheap to create. They are used to order all the labels of the viewport
+     * by priority before they are laid out, and to skip labels that duplicate a placed label.
+     *
+     * Only for internal use.
+     */
+    struct LabelRequest {
+        const SymbolLayerStyle *layerStyle = nullptr;
+        const AbstractLayerFeature *feature = nullptr;
+        // Determines whether the feature is a LineFeature with curved text or a PointFeature.
+        bool isCurved = false;
+        int mapZoom{};
+        double vpZoom{};
+        QTransform transformIn;
+        int tileSize{};
+        int tileOriginX{};
+        int tileOriginY{};
+        // Index of the layer style in the stylesheet. Earlier layer styles are placed first.
+        int styleLayerIndex{};
+        // The "rank" of the feature. Lower ranks are placed first.
+        int rank{};
+        // The text that will be shown.
+        QString text;
+        // Where the label is anchored, in viewport coordinates.
+        QPointF anchor;
+        // Labels with the same text closer than this distance, in pixels, are duplicates.
+        double duplicateDistance{};
+        // The properties of the layer style resolved for the frame. Can be null.
+        const ZoomPropertyValues *zoomValues = nullptr;
+    };
+
+    /*!
+     * \internal
+     * \brief The LabelCandidate class
+     * Holds a label that has been fully laid out but not yet gone through
+     * collision detection.
+     *
+     * Candidates can be created on any thread, since creating them does not
+     * touch the QPainter or any shared state. The collision detection is then done
+     * on the rendering thread, in a fixed order, through placeLabelCandidate.
+     *
+     * Only for internal use.
+     */
+    struct LabelCandidate {
+        // Bounding rect used for collision detection, in viewport coordinates.
+        QRect collisionRect;
+        // Determines which of the two text structs below holds the label.
+        bool isCurved = false;
+        vpGlobalText text;
+        vpGlobalCurvedText curvedText;
+    };
+
     /*!
      * \brief The MapCoordinate struct stores a map coordinate with a x and y.
      *
@@ -157,30 +272,58 @@ namespace Bach {
     MapCoordinate calcViewportSizeNorm(double viewportZoom, double viewportAspect);
     double normalizeValueToZeroOneRange(double value, double min, double max);
 
+    QColor getFillColor(
+        const FillLayerStyle &layerStyle,
+        const AbstractLayerFeature &feature,
+        int mapZoom,
+        double vpZoom,
+        const ZoomPropertyValues *zoomValues = nullptr);
+
     void paintSingleTileFeature_Polygon(PaintingDetailsPolygon details);
 
     void paintSingleTileFeature_Line(PaintingDetailsLine details);
 
 
-    void processSingleTileFeature_Point(
+    std::optional<LabelRequest> createLabelRequest_Point(
         PaintingDetailsPoint details,
-        const int tileSize,
-        const int tileOriginX,
-        const int tileOriginY,
-        const bool forceNoChangeFontType,
-        QVector<QRect> &rects,
-        QVector<vpGlobalText> &vpTextList);
+        int tileSize,
+        int tileOriginX,
+        int tileOriginY);
+
+    std::optional<LabelRequest> createLabelRequest_PointCurved(
+        PaintingDetailsPointCurved details,
+        int tileSize,
+        int tileOriginX,
+        int tileOriginY);
+
+    std::optional<LabelCandidate> createLabelCandidate_Point(
+        PaintingDetailsPoint details,
+        const QString &textToDraw,
+        int tileSize,
+        int tileOriginX,
+        int tileOriginY,
+        const QFont &painterFont,
+        bool forceNoChangeFontType);
 
     void paintSingleTileFeature_Point_Curved(PaintingDetailsPointCurved details);
 
-    void processSingleTileFeature_Point_Curved(
+    std::optional<LabelCandidate> createLabelCandidate_PointCurved(
         PaintingDetailsPointCurved details,
-        const int tileSize,
+        const QString &textToDraw,
+        int tileSize,
         int tileOriginX,
-        int tileOriginY,
+        int tileOriginY);
+
+    bool placeLabelCandidate(
+        const LabelCandidate &candidate,
         QVector<QRect> &rects,
+        QVector<vpGlobalText> &vpTextList,
         QVector<vpGlobalCurvedText> &vpCurvedTextList);
 
+    QVector<LabelRequest> prioritizeLabelRequests(const QVector<QVector<LabelRequest>> &tileRequests);
+
+    QVector<bool> findPossibleDuplicateLabels(const QVector<LabelRequest> &queue);
+
 
     int calcMapZoomLevelForTileSizePixels(
         int vpWidth,
@@ -188,6 +331,12 @@ namespace Bach {
         double vpZoom,
         int desiredTileSize = defaultDesiredTileSizePixels);
 
+    double calcFractionalMapZoomLevel(
+        int vpWidth,
+        int vpHeight,
+        double vpZoom,
+        int desiredTileSize = defaultDesiredTileSizePixels);
+
     QVector<TileCoord> calcVisibleTiles(
         double vpX,
         double vpY,
@@ -195,6 +344,26 @@ namespace Bach {
         double vpZoomLevel,
         int mapZoomLevel);
 
+    /*!
+     * \brief The WrappedTileCoord class holds a visible tile when the world wraps horizontally.
+     *
+     * The same tile can be visible several times, once for each copy of the world.
+     * The coordinate always points inside the map, so every copy uses the same tile data.
+     */
+    struct WrappedTileCoord {
+        TileCoord coord;
+        // Which copy of the world the tile belongs to. 0 is the original,
+        // -1 is the copy to the left of it and 1 is the copy to the right.
+        int worldCopy = 0;
+    };
+
+    QVector<WrappedTileCoord> calcVisibleTilesWrapped(
+        double vpX,
+        double vpY,
+        double vpAspect,
+        double vpZoomLevel,
+        int mapZoomLevel);
+
 
     /*!
      * \class Collection of settings that modify how vector tiles are rendered.
@@ -232,9 +401,116 @@ namespace Bach {
          */
         bool useQTextLayout = {};
 
+        /*!
+         * \brief
+         * Gathers and lays out the labels of each tile on worker threads while the
+         * geometry is being painted. The collision detection is always
+         * done afterwards on the calling thread in priority order,
+         * so the placed labels are the same as when this is turned off.
+         * Text layout stays on the calling thread if the platform does not
+         * support threaded font rendering.
+         */
+        bool generateLabelsInParallel = {};
+
+        /*!
+         * \brief
+         * Drops labels that have the same text as an already placed label of higher priority
+         * within the symbol-spacing of the layer style, for example a road name
+         * that is repeated in every tile the road passes through.
+         */
+        bool suppressDuplicateLabels = {};
+
+        /*!
+         * \brief
+         * Turns antialiasing off for all geometry, regardless of what the stylesheet says.
+         * Used for cheaper frames while the map is being moved.
+         */
+        bool forceNoAntialiasing = {};
+
+        /*!
+         * \brief
+         * Fill and line features whose on-screen bounding box is smaller than this
+         * in both directions, in pixels, are skipped.
+         * Zero means every feature is drawn.
+         */
+        double minFeatureSizePixels = {};
+
+        /*!
+         * \brief
+         * Repeats the world horizontally, so the map continues across the antimeridian.
+         * Every copy of a tile is drawn from the same tile data.
+         */
+        bool wrapWorld = {};
+
         static PaintVectorTileSettings getDefault();
     };
 
+    /*!
+     * \internal
+     * \brief The ZoomPropertyCache class holds the ZoomPropertyValues of every
+     * layer style in a stylesheet, for a single frame.
+     *
+     * It is created once before a frame is painted and is not changed afterwards,
+     * so it can be read from the threads that lay out labels.
+     *
+     * Only for internal use.
+     */
+    struct ZoomPropertyCache {
+        // Indexed by the position of the layer style in the stylesheet.
+        QVector<ZoomPropertyValues> layerValues;
+
+        static ZoomPropertyCache create(const StyleSheet &styleSheet, double zoom);
+        const ZoomPropertyValues *find(int styleLayerIndex) const;
+    };
+
+    /*!
+     * \brief The RenderedFeatureSet class records which features a frame drew.
+     *
+     * It lets feature queries answer with exactly what is on screen, without
+     * evaluating the filters of the stylesheet again.
+     * The pointers are only used as keys and are never dereferenced.
+     */
+    struct RenderedFeatureSet {
+        // The tile data each tile was drawn with.
+        QMap<TileCoord, const VectorTile*> tiles;
+        // Every feature drawn, paired with the index of the layer style that drew it.
+        QSet<std::pair<const AbstractLayerFeature*, int>> features;
+
+        void clear();
+        bool containsTile(TileCoord coord, const VectorTile *tile) const;
+        bool contains(const AbstractLayerFeature *feature, int styleLayerIndex) const;
+    };
+
+    /*!
+     * \brief The RenderedFeatureHit class describes a rendered feature found by a query.
+     */
+    struct RenderedFeatureHit {
+        TileCoord tileCoord;
+        // Name of the layer in the tile the feature is part of.
+        QString sourceLayer;
+        // Id of the layer style that drew the feature.
+        QString styleLayerId;
+        // Index of the layer style in the stylesheet. Higher indices are drawn on top.
+        int styleLayerIndex = 0;
+        // Only valid as long as the tile data passed to the query is.
+        const AbstractLayerFeature *feature = nullptr;
+        AbstractLayerFeature::featureType featureType = AbstractLayerFeature::featureType::unknown;
+        QMap<QString, QVariant> attributes;
+        // Distance from the query point to the geometry, in pixels.
+        // Zero if the point is inside a polygon.
+        double distancePixels = 0;
+    };
+
+    SolidTileInfo analyzeSolidTile(
+        const VectorTile &tileData,
+        const StyleSheet &styleSheet,
+        int mapZoom);
+
+    SolidTileInfo getSolidTileInfo(
+        const VectorTile &tileData,
+        const StyleSheet &styleSheet,
+        int mapZoom);
+
     void paintVectorTiles(
         QPainter &painter,
         double vpX,
@@ -244,7 +520,59 @@ namespace Bach {
         const QMap<TileCoord, const VectorTile*> &tileContainer,
         const StyleSheet &styleSheet,
         const PaintVectorTileSettings &settings,
-        bool drawDebug);
+        bool drawDebug,
+        RenderedFeatureSet *renderedFeaturesOut = nullptr);
+
+    /*!
+     * \brief Called for every feature found by queryRenderedFeatures.
+     * The feature pointer of the hit is valid during the call.
+     * Return false to stop the query.
+     */
+    using RenderedFeatureCallbackFn = std::function<bool(const RenderedFeatureHit&)>;
+
+    void queryRenderedFeatures(
+        const QPolygonF &vpSelection,
+        const QStringList &styleLayerIds,
+        int vpWidth,
+        int vpHeight,
+        double vpX,
+        double vpY,
+        double viewportZoom,
+        int mapZoom,
+        const QMap<TileCoord, const VectorTile*> &tileContainer,
+        const StyleSheet &styleSheet,
+        const RenderedFeatureSet *renderedFeatures,
+        const RenderedFeatureCallbackFn &fn,
+        bool wrapWorld = false);
+
+    void queryRenderedFeatures(
+        const QRectF &vpRect,
+        const QStringList &styleLayerIds,
+        int vpWidth,
+        int vpHeight,
+        double vpX,
+        double vpY,
+        double viewportZoom,
+        int mapZoom,
+        const QMap<TileCoord, const VectorTile*> &tileContainer,
+        const StyleSheet &styleSheet,
+        const RenderedFeatureSet *renderedFeatures,
+        const RenderedFeatureCallbackFn &fn,
+        bool wrapWorld = false);
+
+    QVector<RenderedFeatureHit> queryRenderedFeaturesAt(
+        QPointF vpPos,
+        double radiusPixels,
+        int vpWidth,
+        int vpHeight,
+        double vpX,
+        double vpY,
+        double viewportZoom,
+        int mapZoom,
+        const QMap<TileCoord, const VectorTile*> &tileContainer,
+        const StyleSheet &styleSheet,
+        const RenderedFeatureSet *renderedFeatures = nullptr,
+        bool wrapWorld = false);
 
     void paintRasterTiles(
         QPainter &painter,
@@ -254,7 +582,8 @@ namespace Bach {
         int mapZoomLevel,
         const QMap<TileCoord, const QImage*> &tileContainer,
         const StyleSheet &styleSheet,
-        bool drawDebug);
+        bool drawDebug,
+        bool wrapWorld = false);
 }
 
 #endif // RENDERING_HPP
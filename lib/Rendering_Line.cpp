@@ -1,7 +1,6 @@
 // Copyright (c) 2024 Cecilia Norevik Bratlie, Nils Petter Skålerud, Eimen Oueslati
 // SPDX-License-Identifier: MIT
 
-#include "Evaluator.h"
 #include "Rendering.h"
 
 
@@ -13,23 +12,24 @@
  * \param feature the feature to be used in case the QVariant is an expression
  * \param mapZoom the map zoom level to be used in case the QVariant is an expression
  * \param vpZoom the viewport zoom level to be used in case the QVariant is an expression
+ * \param zoomValues the properties of the layerStyle resolved for the frame, can be null
  * \return the QColor to be used to render the line
  */
 static QColor getLineColor(
     const LineLayerStyle &layerStyle,
     const LineFeature &feature,
     int mapZoom,
-    double vpZoom)
+    double vpZoom,
+    const Bach::ZoomPropertyValues *zoomValues)
 {
-    QVariant color = layerStyle.getLineColorAtZoom(mapZoom);
     // The layer style might return an expression, we need to resolve it.
-    if(color.typeId() == QMetaType::Type::QJsonArray){
-        color = Evaluator::resolveExpression(
-            color.toJsonArray(),
-            &feature,
-            mapZoom,
-            vpZoom);
-    }
+    QVariant color = Bach::resolveStyleProperty(
+        layerStyle.getLineColorAtZoom(mapZoom),
+        Bach::ZoomProperty::LineColor,
+        feature,
+        mapZoom,
+        vpZoom,
+        zoomValues);
     return color.value<QColor>();
 }
 
@@ -41,23 +41,24 @@ static QColor getLineColor(
  * \param feature the feature to be used in case the QVariant is an expression
  * \param mapZoom the map zoom level to be used in case the QVariant is an expression
  * \param vpZoom the viewport zoom level to be used in case the QVariant is an expression
+ * \param zoomValues the properties of the layerStyle resolved for the frame, can be null
  * \return a float for the opacity to be used to render the line
  */
 static float getLineOpacity(
     const LineLayerStyle &layerStyle,
     const LineFeature &feature,
     int mapZoom,
-    double vpZoom)
+    double vpZoom,
+    const Bach::ZoomPropertyValues *zoomValues)
 {
-    QVariant lineOpacity = layerStyle.getLineOpacityAtZoom(mapZoom);
     // The layer style might return an expression, we need to resolve it.
-    if(lineOpacity.typeId() == QMetaType::Type::QJsonArray){
-        lineOpacity = Evaluator::resolveExpression(
-            lineOpacity.toJsonArray(),
-            &feature,
-            mapZoom,
-            vpZoom);
-    }
+    QVariant lineOpacity = Bach::resolveStyleProperty(
+        layerStyle.getLineOpacityAtZoom(mapZoom),
+        Bach::ZoomProperty::LineOpacity,
+        feature,
+        mapZoom,
+        vpZoom,
+        zoomValues);
     return lineOpacity.value<float>();
 }
 
@@ -69,23 +70,24 @@ static float getLineOpacity(
  * \param feature the feature to be used in case the QVariant is an expression
  * \param mapZoom the map zoom level to be used in case the QVariant is an expression
  * \param vpZoom the viewport zoom level to be used in case the QVariant is an expression
+ * \param zoomValues the properties of the layerStyle resolved for the frame, can be null
  * \return an int for the line width value to be used to render the line
  */
 static int getLineWidth(
     const LineLayerStyle &layerStyle,
     const LineFeature &feature,
     int mapZoom,
-    double vpZoom)
+    double vpZoom,
+    const Bach::ZoomPropertyValues *zoomValues)
 {
-    QVariant lineWidth = layerStyle.getLineWidthAtZoom(mapZoom);
     // The layer style might return an expression, we need to resolve it.
-    if(lineWidth.typeId() == QMetaType::Type::QJsonArray){
-        lineWidth = Evaluator::resolveExpression(
-            lineWidth.toJsonArray(),
-            &feature,
-            mapZoom,
-            vpZoom);
-    }
+    QVariant lineWidth = Bach::resolveStyleProperty(
+        layerStyle.getLineWidthAtZoom(mapZoom),
+        Bach::ZoomProperty::LineWidth,
+        feature,
+        mapZoom,
+        vpZoom,
+        zoomValues);
     return lineWidth.value<int>();
 }
 
@@ -105,9 +107,9 @@ void Bach::paintSingleTileFeature_Line(Bach::PaintingDetailsLine details)
     const LineLayerStyle &layerStyle = *details.layerStyle;
     QPen pen = painter.pen();
 
-    pen.setColor(getLineColor(layerStyle, feature, details.mapZoom, details.vpZoom));
-    painter.setOpacity(getLineOpacity(layerStyle, feature,  details.mapZoom,  details.vpZoom));
-    pen.setWidth(getLineWidth(layerStyle, feature, details.mapZoom, details.vpZoom));
+    pen.setColor(getLineColor(layerStyle, feature, details.mapZoom, details.vpZoom, details.zoomValues));
+    painter.setOpacity(getLineOpacity(layerStyle, feature,  details.mapZoom,  details.vpZoom, details.zoomValues));
+    pen.setWidth(getLineWidth(layerStyle, feature, details.mapZoom, details.vpZoom, details.zoomValues));
     pen.setCapStyle(layerStyle.getCapStyle());
     pen.setJoinStyle(layerStyle.getJoinStyle());
     if(!layerStyle.m_lineDashArray.isEmpty()){
@@ -73,6 +73,32 @@ int Bach::calcMapZoomLevelForTileSizePixels(
     int vpHeight,
     double vpZoom,
     int desiredTileWidth)
+{
+    double newMapZoomLevel = calcFractionalMapZoomLevel(vpWidth, vpHeight, vpZoom, desiredTileWidth);
+
+    // Round to int, and clamp output to zoom level range.
+    return std::clamp((int)round(newMapZoomLevel), 0, maxZoomLevel);
+}
+
+/*!
+ * \brief Bach::calcFractionalMapZoomLevel calculates the zoom level that gives a displayed
+ * tile size of exactly desiredTileWidth.
+ *
+ * This is the zoom level before it's rounded by calcMapZoomLevelForTileSizePixels.
+ * It changes continuously with the viewport zoom, so it's used to evaluate style
+ * expressions without jumps between the map zoom levels.
+ *
+ * \param vpWidth is the width of the viewport in pixels.
+ * \param vpHeight is the height of the viewport in pixels.
+ * \param vpZoom is the zoom level of the viewport.
+ * \param desiredTileWidth is the desired size of tiles in pixels.
+ * \return the zoom level, in the range [0, maxZoomLevel].
+ */
+double Bach::calcFractionalMapZoomLevel(
+    int vpWidth,
+    int vpHeight,
+    double vpZoom,
+    int desiredTileWidth)
 {
     // Calculate current tile size based on the largest dimension and current scale
     int currentTileSize = qMax(vpWidth, vpHeight);
@@ -84,8 +110,7 @@ int Bach::calcMapZoomLevelForTileSizePixels(
     // needed to satisfy the pixel-size requirement.
     double newMapZoomLevel = vpZoom - log2(desiredScale);
 
-    // Round to int, and clamp output to zoom level range.
-    return std::clamp((int)round(newMapZoomLevel), 0, maxZoomLevel);
+    return std::clamp(newMapZoomLevel, 0.0, (double)maxZoomLevel);
 }
 
 /* Calculates the width and height of the viewport in world-normalized coordinates.
@@ -191,6 +216,63 @@ QVector<TileCoord> Bach::calcVisibleTiles(
     }
 }
 
+/*!
+ * \brief Bach::calcVisibleTilesWrapped calculates the set of visible tiles in a viewport
+ * when the world repeats horizontally.
+ *
+ * Works like calcVisibleTiles, except that the viewport is not clamped in the X direction.
+ * Tiles outside the map are wrapped back into it, and the copy of the world they belong
+ * to is returned alongside them. The same tile is returned once for every copy of the
+ * world that is visible.
+ *
+ * \param vpX is the center X coordinate of the viewport in world-normalized coordinates.
+ * Can be outside [0, 1].
+ * \param vpY is the center Y coordinate of the viewport in world-normalized coordinates.
+ * \param vpAspect is the aspect ratio of the viewport, expressed as a fraction width / height.
+ * \param vpZoomLevel is the zoom level of the viewport.
+ * \param mapZoomLevel is the zoom level of the map.
+ * \return a list of wrapped tile-coordinates, from left to right and top to bottom.
+ */
+QVector<Bach::WrappedTileCoord> Bach::calcVisibleTilesWrapped(
+    double vpX,
+    double vpY,
+    double vpAspect,
+    double vpZoomLevel,
+    int mapZoomLevel)
+{
+    mapZoomLevel = qMax(0, mapZoomLevel);
+
+    auto [vpWidthNorm, vpHeightNorm] = calcViewportSizeNorm(vpZoomLevel, vpAspect);
+
+    auto vpMinNormX = vpX - (vpWidthNorm / 2.0);
+    auto vpMaxNormX = vpX + (vpWidthNorm / 2.0);
+    auto vpMinNormY = vpY - (vpHeightNorm / 2.0);
+    auto vpMaxNormY = vpY + (vpHeightNorm / 2.0);
+
+    auto tileCount = 1 << mapZoomLevel;
+
+    auto clampToGrid = [&](int i) {
+        return std::clamp(i, 0, tileCount-1);
+    };
+
+    // Only the Y direction is clamped, the X direction continues into the copies of the world.
+    auto leftTileX = (int)floor(vpMinNormX * tileCount);
+    auto rightTileX = (int)floor(vpMaxNormX * tileCount);
+    auto topTileY = clampToGrid((int)floor(vpMinNormY * tileCount));
+    auto botTileY = clampToGrid((int)floor(vpMaxNormY * tileCount));
+
+    QVector<WrappedTileCoord> visibleTiles;
+    for (int y = topTileY; y <= botTileY; y++) {
+        for (int x = leftTileX; x <= rightTileX; x++) {
+            // Rounds towards negative infinity, so tiles left of the map get a negative copy.
+            int worldCopy = (int)floor((double)x / tileCount);
+            int wrappedX = x - worldCopy * tileCount;
+            visibleTiles += WrappedTileCoord{ { mapZoomLevel, wrappedX, y }, worldCopy };
+        }
+    }
+    return visibleTiles;
+}
+
 /*!
  * \brief normalizeValueToZeroOneRange normalizes a value from its original range to [0, 1]
  * \param value is the value to normalize.
@@ -1,50 +1,42 @@
 // Copyright (c) 2024 Cecilia Norevik Bratlie, Nils Petter Skålerud, Eimen Oueslati
 // SPDX-License-Identifier: MIT
 
-#include "Evaluator.h"
 #include "Rendering.h"
 
 /*!
- * \brief getFillColor
+ * \brief Bach::getFillColor
  * Get the QVariant of the color from the layerStyle and resolve and return it if its an expression,
  * or return it as a QColor otherwise. This function also gets the opacity of the polygon.
  * \param layerStyle the layerStyle containing the color variable.
  * \param feature The feature to be used in case the QVariant is an expression.
  * \param mapZoom The map zoom level to be used in case the QVariant is an expression.
  * \param vpZoom The viewport zoom level to be used in case the QVariant is an expression.
+ * \param zoomValues The properties of the layerStyle resolved for the frame. Can be null.
  * \return The QColor to be used to render the polygon.
  */
-static QColor getFillColor(
+QColor Bach::getFillColor(
     const FillLayerStyle &layerStyle,
     const AbstractLayerFeature &feature,
     int mapZoom,
-    double vpZoom)
+    double vpZoom,
+    const ZoomPropertyValues *zoomValues)
 {
-    QVariant colorVariant = layerStyle.getFillColorAtZoom(mapZoom);
-    QColor color;
     // The layer style might return an expression, that must be resolved.
-    if (colorVariant.typeId() == QMetaType::Type::QJsonArray){
-        color = Evaluator::resolveExpression(
-                    colorVariant.toJsonArray(),
-                    &feature,
-                    mapZoom,
-                    vpZoom).value<QColor>();
-    } else {
-        color = colorVariant.value<QColor>();
-    }
+    QColor color = resolveStyleProperty(
+        layerStyle.getFillColorAtZoom(mapZoom),
+        ZoomProperty::FillColor,
+        feature,
+        mapZoom,
+        vpZoom,
+        zoomValues).value<QColor>();
 
-    QVariant fillOpacityVariant = layerStyle.getFillOpacityAtZoom(mapZoom);
-    float fillOpacity;
-    // The layer style might return an expression, that must be resolved.
-    if (fillOpacityVariant.typeId() == QMetaType::Type::QJsonArray){
-        fillOpacity = Evaluator::resolveExpression(
-                          fillOpacityVariant.toJsonArray(),
-                          &feature,
-                          mapZoom,
-                          vpZoom).value<float>();
-    } else {
-        fillOpacity = fillOpacityVariant.value<float>();
-    }
+    float fillOpacity = resolveStyleProperty(
+        layerStyle.getFillOpacityAtZoom(mapZoom),
+        ZoomProperty::FillOpacity,
+        feature,
+        mapZoom,
+        vpZoom,
+        zoomValues).value<float>();
 
     color.setAlphaF(fillOpacity * color.alphaF());
     return color;
@@ -61,11 +53,11 @@ void Bach::paintSingleTileFeature_Polygon(Bach::PaintingDetailsPolygon details)
 {
     const FillLayerStyle &layerStyle = *details.layerStyle;
     const PolygonFeature &feature = *details.feature;
-    QColor brushColor = getFillColor(layerStyle, feature, details.mapZoom, details.vpZoom);
+    QColor brushColor = Bach::getFillColor(layerStyle, feature, details.mapZoom, details.vpZoom, details.zoomValues);
 
     QPainter &painter = *details.painter;
     painter.setBrush(brushColor);
-    painter.setRenderHints(QPainter::Antialiasing, layerStyle.m_antialias);
+    painter.setRenderHints(QPainter::Antialiasing, layerStyle.m_antialias && !details.forceNoAntialiasing);
     painter.setPen(Qt::NoPen);
 
     const QPainterPath &path = feature.polygon();
@@ -14,23 +14,24 @@
  * \param feature the feature to be used in case the QVariant is an expression
  * \param mapZoom the map zoom level to be used in case the QVariant is an expression
  * \param vpZoom the viewport zoom level to be used in case the QVariant is an expression
+ * \param zoomValues the properties of the layerStyle resolved for the frame, can be null
  * \return the QColor to be used to render the text
  */
 static QColor getTextColor(
     const SymbolLayerStyle &layerStyle,
     const AbstractLayerFeature &feature,
     int mapZoom,
-    double vpZoom)
+    double vpZoom,
+    const Bach::ZoomPropertyValues *zoomValues)
 {
-    QVariant color = layerStyle.getTextColorAtZoom(mapZoom);
     // The layer style might return an expression, we need to resolve it.
-    if(color.typeId() == QMetaType::Type::QJsonArray){
-        color = Evaluator::resolveExpression(
-            color.toJsonArray(),
-            &feature,
-            mapZoom,
-            vpZoom);
-    }
+    QVariant color = Bach::resolveStyleProperty(
+        layerStyle.getTextColorAtZoom(mapZoom),
+        Bach::ZoomProperty::TextColor,
+        feature,
+        mapZoom,
+        vpZoom,
+        zoomValues);
     return color.value<QColor>();
 }
 
@@ -43,23 +44,24 @@ static QColor getTextColor(
  * \param feature the feature to be used in case the QVariant is an expression
  * \param mapZoom the map zoom level to be used in case the QVariant is an expression
  * \param vpZoom the viewport zoom level to be used in case the QVariant is an expression
+ * \param zoomValues the properties of the layerStyle resolved for the frame, can be null
  * \return and int for the size to be used to render the text
  */
 static int getTextSize(
     const SymbolLayerStyle &layerStyle,
     const AbstractLayerFeature &feature,
     int mapZoom,
-    double vpZoom)
+    double vpZoom,
+    const Bach::ZoomPropertyValues *zoomValues)
 {
-    QVariant size = layerStyle.getTextSizeAtZoom(mapZoom);
     // The layer style might return an expression, we need to resolve it.
-    if(size.typeId() == QMetaType::Type::QJsonArray){
-        size = Evaluator::resolveExpression(
-            size.toJsonArray(),
-            &feature,
-            mapZoom,
-            vpZoom);
-    }
+    QVariant size = Bach::resolveStyleProperty(
+        layerStyle.getTextSizeAtZoom(mapZoom),
+        Bach::ZoomProperty::TextSize,
+        feature,
+        mapZoom,
+        vpZoom,
+        zoomValues);
     return size.value<int>();
 }
 
@@ -72,23 +74,24 @@ static int getTextSize(
  * \param feature the feature to be used in case the QVariant is an expression
  * \param mapZoom the map zoom level to be used in case the QVariant is an expression
  * \param vpZoom the viewport zoom level to be used in case the QVariant is an expression
+ * \param zoomValues the properties of the layerStyle resolved for the frame, can be null
  * \return a float for the opacity to be used to render the text
  */
 static float getTextOpacity(
     const SymbolLayerStyle &layerStyle,
     const AbstractLayerFeature &feature,
     int mapZoom,
-    double vpZoom)
+    double vpZoom,
+    const Bach::ZoomPropertyValues *zoomValues)
 {
-    QVariant opacity = layerStyle.getTextOpacityAtZoom(mapZoom);
     // The layer style might return an expression, we need to resolve it.
-    if(opacity.typeId() == QMetaType::Type::QJsonArray){
-        opacity = Evaluator::resolveExpression(
-            opacity.toJsonArray(),
-            &feature,
-            mapZoom,
-            vpZoom);
-    }
+    QVariant opacity = Bach::resolveStyleProperty(
+        layerStyle.getTextOpacityAtZoom(mapZoom),
+        Bach::ZoomProperty::TextOpacity,
+        feature,
+        mapZoom,
+        vpZoom,
+        zoomValues);
     return opacity.value<float>();
 }
 
@@ -140,23 +143,24 @@ static QString getTextContent(
  * \param feature the feature to be used in case the QVariant is an expression
  * \param mapZoom the map zoom level to be used in case the QVariant is an expression
  * \param vpZoom the viewport zoom level to be used in case the QVariant is an expression
+ * \param zoomValues the properties of the layerStyle resolved for the frame, can be null
  * \return an int with the max angle value
  */
 static int getTextMaxAngle(
     const SymbolLayerStyle &layerStyle,
     const AbstractLayerFeature &feature,
     int mapZoom,
-    double vpZoom)
+    double vpZoom,
+    const Bach::ZoomPropertyValues *zoomValues)
 {
-    QVariant angle = layerStyle.getTextMaxAngleAtZoom(mapZoom);
     // The layer style might return an expression, we need to resolve it.
-    if(angle.typeId() == QMetaType::Type::QJsonArray){
-        angle = Evaluator::resolveExpression(
-            angle.toJsonArray(),
-            &feature,
-            mapZoom,
-            vpZoom);
-    }
+    QVariant angle = Bach::resolveStyleProperty(
+        layerStyle.getTextMaxAngleAtZoom(mapZoom),
+        Bach::ZoomProperty::TextMaxAngle,
+        feature,
+        mapZoom,
+        vpZoom,
+        zoomValues);
     return angle.value<int>();
 }
 
@@ -168,6 +172,7 @@ static int getTextMaxAngle(
  * \param feature the feature to be used in case the QVariant is an expression
  * \param mapZoom the map zoom level to be used in case the QVariant is an expression
  * \param vpZoom the viewport zoom level to be used in case the QVariant is an expression
+ * \param zoomValues the properties of the layerStyle resolved for the frame, can be null
  * \param fontSize used to convert the spacing value from ems to pixels
  * \return an int with the max angle value
  */
@@ -176,23 +181,92 @@ static float getTextLetterSpacing(
     const AbstractLayerFeature &feature,
     int mapZoom,
     double vpZoom,
+    const Bach::ZoomPropertyValues *zoomValues,
     int fontSize)
 {
-    QVariant spacing = layerStyle.getTextLetterSpacingAtZoom(mapZoom);
     // The layer style might return an expression, we need to resolve it.
-    if(spacing.typeId() == QMetaType::Type::QJsonArray){
-        spacing = Evaluator::resolveExpression(
-            spacing.toJsonArray(),
-            &feature,
-            mapZoom,
-            vpZoom);
-    }
+    QVariant spacing = Bach::resolveStyleProperty(
+        layerStyle.getTextLetterSpacingAtZoom(mapZoom),
+        Bach::ZoomProperty::TextLetterSpacing,
+        feature,
+        mapZoom,
+        vpZoom,
+        zoomValues);
     float spacingValue = spacing.value<float>() * fontSize;
     return spacingValue;
 }
 
 
 
+/*!
+ * \brief getSymbolSpacing
+ * Get the minimum distance between two labels with the same text.
+ * \param layerStyle the layerStyle containing the spacing variable
+ * \param feature the feature to be used in case the QVariant is an expression
+ * \param mapZoom the map zoom level to be used in case the QVariant is an expression
+ * \param vpZoom the viewport zoom level to be used in case the QVariant is an expression
+ * \param zoomValues the properties of the layerStyle resolved for the frame, can be null
+ * \return the spacing in pixels
+ */
+static int getSymbolSpacing(
+    const SymbolLayerStyle &layerStyle,
+    const AbstractLayerFeature &feature,
+    int mapZoom,
+    double vpZoom,
+    const Bach::ZoomPropertyValues *zoomValues)
+{
+    // The layer style might return an expression, we need to resolve it.
+    QVariant spacing = Bach::resolveStyleProperty(
+        layerStyle.getSymbolSpacingAtZoom(mapZoom),
+        Bach::ZoomProperty::SymbolSpacing,
+        feature,
+        mapZoom,
+        vpZoom,
+        zoomValues);
+    return spacing.value<int>();
+}
+
+/*!
+ * \brief getLabelRank
+ * Get the "rank" of a feature, used to order labels. Labels with a lower rank are placed first.
+ * \param feature the feature to get the rank of
+ * \return the rank of the feature if present, or 100 otherwise.
+ */
+static int getLabelRank(const AbstractLayerFeature &feature)
+{
+    if (feature.featureMetaData.contains("rank"))
+        return feature.featureMetaData["rank"].toInt();
+    return 100;
+}
+
+/*!
+ * \brief getPointLabelCoordinates
+ * Gets the position of a point label within its tile.
+ * \param feature the text feature
+ * \param tileSize the size of the current tile in pixels.
+ * \return the position in pixels relative to the tile origin.
+ */
+static QPoint getPointLabelCoordinates(const PointFeature &feature, int tileSize)
+{
+    // Get the coordinates for the text rendering
+    // We don't actually know why
+    // but when there are 3 points inside the text feature,
+    // only index 1 contains the one we expect.
+    // possible explanation: the extra coordinated might be there for map duplication (infinite horizontal scrolling)
+    const QList<QPoint> points = feature.points();
+    QPoint coordinates;
+    if (points.length() > 1) {
+        coordinates = points.at(1);
+    } else {
+        coordinates = points.at(0);
+    }
+    QTransform transform = {};
+    transform.scale(1 / 4096.0, 1 / 4096.0);
+    transform.scale(tileSize, tileSize);
+    //Remap the original coordinates so that they are positioned correctly.
+    return transform.map(coordinates);
+}
+
 /*!
  * \brief isOverlapping
  * Checks if the passed QRect intersects any QRects in the passed list. This is used to eliminate text
@@ -249,37 +323,35 @@ static QList<QString> getCorrectedText(
 
 
 /*!
- * \brief processSimpleText
- * This function renders text that fits in one line and does not require wrapping.
+ * \brief createSimpleTextCandidate
+ * This function lays out text that fits in one line and does not require wrapping.
  * \param text the text to be rendered
  * \param coordinate the coordinates where the text should be rendered. The text is rendered so that the point is right in the middle of the bounding rect of the text.
  * \param outlineSize the width of the text outline.
  * \param outlineColor the color of the text outline
  * \param textFont the text font
- * \param rects the QList of previously rendered texts to be used to check for overlapping.
- * \param painter The painter object to paint into.
  * \param feature the text feature
  * \param layerStyle the layerStyle to style the text
  * \param mapZoom
  * \param vpZoom
+ * \param zoomValues the properties of the layerStyle resolved for the frame, can be null
  * \param tileOriginX the x component of this feature's parent tile's origin (used for text collistion detection)
  * \param tileOriginY the y component of this feature's parent tile's origin (used for text collistion detection)
- * \param vpTextList the list of text features that this text will be added to
+ * \return the laid out label, ready for collision detection.
  */
-static void processSimpleText(
+static Bach::LabelCandidate createSimpleTextCandidate(
     const QString &text,
     const QPoint &coordinate,
     int outlineSize,
     const QColor &outlineColor,
     const QFont &textFont,
-    QVector<QRect> &rects,
     const PointFeature &feature,
     const SymbolLayerStyle &layerStyle,
     int mapZoom,
     double vpZoom,
+    const Bach::ZoomPropertyValues *zoomValues,
     int tileOriginX,
-    int tileOriginY,
-    QVector<Bach::vpGlobalText> &vpTextList)
+    int tileOriginY)
 {
 
     //Create a QPainterPath for the text.
@@ -302,7 +374,7 @@ static void processSimpleText(
     boundingRect.translate({textCenteringOffsetX, textCenteringOffsetY});
     boundingRect.translate(coordinate);
 
-    //Check if the text overlaps with any previously processed text.
+    //This is the rect used to check if the text overlaps with any other text.
     QRect globalRect {
         QPoint {
             (int)(tileOriginX + coordinate.x() - boundingRect.width()/2),
@@ -310,58 +382,56 @@ static void processSimpleText(
         QSize {
             (int)boundingRect.width(),
             (int)boundingRect.height() } };
-    if(isOverlapping(globalRect, rects)) return;
-    //Add the total bouding rect to the list of the text rects to check for overlap for upcoming text.
-    rects.append(globalRect);
-    //add the feature's details to the vpTextList
-    vpTextList.append({ QPoint(tileOriginX, tileOriginY),
+    Bach::LabelCandidate candidate;
+    candidate.collisionRect = globalRect;
+    //Store the feature's details so the text can be added to the vpTextList once placed.
+    candidate.text = { QPoint(tileOriginX, tileOriginY),
         { textPath },
         { text },
         { QPoint{
             (int)(coordinate.x() + textCenteringOffsetX),
             (int)(coordinate.y() + textCenteringOffsetY) } },
         textFont,
-        getTextColor(layerStyle, feature, mapZoom, vpZoom),
+        getTextColor(layerStyle, feature, mapZoom, vpZoom, zoomValues),
         outlineSize,
         outlineColor,
-        boundingRect.toRect()});
+        boundingRect.toRect()};
+    return candidate;
 }
 
 
-/* Render a text that should be drawn on multiple lines.
+/* Lay out a text that should be drawn on multiple lines.
  */
 /*!
- * \brief processCompositeText
- * This function renders text that requires myltiple lines
+ * \brief createCompositeTextCandidate
+ * This function lays out text that requires myltiple lines
  * \param texts the List containing the strings of text to be rendered, each on a separate line.
  * \param coordinates the coordinates where the text should be rendered. The text is rendered so that the point is right in the middle of the union of all the bounding rects of the text strings.
  * \param outlineSize the width of the text outline.
  * \param outlineColor the color of the text outline
  * \param textFont the text font
- * \param rects the QList of previously rendered texts to be used to check for overlapping.
- * \param painter The painter object to paint into.
  * \param feature the text feature
  * \param layerStyle the layerStyle to style the text
  * \param mapZoom
  * \param vpZoom
+ * \param zoomValues the properties of the layerStyle resolved for the frame, can be null
  * \param tileOriginX the x component of this feature's parent tile's origin (used for text collistion detection)
  * \param tileOriginY the y component of this feature's parent tile's origin (used for text collistion detection)
- * \param vpTextList the list of text features that this text will be added to
+ * \return the laid out label, ready for collision detection.
  */
-static void processCompositeText(
+static Bach::LabelCandidate createCompositeTextCandidate(
     const QList<QString> &texts,
     const QPoint &coordinates,
     int outlineSize,
-    QColor &outlineColor,
+    const QColor &outlineColor,
     const QFont &textFont,
-    QVector<QRect> &rects,
     const PointFeature &feature,
     const SymbolLayerStyle &layerStyle,
     int mapZoom,
     double vpZoom,
+    const Bach::ZoomPropertyValues *zoomValues,
     int tileOriginX,
-    int tileOriginY,
-    QVector<Bach::vpGlobalText> &vpTextList)
+    int tileOriginY)
 {
     //The font metrics var is used to calculate how much space does each word consume.
     QFontMetricsF fmetrics(textFont);
@@ -408,7 +478,7 @@ static void processCompositeText(
         boundingRect = boundingRect.united(path.boundingRect().toRect());
     }
 
-    //Check if the text overlaps with any previously rendered text.
+    //This is the rect used to check if the text overlaps with any other text.
      QRect globalRect {
         QPoint {
             (tileOriginX + coordinates.x()) - boundingRect.width()/2,
@@ -416,142 +486,198 @@ static void processCompositeText(
         QSize {
             boundingRect.width(),
             boundingRect.height() } };
-    if(isOverlapping(globalRect, rects)) return;
-    //Add the total bouding rect to the list of the text rects to check for overlap for upcoming text.
-    rects.append(globalRect);
-    //add the feature's details to the vpTextList
+    Bach::LabelCandidate candidate;
+    candidate.collisionRect = globalRect;
+    //Store the feature's details so the text can be added to the vpTextList once placed.
     QList<QPainterPath> pathsList;
     for(const QPainterPath &path : paths){
         pathsList.append(path);
     }
-    vpTextList.append({
+    candidate.text = {
         QPoint{ tileOriginX, tileOriginY },
         pathsList,
         texts,
         points,
         textFont,
-        getTextColor(layerStyle, feature, mapZoom, vpZoom),
+        getTextColor(layerStyle, feature, mapZoom, vpZoom, zoomValues),
         outlineSize,
         outlineColor,
-        boundingRect});
+        boundingRect};
+    return candidate;
+}
+
+/*!
+ * \brief Bach::createLabelRequest_Point
+ * Creates the request for a point label, without doing any text layout.
+ *
+ * The function does not use the QPainter in the details struct, and can be called from any thread.
+ *
+ * \param details the struct containig all the elemets needed to paint the feature includeing the layerStyle and the feature itself.
+ * \param tileSize the size of the current tile in pixels, used to scale the the transform.
+ * \param tileOriginX the x component of this feature's parent tile's origin
+ * \param tileOriginY the y component of this feature's parent tile's origin
+ * \return the label request, or std::nullopt if the feature has no text to render within this tile.
+ */
+std::optional<Bach::LabelRequest> Bach::createLabelRequest_Point(
+    PaintingDetailsPoint details,
+    int tileSize,
+    int tileOriginX,
+    int tileOriginY)
+{
+    const SymbolLayerStyle &layerStyle = *details.layerStyle;
+    const PointFeature &feature = *details.feature;
+    QString text = getTextContent(layerStyle, feature, details.mapZoom, details.vpZoom);
+    if(text == "")
+        return std::nullopt;
+
+    const QPoint coordinates = getPointLabelCoordinates(feature, tileSize);
+    //exclude any text that is outside of the tile extent
+    if (coordinates.x() < 0 || coordinates.x() > tileSize || coordinates.y() < 0 || coordinates.y() > tileSize)
+        return std::nullopt;
+
+    LabelRequest request;
+    request.layerStyle = &layerStyle;
+    request.feature = &feature;
+    request.mapZoom = details.mapZoom;
+    request.vpZoom = details.vpZoom;
+    request.zoomValues = details.zoomValues;
+    request.transformIn = details.transformIn;
+    request.tileSize = tileSize;
+    request.tileOriginX = tileOriginX;
+    request.tileOriginY = tileOriginY;
+    request.rank = getLabelRank(feature);
+    request.text = text;
+    request.anchor = QPointF(tileOriginX + coordinates.x(), tileOriginY + coordinates.y());
+    request.duplicateDistance = getSymbolSpacing(layerStyle, feature, details.mapZoom, details.vpZoom, details.zoomValues);
+    return request;
 }
 
 /*!
- * \brief Bach::processSingleTileFeature_Point
- * This function is called in the tile rendering loop. It is responsible for processing the feature and layerstyle, and passing the text to be rendered
- * along with the styling information to one of the two rendering functions above depending if the text is a one liner or if it requires multiple lines.
+ * \brief Bach::createLabelCandidate_Point
+ * This function is responsible for processing the feature and layerstyle, and laying out the text to be rendered
+ * along with the styling information with one of the two functions above depending if the text is a one liner or if it requires multiple lines.
+ *
+ * The function does not use the QPainter in the details struct, and can be called from any thread.
+ *
  * \param details the struct containig all the elemets needed to paint the feature includeing the layerStyle and the feature itself.
+ * \param textToDraw the text of the label, as resolved by createLabelRequest_Point.
  * \param tileSize the size of the current tile in pixels, used to scale the the transform.
+ * \param tileOriginX the x component of this feature's parent tile's origin (used for text collistion detection)
+ * \param tileOriginY the y component of this feature's parent tile's origin (used for text collistion detection)
+ * \param painterFont the font currently set by the QPainter object, used when forceNoChangeFontType is set.
  * \param forceNoChangeFontType If set to true, the text font
  * rendered will be the one currently set by the QPainter object.
  * If set to false, it will try to use the font suggested by the stylesheet.
- * \param tileOriginX the x component of this feature's parent tile's origin (used for text collistion detection)
- * \param tileOriginY the y component of this feature's parent tile's origin (used for text collistion detection)
- * \param rects the list of rects that the current feature's rect will be checked against for collision
- * \param vpTextList the list of text features that this text will be added to if it passses all the filters.
+ * \return the laid out label, or std::nullopt if the feature has no text to render within this tile.
  */
-void Bach::processSingleTileFeature_Point(
+std::optional<Bach::LabelCandidate> Bach::createLabelCandidate_Point(
     PaintingDetailsPoint details,
+    const QString &textToDraw,
     int tileSize,
     int tileOriginX,
     int tileOriginY,
-    bool forceNoChangeFontType,
-    QVector<QRect> &rects,
-    QVector<vpGlobalText> &vpTextList)
+    const QFont &painterFont,
+    bool forceNoChangeFontType)
 {
-    QPainter &painter = *details.painter;
     const SymbolLayerStyle &layerStyle = *details.layerStyle;
     const PointFeature &feature = *details.feature;
-    //Get the text to be rendered.
-    QString textToDraw = getTextContent(layerStyle, feature, details.mapZoom, details.vpZoom);
     //If there is no text then there is nothing to render, we return
     if(textToDraw == "")
-        return;
+        return std::nullopt;
 
-    //Get the rendering parameters from the layerstyle and set the relevant painter field.
+    //Get the rendering parameters from the layerstyle.
 
     // If the flag 'forceNoChangeFontType' it means we should use the
     // font object already set by the painter.
     // So we count on the font already set by the painter object.
     QFont textFont;
     if (forceNoChangeFontType) {
-        textFont = painter.font();
+        textFont = painterFont;
     } else {
         textFont = QFont(layerStyle.m_textFont);
     }
 
-    int textSize = getTextSize(layerStyle, feature, details.mapZoom, details.vpZoom);
+    int textSize = getTextSize(layerStyle, feature, details.mapZoom, details.vpZoom, details.zoomValues);
     textFont.setPixelSize(textSize);
 
-    painter.setBrush(Qt::NoBrush);
-
-    painter.setOpacity(getTextOpacity(layerStyle, feature, details.mapZoom, details.vpZoom));
-
     const int outlineSize = layerStyle.m_textHaloWidth.toInt();
     QColor outlineColor = layerStyle.m_textHaloColor.value<QColor>();
 
-    //Text is always antialised (otherwise it does not look good)
-    painter.setRenderHints(QPainter::Antialiasing, true);
-
     //Get the corrected version of the text.
     //This means that text is split up for text wrapping depending on if it exceeds the maximum allowed width.
     QList<QString> correctedText = getCorrectedText(textToDraw, textFont, layerStyle.m_textMaxWidth.toInt());
 
-    // Get the coordinates for the text rendering
-    // We don't actually know why
-    // but when there are 3 points inside the text feature,
-    // only index 1 contains the one we expect.
-    // possible explanation: the extra coordinated might be there for map duplication (infinite horizontal scrolling)
-    QPoint coordinates;
-    if (feature.points().length() > 1) {
-        coordinates = feature.points().at(1);
-    } else {
-        coordinates = feature.points().at(0);
-    }
-    QTransform transform = {};
-    transform.scale(1 / 4096.0, 1 / 4096.0);
-    transform.scale(tileSize, tileSize);
-    //Remap the original coordinates so that they are positioned correctly.
-    const QPoint newCoordinates = transform.map(coordinates);
+    const QPoint newCoordinates = getPointLabelCoordinates(feature, tileSize);
     //exclude any text that is outside of the tile extent
     if (newCoordinates.x() < 0 || newCoordinates.x() > tileSize || newCoordinates.y() < 0 || newCoordinates.y() > tileSize){
-        return;
+        return std::nullopt;
     }
 
     //The text is processed differently depending on it it wraps or not.
     if (correctedText.size() == 1) //In case there is only one string to be processed (no wrapping)
-        processSimpleText(
+        return createSimpleTextCandidate(
             correctedText.at(0),
             newCoordinates,
             outlineSize,
             outlineColor,
             textFont,
-            rects,
             feature,
             layerStyle,
             details.mapZoom,
             details.vpZoom,
+            details.zoomValues,
             tileOriginX,
-            tileOriginY,
-            vpTextList);
+            tileOriginY);
     else { //In case there are multiple strings to be processed (text wrapping)
-        processCompositeText(
+        return createCompositeTextCandidate(
             correctedText,
             newCoordinates,
             outlineSize,
             outlineColor,
             textFont,
-            rects,
             feature,
             layerStyle,
             details.mapZoom,
             details.vpZoom,
+            details.zoomValues,
             tileOriginX,
-            tileOriginY,
-            vpTextList);
+            tileOriginY);
     }
 }
 
+/*!
+ * \brief Bach::placeLabelCandidate
+ * Runs the collision detection for a laid out label. If the label does not overlap any previously
+ * placed label, it is added to the correct text list and its bounding rect is added to the rects list.
+ *
+ * Labels are placed on a first come, first served basis, so the order of the calls decides which
+ * label wins when two of them overlap.
+ *
+ * \param candidate the label to be placed.
+ * \param rects the list of rects that the label's rect will be checked against for collision
+ * \param vpTextList the list of text features that this text will be added to if it is a normal label.
+ * \param vpCurvedTextList the list of curved text features that this text will be added to if it is a curved label.
+ * \return true if the label was placed, or false if it overlapped another label.
+ */
+bool Bach::placeLabelCandidate(
+    const LabelCandidate &candidate,
+    QVector<QRect> &rects,
+    QVector<vpGlobalText> &vpTextList,
+    QVector<vpGlobalCurvedText> &vpCurvedTextList)
+{
+    //Check for overlap with other text and cancel processing if this text overllaps with another
+    if(isOverlapping(candidate.collisionRect, rects))
+        return false;
+    //Add the total bouding rect to the list of the text rects to check for overlap for upcoming text.
+    rects.append(candidate.collisionRect);
+    //Queue this text for rendering by adding it to the correct texts list.
+    if (candidate.isCurved)
+        vpCurvedTextList.append(candidate.curvedText);
+    else
+        vpTextList.append(candidate.text);
+    return true;
+}
+
 /*!
  * \brief isTextFlipped
  * Determin if the text should be flipped or not. Text is flipped only if the first character's roation angle is
@@ -585,16 +711,67 @@ static int calctotalTextHorizontalAdvance(QFontMetrics fMetrics, QString text, i
 }
 
 /*!
- * \brief Bach::processSingleTileFeature_Point_Curved
- * This function is called in the tile rendering loop.
- * It is responsible for processing curved text. The function filters out texts
- * based on multiple parameters and then adds the text to be rendered to the text list.
+ * \brief Bach::createLabelRequest_PointCurved
+ * Creates the request for a curved label, without doing any text layout.
+ * The label is anchored at the start of the line.
+ *
+ * The function does not use the QPainter in the details struct, and can be called from any thread.
+ *
+ * \param details the struct containig all the elemets needed to
+ * paint the feature including the layerStyle and the feature itself.
+ * \param tileSize the size of the current tile in pixels.
+ * \param tileOriginX the x component of this feature's parent tile's origin
+ * \param tileOriginY the y component of this feature's parent tile's origin
+ * \return the label request, or std::nullopt if the feature has no text to render.
+ */
+std::optional<Bach::LabelRequest> Bach::createLabelRequest_PointCurved(
+    PaintingDetailsPointCurved details,
+    int tileSize,
+    int tileOriginX,
+    int tileOriginY)
+{
+    const SymbolLayerStyle &layerStyle = *details.layerStyle;
+    const LineFeature &feature = *details.feature;
+    QString text = getTextContent(layerStyle, feature, details.mapZoom, details.vpZoom).toUpper();
+    if(text == "" || feature.line().elementCount() == 0)
+        return std::nullopt;
+
+    QTransform transform = details.transformIn;
+    transform.scale(1 / 4096.0, 1 / 4096.0);
+    const QPointF start = transform.map(QPointF(feature.line().elementAt(0)));
+
+    LabelRequest request;
+    request.layerStyle = &layerStyle;
+    request.feature = &feature;
+    request.isCurved = true;
+    request.mapZoom = details.mapZoom;
+    request.vpZoom = details.vpZoom;
+    request.zoomValues = details.zoomValues;
+    request.transformIn = details.transformIn;
+    request.tileSize = tileSize;
+    request.tileOriginX = tileOriginX;
+    request.tileOriginY = tileOriginY;
+    request.rank = getLabelRank(feature);
+    request.text = text;
+    request.anchor = start + QPointF(tileOriginX, tileOriginY);
+    request.duplicateDistance = getSymbolSpacing(layerStyle, feature, details.mapZoom, details.vpZoom, details.zoomValues);
+    return request;
+}
+
+/*!
+ * \brief Bach::createLabelCandidate_PointCurved
+ * It is responsible for laying out curved text. The function filters out texts
+ * based on multiple parameters and then returns the text to be placed.
  * Curved text is represented as a list of structs each containing a
  * charater with its position and rotation.
  *
+ * The function does not use the QPainter in the details struct, and can be called from any thread.
+ *
  * \param details the struct containig all the elemets needed to
  * paint the feature including the layerStyle and the feature itself.
  *
+ * \param textToDraw the upper-cased text of the label, as resolved by createLabelRequest_PointCurved.
+ *
  * \param tileSize the size of the current tile in pixels,
  * used to scale the the transform.
  *
@@ -604,31 +781,23 @@ static int calctotalTextHorizontalAdvance(QFontMetrics fMetrics, QString text, i
  * \param tileOriginY the y component of this feature's parent
  * tile's origin (used for text collistion detection)
  *
- * \param rects the list of rects that the current feature's
- * rect will be checked against for collision
- *
- * \param vpCurvedTextList the list of curved text features
- * that this text will be added to if it passses all the filters.
+ * \return the laid out label, or std::nullopt if the text does not fit along the line.
  */
-void Bach::processSingleTileFeature_Point_Curved(
+std::optional<Bach::LabelCandidate> Bach::createLabelCandidate_PointCurved(
     PaintingDetailsPointCurved details,
+    const QString &textToDraw,
     const int tileSize,
     int tileOriginX,
-    int tileOriginY,
-    QVector<QRect> &rects,
-    QVector<vpGlobalCurvedText> &vpCurvedTextList)
+    int tileOriginY)
 {
-    QPainter &painter = *details.painter;
     const SymbolLayerStyle &layerStyle = *details.layerStyle;
     const LineFeature &feature = *details.feature;
-    //Get the text to be rendered.
-    QString textToDraw = getTextContent(layerStyle, feature, details.mapZoom, details.vpZoom).toUpper();
     //If there is no text then there is nothing to render, we return
-    if(textToDraw == "") return;
+    if(textToDraw == "") return std::nullopt;
     //Get the styling parameters
-    int textSize = getTextSize(layerStyle, feature, details.mapZoom, details.vpZoom);
+    int textSize = getTextSize(layerStyle, feature, details.mapZoom, details.vpZoom, details.zoomValues);
     QFont textFont = QFont(layerStyle.m_textFont);
-    float spacing = getTextLetterSpacing(layerStyle, feature, details.mapZoom, details.vpZoom, textSize);
+    float spacing = getTextLetterSpacing(layerStyle, feature, details.mapZoom, details.vpZoom, details.zoomValues, textSize);
     textFont.setPixelSize(textSize);
     const int outlineSize = layerStyle.m_textHaloWidth.toInt();
     QColor outlineColor = layerStyle.m_textHaloColor.value<QColor>();
@@ -641,11 +810,11 @@ void Bach::processSingleTileFeature_Point_Curved(
 
     // Check if the path is long enough to render the text at least once
     if(calctotalTextHorizontalAdvance(fMetrics, textToDraw, spacing) > path.length())
-        return;
+        return std::nullopt;
 
     //Check if the text should be rotated 180 degrees or not
     bool flipText = isTextFlipped(path.angleAtPercent(0));
-    int maxAngle = getTextMaxAngle(layerStyle, feature, details.mapZoom, details.vpZoom);
+    int maxAngle = getTextMaxAngle(layerStyle, feature, details.mapZoom, details.vpZoom, details.zoomValues);
     qreal length = 0;
     qreal percentage = path.percentAtLength(length);
     qreal angle;
@@ -661,7 +830,7 @@ void Bach::processSingleTileFeature_Point_Curved(
             //If the path would cause the text to be rendered with a large angle difference betweem two
             //adjacent characters, we cancel the text processing
             if(std::abs(angle - preAngle) > maxAngle)
-                return;
+                return std::nullopt;
             charsVector.append({textToDraw.at(i), charPosition, -(angle + 180)});
             QRect charRect(charPosition.x(), charPosition.y() - fMetrics.height()/2, fMetrics.horizontalAdvance(textToDraw.at(i)), fMetrics.height());
             textRect = textRect.united(charRect);
@@ -677,7 +846,7 @@ void Bach::processSingleTileFeature_Point_Curved(
             //If the path would cause the text to be rendered with a large angle difference betweem two
             //adjacent characters, we cancel the text processing
             if(std::abs(angle - preAngle) > maxAngle)
-                return;
+                return std::nullopt;
             charsVector.append({textToDraw.at(i), charPosition, -angle});
             QRect charRect(charPosition.x(), charPosition.y() - fMetrics.height()/2, fMetrics.horizontalAdvance(textToDraw.at(i)), fMetrics.height());
             textRect = textRect.united(charRect);
@@ -689,22 +858,16 @@ void Bach::processSingleTileFeature_Point_Curved(
     }
     //Chan ge the rects coordinates so that it is relative to the view port rather than the tile origin
     textRect.translate(tileOriginX, tileOriginY);
-    //Check for overlap with other text and cancel processing if this text overllaps with another
-    if(isOverlapping(textRect, rects)){
-        return;
-    }else{
-        //Add this text's total bouding rect to the list of the text rects to check for overlap for upcoming text.
-        rects.append(textRect);
-        //Queue this text for rendering by adding it to the texts list.
-        vpCurvedTextList.append({
-            charsVector,
-            textFont,
-            getTextColor(layerStyle, feature, details.mapZoom, details.vpZoom),
-            getTextOpacity(layerStyle, feature, details.mapZoom, details.vpZoom),
-            QPoint{ tileOriginX, tileOriginY },
-            outlineColor,
-            outlineSize });
-    }
+    LabelCandidate candidate;
+    candidate.collisionRect = textRect;
+    candidate.isCurved = true;
+    candidate.curvedText = {
+        charsVector,
+        textFont,
+        getTextColor(layerStyle, feature, details.mapZoom, details.vpZoom, details.zoomValues),
+        getTextOpacity(layerStyle, feature, details.mapZoom, details.vpZoom, details.zoomValues),
+        QPoint{ tileOriginX, tileOriginY },
+        outlineColor,
+        outlineSize };
+    return candidate;
 }
-
-
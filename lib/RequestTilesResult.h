@@ -20,6 +20,9 @@ namespace Bach {
      *  This is useful because it lets us run custom
      *  cleanup code in the destructor. For us this
      *  means we can mark tiles as no longer being read.
+     *
+     *  The tiles are owned by the TileLoader that returned the result,
+     *  so the result must be destroyed before the TileLoader.
      */
     class RequestTilesResult : public QObject{
         Q_OBJECT
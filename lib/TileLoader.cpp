@@ -13,9 +13,14 @@
 #include <QScopeGuard>
 #include <QStandardPaths>
 
+// STL header files
+#include <algorithm>
+
 // Other header files
+#include "AllocationCounting.h"
 #include "TileCoord.h"
 #include "TileLoader.h"
+#include "Tracing.h"
 #include "Utilities.h"
 
 using Bach::TileLoader;
@@ -23,12 +28,15 @@ using Bach::TileLoader;
 // This might not be ideal place to define this struct.
 struct TileResultType : public Bach::RequestTilesResult {
     virtual ~TileResultType() {
-        // TODO:
-        // This should eventually notify the TileLoader
-        // that our tiles are no longer being read.
-        // Only really necessary when we have an eviction policy in place.
+        // Tell the TileLoader that our tiles are no longer being read,
+        // so they can be evicted.
+        if (releaseFn)
+            releaseFn();
     }
 
+    // Releases the read pins of the returned vector tiles.
+    std::function<void()> releaseFn;
+
     // Generate the map holding tile coordinates and a vector tile.
     QMap<TileCoord, const VectorTile*> _vectorMap;
     const QMap<TileCoord, const VectorTile*> &vectorMap() const override
@@ -57,7 +65,31 @@ struct TileResultType : public Bach::RequestTilesResult {
 TileLoader::TileLoader() :
     tileCacheDiskPath { getTileCacheFolder() }
 {
+    views.insert({ defaultViewId, ViewState{} });
+}
 
+/*!
+ * \brief TileLoader::~TileLoader stops starting new load jobs,
+ * and waits for the running ones to finish.
+ *
+ * Every RequestTilesResult returned by requestTiles must be destroyed before this.
+ */
+TileLoader::~TileLoader()
+{
+    {
+        QMutexLocker lock = createTileMemoryLocker();
+        Q_ASSERT_X(
+            pinnedResults == 0,
+            "TileLoader::~TileLoader",
+            "A RequestTilesResult outlived the TileLoader that returned it.");
+        stopScheduling = true;
+        for (auto &[viewId, view] : views) {
+            counters.queuedJobs -= (int)view.queuedJobs.size();
+            view.queuedJobs.clear();
+        }
+        queuedDownloads.clear();
+    }
+    threadPool.waitForDone();
 }
 
 /*!
@@ -173,6 +205,141 @@ std::optional<Bach::LoadedTileState> TileLoader::getTileState_Vector(TileCoord c
     }
 }
 
+/*!
+ * \brief TileLoader::getVectorMemoryUsage returns the estimated memory used
+ * by the decoded vector tiles currently in memory, split by layer.
+ *
+ * The result is kept up to date as tiles are loaded, so this is cheap to call.
+ *
+ * \return The memory usage.
+ *
+ * \threadsafe
+ */
+Bach::VectorTileMemoryUsage TileLoader::getVectorMemoryUsage() const
+{
+    QMutexLocker lock = createTileMemoryLocker();
+    return residentVectorMemory;
+}
+
+/*!
+ * \brief TileLoader::setStyleSheet replaces the stylesheet passed on to rendering.
+ *
+ * Lets the TileLoader be created, and start loading tiles, before the stylesheet
+ * has been parsed. Must be called before any tiles are requested for rendering,
+ * since the results of requestTiles point to the stylesheet.
+ *
+ * \param styleSheet The parsed stylesheet.
+ */
+void TileLoader::setStyleSheet(StyleSheet &&styleSheetIn)
+{
+    QMutexLocker lock = createTileMemoryLocker();
+    styleSheet = std::move(styleSheetIn);
+    // The analyses were made with the old layer styles.
+    for (const auto &[coord, memoryItem] : vectorTileMemory) {
+        if (memoryItem.tileData != nullptr)
+            memoryItem.tileData->clearSolidTileInfo();
+    }
+}
+
+/*!
+ * \brief TileLoader::setTileContentUsage slims the vector tiles downloaded from now on.
+ *
+ * The tiles are re-encoded without the layers and attributes the usage doesn't
+ * include, before they are written to the disk cache and parsed. This shrinks the
+ * disk cache, and the time to read and parse every later load of the tiles.
+ *
+ * Slimmed vector tiles are cached in a sub-folder named after
+ * TileContentUsage::cacheKey, so tiles slimmed for one usage are never
+ * read back for another, or when tiles are kept whole.
+ *
+ * \param usage What to keep, usually from TileContentUsage::fromStyleSheetJson.
+ * Nothing keeps the tiles whole, which is the default.
+ *
+ * \threadsafe
+ */
+void TileLoader::setTileContentUsage(std::optional<Bach::TileContentUsage> usage)
+{
+    QMutexLocker lock = createTileMemoryLocker();
+    if (usage.has_value()) {
+        tileContentUsageKey = usage->cacheKey();
+        tileContentUsage = std::make_shared<const Bach::TileContentUsage>(std::move(usage.value()));
+    } else {
+        tileContentUsageKey.clear();
+        tileContentUsage = nullptr;
+    }
+}
+
+/*!
+ * \brief TileLoader::getRecentVectorTiles returns the loaded vector tiles that were requested most recently.
+ *
+ * \param maxCount The largest number of tiles to return.
+ * \return The tiles, most recently requested first.
+ *
+ * \threadsafe
+ */
+QVector<TileCoord> TileLoader::getRecentVectorTiles(int maxCount) const
+{
+    QVector<std::pair<quint64, TileCoord>> loadedTiles;
+    {
+        QMutexLocker lock = createTileMemoryLocker();
+        for (const auto &[coord, memoryItem] : vectorTileMemory) {
+            if (memoryItem.isReadyToRender())
+                loadedTiles.push_back({ memoryItem.lastRequested, coord });
+        }
+    }
+    std::stable_sort(
+        loadedTiles.begin(),
+        loadedTiles.end(),
+        [](const auto &a, const auto &b) { return a.first > b.first; });
+
+    QVector<TileCoord> out;
+    for (qsizetype i = 0; i < loadedTiles.size() && i < maxCount; i++)
+        out.push_back(loadedTiles[i].second);
+    return out;
+}
+
+/*!
+ * \brief TileLoader::getMetrics reads the current metrics of this TileLoader.
+ *
+ * The counters are read one at a time, so values that are related to each other
+ * may be slightly out of sync while tiles are loading.
+ *
+ * \return The metrics.
+ *
+ * \threadsafe
+ */
+Bach::TileLoaderMetrics TileLoader::getMetrics() const
+{
+    TileLoaderMetrics out;
+    out.memoryHits = counters.memoryHits;
+    out.memoryPending = counters.memoryPending;
+    out.memoryMisses = counters.memoryMisses;
+    out.diskHits = counters.diskHits;
+    out.diskMisses = counters.diskMisses;
+    out.networkInFlight = counters.networkInFlight;
+    out.networkCompleted = counters.networkCompleted;
+    out.networkFailed = counters.networkFailed;
+    out.queuedJobs = counters.queuedJobs;
+    out.activeDiskLoads = counters.activeDiskLoads;
+    out.activeDecodes = counters.activeDecodes;
+    out.vectorBytesResident = counters.vectorBytesResident;
+    out.rasterBytesResident = counters.rasterBytesResident;
+    out.vectorTilesEvicted = counters.vectorTilesEvicted;
+    out.vectorDecodeTime = counters.vectorDecodeTime.snapshot();
+    out.rasterDecodeTime = counters.rasterDecodeTime.snapshot();
+
+    QMutexLocker lock = createTileMemoryLocker();
+    for (const auto &[coord, memoryItem] : vectorTileMemory) {
+        if (memoryItem.isReadyToRender())
+            out.vectorTilesResident++;
+    }
+    for (const auto &[coord, memoryItem] : rasterTileMemory) {
+        if (memoryItem.isReadyToRender())
+            out.rasterTilesResident++;
+    }
+    return out;
+}
+
 /*!
  * \brief Bach::setPbfLink exchanges x, y, z coordinates in a Protobuf link.
  *
@@ -198,10 +365,32 @@ QString Bach::setPbfLink(TileCoord tileCoord, const QString &pbfLinkTemplate)
 
 /*!
  * \brief Gets the full file-path of a given tile, whether it exists or not.
+ *
+ * Vector tiles are looked up among the tiles slimmed for the current
+ * content usage, see setTileContentUsage.
+ *
+ * \threadsafe
  */
 QString TileLoader::getTileDiskPath(TileCoord coord, TileType tileType)
 {
-    return tileCacheDiskPath + QDir::separator() + Bach::tileDiskCacheSubPath(coord, tileType);
+    QString basePath = tileCacheDiskPath;
+    if (tileType == TileType::Vector) {
+        QMutexLocker lock = createTileMemoryLocker();
+        basePath = getVectorTileCacheDiskPath(tileContentUsageKey);
+    }
+    return basePath + QDir::separator() + Bach::tileDiskCacheSubPath(coord, tileType);
+}
+
+/*!
+ * \brief Gets the folder the vector tiles slimmed for a content usage are cached in.
+ *
+ * \param usageKey The TileContentUsage::cacheKey of the usage, or empty for whole tiles.
+ */
+QString TileLoader::getVectorTileCacheDiskPath(const QString &usageKey) const
+{
+    if (usageKey.isEmpty())
+        return tileCacheDiskPath;
+    return tileCacheDiskPath + QDir::separator() + "slim-" + usageKey;
 }
 
 /*!
@@ -216,6 +405,12 @@ QString TileLoader::getTileDiskPath(TileCoord coord, TileType tileType)
  * use the tileLoadedSignalFn parameter and call this function again.
  * Alternatively connect to the tileFinished-signal.
  *
+ * The returned vector tiles are not evicted until the result is destroyed.
+ *
+ * \param viewId is the view requesting the tiles, see registerView. The missing
+ * tiles are queued for this view, and when a callback is passed the requested
+ * tiles are kept in memory while the view shows them.
+ *
  * \param requestInput is a set of TileCoords that is requested.
  *
  * \param tileLoadedSignalFn is a function that will get called whenever
@@ -231,15 +426,23 @@ QString TileLoader::getTileDiskPath(TileCoord coord, TileType tileType)
  * TileLoader to NOT load tiles that are requested but not loaded.
  * This means missing tiles will NOT be loaded in the future.
  *
+ * \param tileTypes are the tile types the caller shows. Only these types are
+ * returned and loaded, so a view showing vector tiles never loads raster tiles.
+ * The other type is loaded when it is requested later.
+ *
  * \return Returns a RequestTilesResult object containing
  * the resulting map of tiles. The returned set of
  * data will always be a subset of requested tiles and all currently loaded tiles.
  */
 QScopedPointer<Bach::RequestTilesResult> TileLoader::requestTiles(
+    ViewId requestedViewId,
     const std::set<TileCoord> &input,
     const TileLoadedCallbackFn &signalFn,
-    bool loadMissingTiles)
+    bool loadMissingTiles,
+    TileTypes tileTypes)
 {
+    BACH_TRACE_SCOPE("TileLoader::requestTiles");
+    BACH_ALLOCATION_PHASE(Request);
     TileResultType* out = new TileResultType;
     // Temporary: We just need some way to handle when the user makes
     // a dummy TileLoader with no stylesheet, but tries to request one anyways.
@@ -252,33 +455,79 @@ QScopedPointer<Bach::RequestTilesResult> TileLoader::requestTiles(
     // Create scope for the mutex-locker
     {
         QMutexLocker lock = createTileMemoryLocker();
+        requestCount++;
+
+        ViewId viewId = requestedViewId;
+        auto viewIt = views.find(viewId);
+        if (viewIt == views.end()) {
+            qWarning() << "TileLoader error: View" << viewId << "is not registered. Using the default view.";
+            viewId = defaultViewId;
+            viewIt = views.find(viewId);
+        }
+        ViewState &view = viewIt->second;
+        // Requests with a callback come from the view drawing itself, so these
+        // are the tiles it shows. Requests without one are lookups.
+        if (signalFn) {
+            // Only vector tiles are kept in memory for the view. When it shows
+            // raster tiles, its vector tiles can be evicted.
+            std::set<TileCoord> newWantedTiles;
+            if (tileTypes.testFlag(TileTypeFlag::Vector))
+                newWantedTiles = input;
+            // Tiles the view stops showing may be evictable now.
+            if (view.previousWantedTiles != view.wantedTiles || view.wantedTiles != newWantedTiles)
+                vectorEvictionBlocked = false;
+            view.previousWantedTiles = std::move(view.wantedTiles);
+            view.wantedTiles = std::move(newWantedTiles);
+            view.tileLoadedFn = signalFn;
+            // Load the tiles the view shows now before the ones it has moved away from,
+            // or of the tile type it no longer shows.
+            std::stable_partition(
+                view.queuedJobs.begin(),
+                view.queuedJobs.end(),
+                [&](const QueuedLoadJob &job) {
+                    return tileTypes.testFlag(toTileTypeFlag(job.type)) && input.count(job.tileCoord) > 0;
+                });
+        }
+
         for (TileCoord requestedCoord : input) {
 
             // First run our code on vector-tiles.
-            {
+            if (tileTypes.testFlag(TileTypeFlag::Vector)) {
                 // Load iterator to our tile memory.
                 auto tileIt = vectorTileMemory.find(requestedCoord);
                 // If found, return it immediately.
                 // (Maybe mark it as recently used for cache purposes???)
                 if (tileIt != vectorTileMemory.end()) {
                     // Key found, check if it can be returned immediately.
-                    const StoredVectorTile &memoryItem = tileIt->second;
+                    StoredVectorTile &memoryItem = tileIt->second;
+                    memoryItem.lastRequested = requestCount;
                     // If the item is marked as nullptr,
                     // it means it is pending and should not be immediately returned.
                     if (memoryItem.isReadyToRender()) {
                         out->_vectorMap.insert(requestedCoord, memoryItem.tileData.get());
+                        // Keep the tile in memory until the result is released.
+                        memoryItem.readPins++;
+                        counters.memoryHits++;
+                    } else {
+                        counters.memoryPending++;
+                        // The tile may have been queued by another view.
+                        if (signalFn && memoryItem.state == Bach::LoadedTileState::Pending)
+                            waitingViews[{ requestedCoord, TileType::Vector }].insert(viewId);
                     }
                 } else if (loadMissingTiles) {
+                    counters.memoryMisses++;
                     // Tile not found, queue it for loading.
                     // Insert it with the pending status.
+                    StoredVectorTile newItem = StoredVectorTile::newPending();
+                    newItem.lastRequested = requestCount;
                     vectorTileMemory.insert({
                         requestedCoord,
-                        StoredVectorTile::newPending() });
+                        std::move(newItem) });
                     loadJobs.push_back({ requestedCoord, TileType::Vector });
                 }
             }
 
-            {
+            if (tileTypes.testFlag(TileTypeFlag::Raster)) {
                 // Load iterator to our tile memory.
                 auto tileIt = rasterTileMemory.find(requestedCoord);
                 // If found, return it immediately.
@@ -289,8 +538,15 @@ QScopedPointer<Bach::RequestTilesResult> TileLoader::requestTiles(
                     // it means it is pending and should not be immediately returned.
                     if (memoryItem.isReadyToRender()) {
                         out->_rasterMap.insert(requestedCoord, &memoryItem.image);
+                        counters.memoryHits++;
+                    } else {
+                        counters.memoryPending++;
+                        // The tile may have been queued by another view.
+                        if (signalFn && memoryItem.state == Bach::LoadedTileState::Pending)
+                            waitingViews[{ requestedCoord, TileType::Raster }].insert(viewId);
                     }
                 } else if (loadMissingTiles && loadRaster) {
+                    counters.memoryMisses++;
                     // Tile not found, queue it for loading.
                     // Insert it with the pending status.
                     rasterTileMemory.insert({
@@ -300,9 +556,19 @@ QScopedPointer<Bach::RequestTilesResult> TileLoader::requestTiles(
                 }
             }
         }
+
+        if (!out->_vectorMap.isEmpty()) {
+            // The result must not outlive this TileLoader, see the destructor.
+            pinnedResults++;
+            out->releaseFn = [this, pinnedTiles = out->_vectorMap.keys()]() {
+                releaseReadPins(pinnedTiles);
+            };
+        }
+
+        if (loadMissingTiles)
+            queueTileLoadingJobs(viewId, loadJobs, signalFn);
     }
-    if (loadMissingTiles)
-        queueTileLoadingJobs(loadJobs, signalFn);
+    startQueuedJobs();
 
     return QScopedPointer<Bach::RequestTilesResult>{ out };
 }
@@ -315,13 +581,17 @@ QScopedPointer<Bach::RequestTilesResult> TileLoader::requestTiles(
  */
 bool TileLoader::loadFromDisk_Vector(TileCoord coord, TileLoadedCallbackFn signalFn)
 {
+    BACH_TRACE_SCOPE("TileLoader::loadFromDisk_Vector");
+    ScopedGauge diskLoadGauge { counters.activeDiskLoads };
     // Check if the tile in disk.
     QString vectorDiskPath = getTileDiskPath(coord, TileType::Vector);
     QFile vectorFile { vectorDiskPath };
     if (!vectorFile.exists()) {
         // This is NOT an error. This just means our cache files didn't exist and we should return false
+        counters.diskMisses++;
         return false;
     }
+    counters.diskHits++;
 
     // TODO: Check that the file isn't currently being written into
     // by another thread by checking for associated .lock file.
@@ -351,13 +621,17 @@ bool TileLoader::loadFromDisk_Vector(TileCoord coord, TileLoadedCallbackFn signa
  */
 bool TileLoader::loadFromDisk_Raster(TileCoord coord, TileLoadedCallbackFn signalFn)
 {
+    BACH_TRACE_SCOPE("TileLoader::loadFromDisk_Raster");
+    ScopedGauge diskLoadGauge { counters.activeDiskLoads };
     // Check if the tile in disk.
     QString diskPath = getTileDiskPath(coord, TileType::Raster);
     QFile file { diskPath };
     if (!file.exists()) {
         // This is NOT an error. This just means our cache files didn't exist and we should return false
+        counters.diskMisses++;
         return false;
     }
+    counters.diskHits++;
 
     // TODO: Check that the file isn't currently being written into
     // by another thread by checking for associated .lock file.
@@ -400,14 +674,16 @@ void TileLoader::writeTileToDisk_Raster(
  * \brief TileLoader::writeTileToDisk writes a tile to disk cache.
  * \param coord is the ZXY coordinate of the tile to write to disk.
  * \param bytes is vector tile information stored as a QByteArray.
+ * \param usageKey is the cache key of the content usage the tile was slimmed for, or empty.
  */
 void TileLoader::writeTileToDisk_Vector(
     TileCoord coord,
-    const QByteArray &vectorBytes)
+    const QByteArray &vectorBytes,
+    const QString &usageKey)
 {
     // TODO unused return value of this function.
     Bach::writeTileToDiskCache_Vector(
-        tileCacheDiskPath,
+        getVectorTileCacheDiskPath(usageKey),
         coord,
         vectorBytes);
 }
@@ -424,12 +700,16 @@ void TileLoader::networkReplyHandler_Raster(
     TileLoadedCallbackFn signalFn)
 {
     rasterReply->deleteLater();
+    counters.networkInFlight--;
 
     // Check for errors in the reply.
     if (rasterReply->error() != QNetworkReply::NoError) {
+        counters.networkFailed++;
         qDebug() << "Error when requesting tile from web: " << rasterReply->errorString() << '\n';
         // TODO: Do something meaningful, like retrying the request later or
         // marking this tile as non-functional to stop us from requesting it anymore.
+    } else {
+        counters.networkCompleted++;
     }
 
     // TODO: Reply can return 204 No Content, and this is a valid result
@@ -466,6 +746,9 @@ void TileLoader::networkReplyHandler_Raster(
 
         insertIntoTileMemory_Raster(coord, rasterBytes, signalFn);
     });
+
+    // Let the next waiting download start.
+    finishDownload();
 }
 
 /*!
@@ -480,12 +763,16 @@ void TileLoader::networkReplyHandler_Vector(
     TileLoadedCallbackFn signalFn)
 {
     vectorReply->deleteLater();
+    counters.networkInFlight--;
 
     // Check for errors in the reply.
     if (vectorReply->error() != QNetworkReply::NoError) {
+        counters.networkFailed++;
         qDebug() << "Error when requesting tile from web: " << vectorReply->errorString() << '\n';
         // TODO: Do something meaningful, like retrying the request later or
         // marking this tile as non-functional to stop us from requesting it anymore.
+    } else {
+        counters.networkCompleted++;
     }
     // TODO: Reply can return 204 No Content, and this is a valid result
     // it just means that the tile has no data and doesn't need to be rendered.
@@ -494,6 +781,14 @@ void TileLoader::networkReplyHandler_Vector(
     // Extract the bytes we want and discard the reply.
     QByteArray vectorBytes = vectorReply->readAll();
 
+    std::shared_ptr<const Bach::TileContentUsage> usage;
+    QString usageKey;
+    {
+        QMutexLocker lock = createTileMemoryLocker();
+        usage = tileContentUsage;
+        usageKey = tileContentUsageKey;
+    }
+
     // We are now on the same thread as the QNetworkAccessManager,
     // which means we are on the GUI thread. We need to dispatch the result of
     // the reply onto a new thread. This is because parsing will block
@@ -501,10 +796,21 @@ void TileLoader::networkReplyHandler_Vector(
 
     // Create async jobs to insert tile into memory
     getThreadPool().start([=]() {
-        writeTileToDisk_Vector(coord, vectorBytes);
+        QByteArray tileBytes = vectorBytes;
+        // Tiles that can't be slimmed are kept whole, parsing will report the error.
+        if (usage != nullptr) {
+            std::optional<QByteArray> slimBytes = Bach::slimVectorTile(vectorBytes, *usage);
+            if (slimBytes.has_value())
+                tileBytes = std::move(slimBytes.value());
+        }
 
-        insertIntoTileMemory_Vector(coord, vectorBytes, signalFn);
+        writeTileToDisk_Vector(coord, tileBytes, usageKey);
+
+        insertIntoTileMemory_Vector(coord, tileBytes, signalFn);
     });
+
+    // Let the next waiting download start.
+    finishDownload();
 }
 
 
@@ -537,6 +843,7 @@ void TileLoader::loadFromWeb_Raster(TileCoord coord, TileLoadedCallbackFn signal
             this,
             [=]() { networkReplyHandler_Raster(rasterReply, coord, signalFn); });
     };
+    counters.networkInFlight++;
     QMetaObject::invokeMethod(
         &networkManager,
         job);
@@ -570,66 +877,487 @@ void TileLoader::loadFromWeb_Vector(TileCoord coord, TileLoadedCallbackFn signal
             this,
             [=]() { networkReplyHandler_Vector(vectorReply, coord, signalFn); });
     };
+    counters.networkInFlight++;
     QMetaObject::invokeMethod(
         &networkManager,
         job);
 }
 
 /*!
- * \brief
- * Loads the list of tiles into memory, corresponding to the list of
- * TileCoords inputted.
+ * \brief TileLoader::preloadTiles_Vector starts loading vector tiles before they are requested.
  *
- * This function launches asynchronous jobs, does not block execution!
+ * The tiles are loaded in the given order on the default view, without waiting for
+ * the stylesheet. A view that requests one of them before it's done is signalled
+ * when it loads. Tiles that are already in memory or pending are skipped.
+ *
+ * \param tiles The tiles to load, most important first.
+ *
+ * \threadsafe
+ */
+void TileLoader::preloadTiles_Vector(const QVector<TileCoord> &tiles)
+{
+    {
+        QMutexLocker lock = createTileMemoryLocker();
+        // Count the preload as a request, so the tiles are not the first to be evicted.
+        requestCount++;
+        QVector<LoadJob> loadJobs;
+        for (TileCoord coord : tiles) {
+            if (vectorTileMemory.find(coord) != vectorTileMemory.end())
+                continue;
+            StoredVectorTile newItem = StoredVectorTile::newPending();
+            newItem.lastRequested = requestCount;
+            vectorTileMemory.insert({ coord, std::move(newItem) });
+            loadJobs.push_back({ coord, TileType::Vector });
+        }
+        queueTileLoadingJobs(defaultViewId, loadJobs, nullptr);
+    }
+    startQueuedJobs();
+}
+
+/*!
+ * \brief TileLoader::registerView registers a view that requests tiles from this TileLoader.
+ *
+ * All views share the tile memory and the worker threads. Each view has its own
+ * queue of tiles to load, and the scheduler takes turns between the views, so a view
+ * that requests many tiles can not hold back the others.
+ *
+ * \param priorityWeight How many jobs this view gets started for every job of a
+ * view with weight 1. Values below 1 are treated as 1.
+ * \return The id to pass to requestTiles.
+ *
+ * \threadsafe
+ */
+TileLoader::ViewId TileLoader::registerView(int priorityWeight)
+{
+    QMutexLocker lock = createTileMemoryLocker();
+    const ViewId viewId = nextViewId++;
+    ViewState view;
+    view.priorityWeight = qMax(1, priorityWeight);
+    views.insert({ viewId, std::move(view) });
+    return viewId;
+}
+
+/*!
+ * \brief TileLoader::unregisterView removes a view, for example when its MapWidget is closed.
+ *
+ * Tiles the view queued are handed over to another view that is waiting for them,
+ * or dropped if no view wants them. The tiles the view showed can be evicted again.
+ *
+ * \param viewId The view to remove. The default view can not be removed.
+ *
+ * \threadsafe
+ */
+void TileLoader::unregisterView(ViewId viewId)
+{
+    if (viewId == defaultViewId) {
+        qWarning() << "TileLoader error: The default view can not be unregistered.";
+        return;
+    }
+
+    {
+        QMutexLocker lock = createTileMemoryLocker();
+        auto viewIt = views.find(viewId);
+        if (viewIt == views.end())
+            return;
+        std::deque<QueuedLoadJob> orphanedJobs = std::move(viewIt->second.queuedJobs);
+        views.erase(viewIt);
+        for (auto &[key, waitingViewIds] : waitingViews)
+            waitingViewIds.erase(viewId);
+
+        for (QueuedLoadJob &job : orphanedJobs) {
+            auto waitingIt = waitingViews.find({ job.tileCoord, job.type });
+            if (waitingIt != waitingViews.end() && !waitingIt->second.empty()) {
+                // Another view is waiting for this tile, it takes over the job.
+                const ViewId newOwnerId = *waitingIt->second.begin();
+                waitingIt->second.erase(newOwnerId);
+                ViewState &newOwner = views.at(newOwnerId);
+                if (newOwner.queuedJobs.empty())
+                    newOwner.virtualTime = qMax(newOwner.virtualTime, schedulerVirtualTime);
+                job.signalFn = newOwner.tileLoadedFn;
+                newOwner.queuedJobs.push_back(std::move(job));
+                continue;
+            }
+
+            // Nobody wants the tile. Forget it, so it is queued again if it's requested later.
+            counters.queuedJobs--;
+            if (job.type == TileType::Vector) {
+                auto tileIt = vectorTileMemory.find(job.tileCoord);
+                if (tileIt != vectorTileMemory.end() && tileIt->second.state == Bach::LoadedTileState::Pending)
+                    vectorTileMemory.erase(tileIt);
+            } else {
+                auto tileIt = rasterTileMemory.find(job.tileCoord);
+                if (tileIt != rasterTileMemory.end() && tileIt->second.state == Bach::LoadedTileState::Pending)
+                    rasterTileMemory.erase(tileIt);
+            }
+        }
+
+        vectorEvictionBlocked = false;
+        evictVectorTilesOverBudget();
+    }
+    startQueuedJobs();
+}
+
+/*!
+ * \brief TileLoader::setViewPriorityWeight changes the share of the worker threads a view gets.
+ *
+ * \param viewId The view to change.
+ * \param priorityWeight The new weight, see registerView.
+ *
+ * \threadsafe
+ */
+void TileLoader::setViewPriorityWeight(ViewId viewId, int priorityWeight)
+{
+    QMutexLocker lock = createTileMemoryLocker();
+    auto viewIt = views.find(viewId);
+    if (viewIt != views.end())
+        viewIt->second.priorityWeight = qMax(1, priorityWeight);
+}
+
+/*!
+ * \brief TileLoader::setVectorMemoryBudget limits the memory used by the vector tiles.
+ *
+ * When the estimated memory of the vector tiles goes above the budget, the tiles that
+ * have gone the longest without being requested are evicted. The estimate comes from
+ * Bach::calcMemoryUsage and includes the feature index and solid tile cache of each tile. Tiles are never evicted
+ * while a view shows them or a RequestTilesResult holds them, so the memory can
+ * stay above the budget when the views show more than it allows.
+ *
+ * \param bytes The budget in bytes. 0 turns eviction off, which is the default.
  *
  * \threadsafe
  */
+void TileLoader::setVectorMemoryBudget(qint64 bytes)
+{
+    QMutexLocker lock = createTileMemoryLocker();
+    vectorMemoryBudget = qMax((qint64)0, bytes);
+    vectorEvictionBlocked = false;
+    evictVectorTilesOverBudget();
+}
+
+/*!
+ * \brief TileLoader::getVectorMemoryBudget returns the budget set with setVectorMemoryBudget.
+ *
+ * \threadsafe
+ */
+qint64 TileLoader::getVectorMemoryBudget() const
+{
+    QMutexLocker lock = createTileMemoryLocker();
+    return vectorMemoryBudget;
+}
+
+/*!
+ * \brief
+ * Adds the list of tiles to the load queue of a view.
+ *
+ * The jobs are started by startQueuedJobs.
+ *
+ * IMPORTANT! Only call when 'tileMemoryLock' is locked!
+ */
 void TileLoader::queueTileLoadingJobs(
+    ViewId viewId,
     const QVector<LoadJob> &input,
     const TileLoadedCallbackFn &signalFn)
 {
+    BACH_TRACE_SCOPE("TileLoader::queueTileLoadingJobs");
     // We can assume all input tiles do not exist in memory.
+    if (input.isEmpty())
+        return;
 
-    // We queue up one task to launch
-    // the smaller tasks to return as early as possible.
-    auto asyncJob = [=]() {
-        for (LoadJob job : input) {
+    ViewState &view = views.at(viewId);
+    // A view that had nothing queued can't save up turns while it was idle.
+    if (view.queuedJobs.empty())
+        view.virtualTime = qMax(view.virtualTime, schedulerVirtualTime);
+    for (const LoadJob &job : input)
+        view.queuedJobs.push_back({ job.tileCoord, job.type, signalFn });
+    counters.queuedJobs += (int)input.size();
+}
 
-            // Then we spawn one async task per item.
-            getThreadPool().start([=]() {
+/*!
+ * \brief
+ * Starts queued load jobs until every worker thread is busy.
+ *
+ * The next job is taken from the view that has had the least worker time
+ * relative to its priority weight. This is weighted fair queuing, with
+ * every job counting as the same amount of work.
+ *
+ * Jobs are only handed to the thread pool when a worker thread is free,
+ * since the pool runs its jobs first-come-first-served. Downloads are limited
+ * separately, see startDownload. While downloads are waiting no jobs are
+ * started, otherwise the queues of the views would be moved into the
+ * download queue as fast as the disk cache can be checked.
+ *
+ * This function launches asynchronous jobs, does not block execution!
+ *
+ * \threadsafe
+ */
+void TileLoader::startQueuedJobs()
+{
+    QMutexLocker lock = createTileMemoryLocker();
+    const int maxRunningJobs = getThreadPool().maxThreadCount();
+    while (!stopScheduling && runningLoadJobs < maxRunningJobs && queuedDownloads.empty()) {
+        ViewId nextViewId = defaultViewId;
+        ViewState *nextView = nullptr;
+        for (auto &[viewId, view] : views) {
+            if (view.queuedJobs.empty())
+                continue;
+            if (nextView == nullptr || view.virtualTime < nextView->virtualTime) {
+                nextViewId = viewId;
+                nextView = &view;
+            }
+        }
+        if (nextView == nullptr)
+            break;
 
-                // Check if we have a tile-load override function.
-                if (loadTileOverride) {
-                    const QByteArray* fileBytes = loadTileOverride(job.tileCoord, job.type);
-                    if (fileBytes == nullptr || fileBytes->isEmpty()) {
-                        // Handle error?
-                    } else {
-                        if (job.type == TileType::Vector) {
-                            insertIntoTileMemory_Vector(job.tileCoord, *fileBytes, signalFn);
-                        } else {
-                            insertIntoTileMemory_Raster(job.tileCoord, *fileBytes, signalFn);
-                        }
-                    }
-                } else {
-                    // First we try loading from disk. If found, the disk function will handle
-                    // the rest of this async process.
-                    // If not found, start the process to download from web.
-                    if (job.type == TileType::Vector) {
-                        bool loadedFromDiskSuccess = loadFromDisk_Vector(job.tileCoord, signalFn);
-                        if (!loadedFromDiskSuccess && useWeb) {
-                            loadFromWeb_Vector(job.tileCoord, signalFn);
-                        }
-                    } else {
-                        bool loadedFromDiskSuccess = loadFromDisk_Raster(job.tileCoord, signalFn);
-                        if (!loadedFromDiskSuccess && useWeb) {
-                            loadFromWeb_Raster(job.tileCoord, signalFn);
-                        }
-                    }
-                }
-            });
+        QueuedLoadJob job = std::move(nextView->queuedJobs.front());
+        nextView->queuedJobs.pop_front();
+        schedulerVirtualTime = nextView->virtualTime;
+        nextView->virtualTime += 1.0 / nextView->priorityWeight;
+        counters.queuedJobs--;
+        runningLoadJobs++;
+
+        getThreadPool().start([this, nextViewId, job]() {
+            runLoadJob(nextViewId, job);
+            {
+                QMutexLocker lock = createTileMemoryLocker();
+                runningLoadJobs--;
+            }
+            startQueuedJobs();
+        });
+    }
+}
+
+/*!
+ * \brief
+ * Downloads a tile, or puts it in the download queue when
+ * maxConcurrentDownloads tiles are already being downloaded.
+ *
+ * \threadsafe
+ */
+void TileLoader::startDownload(TileCoord coord, TileType type, const TileLoadedCallbackFn &signalFn)
+{
+    {
+        QMutexLocker lock = createTileMemoryLocker();
+        if (runningDownloads >= maxConcurrentDownloads) {
+            queuedDownloads.push_back({ coord, type, signalFn });
+            return;
         }
+        runningDownloads++;
+    }
+    if (type == TileType::Vector)
+        loadFromWeb_Vector(coord, signalFn);
+    else
+        loadFromWeb_Raster(coord, signalFn);
+}
+
+/*!
+ * \brief
+ * Called when a download is done. Starts the next waiting download, and
+ * new load jobs once no downloads are waiting.
+ *
+ * \threadsafe
+ */
+void TileLoader::finishDownload()
+{
+    std::optional<QueuedDownload> nextDownload;
+    {
+        QMutexLocker lock = createTileMemoryLocker();
+        runningDownloads--;
+        if (!queuedDownloads.empty()) {
+            nextDownload = std::move(queuedDownloads.front());
+            queuedDownloads.pop_front();
+        }
+    }
+    if (nextDownload.has_value())
+        startDownload(nextDownload->tileCoord, nextDownload->type, nextDownload->signalFn);
+    startQueuedJobs();
+}
+
+/*!
+ * \brief
+ * Loads a single tile on the current thread, from the override function,
+ * the disk cache or the web.
+ *
+ * \param viewId The view that queued the job.
+ * \param job The tile to load.
+ */
+void TileLoader::runLoadJob(ViewId viewId, const QueuedLoadJob &job)
+{
+    // Signal the view that queued the tile, then the other views waiting for it.
+    TileLoadedCallbackFn signalFn = [this, viewId, job](TileCoord coord) {
+        if (job.signalFn)
+            job.signalFn(coord);
+        signalWaitingViews(coord, job.type, viewId);
     };
-    getThreadPool().start(asyncJob);
+
+    // Check if we have a tile-load override function.
+    if (loadTileOverride) {
+        const QByteArray* fileBytes = loadTileOverride(job.tileCoord, job.type);
+        if (fileBytes == nullptr || fileBytes->isEmpty()) {
+            abandonPendingTile(job.tileCoord, job.type);
+        } else {
+            if (job.type == TileType::Vector) {
+                insertIntoTileMemory_Vector(job.tileCoord, *fileBytes, signalFn);
+            } else {
+                insertIntoTileMemory_Raster(job.tileCoord, *fileBytes, signalFn);
+            }
+        }
+    } else {
+        // First we try loading from disk. If found, the disk function will handle
+        // the rest of this async process.
+        // If not found, start the process to download from web.
+        if (job.type == TileType::Vector) {
+            bool loadedFromDiskSuccess = loadFromDisk_Vector(job.tileCoord, signalFn);
+            if (!loadedFromDiskSuccess && useWeb)
+                startDownload(job.tileCoord, job.type, signalFn);
+            else if (!loadedFromDiskSuccess)
+                abandonPendingTile(job.tileCoord, job.type);
+        } else {
+            bool loadedFromDiskSuccess = loadFromDisk_Raster(job.tileCoord, signalFn);
+            if (!loadedFromDiskSuccess && useWeb)
+                startDownload(job.tileCoord, job.type, signalFn);
+            else if (!loadedFromDiskSuccess)
+                abandonPendingTile(job.tileCoord, job.type);
+        }
+    }
+}
+
+/*!
+ * \brief
+ * Removes a pending tile that could not be loaded, so a later request
+ * queues it again instead of waiting for it forever.
+ *
+ * The views waiting for the tile are forgotten without being signalled,
+ * so a tile that keeps failing doesn't make them request it again at once.
+ *
+ * \threadsafe
+ */
+void TileLoader::abandonPendingTile(TileCoord coord, TileType type)
+{
+    QMutexLocker lock = createTileMemoryLocker();
+    if (type == TileType::Vector) {
+        auto tileIt = vectorTileMemory.find(coord);
+        if (tileIt != vectorTileMemory.end() && tileIt->second.state == Bach::LoadedTileState::Pending)
+            vectorTileMemory.erase(tileIt);
+    } else {
+        auto tileIt = rasterTileMemory.find(coord);
+        if (tileIt != rasterTileMemory.end() && tileIt->second.state == Bach::LoadedTileState::Pending)
+            rasterTileMemory.erase(tileIt);
+    }
+    waitingViews.erase(std::make_pair(coord, type));
+}
+
+/*!
+ * \brief
+ * Signals the views that requested a tile while it was pending.
+ *
+ * \param coord The tile that was loaded.
+ * \param type The type of the tile that was loaded.
+ * \param signalledViewId The view that queued the tile, which has already been signalled.
+ *
+ * \threadsafe
+ */
+void TileLoader::signalWaitingViews(TileCoord coord, TileType type, ViewId signalledViewId)
+{
+    QVector<TileLoadedCallbackFn> callbacks;
+    {
+        QMutexLocker lock = createTileMemoryLocker();
+        auto waitingIt = waitingViews.find({ coord, type });
+        if (waitingIt == waitingViews.end())
+            return;
+        for (ViewId viewId : waitingIt->second) {
+            if (viewId == signalledViewId)
+                continue;
+            auto viewIt = views.find(viewId);
+            if (viewIt != views.end() && viewIt->second.tileLoadedFn)
+                callbacks.push_back(viewIt->second.tileLoadedFn);
+        }
+        waitingViews.erase(waitingIt);
+    }
+    // Call outside the lock, the callbacks may request tiles.
+    for (const TileLoadedCallbackFn &callback : callbacks)
+        callback(coord);
+}
+
+/*!
+ * \brief
+ * Releases the read pins taken by requestTiles, once the result is destroyed.
+ *
+ * \param vectorTiles The vector tiles that were returned.
+ *
+ * \threadsafe
+ */
+void TileLoader::releaseReadPins(const QVector<TileCoord> &vectorTiles)
+{
+    QMutexLocker lock = createTileMemoryLocker();
+    pinnedResults--;
+    for (TileCoord coord : vectorTiles) {
+        auto tileIt = vectorTileMemory.find(coord);
+        if (tileIt == vectorTileMemory.end() || tileIt->second.readPins == 0)
+            continue;
+        tileIt->second.readPins--;
+        // Most released tiles are still shown by a view, those can't be evicted anyway.
+        if (tileIt->second.readPins == 0 && !isWantedByAnyView(coord))
+            vectorEvictionBlocked = false;
+    }
+    evictVectorTilesOverBudget();
+}
+
+/*!
+ * \brief
+ * Checks if any view showed the tile in one of its two latest requests.
+ *
+ * IMPORTANT! Only call when 'tileMemoryLock' is locked!
+ */
+bool TileLoader::isWantedByAnyView(TileCoord coord) const
+{
+    for (const auto &[viewId, view] : views) {
+        if (view.wantedTiles.count(coord) > 0 || view.previousWantedTiles.count(coord) > 0)
+            return true;
+    }
+    return false;
+}
+
+/*!
+ * \brief
+ * Evicts the least recently requested vector tiles until the memory is within budget.
+ *
+ * Pending tiles, tiles held by a RequestTilesResult and tiles a view shows are kept.
+ * If the last pass could not get within the budget, nothing is done until
+ * a tile may have become evictable, see vectorEvictionBlocked.
+ *
+ * IMPORTANT! Only call when 'tileMemoryLock' is locked!
+ */
+void TileLoader::evictVectorTilesOverBudget()
+{
+    if (vectorMemoryBudget <= 0 || residentVectorMemory.total().totalBytes() <= vectorMemoryBudget)
+        return;
+    if (vectorEvictionBlocked)
+        return;
+    BACH_TRACE_SCOPE("TileLoader::evictVectorTilesOverBudget");
+
+    // Sorted by when the tile was last requested, oldest first.
+    QVector<std::pair<quint64, TileCoord>> candidates;
+    for (const auto &[coord, memoryItem] : vectorTileMemory) {
+        if (memoryItem.state == Bach::LoadedTileState::Pending || memoryItem.readPins > 0)
+            continue;
+        if (isWantedByAnyView(coord))
+            continue;
+        candidates.push_back({ memoryItem.lastRequested, coord });
+    }
+    std::sort(candidates.begin(), candidates.end());
+
+    for (const auto &[lastRequested, coord] : candidates) {
+        if (residentVectorMemory.total().totalBytes() <= vectorMemoryBudget)
+            break;
+        auto tileIt = vectorTileMemory.find(coord);
+        const StoredVectorTile &memoryItem = tileIt->second;
+        counters.vectorBytesResident -= memoryItem.memoryUsage.total().totalBytes();
+        residentVectorMemory -= memoryItem.memoryUsage;
+        labelSearchIndex.removeTile(coord);
+        vectorTileMemory.erase(tileIt);
+        counters.vectorTilesEvicted++;
+    }
+    vectorEvictionBlocked = residentVectorMemory.total().totalBytes() > vectorMemoryBudget;
 }
 
 /*!
@@ -646,6 +1374,7 @@ void TileLoader::insertIntoTileMemory_Raster(
     const QByteArray &rasterBytes,
     TileLoadedCallbackFn signalFn)
 {
+    BACH_TRACE_SCOPE("TileLoader::insertIntoTileMemory_Raster");
     // Check iterator to see if it's fine to access
     // this tile-memory element.
     auto checkIterator = [&](auto tileIt) {
@@ -663,7 +1392,14 @@ void TileLoader::insertIntoTileMemory_Raster(
 
     // And try parsing the raster image.
     QImage rasterImage;
-    bool rasterParseSuccess = rasterImage.loadFromData(rasterBytes);
+    bool rasterParseSuccess;
+    {
+        ScopedGauge decodeGauge { counters.activeDecodes };
+        BACH_ALLOCATION_PHASE(Decode);
+        const qint64 decodeStartNs = metricsNowNs();
+        rasterParseSuccess = rasterImage.loadFromData(rasterBytes);
+        counters.rasterDecodeTime.record(metricsNowNs() - decodeStartNs);
+    }
 
     // If we failed to parse our tile,
     // mark the memory as parsing failed.
@@ -679,6 +1415,8 @@ void TileLoader::insertIntoTileMemory_Raster(
         } else {
             StoredRasterTile &memoryItem = tileIt->second;
             memoryItem.state = Bach::LoadedTileState::ParsingFailed;
+            // The tile won't load, so the views waiting for it are not signalled.
+            waitingViews.erase(std::make_pair(coord, TileType::Raster));
         }
         emit tileFinished(coord);
         return;
@@ -696,6 +1434,7 @@ void TileLoader::insertIntoTileMemory_Raster(
             memoryItem.image = rasterImage;
 
             memoryItem.state = Bach::LoadedTileState::Ok;
+            counters.rasterBytesResident += rasterImage.sizeInBytes();
         }
     }
     emit tileFinished(coord);
@@ -721,6 +1460,7 @@ void TileLoader::insertIntoTileMemory_Vector(
     const QByteArray &vectorBytes,
     TileLoadedCallbackFn signalFn)
 {
+    BACH_TRACE_SCOPE("TileLoader::insertIntoTileMemory_Vector");
     // Check iterator to see if it's fine to access
     // this tile-memory element.
     auto checkIterator = [&](auto tileIt) {
@@ -737,7 +1477,13 @@ void TileLoader::insertIntoTileMemory_Vector(
     };
 
     // Try parsing the bytes into our tile.
-    std::optional<VectorTile> newTileResult = Bach::tileFromByteArray(vectorBytes);
+    std::optional<VectorTile> newTileResult;
+    {
+        ScopedGauge decodeGauge { counters.activeDecodes };
+        const qint64 decodeStartNs = metricsNowNs();
+        newTileResult = Bach::tileFromByteArray(vectorBytes);
+        counters.vectorDecodeTime.record(metricsNowNs() - decodeStartNs);
+    }
 
     // If we failed to parse our tile,
     // mark the memory as parsing failed.
@@ -754,6 +1500,8 @@ void TileLoader::insertIntoTileMemory_Vector(
             StoredVectorTile &memoryItem = tileIt->second;
             memoryItem.tileData = nullptr;
             memoryItem.state = Bach::LoadedTileState::ParsingFailed;
+            // The tile won't load, so the views waiting for it are not signalled.
+            waitingViews.erase(std::make_pair(coord, TileType::Vector));
         }
         emit tileFinished(coord);
         return;
@@ -761,6 +1509,10 @@ void TileLoader::insertIntoTileMemory_Vector(
 
     // Turn our VectorTile into a dedicated allocation that fits our storage.
     auto allocatedTile = std::make_unique<VectorTile>(std::move(newTileResult.value()));
+    // Measure the tile before taking the lock, it has to visit every feature.
+    Bach::VectorTileMemoryUsage memoryUsage = Bach::calcMemoryUsage(*allocatedTile);
+    // Collect the names for the search index for the same reason.
+    Bach::TileLabels labels = Bach::LabelSearchIndex::collectLabels(*allocatedTile);
     // Create a scope for our mutex lock.
     {
         QMutexLocker lock = createTileMemoryLocker();
@@ -772,6 +1524,13 @@ void TileLoader::insertIntoTileMemory_Vector(
             StoredVectorTile &memoryItem = tileIt->second;
             memoryItem.tileData = std::move(allocatedTile);
             memoryItem.state = Bach::LoadedTileState::Ok;
+            counters.vectorBytesResident += memoryUsage.total().totalBytes();
+            residentVectorMemory += memoryUsage;
+            memoryItem.memoryUsage = std::move(memoryUsage);
+            labelSearchIndex.insertTile(coord, std::move(labels));
+            if (memoryItem.readPins == 0 && !isWantedByAnyView(coord))
+                vectorEvictionBlocked = false;
+            evictVectorTilesOverBudget();
         }
     }
     emit tileFinished(coord);
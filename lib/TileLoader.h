@@ -13,14 +13,19 @@
 #include <QUrl>
 
 // STL header files
+#include <deque>
 #include <functional>
 #include <map>
 #include <memory>
 #include <set>
 
 // Other header files
+#include "LabelSearchIndex.h"
+#include "Metrics.h"
 #include "RequestTilesResult.h"
 #include "TileCoord.h"
+#include "TileSlimming.h"
+#include "Tracing.h"
 #include "Utilities.h"
 #include "VectorTiles.h"
 
@@ -54,7 +59,7 @@ namespace Bach {
         TileLoader(const TileLoader&) = delete;
         // Inheriting from QObject makes our class non-movable.
         TileLoader(TileLoader&&) = delete;
-        ~TileLoader(){};
+        ~TileLoader();
 
         // Disallow copying.
         TileLoader& operator=(const TileLoader&) = delete;
@@ -88,6 +93,19 @@ namespace Bach {
 
         std::optional<Bach::LoadedTileState> getTileState_Vector(TileCoord) const;
 
+        TileLoaderMetrics getMetrics() const;
+
+        Bach::VectorTileMemoryUsage getVectorMemoryUsage() const;
+
+        void setStyleSheet(StyleSheet &&styleSheet);
+
+        void setTileContentUsage(std::optional<Bach::TileContentUsage> usage);
+
+        QVector<TileCoord> getRecentVectorTiles(int maxCount) const;
+
+        // Names of the vector tiles in memory. Kept up to date as tiles are loaded.
+        const Bach::LabelSearchIndex &getLabelSearchIndex() const { return labelSearchIndex; }
+
     signals:
         /*!
          * @brief Gets signalled whenever a tile is finished loading,
@@ -116,6 +134,9 @@ namespace Bach {
         // Directory path to tile cache storage.
         QString tileCacheDiskPath;
 
+        // Live counters for the metrics. Can be updated from any thread.
+        TileLoaderCounters counters;
+
         struct StoredVectorTile {
             // Current loading-state of this tile.
             Bach::LoadedTileState state = {};
@@ -126,6 +147,17 @@ namespace Bach {
             // because QScopedPointer doesn't support move semantics.
             std::unique_ptr<VectorTile> tileData;
 
+            // Estimated memory used by tileData.
+            Bach::VectorTileMemoryUsage memoryUsage;
+
+            // Number of RequestTilesResult objects that currently hold this tile.
+            // The tile can not be evicted while this is above zero.
+            int readPins = 0;
+
+            // The value of 'requestCount' the last time this tile was requested.
+            // The tiles that have gone the longest without being requested are evicted first.
+            quint64 lastRequested = 0;
+
             // Tells us whether this tile is safe to return to
             // rendering.
             bool isReadyToRender() const {
@@ -167,6 +199,49 @@ namespace Bach {
          * which interferes with our automated resource cleanup.
          */
         std::map<TileCoord, StoredVectorTile> vectorTileMemory;
+        /* The combined memory usage of all the tiles in 'vectorTileMemory'.
+         * Updated whenever a tile is inserted.
+         *
+         * IMPORTANT! Only use when 'tileMemoryLock' is locked!
+         */
+        Bach::VectorTileMemoryUsage residentVectorMemory;
+        /* Largest estimated memory of the tiles in 'vectorTileMemory', in bytes.
+         * Tiles that no view uses are evicted when it is exceeded. 0 means no limit.
+         *
+         * IMPORTANT! Only use when 'tileMemoryLock' is locked!
+         */
+        qint64 vectorMemoryBudget = 0;
+        /* Set when an eviction pass could not get the memory within the budget.
+         * Cleared when a tile may have become evictable, so passes that would find
+         * nothing to evict are skipped.
+         *
+         * IMPORTANT! Only use when 'tileMemoryLock' is locked!
+         */
+        bool vectorEvictionBlocked = false;
+        /* What the downloaded vector tiles are slimmed down to before they are
+         * cached and parsed, see setTileContentUsage. Null means tiles are kept whole.
+         *
+         * IMPORTANT! Only use when 'tileMemoryLock' is locked!
+         */
+        std::shared_ptr<const Bach::TileContentUsage> tileContentUsage;
+        /* The cache key of tileContentUsage, empty when tiles are kept whole.
+         * Slimmed vector tiles are cached in a folder of their own for each key.
+         *
+         * IMPORTANT! Only use when 'tileMemoryLock' is locked!
+         */
+        QString tileContentUsageKey;
+        // Counts the calls to requestTiles, used to find the least recently used tiles.
+        // IMPORTANT! Only use when 'tileMemoryLock' is locked!
+        quint64 requestCount = 0;
+        // Number of RequestTilesResult that hold read pins and have not been destroyed.
+        // IMPORTANT! Only use when 'tileMemoryLock' is locked!
+        int pinnedResults = 0;
+        /* Text index over the names in 'vectorTileMemory'. A tile is
+         * added when it is inserted, and removed when it is evicted.
+         *
+         * Has its own lock, so it can be searched without the tile memory lock.
+         */
+        Bach::LabelSearchIndex labelSearchIndex;
         /* This contains our memory tile-cache.
          *
          * IMPORTANT! Only use when 'tileMemoryLock' is locked!
@@ -176,22 +251,109 @@ namespace Bach {
          */
         std::map<TileCoord, StoredRasterTile> rasterTileMemory;
 
+        /* A load job that is queued by a view, but not started yet.
+         */
+        struct QueuedLoadJob {
+            TileCoord tileCoord;
+            TileType type;
+            // The callback passed with the request that queued this job.
+            std::function<void(TileCoord)> signalFn;
+        };
+
+        /* The state the scheduler keeps for each registered view.
+         */
+        struct ViewState {
+            // How many jobs this view gets started for each job of a view with weight 1.
+            int priorityWeight = 1;
+            // The jobs of this view that have not started yet, oldest first.
+            std::deque<QueuedLoadJob> queuedJobs;
+            // Grows by 1/priorityWeight for each job started. The view with the
+            // lowest value and jobs waiting gets the next free worker thread.
+            double virtualTime = 0;
+            // The tiles of the two last requests that passed a callback.
+            // These tiles are never evicted, since the view is showing them.
+            std::set<TileCoord> wantedTiles;
+            std::set<TileCoord> previousWantedTiles;
+            // The callback of the latest request. Called when a tile another
+            // view queued, and this view waits for, has loaded.
+            std::function<void(TileCoord)> tileLoadedFn;
+        };
+        /* The registered views, by ViewId. The default view is always here.
+         *
+         * IMPORTANT! Only use the scheduler state when 'tileMemoryLock' is locked!
+         */
+        std::map<int, ViewState> views;
+        int nextViewId = 1;
+        // Number of load jobs on the worker threads. Never more than the number of
+        // worker threads, so the other jobs wait in the queues of the views.
+        int runningLoadJobs = 0;
+        // Number of tiles being downloaded.
+        int runningDownloads = 0;
+        // The QNetworkAccessManager opens at most 6 connections per host, so more
+        // downloads than this at once only wait in its queue.
+        static constexpr int maxConcurrentDownloads = 6;
+        // A tile a load job found no cache for, waiting for a free download.
+        struct QueuedDownload {
+            TileCoord tileCoord;
+            TileType type;
+            TileLoadedCallbackFn signalFn;
+        };
+        // Downloads that are waiting, in the order the load jobs were started.
+        // No new load jobs are started while downloads are waiting.
+        std::deque<QueuedDownload> queuedDownloads;
+        // The virtual time of the last job started.
+        double schedulerVirtualTime = 0;
+        // Set when the TileLoader is destroyed, so no more jobs are started.
+        bool stopScheduling = false;
+        // Views that requested a tile while it was pending, and need to be signalled
+        // when it loads. The view that queued the tile is signalled through its job.
+        std::map<std::pair<TileCoord, TileType>, std::set<int>> waitingViews;
+
         // We use unique-ptr here to let use the lock in const methods.
         std::unique_ptr<QMutex> _tileMemoryLock = std::make_unique<QMutex>();
 
         // Generates the scoped lock for our tile-memory.
-        // Will block if mutex is already held.
-        QMutexLocker<QMutex> createTileMemoryLocker() const { return QMutexLocker(_tileMemoryLock.get()); }
+        // Will block if mutex is already held. The time spent waiting shows up in traces.
+        QMutexLocker<QMutex> createTileMemoryLocker() const
+        {
+            BACH_TRACE_SCOPE("TileLoader::tileMemoryLockWait");
+            return QMutexLocker(_tileMemoryLock.get());
+        }
 
     public:
         // Function signature of the tile-loaded
         // callback passed into 'requestTiles'.
         using TileLoadedCallbackFn = std::function<void(TileCoord)>;
 
+        // Identifies a view, like a MapWidget, that requests tiles from this TileLoader.
+        using ViewId = int;
+        // The view used by the overloads of 'requestTiles' that don't take a view.
+        static constexpr ViewId defaultViewId = 0;
+
+        ViewId registerView(int priorityWeight = 1);
+        void unregisterView(ViewId viewId);
+        void setViewPriorityWeight(ViewId viewId, int priorityWeight);
+
+        void setVectorMemoryBudget(qint64 bytes);
+        qint64 getVectorMemoryBudget() const;
+
+        void preloadTiles_Vector(const QVector<TileCoord> &tiles);
+
         QScopedPointer<Bach::RequestTilesResult> requestTiles(
+            ViewId viewId,
             const std::set<TileCoord> &requestInput,
             const TileLoadedCallbackFn &tileLoadedSignalFn,
-            bool loadMissingTiles);
+            bool loadMissingTiles,
+            TileTypes tileTypes = allTileTypes);
+
+        // Overload that requests the tiles for the default view.
+        auto requestTiles(
+            const std::set<TileCoord> &requestInput,
+            const TileLoadedCallbackFn &tileLoadedSignalFn,
+            bool loadMissingTiles)
+        {
+            return requestTiles(defaultViewId, requestInput, tileLoadedSignalFn, loadMissingTiles);
+        }
         // Overload where we don't need to pass any callback function.
         auto requestTiles(
             const std::set<TileCoord> &requestInput,
@@ -219,8 +381,18 @@ namespace Bach {
             TileType type;
         };
         void queueTileLoadingJobs(
+            ViewId viewId,
             const QVector<LoadJob> &input,
             const TileLoadedCallbackFn &signalFn);
+        void startQueuedJobs();
+        void runLoadJob(ViewId viewId, const QueuedLoadJob &job);
+        void startDownload(TileCoord coord, TileType type, const TileLoadedCallbackFn &signalFn);
+        void finishDownload();
+        void abandonPendingTile(TileCoord coord, TileType type);
+        void signalWaitingViews(TileCoord coord, TileType type, ViewId signalledViewId);
+        void releaseReadPins(const QVector<TileCoord> &vectorTiles);
+        bool isWantedByAnyView(TileCoord coord) const;
+        void evictVectorTilesOverBudget();
 
         // Thread-pool for the tile-loader worker threads.
         QThreadPool threadPool;
@@ -244,7 +416,9 @@ namespace Bach {
             const QByteArray &rasterBytes);
         void writeTileToDisk_Vector(
             TileCoord coord,
-            const QByteArray &vectorBytes);
+            const QByteArray &vectorBytes,
+            const QString &usageKey);
+        QString getVectorTileCacheDiskPath(const QString &usageKey) const;
         void insertIntoTileMemory_Vector(
             TileCoord coord,
             const QByteArray &vectorBytes,
@@ -0,0 +1,232 @@
+// Copyright (c) 2024 Cecilia Norevik Bratlie, Nils Petter Skålerud, Eimen Oueslati
+// SPDX-License-Identifier: MIT
+
+// Qt header files
+#include <QCryptographicHash>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QProtobufSerializer>
+#include <QRegularExpression>
+
+// Other header files
+#include "TileSlimming.h"
+#include "Tracing.h"
+#include "vector_tile.qpb.h"
+
+using Bach::TileContentUsage;
+
+/*!
+ * \internal
+ * \brief collectAttributeKeys gathers the strings in a style property that may be attribute keys.
+ *
+ * Covers the forms used by the stylesheets:
+ *
+ * * Expressions and legacy filters, where the key follows the operator,
+ *   like ["get", "class"] and ["==", "class", "ocean"].
+ * * Functions with a "property" field.
+ * * Text fields with keys in braces, like "{name:latin}".
+ *
+ * Strings that are not keys are gathered too, keeping a few unused attributes is harmless.
+ *
+ * \param value The property, or part of it.
+ * \param keysOut The keys are added to this set.
+ */
+static void collectAttributeKeys(const QJsonValue &value, QSet<QString> &keysOut)
+{
+    if (value.isArray()) {
+        const QJsonArray array = value.toArray();
+        if (array.size() >= 2 && array.at(0).isString() && array.at(1).isString())
+            keysOut.insert(array.at(1).toString());
+        for (const QJsonValue &element : array)
+            collectAttributeKeys(element, keysOut);
+    } else if (value.isObject()) {
+        const QJsonObject object = value.toObject();
+        if (object.value("property").isString())
+            keysOut.insert(object.value("property").toString());
+        for (const QJsonValue &element : object)
+            collectAttributeKeys(element, keysOut);
+    } else if (value.isString()) {
+        static const QRegularExpression tokenRegex { "\\{([^{}]+)\\}" };
+        QRegularExpressionMatchIterator it = tokenRegex.globalMatch(value.toString());
+        while (it.hasNext())
+            keysOut.insert(it.next().captured(1));
+    }
+}
+
+/*!
+ * \brief TileContentUsage::fromStyleSheetJson finds the source layers and attribute keys
+ * used by the layer styles of a stylesheet.
+ *
+ * Layer styles that are hidden are included, since they can be shown later.
+ *
+ * \param styleSheetJson The stylesheet, before it's parsed.
+ * \return The usage.
+ */
+TileContentUsage TileContentUsage::fromStyleSheetJson(const QJsonDocument &styleSheetJson)
+{
+    TileContentUsage out;
+    const QJsonArray layers = styleSheetJson.object().value("layers").toArray();
+    for (const QJsonValue &layerValue : layers) {
+        const QJsonObject layer = layerValue.toObject();
+        // Background layers and raster sources have no source layer.
+        const QString sourceLayer = layer.value("source-layer").toString();
+        if (sourceLayer.isEmpty())
+            continue;
+
+        QSet<QString> &keys = out.attributeKeysByLayer[sourceLayer];
+        collectAttributeKeys(layer.value("filter"), keys);
+        collectAttributeKeys(layer.value("layout"), keys);
+        collectAttributeKeys(layer.value("paint"), keys);
+    }
+    return out;
+}
+
+/*!
+ * \brief TileContentUsage::usesLayer checks if any layer style draws a source layer.
+ */
+bool TileContentUsage::usesLayer(const QString &layerName) const
+{
+    return attributeKeysByLayer.contains(layerName);
+}
+
+/*!
+ * \brief TileContentUsage::usesAttribute checks if an attribute of a source layer is used.
+ */
+bool TileContentUsage::usesAttribute(const QString &layerName, const QString &key) const
+{
+    if (keepAllAttributes)
+        return usesLayer(layerName);
+    for (const QString &prefix : keptKeyPrefixes) {
+        if (key.startsWith(prefix))
+            return true;
+    }
+    auto it = attributeKeysByLayer.find(layerName);
+    return it != attributeKeysByLayer.end() && it->contains(key);
+}
+
+/*!
+ * \brief TileContentUsage::cacheKey identifies what tiles slimmed with this usage contain.
+ *
+ * Two usages have the same key only if they keep the same layers and attributes,
+ * so tiles slimmed for one can be reused by the other. It is used to keep the
+ * slimmed tiles of each usage apart in the disk cache.
+ *
+ * \return A short hex string that can be used in file names.
+ */
+QString TileContentUsage::cacheKey() const
+{
+    QByteArray description;
+    QStringList layerNames = attributeKeysByLayer.keys();
+    layerNames.sort();
+    for (const QString &layerName : layerNames) {
+        QStringList keys = attributeKeysByLayer.value(layerName).values();
+        keys.sort();
+        description += "layer:" + layerName.toUtf8() + '\n';
+        // The keys don't matter if all attributes are kept.
+        if (!keepAllAttributes) {
+            for (const QString &key : keys)
+                description += "key:" + key.toUtf8() + '\n';
+        }
+    }
+    if (keepAllAttributes) {
+        description += "all-attributes\n";
+    } else {
+        QStringList prefixes = keptKeyPrefixes;
+        prefixes.sort();
+        for (const QString &prefix : prefixes)
+            description += "prefix:" + prefix.toUtf8() + '\n';
+    }
+    return QCryptographicHash::hash(description, QCryptographicHash::Sha1).toHex().left(16);
+}
+
+/*!
+ * \brief Bach::slimVectorTile re-encodes a vector tile without the content a stylesheet doesn't use.
+ *
+ * Removes the layers no layer style draws, and the attributes no layer style reads.
+ * The key and value tables of each layer are rebuilt to hold only what the
+ * remaining features refer to. The geometry, types and ids of the features
+ * are copied as they are, so the slimmed tile renders the same.
+ *
+ * \param bytes The tile in the Mapbox Vector Tile format.
+ * \param usage What to keep, see TileContentUsage::fromStyleSheetJson.
+ * \param statsOut If not null, it is filled with what was removed.
+ * \return The slimmed tile, or nothing if the tile could not be parsed.
+ */
+std::optional<QByteArray> Bach::slimVectorTile(
+    const QByteArray &bytes,
+    const TileContentUsage &usage,
+    SlimTileStats *statsOut)
+{
+    BACH_TRACE_SCOPE("TileSlimming::slimVectorTile");
+    QProtobufSerializer serializer;
+    vector_tile::Tile tile;
+    tile.deserialize(&serializer, bytes);
+    if (serializer.deserializationError() != QAbstractProtobufSerializer::NoError)
+        return std::nullopt;
+
+    SlimTileStats stats;
+    QList<vector_tile::Tile_QtProtobufNested::Layer> slimLayers;
+    for (const vector_tile::Tile_QtProtobufNested::Layer &layer : tile.layers()) {
+        if (!usage.usesLayer(layer.name())) {
+            stats.layersRemoved++;
+            continue;
+        }
+
+        // Maps the indices of the old tables to the new ones, -1 if removed.
+        const QList<QString> &keys = layer.keys();
+        QList<int> keyIndices(keys.size(), -1);
+        QList<QString> slimKeys;
+        for (int i = 0; i < keys.size(); i++) {
+            if (usage.usesAttribute(layer.name(), keys[i])) {
+                keyIndices[i] = slimKeys.size();
+                slimKeys.append(keys[i]);
+            }
+        }
+
+        // Values are only kept if a remaining tag refers to them.
+        const QList<vector_tile::Tile_QtProtobufNested::Value> &values = layer.values();
+        QList<int> valueIndices(values.size(), -1);
+        QList<vector_tile::Tile_QtProtobufNested::Value> slimValues;
+
+        QList<vector_tile::Tile_QtProtobufNested::Feature> slimFeatures;
+        slimFeatures.reserve(layer.features().size());
+        for (const vector_tile::Tile_QtProtobufNested::Feature &feature : layer.features()) {
+            const auto &tags = feature.tags();
+            QList<quint32> slimTags;
+            for (int i = 0; i + 1 < tags.size(); i += 2) {
+                const quint32 keyIndex = tags[i];
+                const quint32 valueIndex = tags[i + 1];
+                // Skip tags that point outside the tables.
+                if (keyIndex >= (quint32)keys.size() || valueIndex >= (quint32)values.size())
+                    continue;
+                if (keyIndices[keyIndex] < 0)
+                    continue;
+                if (valueIndices[valueIndex] < 0) {
+                    valueIndices[valueIndex] = slimValues.size();
+                    slimValues.append(values[valueIndex]);
+                }
+                slimTags.append(keyIndices[keyIndex]);
+                slimTags.append(valueIndices[valueIndex]);
+            }
+
+            vector_tile::Tile_QtProtobufNested::Feature slimFeature = feature;
+            slimFeature.setTags(slimTags);
+            slimFeatures.append(std::move(slimFeature));
+        }
+
+        stats.keysRemoved += keys.size() - slimKeys.size();
+        stats.valuesRemoved += values.size() - slimValues.size();
+
+        vector_tile::Tile_QtProtobufNested::Layer slimLayer = layer;
+        slimLayer.setKeys(slimKeys);
+        slimLayer.setValues(slimValues);
+        slimLayer.setFeatures(slimFeatures);
+        slimLayers.append(std::move(slimLayer));
+    }
+
+    vector_tile::Tile slimTile;
+    slimTile.setLayers(slimLayers);
+    if (statsOut != nullptr)
+        *statsOut = stats;
+    return slimTile.serialize(&serializer);
+}
@@ -0,0 +1,59 @@
+// Copyright (c) 2024 Cecilia Norevik Bratlie, Nils Petter Skålerud, Eimen Oueslati
+// SPDX-License-Identifier: MIT
+
+#ifndef TILESLIMMING_H
+#define TILESLIMMING_H
+
+// Qt header files
+#include <QByteArray>
+#include <QHash>
+#include <QJsonDocument>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+// STL header files
+#include <optional>
+
+namespace Bach {
+    /*!
+     * \brief The TileContentUsage class holds which parts of the vector tiles a stylesheet uses.
+     *
+     * It is used to slim tiles down to the layers and attributes that can change
+     * what is rendered, before they are cached. Attribute keys are gathered
+     * generously, any string in a filter or expression that could be a key is kept.
+     */
+    struct TileContentUsage {
+        // The attribute keys used by the layer styles of each source layer.
+        // Only the source layers in here are kept.
+        QHash<QString, QSet<QString>> attributeKeysByLayer;
+        // Attributes whose key starts with one of these are kept in every layer.
+        // The names are kept for the search index, see LabelSearchIndex.
+        QStringList keptKeyPrefixes = { "name" };
+        // Keeps every attribute of the used layers, and only removes the unused layers.
+        // Needed when the attributes are shown to the user, like by the feature queries.
+        bool keepAllAttributes = false;
+
+        static TileContentUsage fromStyleSheetJson(const QJsonDocument &styleSheetJson);
+
+        bool usesLayer(const QString &layerName) const;
+        bool usesAttribute(const QString &layerName, const QString &key) const;
+        QString cacheKey() const;
+    };
+
+    /*!
+     * \brief The SlimTileStats class counts what slimVectorTile removed.
+     */
+    struct SlimTileStats {
+        int layersRemoved = 0;
+        int keysRemoved = 0;
+        int valuesRemoved = 0;
+    };
+
+    std::optional<QByteArray> slimVectorTile(
+        const QByteArray &bytes,
+        const TileContentUsage &usage,
+        SlimTileStats *statsOut = nullptr);
+}
+
+#endif // TILESLIMMING_H
@@ -0,0 +1,329 @@
+// Copyright (c) 2024 Cecilia Norevik Bratlie, Nils Petter Skålerud, Eimen Oueslati
+// SPDX-License-Identifier: MIT
+
+// Qt header files
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+
+// STL header files
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+// Other header files
+#include "Tracing.h"
+
+namespace Bach::Tracing {
+    /*!
+     * \internal
+     * \brief The TraceEvent class is a single slot in a thread's ring buffer.
+     *
+     * The members are atomic because the buffer can be exported from another thread
+     * while the owning thread is writing to it. Relaxed loads and stores are enough,
+     * since we detect overwritten slots through the write index instead.
+     */
+    struct TraceEvent {
+        std::atomic<const char*> name = nullptr;
+        std::atomic<qint64> startNs = 0;
+        std::atomic<qint64> endNs = 0;
+    };
+
+    /*!
+     * \internal
+     * \brief The RecordedSpan class is a span copied out of the ring buffer of a thread that has exited.
+     */
+    struct RecordedSpan {
+        const char *name = nullptr;
+        qint64 startNs = 0;
+        qint64 endNs = 0;
+    };
+
+    using TraceEventRing = std::array<TraceEvent, eventsPerThread>;
+
+    /*!
+     * \internal
+     * \brief The ThreadBuffer class is the ring buffer of a single thread.
+     * Only the owning thread writes to it.
+     *
+     * When the thread exits, the spans in the ring are copied into retiredSpans
+     * and the ring is freed.
+     */
+    struct ThreadBuffer {
+        int threadIndex = 0;
+        QString threadName;
+        // Total number of spans ever written. The slot is writeCount % eventsPerThread.
+        std::atomic<quint64> writeCount = 0;
+        // Null once the thread has exited.
+        std::unique_ptr<TraceEventRing> events = std::make_unique<TraceEventRing>();
+        // The spans of a thread that has exited, oldest first.
+        std::vector<RecordedSpan> retiredSpans;
+    };
+
+    /*!
+     * \internal
+     * \brief The Registry class keeps track of every thread's buffer.
+     *
+     * The ring buffer of a thread is freed when the thread exits, but its spans are kept
+     * until clear() is called, because they can still be of interest.
+     */
+    struct Registry {
+        QMutex lock;
+        std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+        int nextThreadIndex = 0;
+        std::atomic<bool> enabled = true;
+        const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+    };
+
+    static Registry &getRegistry()
+    {
+        static Registry registry;
+        return registry;
+    }
+
+    /*!
+     * \internal
+     * \brief retireThreadBuffer copies the spans out of an exiting thread's ring buffer and frees it.
+     */
+    static void retireThreadBuffer(ThreadBuffer &buffer)
+    {
+        Registry &registry = getRegistry();
+        QMutexLocker lock { &registry.lock };
+        const quint64 writeCount = buffer.writeCount.load(std::memory_order_relaxed);
+        const quint64 first = writeCount > (quint64)eventsPerThread
+            ? writeCount - eventsPerThread
+            : 0;
+        buffer.retiredSpans.reserve(writeCount - first);
+        for (quint64 i = first; i < writeCount; i++) {
+            const TraceEvent &event = (*buffer.events)[i % eventsPerThread];
+            buffer.retiredSpans.push_back({
+                event.name.load(std::memory_order_relaxed),
+                event.startNs.load(std::memory_order_relaxed),
+                event.endNs.load(std::memory_order_relaxed) });
+        }
+        buffer.events = nullptr;
+    }
+
+    // Set once the calling thread's buffer has been retired.
+    // Spans recorded after that, by destructors that run late in the thread's exit, are dropped.
+    static thread_local bool threadBufferRetired = false;
+
+    /*!
+     * \internal
+     * \brief The ThreadBufferOwner class retires the buffer of its thread when the thread exits.
+     */
+    struct ThreadBufferOwner {
+        ThreadBuffer *buffer = nullptr;
+        ~ThreadBufferOwner()
+        {
+            threadBufferRetired = true;
+            if (buffer != nullptr)
+                retireThreadBuffer(*buffer);
+        }
+    };
+
+    /*!
+     * \internal
+     * \brief getThreadBuffer returns the buffer of the calling thread,
+     * creating and registering it on first use.
+     *
+     * \return The buffer, or null if the thread is exiting.
+     */
+    static ThreadBuffer *getThreadBuffer()
+    {
+        if (threadBufferRetired)
+            return nullptr;
+        thread_local ThreadBufferOwner owner;
+        if (owner.buffer == nullptr) {
+            Registry &registry = getRegistry();
+            auto newBuffer = std::make_unique<ThreadBuffer>();
+            QMutexLocker lock { &registry.lock };
+            newBuffer->threadIndex = registry.nextThreadIndex++;
+            QString threadName = QThread::currentThread()->objectName();
+            newBuffer->threadName = threadName.isEmpty()
+                ? QString("Thread %1").arg(newBuffer->threadIndex)
+                : threadName;
+            owner.buffer = newBuffer.get();
+            registry.buffers.push_back(std::move(newBuffer));
+        }
+        return owner.buffer;
+    }
+}
+
+/*!
+ * \brief Bach::Tracing::nowNs returns the time since tracing started.
+ * \return The time in nanoseconds.
+ */
+qint64 Bach::Tracing::nowNs()
+{
+    auto elapsed = std::chrono::steady_clock::now() - getRegistry().startTime;
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+}
+
+/*!
+ * \brief Bach::Tracing::recordSpan records a finished span into the calling thread's ring buffer.
+ *
+ * \param name The name of the span. Must have static lifetime.
+ * \param startNs When the span started, as returned by nowNs.
+ * \param endNs When the span ended, as returned by nowNs.
+ *
+ * \threadsafe
+ */
+void Bach::Tracing::recordSpan(const char *name, qint64 startNs, qint64 endNs)
+{
+    ThreadBuffer *buffer = getThreadBuffer();
+    if (buffer == nullptr)
+        return;
+    quint64 index = buffer->writeCount.load(std::memory_order_relaxed);
+    TraceEvent &event = (*buffer->events)[index % eventsPerThread];
+    event.name.store(name, std::memory_order_relaxed);
+    event.startNs.store(startNs, std::memory_order_relaxed);
+    event.endNs.store(endNs, std::memory_order_relaxed);
+    buffer->writeCount.store(index + 1, std::memory_order_release);
+}
+
+/*!
+ * \brief Bach::Tracing::isEnabled
+ * \return True if new spans are being recorded.
+ */
+bool Bach::Tracing::isEnabled()
+{
+    return getRegistry().enabled.load(std::memory_order_relaxed);
+}
+
+/*!
+ * \brief Bach::Tracing::setEnabled turns recording of new spans on or off at runtime.
+ * Spans that are already recorded are kept.
+ */
+void Bach::Tracing::setEnabled(bool enabled)
+{
+    getRegistry().enabled.store(enabled, std::memory_order_relaxed);
+}
+
+/*!
+ * \brief Bach::Tracing::clear removes all recorded spans.
+ *
+ * The buffers of threads that have exited are freed.
+ * Spans that are being recorded by other threads while clearing may or may not be kept.
+ */
+void Bach::Tracing::clear()
+{
+    Registry &registry = getRegistry();
+    QMutexLocker lock { &registry.lock };
+    auto isRetired = [](const std::unique_ptr<ThreadBuffer> &buffer) { return buffer->events == nullptr; };
+    registry.buffers.erase(
+        std::remove_if(registry.buffers.begin(), registry.buffers.end(), isRetired),
+        registry.buffers.end());
+    for (const auto &buffer : registry.buffers) {
+        buffer->writeCount.store(0, std::memory_order_release);
+    }
+}
+
+/*!
+ * \brief Bach::Tracing::exportChromeTraceJson builds a Chrome trace of all recorded spans.
+ *
+ * Slots that were overwritten while they were being read are left out.
+ *
+ * \return The trace as a JSON document in the Chrome trace event format.
+ *
+ * \threadsafe
+ */
+QByteArray Bach::Tracing::exportChromeTraceJson()
+{
+    Registry &registry = getRegistry();
+    QMutexLocker lock { &registry.lock };
+
+    auto createSpanEvent = [](int threadIndex, const char *name, qint64 startNs, qint64 endNs) {
+        QJsonObject traceEvent;
+        traceEvent["name"] = name;
+        traceEvent["cat"] = "bach";
+        traceEvent["ph"] = "X";
+        traceEvent["pid"] = 1;
+        traceEvent["tid"] = threadIndex;
+        // The Chrome trace format uses microseconds.
+        traceEvent["ts"] = startNs / 1000.0;
+        traceEvent["dur"] = (endNs - startNs) / 1000.0;
+        return traceEvent;
+    };
+
+    QJsonArray traceEvents;
+    for (const auto &buffer : registry.buffers) {
+        // Name the thread in the trace viewer.
+        QJsonObject threadNameEvent;
+        threadNameEvent["name"] = "thread_name";
+        threadNameEvent["ph"] = "M";
+        threadNameEvent["pid"] = 1;
+        threadNameEvent["tid"] = buffer->threadIndex;
+        threadNameEvent["args"] = QJsonObject{ { "name", buffer->threadName } };
+        traceEvents.append(threadNameEvent);
+
+        // The thread has exited, and its spans can no longer change.
+        if (buffer->events == nullptr) {
+            for (const RecordedSpan &span : buffer->retiredSpans) {
+                if (span.name != nullptr)
+                    traceEvents.append(createSpanEvent(buffer->threadIndex, span.name, span.startNs, span.endNs));
+            }
+            continue;
+        }
+
+        const quint64 writeCountBefore = buffer->writeCount.load(std::memory_order_acquire);
+        const quint64 first = writeCountBefore > (quint64)eventsPerThread
+            ? writeCountBefore - eventsPerThread
+            : 0;
+
+        QJsonArray threadEvents;
+        QVector<quint64> eventIndices;
+        for (quint64 i = first; i < writeCountBefore; i++) {
+            const TraceEvent &event = (*buffer->events)[i % eventsPerThread];
+            const char *name = event.name.load(std::memory_order_relaxed);
+            if (name == nullptr)
+                continue;
+            const qint64 startNs = event.startNs.load(std::memory_order_relaxed);
+            const qint64 endNs = event.endNs.load(std::memory_order_relaxed);
+            threadEvents.append(createSpanEvent(buffer->threadIndex, name, startNs, endNs));
+            eventIndices.push_back(i);
+        }
+
+        // Any slot the owning thread reached while we were reading may have been
+        // overwritten halfway, so we drop those. The thread may also be writing the slot
+        // of index writeCountAfter right now, which is the slot of writeCountAfter - eventsPerThread.
+        const quint64 writeCountAfter = buffer->writeCount.load(std::memory_order_acquire);
+        if (writeCountAfter < writeCountBefore)
+            continue;
+        const quint64 firstSafe = writeCountAfter >= (quint64)eventsPerThread
+            ? writeCountAfter - eventsPerThread + 1
+            : 0;
+        for (int i = 0; i < threadEvents.size(); i++) {
+            if (eventIndices[i] >= firstSafe)
+                traceEvents.append(threadEvents[i]);
+        }
+    }
+
+    QJsonObject root;
+    root["traceEvents"] = traceEvents;
+    root["displayTimeUnit"] = "ms";
+    return QJsonDocument{ root }.toJson(QJsonDocument::Compact);
+}
+
+/*!
+ * \brief Bach::Tracing::writeChromeTrace writes all recorded spans to a Chrome trace file.
+ *
+ * \param path The path of the file to write.
+ * \return True if the file was written successfully.
+ */
+bool Bach::Tracing::writeChromeTrace(const QString &path)
+{
+    QFile file { path };
+    if (!file.open(QFile::WriteOnly)) {
+        return false;
+    }
+    const QByteArray json = exportChromeTraceJson();
+    return file.write(json) == json.size();
+}
@@ -0,0 +1,81 @@
+// Copyright (c) 2024 Cecilia Norevik Bratlie, Nils Petter Skålerud, Eimen Oueslati
+// SPDX-License-Identifier: MIT
+
+#ifndef TRACING_H
+#define TRACING_H
+
+// Qt header files
+#include <QByteArray>
+#include <QString>
+#include <QtTypes>
+
+/*
+ * Scoped trace spans for the hot paths of the library.
+ *
+ * Spans are recorded into a fixed-size ring buffer per thread, so recording never
+ * takes a lock and never allocates after the first span of a thread. The ring buffer
+ * is freed when its thread exits, and the spans it held are kept until clear() is called.
+ * The spans can be exported to the Chrome trace JSON format at any time,
+ * which can be opened in chrome://tracing or https://ui.perfetto.dev.
+ *
+ * Tracing is compiled in when BACH_TRACING_ENABLED is defined to 1,
+ * which is controlled by the BACH_ENABLE_TRACING CMake option.
+ * When it is compiled out, BACH_TRACE_SCOPE expands to nothing.
+ */
+
+namespace Bach::Tracing {
+    /*!
+     * \brief eventsPerThread is the capacity of each thread's ring buffer.
+     * Once a thread has recorded more spans than this, the oldest spans are overwritten.
+     */
+    constexpr int eventsPerThread = 16384;
+
+    qint64 nowNs();
+    void recordSpan(const char *name, qint64 startNs, qint64 endNs);
+
+    bool isEnabled();
+    void setEnabled(bool enabled);
+
+    void clear();
+    QByteArray exportChromeTraceJson();
+    bool writeChromeTrace(const QString &path);
+
+    /*!
+     * \brief The ScopedSpan class records a trace span from its construction until its destruction.
+     *
+     * Should be created through the BACH_TRACE_SCOPE macro.
+     * The name must be a string literal, since only the pointer is stored.
+     */
+    class ScopedSpan {
+    public:
+        explicit ScopedSpan(const char *name) :
+            name{ name },
+            startNs{ isEnabled() ? nowNs() : -1 } {}
+        ScopedSpan(const ScopedSpan&) = delete;
+        ScopedSpan& operator=(const ScopedSpan&) = delete;
+        ~ScopedSpan()
+        {
+            if (startNs >= 0)
+                recordSpan(name, startNs, nowNs());
+        }
+
+    private:
+        const char *name = nullptr;
+        qint64 startNs = -1;
+    };
+}
+
+#define BACH_TRACE_CONCAT_IMPL(a, b) a##b
+#define BACH_TRACE_CONCAT(a, b) BACH_TRACE_CONCAT_IMPL(a, b)
+
+#if defined(BACH_TRACING_ENABLED) && BACH_TRACING_ENABLED
+/*!
+ * \brief BACH_TRACE_SCOPE records a trace span named \a name that lasts until the end of the current scope.
+ */
+#define BACH_TRACE_SCOPE(name) \
+    const Bach::Tracing::ScopedSpan BACH_TRACE_CONCAT(bachTraceSpan_, __LINE__){ name }
+#else
+#define BACH_TRACE_SCOPE(name) do {} while (false)
+#endif
+
+#endif // TRACING_H
@@ -6,6 +6,7 @@
 
 // Qt header files
 #include <QByteArray>
+#include <QFlags>
 #include <QJsonDocument>
 #include <QString>
 
@@ -25,6 +26,31 @@ enum class TileType {
     Raster,
 };
 
+/*!
+ * \brief The TileTypeFlag enum is used to request a combination of tile types.
+ *
+ * The TileTypes flags are passed along with a tile request, so that only
+ * the tile types that are shown get loaded.
+ */
+enum class TileTypeFlag {
+    Vector = 0x1,
+    Raster = 0x2,
+};
+Q_DECLARE_FLAGS(TileTypes, TileTypeFlag)
+Q_DECLARE_OPERATORS_FOR_FLAGS(TileTypes)
+
+// Requests both vector and raster tiles.
+constexpr TileTypes allTileTypes = TileTypeFlag::Vector | TileTypeFlag::Raster;
+
+/*!
+ * \brief toTileTypeFlag converts a TileType to the flag used in TileTypes.
+ * \param type - The tile type.
+ * \return the matching flag.
+ */
+constexpr inline TileTypeFlag toTileTypeFlag(TileType type) {
+    return type == TileType::Vector ? TileTypeFlag::Vector : TileTypeFlag::Raster;
+}
+
 /*!
  * \brief The FileFormat enum can be used to handle different tile file formats.
  *
@@ -0,0 +1,310 @@
+// Copyright (c) 2024 Cecilia Norevik Bratlie, Nils Petter Skålerud, Eimen Oueslati
+// SPDX-License-Identifier: MIT
+
+// Qt header files
+#include <QProtobufSerializer>
+
+// Other header files
+#include "VectorTileWriter.h"
+#include "vector_tile.qpb.h"
+
+using Bach::VectorTileWriter;
+
+namespace {
+    // Command IDs of the geometry encoding.
+    constexpr quint32 moveToCommand = 1;
+    constexpr quint32 lineToCommand = 2;
+    constexpr quint32 closePathCommand = 7;
+
+    // GeomType values of the MVT format.
+    constexpr int pointType = 1;
+    constexpr int lineStringType = 2;
+    constexpr int polygonType = 3;
+
+    /*!
+     * \internal
+     * \brief The GeometryEncoder class writes geometry commands.
+     *
+     * Coordinates are stored relative to the previous point, so the encoder
+     * keeps track of the cursor across all the parts of a feature.
+     */
+    struct GeometryEncoder {
+        QList<quint32> out;
+        QPoint cursor;
+
+        static quint32 commandInteger(quint32 id, quint32 count)
+        {
+            return (id & 0x7) | (count << 3);
+        }
+
+        // Zigzag-encodes a signed value so that small negative values stay small.
+        static quint32 parameterInteger(qint32 value)
+        {
+            return ((quint32)value << 1) ^ (quint32)(value >> 31);
+        }
+
+        void writePoint(QPoint point)
+        {
+            out.append(parameterInteger(point.x() - cursor.x()));
+            out.append(parameterInteger(point.y() - cursor.y()));
+            cursor = point;
+        }
+
+        void moveTo(QPoint point)
+        {
+            out.append(commandInteger(moveToCommand, 1));
+            writePoint(point);
+        }
+
+        void lineTo(const QPolygon &points, int start, int end)
+        {
+            if (end <= start)
+                return;
+            out.append(commandInteger(lineToCommand, end - start));
+            for (int i = start; i < end; i++)
+                writePoint(points[i]);
+        }
+
+        void closePath()
+        {
+            out.append(commandInteger(closePathCommand, 1));
+        }
+    };
+
+    /*!
+     * \internal
+     * \brief valueKey builds the key used to share equal values within a layer.
+     */
+    QString valueKey(const QVariant &value)
+    {
+        return QString::number(value.typeId()) + ':' + value.toString();
+    }
+
+    /*!
+     * \internal
+     * \brief toProtoValue converts an attribute to a value of the MVT format.
+     *
+     * Integers are written as int_value, except negative numbers which are written
+     * as sint_value since the format encodes those more compactly.
+     * Types that have no counterpart in the format are written as strings.
+     */
+    vector_tile::Tile_QtProtobufNested::Value toProtoValue(const QVariant &value)
+    {
+        vector_tile::Tile_QtProtobufNested::Value out;
+        switch (value.typeId()) {
+        case QMetaType::Type::Bool:
+            out.setBoolValue(value.toBool());
+            break;
+        case QMetaType::Type::Float:
+            out.setFloatValue(value.toFloat());
+            break;
+        case QMetaType::Type::Double:
+            out.setDoubleValue(value.toDouble());
+            break;
+        case QMetaType::Type::Int:
+        case QMetaType::Type::Long:
+        case QMetaType::Type::LongLong:
+            if (value.toLongLong() < 0)
+                out.setSintValue(value.toLongLong());
+            else
+                out.setIntValue(value.toLongLong());
+            break;
+        case QMetaType::Type::UInt:
+        case QMetaType::Type::ULong:
+        case QMetaType::Type::ULongLong:
+            out.setUintValue(value.toULongLong());
+            break;
+        default:
+            out.setStringValue(value.toString());
+            break;
+        }
+        return out;
+    }
+}
+
+/*!
+ * \brief VectorTileWriter::beginLayer starts a new layer.
+ * Features added after this call are put in this layer.
+ *
+ * \param name The name of the layer. Should be unique within the tile.
+ * \param extent The size of the tile in tile coordinates.
+ */
+void VectorTileWriter::beginLayer(const QString &name, int extent)
+{
+    LayerData layer;
+    layer.name = name;
+    layer.extent = extent;
+    layers.append(std::move(layer));
+}
+
+VectorTileWriter::LayerData &VectorTileWriter::currentLayer()
+{
+    // Be forgiving if the caller forgot to start a layer.
+    if (layers.isEmpty())
+        beginLayer("default");
+    return layers.last();
+}
+
+/*!
+ * \internal
+ * \brief VectorTileWriter::encodeAttributes turns attributes into the tags of a feature,
+ * adding any new keys and values to the layer.
+ */
+QList<quint32> VectorTileWriter::encodeAttributes(
+    LayerData &layer,
+    const QMap<QString, QVariant> &attributes)
+{
+    QList<quint32> tags;
+    tags.reserve(attributes.size() * 2);
+    for (auto it = attributes.cbegin(); it != attributes.cend(); it++) {
+        auto keyIt = layer.keyIndices.find(it.key());
+        if (keyIt == layer.keyIndices.end()) {
+            keyIt = layer.keyIndices.insert(it.key(), layer.keys.size());
+            layer.keys.append(it.key());
+        }
+
+        const QString key = valueKey(it.value());
+        auto valueIt = layer.valueIndices.find(key);
+        if (valueIt == layer.valueIndices.end()) {
+            valueIt = layer.valueIndices.insert(key, layer.values.size());
+            layer.values.append(it.value());
+        }
+
+        tags.append(keyIt.value());
+        tags.append(valueIt.value());
+    }
+    return tags;
+}
+
+/*!
+ * \brief VectorTileWriter::addPolygon adds a polygon to the current layer.
+ *
+ * \param rings The rings of the polygon, the exterior ring first.
+ * Rings don't need to repeat their first point at the end.
+ * \param attributes The attributes of the feature.
+ * \param id The id of the feature. Zero means no id.
+ */
+void VectorTileWriter::addPolygon(
+    const QList<QPolygon> &rings,
+    const QMap<QString, QVariant> &attributes,
+    quint64 id)
+{
+    LayerData &layer = currentLayer();
+    FeatureData feature;
+    feature.type = polygonType;
+    feature.id = id;
+    feature.tags = encodeAttributes(layer, attributes);
+
+    GeometryEncoder encoder;
+    for (const QPolygon &ring : rings) {
+        int end = ring.size();
+        // The closing point is implied by ClosePath.
+        if (end > 1 && ring.first() == ring.last())
+            end--;
+        if (end < 3)
+            continue;
+        encoder.moveTo(ring.first());
+        encoder.lineTo(ring, 1, end);
+        encoder.closePath();
+    }
+    feature.geometry = std::move(encoder.out);
+    layer.features.append(std::move(feature));
+}
+
+/*!
+ * \brief VectorTileWriter::addLines adds a line, or a set of lines, to the current layer.
+ *
+ * \param lines The lines of the feature. Lines with fewer than two points are skipped.
+ * \param attributes The attributes of the feature.
+ * \param id The id of the feature. Zero means no id.
+ */
+void VectorTileWriter::addLines(
+    const QList<QPolygon> &lines,
+    const QMap<QString, QVariant> &attributes,
+    quint64 id)
+{
+    LayerData &layer = currentLayer();
+    FeatureData feature;
+    feature.type = lineStringType;
+    feature.id = id;
+    feature.tags = encodeAttributes(layer, attributes);
+
+    GeometryEncoder encoder;
+    for (const QPolygon &line : lines) {
+        if (line.size() < 2)
+            continue;
+        encoder.moveTo(line.first());
+        encoder.lineTo(line, 1, line.size());
+    }
+    feature.geometry = std::move(encoder.out);
+    layer.features.append(std::move(feature));
+}
+
+/*!
+ * \brief VectorTileWriter::addPoints adds a point, or a set of points, to the current layer.
+ *
+ * \param points The points of the feature.
+ * \param attributes The attributes of the feature.
+ * \param id The id of the feature. Zero means no id.
+ */
+void VectorTileWriter::addPoints(
+    const QList<QPoint> &points,
+    const QMap<QString, QVariant> &attributes,
+    quint64 id)
+{
+    LayerData &layer = currentLayer();
+    FeatureData feature;
+    feature.type = pointType;
+    feature.id = id;
+    feature.tags = encodeAttributes(layer, attributes);
+
+    GeometryEncoder encoder;
+    if (!points.isEmpty()) {
+        // All points go in a single MoveTo command.
+        encoder.out.append(GeometryEncoder::commandInteger(moveToCommand, points.size()));
+        for (QPoint point : points)
+            encoder.writePoint(point);
+    }
+    feature.geometry = std::move(encoder.out);
+    layer.features.append(std::move(feature));
+}
+
+/*!
+ * \brief VectorTileWriter::toByteArray encodes every layer that has been added.
+ * \return The tile in the Mapbox Vector Tile format.
+ */
+QByteArray VectorTileWriter::toByteArray() const
+{
+    QList<vector_tile::Tile_QtProtobufNested::Layer> protoLayers;
+    for (const LayerData &layer : layers) {
+        QList<vector_tile::Tile_QtProtobufNested::Feature> protoFeatures;
+        for (const FeatureData &feature : layer.features) {
+            vector_tile::Tile_QtProtobufNested::Feature protoFeature;
+            protoFeature.setType((vector_tile::Tile::GeomType)feature.type);
+            if (feature.id != 0)
+                protoFeature.setId(feature.id);
+            protoFeature.setTags(feature.tags);
+            protoFeature.setGeometry(feature.geometry);
+            protoFeatures.append(std::move(protoFeature));
+        }
+
+        QList<vector_tile::Tile_QtProtobufNested::Value> protoValues;
+        for (const QVariant &value : layer.values)
+            protoValues.append(toProtoValue(value));
+
+        vector_tile::Tile_QtProtobufNested::Layer protoLayer;
+        protoLayer.setVersion(2);
+        protoLayer.setName(layer.name);
+        protoLayer.setExtent(layer.extent);
+        protoLayer.setKeys(layer.keys);
+        protoLayer.setValues(protoValues);
+        protoLayer.setFeatures(protoFeatures);
+        protoLayers.append(std::move(protoLayer));
+    }
+
+    vector_tile::Tile tile;
+    tile.setLayers(protoLayers);
+
+    QProtobufSerializer serializer;
+    return tile.serialize(&serializer);
+}
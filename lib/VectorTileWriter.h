@@ -0,0 +1,86 @@
+// Copyright (c) 2024 Cecilia Norevik Bratlie, Nils Petter Skålerud, Eimen Oueslati
+// SPDX-License-Identifier: MIT
+
+#ifndef VECTORTILEWRITER_H
+#define VECTORTILEWRITER_H
+
+// Qt header files
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QPoint>
+#include <QPolygon>
+#include <QString>
+#include <QVariant>
+
+namespace Bach {
+    /*!
+     * \brief The VectorTileWriter class encodes features into a Mapbox Vector Tile.
+     *
+     * Features are added to the layer that was most recently started with beginLayer.
+     * Attribute keys and values are shared between the features of a layer, as the format requires.
+     *
+     * The writer doesn't check the geometry. Following the format, the exterior ring of a
+     * polygon should be clockwise and holes should be counter-clockwise, in tile coordinates
+     * where y points down.
+     *
+     * Mainly used to generate tiles for tests and benchmarks.
+     */
+    class VectorTileWriter {
+    public:
+        void beginLayer(const QString &name, int extent = 4096);
+
+        void addPolygon(
+            const QList<QPolygon> &rings,
+            const QMap<QString, QVariant> &attributes = {},
+            quint64 id = 0);
+        void addLines(
+            const QList<QPolygon> &lines,
+            const QMap<QString, QVariant> &attributes = {},
+            quint64 id = 0);
+        void addPoints(
+            const QList<QPoint> &points,
+            const QMap<QString, QVariant> &attributes = {},
+            quint64 id = 0);
+
+        int layerCount() const { return layers.size(); }
+
+        QByteArray toByteArray() const;
+
+    private:
+        /*!
+         * \internal
+         * \brief The FeatureData class holds an encoded feature.
+         * Type is the GeomType of the MVT format.
+         */
+        struct FeatureData {
+            int type = 0;
+            quint64 id = 0;
+            QList<quint32> tags;
+            QList<quint32> geometry;
+        };
+
+        /*!
+         * \internal
+         * \brief The LayerData class holds an encoded layer.
+         */
+        struct LayerData {
+            QString name;
+            int extent = 4096;
+            QList<QString> keys;
+            QHash<QString, int> keyIndices;
+            QList<QVariant> values;
+            // Keyed by the type and the text form of the value.
+            QHash<QString, int> valueIndices;
+            QList<FeatureData> features;
+        };
+
+        QList<LayerData> layers;
+
+        LayerData &currentLayer();
+        QList<quint32> encodeAttributes(LayerData &layer, const QMap<QString, QVariant> &attributes);
+    };
+}
+
+#endif // VECTORTILEWRITER_H
@@ -5,9 +5,30 @@
 #include <QProtobufSerializer>
 
 // Other header files
+#include "AllocationCounting.h"
+#include "FeatureIndex.h"
+#include "Tracing.h"
 #include "VectorTiles.h"
 #include "vector_tile.qpb.h"
 
+/*!
+ * \brief AbstractLayerFeature::id
+ * \return the id of the feature, or zero if it has none
+ */
+quint64 AbstractLayerFeature::id() const
+{
+    return m_id;
+}
+
+/*!
+ * \brief AbstractLayerFeature::setId
+ * setter for the id of the feature
+ */
+void AbstractLayerFeature::setId(quint64 id)
+{
+    m_id = id;
+}
+
 /*!
  * \brief PolygonFeature::type
  * \return the type of the feature
@@ -371,6 +392,65 @@ void populateFeatureMetaData(
 VectorTile::VectorTile() {
 }
 
+VectorTile::VectorTile(VectorTile&&) = default;
+
+VectorTile::~VectorTile() = default;
+
+/*!
+ * \brief VectorTile::featureIndex
+ * Gets the spatial index of the features in this tile, and builds it the first time.
+ *
+ * The layers of the tile should not be changed after this has been called.
+ *
+ * \threadsafe
+ *
+ * \return The index. Lives as long as the tile.
+ */
+const Bach::TileFeatureIndex &VectorTile::featureIndex() const
+{
+    QMutexLocker lock { m_featureIndexLock.get() };
+    if (m_featureIndex == nullptr)
+        m_featureIndex = std::make_unique<Bach::TileFeatureIndex>(Bach::TileFeatureIndex::build(*this));
+    return *m_featureIndex;
+}
+
+/*!
+ * \brief VectorTile::solidTileInfo
+ * Gets the solid tile analysis of this tile for a stylesheet and map zoom level.
+ * The analysis is only run the first time, after which the result is cached.
+ *
+ * \threadsafe
+ *
+ * \param styleSheet The stylesheet the tile is rendered with.
+ * \param mapZoom The map zoom level the tile is rendered at.
+ * \param analyzeFn Runs the analysis when there is no cached result.
+ * \return The analysis.
+ */
+Bach::SolidTileInfo VectorTile::solidTileInfo(
+    const StyleSheet *styleSheet,
+    int mapZoom,
+    const std::function<Bach::SolidTileInfo()> &analyzeFn) const
+{
+    QMutexLocker lock { m_solidTileInfoLock.get() };
+    auto it = m_solidTileInfo.find({ styleSheet, mapZoom });
+    if (it == m_solidTileInfo.end())
+        it = m_solidTileInfo.insert({ { styleSheet, mapZoom }, analyzeFn() }).first;
+    return it->second;
+}
+
+/*!
+ * \brief VectorTile::clearSolidTileInfo
+ * Removes the cached solid tile analyses. Has to be called when a stylesheet
+ * the tile has been rendered with changes.
+ *
+ * \threadsafe
+ */
+void VectorTile::clearSolidTileInfo() const
+{
+    QMutexLocker lock { m_solidTileInfoLock.get() };
+    m_solidTileInfo.clear();
+}
+
 
 std::optional<VectorTile> VectorTile::fromByteArray(const QByteArray &bytes)
 {
@@ -397,6 +477,8 @@ std::optional<VectorTile> VectorTile::fromFile(const QString &path)
  */
 std::optional<VectorTile> Bach::tileFromByteArray(const QByteArray &bytes)
 {
+    BACH_TRACE_SCOPE("VectorTiles::tileFromByteArray");
+    BACH_ALLOCATION_PHASE(Decode);
     QProtobufSerializer serializer;
 
     vector_tile::Tile tile;
@@ -426,6 +508,7 @@ std::optional<VectorTile> Bach::tileFromByteArray(const QByteArray &bytes)
                 {
                     std::unique_ptr<AbstractLayerFeature> newFeaturePtr = polygonFeatureFromProto(feature);
                     AbstractLayerFeature *newFeature = newFeaturePtr.get();
+                    newFeature->setId(feature.id());
                     newFeature->tags = feature.tags().toList();
                     populateFeatureMetaData(newFeature, layerKeys, layerValues);
                     newLayer->m_features.push_back(std::move(newFeaturePtr));
@@ -440,6 +523,7 @@ std::optional<VectorTile> Bach::tileFromByteArray(const QByteArray &bytes)
                         newFeaturePtr = lineFeatureFromProto(feature);
                     }
                     AbstractLayerFeature *newFeature = newFeaturePtr.get();
+                    newFeature->setId(feature.id());
                     newFeature->tags = feature.tags().toList();
                     populateFeatureMetaData(newFeature, layerKeys, layerValues);
                     newLayer->m_features.push_back(std::move(newFeaturePtr));
@@ -449,6 +533,7 @@ std::optional<VectorTile> Bach::tileFromByteArray(const QByteArray &bytes)
                 {
                     std::unique_ptr<AbstractLayerFeature> newFeaturePtr = pointFeatureFromProto(feature);
                     AbstractLayerFeature *newFeature = newFeaturePtr.get();
+                    newFeature->setId(feature.id());
                     newFeature->tags = feature.tags().toList();
                     populateFeatureMetaData(newFeature, layerKeys, layerValues);
                     newLayer->m_features.push_back(std::move(newFeaturePtr));
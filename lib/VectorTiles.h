@@ -6,18 +6,41 @@
 
 //Qt header files
 #include <QByteArray>
+#include <QColor>
 #include <QFile>
 #include <QList>
 #include <QMap>
+#include <QMutex>
 #include <QPainterPath>
 #include <QRect>
 #include <QVariant>
 
 // STL header files
+#include <functional>
 #include <map>      // For std::map
 #include <optional> // For std::optional
 #include <memory>   // For std::unique_ptr
 
+class AbstractLayerFeature;
+class StyleSheet;
+
+namespace Bach {
+    class TileFeatureIndex;
+
+    /*!
+     * \brief The SolidTileInfo class tells if a tile renders as a single color
+     * for a stylesheet and map zoom level, see Bach::getSolidTileInfo.
+     */
+    struct SolidTileInfo {
+        bool isSolid = false;
+        // The color the whole tile is filled with.
+        QColor color;
+        // The feature covering the tile, and the index of the layer style drawing it.
+        const AbstractLayerFeature *feature = nullptr;
+        int styleLayerIndex = -1;
+    };
+}
+
 /*
  * This abstract class is the base for all the classes representing different layer features.
  */
@@ -35,10 +58,14 @@ public:
     };
 
     virtual featureType type() const = 0;
+    quint64 id() const;
+    void setId(quint64 id);
     QVector<unsigned int> tags;
     QMap<QString, QVariant> featureMetaData;
 private:
-    int m_id;
+    // The id from the tile, zero if the tile has none.
+    // Features split across tiles have the same id in every tile.
+    quint64 m_id = 0;
 };
 
 /*
@@ -133,23 +160,83 @@ public:
     VectorTile();
     // The move operation of internal memory
     // is automatically handled by the std::unique_ptr
-    VectorTile(VectorTile&&) = default;
+    VectorTile(VectorTile&&);
     // Explicitly deleted copy-constructor so that we know we can never
     // mistakenly copy this class around.
     VectorTile(const VectorTile&) = delete;
     // Internal memory cleanup is automatically handled by the std::unique_ptr
-    ~VectorTile() = default;
+    ~VectorTile();
 
     bool DeserializeMessage(QByteArray data);
     static std::optional<VectorTile> fromByteArray(const QByteArray &bytes);
     static std::optional<VectorTile> fromFile(const QString &path);
     std::map<QString, std::unique_ptr<TileLayer>> m_layers;
+
+    const Bach::TileFeatureIndex &featureIndex() const;
+
+    Bach::SolidTileInfo solidTileInfo(
+        const StyleSheet *styleSheet,
+        int mapZoom,
+        const std::function<Bach::SolidTileInfo()> &analyzeFn) const;
+    void clearSolidTileInfo() const;
+
+private:
+    // The spatial index is built the first time it is needed, from any thread.
+    mutable std::unique_ptr<QMutex> m_featureIndexLock = std::make_unique<QMutex>();
+    mutable std::unique_ptr<Bach::TileFeatureIndex> m_featureIndex;
+    // The solid tile analysis for each stylesheet and map zoom level it was rendered with.
+    mutable std::unique_ptr<QMutex> m_solidTileInfoLock = std::make_unique<QMutex>();
+    mutable std::map<std::pair<const StyleSheet*, int>, Bach::SolidTileInfo> m_solidTileInfo;
 };
 
 namespace Bach {
     inline QString testDataDir = "testdata/";
 
     std::optional<VectorTile> tileFromByteArray(const QByteArray &bytes);
+
+    /*!
+     * \brief The MemoryUsage class holds the estimated heap memory of decoded tile data,
+     * split by category.
+     */
+    struct MemoryUsage {
+        // Number of features counted.
+        qint64 featureCount = 0;
+        // The feature and layer objects themselves.
+        qint64 objectBytes = 0;
+        // The decoded geometry: paths and points.
+        qint64 geometryBytes = 0;
+        // The featureMetaData maps, including the strings they hold.
+        qint64 metaDataBytes = 0;
+        // The raw tag lists.
+        qint64 tagBytes = 0;
+        // The feature index and the solid tile cache, counted before they are built.
+        qint64 indexBytes = 0;
+
+        qint64 totalBytes() const { return objectBytes + geometryBytes + metaDataBytes + tagBytes + indexBytes; }
+
+        MemoryUsage &operator+=(const MemoryUsage &other);
+        MemoryUsage &operator-=(const MemoryUsage &other);
+    };
+
+    /*!
+     * \brief The VectorTileMemoryUsage class holds the estimated heap memory
+     * of one or more decoded vector tiles, split by layer name.
+     */
+    struct VectorTileMemoryUsage {
+        // Number of tiles counted.
+        qint64 tileCount = 0;
+        std::map<QString, MemoryUsage> layers;
+        // The parts of the feature index and the solid tile cache that aren't
+        // tied to a layer. Included in the indexBytes of total().
+        qint64 tileIndexBytes = 0;
+
+        MemoryUsage total() const;
+
+        VectorTileMemoryUsage &operator+=(const VectorTileMemoryUsage &other);
+        VectorTileMemoryUsage &operator-=(const VectorTileMemoryUsage &other);
+    };
+
+    VectorTileMemoryUsage calcMemoryUsage(const VectorTile &tile);
 }
 
 #endif // VECTORTILES_H
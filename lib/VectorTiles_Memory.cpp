@@ -0,0 +1,268 @@
+// Copyright (c) 2024 Cecilia Norevik Bratlie, Nils Petter Skålerud, Eimen Oueslati
+// SPDX-License-Identifier: MIT
+
+// Qt header files
+#include <QSet>
+
+// Other header files
+#include "FeatureIndex.h"
+#include "VectorTiles.h"
+
+/*
+ * The sizes below are estimates of what the allocator and Qt's containers add
+ * on top of the data we store. They are taken from the sizes of these structures
+ * in 64-bit builds of Qt 6 with glibc's malloc, and have not been checked against
+ * measured allocations. The resulting byte counts, and the memory budget of the
+ * TileLoader that uses them, are estimates, good enough to compare layers and size caches.
+ */
+
+// Bookkeeping the allocator adds to every heap allocation.
+constexpr qint64 estimatedMallocOverheadBytes = 16;
+// Header in front of the data of every QString and QList allocation (QArrayData).
+constexpr qint64 estimatedArrayDataHeaderBytes = 16;
+// The shared data of a non-empty QMap: a reference count and a std::map.
+constexpr qint64 estimatedMapDataBytes = 56;
+// The red-black tree links of every std::map node.
+constexpr qint64 estimatedMapNodeLinkBytes = 32;
+// The private data of a non-empty QPainterPath, excluding the element list.
+constexpr qint64 estimatedPainterPathDataBytes = 64;
+
+/*!
+ * \internal
+ * \brief The SharedDataTracker class remembers which implicitly shared
+ * allocations have already been counted.
+ *
+ * Strings in the metadata of a tile share their data with the key and value
+ * lists of the tile, so the same data is referenced by many features.
+ */
+struct SharedDataTracker {
+    QSet<const void*> seen;
+
+    bool isFirstUse(const void *data)
+    {
+        if (seen.contains(data))
+            return false;
+        seen.insert(data);
+        return true;
+    }
+};
+
+/*!
+ * \internal
+ * \brief heapBytesOfList returns the heap memory of the elements of a QList,
+ * or zero if the list has no allocation of its own.
+ */
+template<typename T>
+static qint64 heapBytesOfList(const QList<T> &list)
+{
+    if (list.capacity() == 0)
+        return 0;
+    return estimatedMallocOverheadBytes + estimatedArrayDataHeaderBytes + list.capacity() * (qint64)sizeof(T);
+}
+
+/*!
+ * \internal
+ * \brief heapBytesOfString returns the heap memory of the string's data,
+ * or zero if the data has already been counted or is not on the heap.
+ */
+static qint64 heapBytesOfString(const QString &string, SharedDataTracker &tracker)
+{
+    if (string.capacity() == 0)
+        return 0;
+    if (!tracker.isFirstUse(string.constData()))
+        return 0;
+    return estimatedMallocOverheadBytes + estimatedArrayDataHeaderBytes + (string.capacity() + 1) * (qint64)sizeof(QChar);
+}
+
+/*!
+ * \internal
+ * \brief heapBytesOfMetaData returns the heap memory of a feature's metadata map.
+ */
+static qint64 heapBytesOfMetaData(
+    const QMap<QString, QVariant> &metaData,
+    SharedDataTracker &tracker)
+{
+    if (metaData.isEmpty())
+        return 0;
+
+    qint64 out = estimatedMallocOverheadBytes + estimatedMapDataBytes;
+    for (auto it = metaData.cbegin(); it != metaData.cend(); it++) {
+        out += estimatedMallocOverheadBytes + estimatedMapNodeLinkBytes + sizeof(QString) + sizeof(QVariant);
+        out += heapBytesOfString(it.key(), tracker);
+        // Strings are the only values we store that own heap memory.
+        // The numbers fit inside the QVariant itself.
+        if (it.value().typeId() == QMetaType::Type::QString) {
+            const QString *string = static_cast<const QString*>(it.value().constData());
+            out += heapBytesOfString(*string, tracker);
+        }
+    }
+    return out;
+}
+
+/*!
+ * \internal
+ * \brief heapBytesOfPath returns the heap memory of a QPainterPath.
+ */
+static qint64 heapBytesOfPath(const QPainterPath &path)
+{
+    if (path.elementCount() == 0)
+        return 0;
+    return estimatedMallocOverheadBytes + estimatedPainterPathDataBytes +
+        estimatedMallocOverheadBytes + estimatedArrayDataHeaderBytes +
+        path.elementCount() * (qint64)sizeof(QPainterPath::Element);
+}
+
+/*!
+ * \internal
+ * \brief calcFeatureMemoryUsage returns the memory used by a single feature.
+ */
+static Bach::MemoryUsage calcFeatureMemoryUsage(
+    const AbstractLayerFeature &feature,
+    SharedDataTracker &tracker)
+{
+    Bach::MemoryUsage out;
+    out.featureCount = 1;
+    out.tagBytes = heapBytesOfList(feature.tags);
+    // The entry of the feature in the feature index, and its place in at least one cell.
+    out.indexBytes = sizeof(Bach::FeatureIndexEntry) + sizeof(int);
+    out.metaDataBytes = heapBytesOfMetaData(feature.featureMetaData, tracker);
+
+    switch (feature.type()) {
+    case AbstractLayerFeature::featureType::polygon:
+        out.objectBytes = estimatedMallocOverheadBytes + sizeof(PolygonFeature);
+        out.geometryBytes = heapBytesOfPath(static_cast<const PolygonFeature&>(feature).polygon());
+        break;
+    case AbstractLayerFeature::featureType::line:
+        out.objectBytes = estimatedMallocOverheadBytes + sizeof(LineFeature);
+        out.geometryBytes = heapBytesOfPath(static_cast<const LineFeature&>(feature).line());
+        break;
+    case AbstractLayerFeature::featureType::point:
+        out.objectBytes = estimatedMallocOverheadBytes + sizeof(PointFeature);
+        out.geometryBytes = heapBytesOfList(static_cast<const PointFeature&>(feature).points());
+        break;
+    default:
+        out.objectBytes = estimatedMallocOverheadBytes + sizeof(UnknownFeature);
+        break;
+    }
+    return out;
+}
+
+/*!
+ * \internal
+ * \brief estimateTileIndexBytes returns the memory of the lazily built structures of a tile
+ * that belong to the tile as a whole rather than to its features.
+ *
+ * The feature index and one entry of the solid tile cache are counted whether they
+ * have been built or not, so a memory budget leaves room for them from the start.
+ */
+static qint64 estimateTileIndexBytes()
+{
+    // The index object, its three vectors, and the start of every grid cell.
+    const qint64 featureIndexBytes =
+        estimatedMallocOverheadBytes + sizeof(Bach::TileFeatureIndex) +
+        3 * estimatedMallocOverheadBytes +
+        (Bach::TileFeatureIndex::gridSize * Bach::TileFeatureIndex::gridSize + 1) * (qint64)sizeof(int);
+    // A tile is usually analyzed with a single stylesheet and map zoom level.
+    const qint64 solidTileCacheBytes =
+        estimatedMallocOverheadBytes + estimatedMapNodeLinkBytes +
+        sizeof(std::pair<const std::pair<const StyleSheet*, int>, Bach::SolidTileInfo>);
+    return featureIndexBytes + solidTileCacheBytes;
+}
+
+Bach::MemoryUsage &Bach::MemoryUsage::operator+=(const MemoryUsage &other)
+{
+    featureCount += other.featureCount;
+    objectBytes += other.objectBytes;
+    geometryBytes += other.geometryBytes;
+    metaDataBytes += other.metaDataBytes;
+    tagBytes += other.tagBytes;
+    indexBytes += other.indexBytes;
+    return *this;
+}
+
+Bach::MemoryUsage &Bach::MemoryUsage::operator-=(const MemoryUsage &other)
+{
+    featureCount -= other.featureCount;
+    objectBytes -= other.objectBytes;
+    geometryBytes -= other.geometryBytes;
+    metaDataBytes -= other.metaDataBytes;
+    tagBytes -= other.tagBytes;
+    indexBytes -= other.indexBytes;
+    return *this;
+}
+
+/*!
+ * \brief Bach::VectorTileMemoryUsage::total
+ * \return The memory usage of all layers combined, and of the structures of the tiles as a whole.
+ */
+Bach::MemoryUsage Bach::VectorTileMemoryUsage::total() const
+{
+    MemoryUsage out;
+    for (const auto &[layerName, usage] : layers)
+        out += usage;
+    out.indexBytes += tileIndexBytes;
+    return out;
+}
+
+Bach::VectorTileMemoryUsage &Bach::VectorTileMemoryUsage::operator+=(const VectorTileMemoryUsage &other)
+{
+    tileCount += other.tileCount;
+    tileIndexBytes += other.tileIndexBytes;
+    for (const auto &[layerName, usage] : other.layers)
+        layers[layerName] += usage;
+    return *this;
+}
+
+Bach::VectorTileMemoryUsage &Bach::VectorTileMemoryUsage::operator-=(const VectorTileMemoryUsage &other)
+{
+    tileCount -= other.tileCount;
+    tileIndexBytes -= other.tileIndexBytes;
+    for (const auto &[layerName, usage] : other.layers) {
+        auto it = layers.find(layerName);
+        if (it == layers.end())
+            continue;
+        it->second -= usage;
+        // Drop layers that no longer have anything counted, so the map doesn't grow forever.
+        if (it->second.featureCount == 0 && it->second.totalBytes() == 0)
+            layers.erase(it);
+    }
+    return *this;
+}
+
+/*!
+ * \brief Bach::calcMemoryUsage estimates how much heap memory a decoded vector tile uses.
+ *
+ * Data that is implicitly shared between features, like the metadata strings,
+ * is only counted once, in the layer where it is first found.
+ *
+ * The feature index and the solid tile cache of the tile are built when they are first
+ * needed. They are included either way, so the estimate doesn't grow after the tile is loaded.
+ *
+ * \param tile The tile to measure.
+ * \return The memory usage of each layer of the tile.
+ */
+Bach::VectorTileMemoryUsage Bach::calcMemoryUsage(const VectorTile &tile)
+{
+    VectorTileMemoryUsage out;
+    out.tileCount = 1;
+    out.tileIndexBytes = estimateTileIndexBytes();
+    SharedDataTracker tracker;
+
+    for (const auto &[layerName, layer] : tile.m_layers) {
+        MemoryUsage &layerUsage = out.layers[layerName];
+
+        // The layer itself, its entry in the tile's map and its list of feature pointers.
+        layerUsage.objectBytes += estimatedMallocOverheadBytes + sizeof(TileLayer);
+        layerUsage.objectBytes += estimatedMallocOverheadBytes + estimatedMapNodeLinkBytes + sizeof(QString) + sizeof(std::unique_ptr<TileLayer>);
+        layerUsage.objectBytes += heapBytesOfString(layerName, tracker);
+        if (layer->m_features.capacity() > 0) {
+            layerUsage.objectBytes +=
+                estimatedMallocOverheadBytes +
+                layer->m_features.capacity() * (qint64)sizeof(std::unique_ptr<AbstractLayerFeature>);
+        }
+
+        for (const auto &feature : layer->m_features)
+            layerUsage += calcFeatureMemoryUsage(*feature, tracker);
+    }
+    return out;
+}
@@ -0,0 +1,189 @@
+// Copyright (c) 2024 Cecilia Norevik Bratlie, Nils Petter Skålerud, Eimen Oueslati
+// SPDX-License-Identifier: MIT
+
+// Qt header files
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSaveFile>
+
+// STL header files
+#include <algorithm>
+#include <set>
+
+// Other header files
+#include "Rendering.h"
+#include "TileLoader.h"
+#include "WarmStart.h"
+
+using Bach::WarmStartState;
+
+/*!
+ * \brief WarmStartState::toJson writes the state into a JSON object.
+ *
+ * Tiles are written as [zoom, x, y] arrays.
+ *
+ * \return The JSON object.
+ */
+QJsonObject WarmStartState::toJson() const
+{
+    QJsonArray tilesJson;
+    for (TileCoord coord : tiles)
+        tilesJson.append(QJsonArray{ coord.zoom, coord.x, coord.y });
+
+    QJsonObject viewportJson;
+    viewportJson.insert("x", x);
+    viewportJson.insert("y", y);
+    viewportJson.insert("zoom", zoom);
+
+    QJsonObject out;
+    out.insert("viewport", viewportJson);
+    out.insert("tiles", tilesJson);
+    return out;
+}
+
+/*!
+ * \internal
+ * \brief isValidTileCoord checks that a tile coordinate exists on the map.
+ */
+static bool isValidTileCoord(TileCoord coord)
+{
+    if (coord.zoom < 0 || coord.zoom > Bach::maxZoomLevel)
+        return false;
+    const int tileCount = 1 << coord.zoom;
+    return coord.x >= 0 && coord.x < tileCount && coord.y >= 0 && coord.y < tileCount;
+}
+
+/*!
+ * \brief WarmStartState::fromJson reads a state written by toJson.
+ *
+ * Tiles that don't exist on the map are skipped, since the file may have been edited.
+ *
+ * \param json The JSON object.
+ * \return The state, or nothing if the viewport is missing or outside the map.
+ */
+std::optional<WarmStartState> WarmStartState::fromJson(const QJsonObject &json)
+{
+    const QJsonObject viewportJson = json.value("viewport").toObject();
+    const QJsonValue xValue = viewportJson.value("x");
+    const QJsonValue yValue = viewportJson.value("y");
+    const QJsonValue zoomValue = viewportJson.value("zoom");
+    if (!xValue.isDouble() || !yValue.isDouble() || !zoomValue.isDouble())
+        return std::nullopt;
+
+    WarmStartState out;
+    out.x = xValue.toDouble();
+    out.y = yValue.toDouble();
+    out.zoom = zoomValue.toDouble();
+    if (out.x < 0 || out.x > 1 || out.y < 0 || out.y > 1)
+        return std::nullopt;
+
+    for (const QJsonValue &tileValue : json.value("tiles").toArray()) {
+        const QJsonArray tileJson = tileValue.toArray();
+        if (tileJson.size() != 3)
+            continue;
+        const TileCoord coord = { tileJson[0].toInt(-1), tileJson[1].toInt(-1), tileJson[2].toInt(-1) };
+        if (isValidTileCoord(coord))
+            out.tiles.push_back(coord);
+    }
+    return out;
+}
+
+/*!
+ * \brief Bach::getWarmStartFilePath returns the path of the warm start file.
+ * It lives in the general cache storage of the application.
+ */
+QString Bach::getWarmStartFilePath()
+{
+    return TileLoader::getGeneralCacheFolder() + QDir::separator() + "warm_start.json";
+}
+
+/*!
+ * \brief Bach::readWarmStartFile reads the state written by writeWarmStartFile.
+ *
+ * \param path The path of the file.
+ * \return The state, or nothing if the file doesn't exist or can't be read.
+ */
+std::optional<WarmStartState> Bach::readWarmStartFile(const QString &path)
+{
+    QFile file{ path };
+    if (!file.open(QFile::ReadOnly))
+        return std::nullopt;
+
+    QJsonParseError parseError;
+    const QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &parseError);
+    if (parseError.error != QJsonParseError::NoError || !doc.isObject()) {
+        qWarning() << "Unable to parse the warm start file:" << parseError.errorString();
+        return std::nullopt;
+    }
+    return WarmStartState::fromJson(doc.object());
+}
+
+/*!
+ * \brief Bach::writeWarmStartFile writes the state to a file.
+ *
+ * The file is replaced in one step, so a crash while writing leaves the old file.
+ *
+ * \param path The path of the file. Its folder is created if it doesn't exist.
+ * \param state The state to write.
+ * \return True if the file was written.
+ */
+bool Bach::writeWarmStartFile(const QString &path, const WarmStartState &state)
+{
+    QDir{}.mkpath(QFileInfo{ path }.absolutePath());
+
+    QSaveFile file{ path };
+    if (!file.open(QFile::WriteOnly))
+        return false;
+    file.write(QJsonDocument{ state.toJson() }.toJson(QJsonDocument::Compact));
+    return file.commit();
+}
+
+/*!
+ * \brief Bach::orderWarmStartTiles picks the tiles to preload on the next start, most important first.
+ *
+ * The visible tiles come first, the ones closest to the center of the viewport before
+ * the ones at the edges. They are followed by the recently used tiles.
+ *
+ * \param visibleTiles The tiles visible in the viewport.
+ * \param x The center of the viewport, in world-normalized coordinates.
+ * \param y The center of the viewport, in world-normalized coordinates.
+ * \param recentTiles The tiles in memory, most recently used first.
+ * \param maxTiles The largest number of tiles to return.
+ * \return The tiles, without duplicates.
+ */
+QVector<TileCoord> Bach::orderWarmStartTiles(
+    const QVector<TileCoord> &visibleTiles,
+    double x,
+    double y,
+    const QVector<TileCoord> &recentTiles,
+    int maxTiles)
+{
+    auto distanceToCenter = [&](TileCoord coord) {
+        const double tileCount = 1 << coord.zoom;
+        const double dx = (coord.x + 0.5) / tileCount - x;
+        const double dy = (coord.y + 0.5) / tileCount - y;
+        return dx * dx + dy * dy;
+    };
+    QVector<TileCoord> sortedVisibleTiles = visibleTiles;
+    std::stable_sort(
+        sortedVisibleTiles.begin(),
+        sortedVisibleTiles.end(),
+        [&](TileCoord a, TileCoord b) { return distanceToCenter(a) < distanceToCenter(b); });
+
+    QVector<TileCoord> out;
+    std::set<TileCoord> added;
+    auto add = [&](const QVector<TileCoord> &tiles) {
+        for (TileCoord coord : tiles) {
+            if (out.size() >= maxTiles)
+                return;
+            if (added.insert(coord).second)
+                out.push_back(coord);
+        }
+    };
+    add(sortedVisibleTiles);
+    add(recentTiles);
+    return out;
+}
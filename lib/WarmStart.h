@@ -0,0 +1,50 @@
+// Copyright (c) 2024 Cecilia Norevik Bratlie, Nils Petter Skålerud, Eimen Oueslati
+// SPDX-License-Identifier: MIT
+
+#ifndef WARMSTART_H
+#define WARMSTART_H
+
+// Qt header files
+#include <QJsonObject>
+#include <QString>
+#include <QVector>
+
+// STL header files
+#include <optional>
+
+// Other header files
+#include "TileCoord.h"
+
+namespace Bach {
+    /*!
+     * \brief The WarmStartState class holds what the application showed when it was last closed.
+     *
+     * It is written on shutdown and read on the next start, so the application can open at
+     * the same place and load the tiles it needs before the first frame.
+     */
+    struct WarmStartState {
+        // Center of the viewport in world-normalized coordinates, range [0, 1].
+        double x = 0.5;
+        double y = 0.5;
+        double zoom = 0;
+
+        // The vector tiles to preload, most important first.
+        QVector<TileCoord> tiles;
+
+        QJsonObject toJson() const;
+        static std::optional<WarmStartState> fromJson(const QJsonObject &json);
+    };
+
+    QString getWarmStartFilePath();
+    std::optional<WarmStartState> readWarmStartFile(const QString &path);
+    bool writeWarmStartFile(const QString &path, const WarmStartState &state);
+
+    QVector<TileCoord> orderWarmStartTiles(
+        const QVector<TileCoord> &visibleTiles,
+        double x,
+        double y,
+        const QVector<TileCoord> &recentTiles,
+        int maxTiles);
+}
+
+#endif // WARMSTART_H
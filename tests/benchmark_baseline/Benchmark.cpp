@@ -0,0 +1,408 @@
+#include "Bach/Benchmark/Benchmark.h"
+
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QRegularExpression>
+#include <QSysInfo>
+#include <QTextStream>
+#include <QtLogging>
+
+#include <AllocationCounting.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace Benchmark = Bach::Benchmark;
+
+/*!
+ * \brief
+ * How many times bigger than the noise of the runs a change needs to be
+ * before we count it as significant.
+ */
+static constexpr double noiseMultiplier = 3.0;
+
+/*!
+ * \brief
+ * Scales the median absolute deviation so that it estimates the standard
+ * deviation of normally distributed samples.
+ */
+static constexpr double madToStdDev = 1.4826;
+
+static double medianOf(std::vector<double> values)
+{
+    if (values.empty())
+        return 0;
+    std::sort(values.begin(), values.end());
+    const size_t middle = values.size() / 2;
+    if (values.size() % 2 == 1)
+        return values[middle];
+    return (values[middle - 1] + values[middle]) / 2;
+}
+
+/*!
+ * \brief Metric::median
+ * \return The median of all samples, or zero if there are none.
+ */
+double Benchmark::Metric::median() const
+{
+    return medianOf(samples);
+}
+
+/*!
+ * \brief Metric::relativeSpread estimates how noisy the samples are.
+ *
+ * Uses the median absolute deviation rather than the standard deviation,
+ * so that a single outlier run doesn't hide real changes.
+ *
+ * \return The estimated standard deviation as a fraction of the median.
+ * Zero if there are fewer than two samples.
+ */
+double Benchmark::Metric::relativeSpread() const
+{
+    if (samples.size() < 2)
+        return 0;
+    const double center = median();
+    if (center == 0)
+        return 0;
+    std::vector<double> deviations;
+    for (double sample : samples)
+        deviations.push_back(std::abs(sample - center));
+    return madToStdDev * medianOf(deviations) / std::abs(center);
+}
+
+/*!
+ * \brief Report::addSample adds a sample to a metric, creating the metric if needed.
+ */
+void Benchmark::Report::addSample(
+    const QString &name,
+    double value,
+    const QString &unit,
+    bool higherIsBetter)
+{
+    Metric &metric = metrics[name];
+    metric.unit = unit;
+    metric.higherIsBetter = higherIsBetter;
+    metric.samples.push_back(value);
+}
+
+QJsonObject Benchmark::Report::toJson() const
+{
+    QJsonObject metricsJson;
+    for (const auto &[name, metric] : metrics) {
+        QJsonArray samplesJson;
+        for (double sample : metric.samples)
+            samplesJson.append(sample);
+
+        QJsonObject metricJson;
+        metricJson["unit"] = metric.unit;
+        metricJson["higher-is-better"] = metric.higherIsBetter;
+        metricJson["median"] = metric.median();
+        metricJson["relative-spread"] = metric.relativeSpread();
+        metricJson["samples"] = samplesJson;
+        metricsJson[name] = metricJson;
+    }
+
+    QJsonObject out;
+    out["benchmark"] = benchmark;
+    out["profile"] = profile;
+    out["metrics"] = metricsJson;
+    if (!details.isEmpty())
+        out["details"] = details;
+    return out;
+}
+
+/*!
+ * \brief Report::fromJson reads a report written by Report::toJson.
+ * \return The report, or nothing if the JSON is not a report.
+ */
+std::optional<Benchmark::Report> Benchmark::Report::fromJson(const QJsonObject &json)
+{
+    if (!json["benchmark"].isString() || !json["metrics"].isObject())
+        return std::nullopt;
+
+    Report out;
+    out.benchmark = json["benchmark"].toString();
+    out.profile = json["profile"].toString();
+    out.details = json["details"].toObject();
+
+    const QJsonObject metricsJson = json["metrics"].toObject();
+    for (auto it = metricsJson.begin(); it != metricsJson.end(); it++) {
+        const QJsonObject metricJson = it.value().toObject();
+        Metric &metric = out.metrics[it.key()];
+        metric.unit = metricJson["unit"].toString();
+        metric.higherIsBetter = metricJson["higher-is-better"].toBool();
+        for (const QJsonValue &sample : metricJson["samples"].toArray())
+            metric.samples.push_back(sample.toDouble());
+    }
+    return out;
+}
+
+bool Benchmark::Comparison::hasRegressions() const
+{
+    return std::any_of(metrics.begin(), metrics.end(), [](const MetricComparison &item) {
+        return item.isRegression;
+    });
+}
+
+/*!
+ * \brief Comparison::toText formats the comparison as a human-readable table.
+ */
+QString Benchmark::Comparison::toText() const
+{
+    QString out;
+    QTextStream stream { &out };
+    for (const MetricComparison &item : metrics) {
+        QString verdict = "ok";
+        if (item.isRegression)
+            verdict = "SLOWER";
+        else if (item.isImprovement)
+            verdict = "faster";
+
+        stream << QString("%1 %2: %3 -> %4 %5 (%6%, threshold %7%)\n")
+            .arg(verdict, -6)
+            .arg(item.name)
+            .arg(item.baselineMedian, 0, 'g', 4)
+            .arg(item.currentMedian, 0, 'g', 4)
+            .arg(item.unit)
+            .arg(item.relativeSlowdown * 100, 0, 'f', 1)
+            .arg(item.threshold * 100, 0, 'f', 1);
+    }
+    for (const QString &name : missingFromReport)
+        stream << "missing from report: " << name << "\n";
+    for (const QString &name : missingFromBaseline)
+        stream << "missing from baseline: " << name << "\n";
+    return out;
+}
+
+/*!
+ * \brief defaultProfileName builds a name for the machine we are running on.
+ *
+ * Benchmarks are only comparable on the same machine, so every machine stores its own baselines.
+ * Use the --profile option to share a profile between identical machines.
+ */
+QString Benchmark::defaultProfileName()
+{
+    QString name = QString("%1-%2-%3")
+        .arg(QSysInfo::machineHostName())
+        .arg(QSysInfo::productType())
+        .arg(QSysInfo::currentCpuArchitecture());
+    // Keep the name safe to use as a folder name.
+    static const QRegularExpression unsafeCharacters("[^A-Za-z0-9_.-]");
+    return name.replace(unsafeCharacters, "_");
+}
+
+/*!
+ * \brief buildBaselinePath
+ * \return The path of the baseline file of a benchmark for a machine profile.
+ */
+QString Benchmark::buildBaselinePath(
+    const QString &baselineDir,
+    const QString &profile,
+    const QString &benchmark)
+{
+    return baselineDir + "/" + profile + "/" + benchmark + ".json";
+}
+
+/*!
+ * \brief parseOptions parses the command line options shared by all benchmarks.
+ *
+ * For compatibility with older scripts, a single positional argument is used as the output path.
+ * Exits the process if the options are invalid.
+ */
+Benchmark::Options Benchmark::parseOptions(const QStringList &arguments)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Runs a benchmark and optionally compares it against a stored baseline.");
+    parser.addHelpOption();
+    QCommandLineOption repeatOption { "repeat", "Number of times to run the whole benchmark.", "count", "1" };
+    QCommandLineOption outputOption { "output", "Write the JSON report to this file instead of standard output.", "path" };
+    QCommandLineOption profileOption { "profile", "Name of the machine profile to store and compare baselines under.", "name" };
+    QCommandLineOption baselineDirOption { "baseline-dir", "Folder holding the baselines of every machine profile.", "path", BACH_BENCHMARK_BASELINE_DIR };
+    QCommandLineOption saveBaselineOption { "save-baseline", "Store the report as the baseline of the machine profile." };
+    QCommandLineOption compareOption { "compare", "Compare the report against the baseline of the machine profile. Exits with an error on slowdowns." };
+    QCommandLineOption thresholdOption { "min-change", "Smallest change, in percent, that can count as a slowdown.", "percent", "5" };
+    QCommandLineOption tileDirOption { "tile-dir", "Folder of z{zoom}x{x}y{y}.mvt files to use instead of the built-in tiles.", "path" };
+    parser.addOptions({
+        repeatOption,
+        outputOption,
+        profileOption,
+        baselineDirOption,
+        saveBaselineOption,
+        compareOption,
+        thresholdOption,
+        tileDirOption });
+    parser.addPositionalArgument("output", "Same as --output.", "[output]");
+    parser.process(arguments);
+
+    Options out;
+    bool repeatsValid = false;
+    out.repeats = parser.value(repeatOption).toInt(&repeatsValid);
+    if (!repeatsValid || out.repeats < 1) {
+        qCritical() << "--repeat must be a positive number.";
+        std::exit(EXIT_FAILURE);
+    }
+
+    bool thresholdValid = false;
+    out.minRelativeChange = parser.value(thresholdOption).toDouble(&thresholdValid) / 100.0;
+    if (!thresholdValid || out.minRelativeChange < 0) {
+        qCritical() << "--min-change must be a non-negative number.";
+        std::exit(EXIT_FAILURE);
+    }
+
+    out.outputPath = parser.value(outputOption);
+    if (out.outputPath.isEmpty() && !parser.positionalArguments().isEmpty())
+        out.outputPath = parser.positionalArguments().first();
+
+    out.profile = parser.isSet(profileOption) ? parser.value(profileOption) : defaultProfileName();
+    out.baselineDir = parser.value(baselineDirOption);
+    out.saveBaseline = parser.isSet(saveBaselineOption);
+    out.compare = parser.isSet(compareOption);
+    out.tileDir = parser.value(tileDirOption);
+    return out;
+}
+
+/*!
+ * \brief compare finds the metrics that changed significantly compared to a baseline.
+ *
+ * A change counts as significant when it is larger than minRelativeChange and larger
+ * than the noise of the runs. The noise is estimated from the spread of the samples of
+ * both the baseline and the current report, so run the benchmark with --repeat of at
+ * least 3 to get noise-aware thresholds. With fewer samples only minRelativeChange is used.
+ *
+ * \param minRelativeChange The smallest change that can be significant, as a fraction.
+ */
+Benchmark::Comparison Benchmark::compare(
+    const Report &baseline,
+    const Report &current,
+    double minRelativeChange)
+{
+    Comparison out;
+    for (const auto &[name, baselineMetric] : baseline.metrics) {
+        auto currentIt = current.metrics.find(name);
+        if (currentIt == current.metrics.end()) {
+            out.missingFromReport.append(name);
+            continue;
+        }
+        const Metric &currentMetric = currentIt->second;
+
+        MetricComparison item;
+        item.name = name;
+        item.unit = currentMetric.unit;
+        item.baselineMedian = baselineMetric.median();
+        item.currentMedian = currentMetric.median();
+        if (item.baselineMedian <= 0 || item.currentMedian <= 0) {
+            // Can't express the change as a fraction, so don't judge it.
+            out.metrics.push_back(item);
+            continue;
+        }
+
+        item.relativeSlowdown = currentMetric.higherIsBetter ?
+            item.baselineMedian / item.currentMedian - 1 :
+            item.currentMedian / item.baselineMedian - 1;
+
+        const double noise = std::hypot(baselineMetric.relativeSpread(), currentMetric.relativeSpread());
+        item.threshold = std::max(minRelativeChange, noiseMultiplier * noise);
+        item.isRegression = item.relativeSlowdown > item.threshold;
+        item.isImprovement = -item.relativeSlowdown > item.threshold;
+        out.metrics.push_back(item);
+    }
+    for (const auto &[name, metric] : current.metrics) {
+        if (baseline.metrics.find(name) == baseline.metrics.end())
+            out.missingFromBaseline.append(name);
+    }
+    return out;
+}
+
+/*!
+ * \brief resetAllocationCounts should be called at the start of every run of a benchmark,
+ * so that addAllocationSamples only sees the allocations of that run.
+ */
+void Benchmark::resetAllocationCounts()
+{
+    Bach::AllocationCounting::reset();
+}
+
+/*!
+ * \brief addAllocationSamples adds the number of allocations and allocated bytes of every phase
+ * since the last call to resetAllocationCounts to the report.
+ *
+ * Does nothing unless the library was built with BACH_ENABLE_ALLOCATION_COUNTING,
+ * so that reports from normal builds don't contain a lot of zeroes.
+ */
+void Benchmark::addAllocationSamples(Report &report)
+{
+    namespace AllocationCounting = Bach::AllocationCounting;
+    if (!AllocationCounting::isCompiledIn())
+        return;
+
+    for (int i = 0; i < (int)AllocationCounting::Phase::Count; i++) {
+        const auto phase = (AllocationCounting::Phase)i;
+        const AllocationCounting::Counts counts = AllocationCounting::getCounts(phase);
+        const QString prefix = QString("allocations/") + AllocationCounting::phaseName(phase);
+        report.addSample(prefix + "/count", (double)counts.allocations, "allocations");
+        report.addSample(prefix + "/bytes", (double)counts.bytes, "bytes");
+    }
+}
+
+static bool writeJsonFile(const QString &path, const QJsonObject &json)
+{
+    QFileInfo(path).absoluteDir().mkpath(".");
+    QFile file { path };
+    if (!file.open(QFile::WriteOnly))
+        return false;
+    file.write(QJsonDocument{ json }.toJson());
+    return true;
+}
+
+/*!
+ * \brief finish writes the report and stores or compares the baseline, as requested by the options.
+ * \return The exit code of the benchmark. Non-zero if anything failed or got slower.
+ */
+int Benchmark::finish(const Options &options, const Report &report)
+{
+    const QJsonObject reportJson = report.toJson();
+    if (options.outputPath.isEmpty()) {
+        QTextStream(stdout) << QJsonDocument{ reportJson }.toJson();
+    } else if (!writeJsonFile(options.outputPath, reportJson)) {
+        qCritical() << "Unable to write output file" << options.outputPath;
+        return EXIT_FAILURE;
+    }
+
+    const QString baselinePath = buildBaselinePath(options.baselineDir, report.profile, report.benchmark);
+
+    if (options.compare) {
+        QFile baselineFile { baselinePath };
+        if (!baselineFile.open(QFile::ReadOnly)) {
+            qCritical() << "No baseline found for profile" << report.profile << "at" << baselinePath;
+            return EXIT_FAILURE;
+        }
+        std::optional<Report> baseline = Report::fromJson(QJsonDocument::fromJson(baselineFile.readAll()).object());
+        if (!baseline.has_value()) {
+            qCritical() << "Baseline file is not a benchmark report:" << baselinePath;
+            return EXIT_FAILURE;
+        }
+
+        const Comparison comparison = compare(baseline.value(), report, options.minRelativeChange);
+        // Keep standard output for the JSON report.
+        QTextStream(stderr) << comparison.toText();
+        if (comparison.hasRegressions()) {
+            qCritical() << "Benchmark" << report.benchmark << "got slower compared to the baseline.";
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Save after comparing, so that comparing and saving in the same run compares against the old baseline.
+    if (options.saveBaseline) {
+        if (!writeJsonFile(baselinePath, reportJson)) {
+            qCritical() << "Unable to write baseline file" << baselinePath;
+            return EXIT_FAILURE;
+        }
+        qInfo() << "Saved baseline to" << baselinePath;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,127 @@
+#ifndef BACH_BENCHMARK_H
+#define BACH_BENCHMARK_H
+
+#include <QJsonObject>
+#include <QString>
+#include <QStringList>
+
+#include <map>
+#include <optional>
+#include <vector>
+
+#ifndef BACH_BENCHMARK_BASELINE_DIR
+#error "C++ define 'BACH_BENCHMARK_BASELINE_DIR' was not defined. This likely means a build error."
+#endif
+
+/*
+ * Shared helpers for the benchmark executables.
+ *
+ * Every benchmark collects its headline numbers into a Report. A Report can be written
+ * as JSON, stored as the baseline for the current machine profile, and compared against
+ * a stored baseline to find slowdowns.
+ *
+ * All benchmarks accept the same command line options, see parseOptions.
+ */
+namespace Bach::Benchmark {
+    /*!
+     * \brief The Metric class holds the samples of a single headline number,
+     * one sample per repeated run of the benchmark.
+     */
+    struct Metric {
+        // For example "ms" or "ns/eval".
+        QString unit;
+        // Whether bigger numbers are better, like throughput.
+        // Otherwise smaller numbers are better, like durations.
+        bool higherIsBetter = false;
+        std::vector<double> samples;
+
+        double median() const;
+        double relativeSpread() const;
+    };
+
+    /*!
+     * \brief The Report class holds the result of a benchmark run.
+     */
+    struct Report {
+        // Name of the benchmark executable.
+        QString benchmark;
+        // Name of the machine profile the benchmark ran on.
+        QString profile;
+        // Metrics by name. Names are stable across runs, so they can be compared.
+        std::map<QString, Metric> metrics;
+        // Benchmark-specific output of the last run, stored as-is.
+        QJsonObject details;
+
+        void addSample(const QString &name, double value, const QString &unit, bool higherIsBetter = false);
+
+        QJsonObject toJson() const;
+        static std::optional<Report> fromJson(const QJsonObject &json);
+    };
+
+    /*!
+     * \brief The Options class holds the command line options shared by all benchmarks.
+     */
+    struct Options {
+        // How many times the whole benchmark is run. Every run adds one sample per metric.
+        int repeats = 1;
+        // Where to write the report. Empty means standard output.
+        QString outputPath;
+        // Name of the machine profile, selects which baseline to use.
+        QString profile;
+        // Folder that holds one subfolder of baselines per machine profile.
+        QString baselineDir;
+        // Store the report as the new baseline of this profile.
+        bool saveBaseline = false;
+        // Compare the report against the stored baseline of this profile.
+        bool compare = false;
+        // Changes smaller than this fraction are never reported, no matter how quiet the runs are.
+        double minRelativeChange = 0.05;
+        // Folder of .mvt files to use instead of the tiles built into the benchmark.
+        // Only used by the benchmarks that read tiles. Empty means the built-in tiles.
+        QString tileDir;
+    };
+
+    /*!
+     * \brief The MetricComparison class holds how a single metric changed
+     * compared to the baseline.
+     */
+    struct MetricComparison {
+        QString name;
+        QString unit;
+        double baselineMedian = 0;
+        double currentMedian = 0;
+        // Positive values mean slower, regardless of whether higher is better for this metric.
+        double relativeSlowdown = 0;
+        // The smallest slowdown that would be counted as significant for this metric.
+        double threshold = 0;
+        bool isRegression = false;
+        bool isImprovement = false;
+    };
+
+    /*!
+     * \brief The Comparison class holds the result of comparing a report against a baseline.
+     */
+    struct Comparison {
+        std::vector<MetricComparison> metrics;
+        // Metrics that are in the baseline but not in the report, or the other way around.
+        QStringList missingFromReport;
+        QStringList missingFromBaseline;
+
+        bool hasRegressions() const;
+        QString toText() const;
+    };
+
+    QString defaultProfileName();
+    QString buildBaselinePath(const QString &baselineDir, const QString &profile, const QString &benchmark);
+
+    Options parseOptions(const QStringList &arguments);
+
+    Comparison compare(const Report &baseline, const Report &current, double minRelativeChange);
+
+    void resetAllocationCounts();
+    void addAllocationSamples(Report &report);
+
+    int finish(const Options &options, const Report &report);
+}
+
+#endif // BACH_BENCHMARK_H
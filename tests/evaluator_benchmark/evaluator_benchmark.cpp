@@ -0,0 +1,423 @@
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+#include <QtLogging>
+
+#include <Bach/Benchmark/Benchmark.h>
+#include <Evaluator.h>
+#include <LayerStyle.h>
+#include <VectorTiles.h>
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <vector>
+
+#ifndef BACH_EVALUATOR_BENCHMARK_RESOURCES_DIR
+#error "C++ define 'BACH_EVALUATOR_BENCHMARK_RESOURCES_DIR' was not defined. This likely means a build error."
+#endif
+
+// Helper function to let us do early shutdown.
+[[noreturn]] void shutdown(const QString &msg = "")
+{
+    if (msg != "") {
+        qCritical() << msg;
+    }
+    std::exit(EXIT_FAILURE);
+}
+
+/*!
+ * \brief
+ * Number of times every expression is evaluated against every feature.
+ */
+static constexpr int iterations = 3;
+
+/*!
+ * \brief
+ * Number of times each zoom-getter is called per measurement.
+ * The getters are cheap, so we need many calls to get a stable number.
+ */
+static constexpr int getterCallsPerMeasurement = 1000;
+
+/*!
+ * \brief
+ * The zoom levels every expression and getter is evaluated at.
+ */
+static const QVector<int> benchmarkZooms = { 0, 3, 6, 9, 12, 15 };
+
+/*!
+ * \brief
+ * Written to after each evaluation, so the compiler can't remove the calls we are measuring.
+ */
+static volatile int evaluationSink = 0;
+
+/*!
+ * \brief The StyleSheetInput class describes a stylesheet to run the benchmark on.
+ */
+struct StyleSheetInput {
+    QString name;
+    QString path;
+};
+
+/*!
+ * \brief The TimingStats class accumulates the time spent on a group of evaluations.
+ */
+struct TimingStats {
+    qint64 count = 0;
+    qint64 totalNs = 0;
+
+    void add(qint64 evalCount, qint64 elapsedNs)
+    {
+        count += evalCount;
+        totalNs += elapsedNs;
+    }
+};
+
+/*!
+ * \brief The PropertyGetter class describes one of the get*AtZoom functions of a layer style.
+ */
+struct PropertyGetter {
+    QString name;
+    std::function<QVariant(const AbstractLayerStyle&, int)> get;
+};
+
+/*!
+ * \brief getPropertyGetters
+ * Returns the zoom-getters of the given layer style type.
+ */
+static QVector<PropertyGetter> getPropertyGetters(AbstractLayerStyle::LayerType type)
+{
+    using LayerType = AbstractLayerStyle::LayerType;
+
+    // Helper to build a PropertyGetter from a member function of a specific layer style class.
+    auto makeGetter = [](const QString &name, QVariant (*getFn)(const AbstractLayerStyle&, int)) {
+        return PropertyGetter { name, getFn };
+    };
+
+    switch (type) {
+    case LayerType::background:
+        return {
+            makeGetter("background-color", [](const AbstractLayerStyle &style, int zoom) {
+                return static_cast<const BackgroundStyle&>(style).getColorAtZoom(zoom); }),
+            makeGetter("background-opacity", [](const AbstractLayerStyle &style, int zoom) {
+                return static_cast<const BackgroundStyle&>(style).getOpacityAtZoom(zoom); }),
+        };
+    case LayerType::fill:
+        return {
+            makeGetter("fill-color", [](const AbstractLayerStyle &style, int zoom) {
+                return static_cast<const FillLayerStyle&>(style).getFillColorAtZoom(zoom); }),
+            makeGetter("fill-opacity", [](const AbstractLayerStyle &style, int zoom) {
+                return static_cast<const FillLayerStyle&>(style).getFillOpacityAtZoom(zoom); }),
+            makeGetter("fill-outline-color", [](const AbstractLayerStyle &style, int zoom) {
+                return static_cast<const FillLayerStyle&>(style).getFillOutLineColorAtZoom(zoom); }),
+        };
+    case LayerType::line:
+        return {
+            makeGetter("line-color", [](const AbstractLayerStyle &style, int zoom) {
+                return static_cast<const LineLayerStyle&>(style).getLineColorAtZoom(zoom); }),
+            makeGetter("line-opacity", [](const AbstractLayerStyle &style, int zoom) {
+                return static_cast<const LineLayerStyle&>(style).getLineOpacityAtZoom(zoom); }),
+            makeGetter("line-width", [](const AbstractLayerStyle &style, int zoom) {
+                return static_cast<const LineLayerStyle&>(style).getLineWidthAtZoom(zoom); }),
+        };
+    case LayerType::symbol:
+        return {
+            makeGetter("text-size", [](const AbstractLayerStyle &style, int zoom) {
+                return static_cast<const SymbolLayerStyle&>(style).getTextSizeAtZoom(zoom); }),
+            makeGetter("text-color", [](const AbstractLayerStyle &style, int zoom) {
+                return static_cast<const SymbolLayerStyle&>(style).getTextColorAtZoom(zoom); }),
+            makeGetter("text-opacity", [](const AbstractLayerStyle &style, int zoom) {
+                return static_cast<const SymbolLayerStyle&>(style).getTextOpacityAtZoom(zoom); }),
+            makeGetter("symbol-spacing", [](const AbstractLayerStyle &style, int zoom) {
+                return static_cast<const SymbolLayerStyle&>(style).getSymbolSpacingAtZoom(zoom); }),
+            makeGetter("text-max-angle", [](const AbstractLayerStyle &style, int zoom) {
+                return static_cast<const SymbolLayerStyle&>(style).getTextMaxAngleAtZoom(zoom); }),
+            makeGetter("text-letter-spacing", [](const AbstractLayerStyle &style, int zoom) {
+                return static_cast<const SymbolLayerStyle&>(style).getTextLetterSpacingAtZoom(zoom); }),
+            makeGetter("text-field", [](const AbstractLayerStyle &style, int) {
+                return static_cast<const SymbolLayerStyle&>(style).m_textField; }),
+        };
+    default:
+        return {};
+    }
+}
+
+/*!
+ * \brief layerTypeName
+ * Returns the stylesheet name of the layer type.
+ */
+static QString layerTypeName(AbstractLayerStyle::LayerType type)
+{
+    using LayerType = AbstractLayerStyle::LayerType;
+    switch (type) {
+    case LayerType::background: return "background";
+    case LayerType::fill: return "fill";
+    case LayerType::line: return "line";
+    case LayerType::symbol: return "symbol";
+    default: return "not-implemented";
+    }
+}
+
+/*!
+ * \brief loadTiles
+ * Loads every vector tile used by the tile parsing benchmark.
+ */
+static std::vector<VectorTile> loadTiles()
+{
+    std::vector<VectorTile> out;
+
+    QDir dir{ QString(BACH_EVALUATOR_BENCHMARK_RESOURCES_DIR) + "/TileParsingBenchmark" };
+    for (const QString &fileName : dir.entryList({ "*.mvt" }, QDir::Filter::Files)) {
+        std::optional<VectorTile> tileResult = VectorTile::fromFile(dir.filePath(fileName));
+        if (!tileResult.has_value()) {
+            shutdown(QString("Failed to load file '%1' into VectorTile object.").arg(fileName));
+        }
+        out.push_back(std::move(tileResult.value()));
+    }
+
+    if (out.empty()) {
+        shutdown("No benchmark tiles found.");
+    }
+    return out;
+}
+
+/*!
+ * \brief collectFeaturesBySourceLayer
+ * Groups the features of all tiles by the name of the layer they belong to.
+ */
+static std::map<QString, std::vector<const AbstractLayerFeature*>> collectFeaturesBySourceLayer(
+    const std::vector<VectorTile> &tiles)
+{
+    std::map<QString, std::vector<const AbstractLayerFeature*>> out;
+    for (const VectorTile &tile : tiles) {
+        for (const auto &[layerName, layer] : tile.m_layers) {
+            std::vector<const AbstractLayerFeature*> &features = out[layerName];
+            for (const auto &feature : layer->m_features) {
+                features.push_back(feature.get());
+            }
+        }
+    }
+    return out;
+}
+
+/*!
+ * \brief expressionOperator
+ * Returns the name of the top-level operator of the expression.
+ *
+ * Nested operators are included in the time of the top-level operator,
+ * since that is what a single call to resolveExpression costs.
+ */
+static QString expressionOperator(const QJsonArray &expression)
+{
+    if (expression.isEmpty() || !expression.first().isString()) {
+        return "<invalid>";
+    }
+    return expression.first().toString();
+}
+
+/*!
+ * \brief timeExpression
+ * Evaluates the expression against every feature and returns the time it took.
+ */
+static qint64 timeExpression(
+    const QJsonArray &expression,
+    const std::vector<const AbstractLayerFeature*> &features,
+    int zoom)
+{
+    int validResults = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for (const AbstractLayerFeature *feature : features) {
+        QVariant result = Evaluator::resolveExpression(expression, feature, zoom, zoom);
+        validResults += result.isValid();
+    }
+    qint64 elapsedNs = timer.nsecsElapsed();
+    evaluationSink = evaluationSink + validResults;
+    return elapsedNs;
+}
+
+/*!
+ * \brief buildStatsJsonArray
+ * Turns a map of TimingStats into a JSON array, sorted by total time
+ * so that the most expensive entries come first.
+ */
+static QJsonArray buildStatsJsonArray(
+    const std::map<QString, TimingStats> &statsMap,
+    const QString &keyName,
+    const QString &countName,
+    const std::map<QString, QString> &extraInfo = {})
+{
+    std::vector<std::pair<QString, TimingStats>> sorted { statsMap.begin(), statsMap.end() };
+    std::sort(
+        sorted.begin(),
+        sorted.end(),
+        [](const auto &a, const auto &b) { return a.second.totalNs > b.second.totalNs; });
+
+    QJsonArray out;
+    for (const auto &[key, stats] : sorted) {
+        QJsonObject item;
+        item[keyName] = key;
+        auto extraIt = extraInfo.find(key);
+        if (extraIt != extraInfo.end()) {
+            item["type"] = extraIt->second;
+        }
+        item[countName] = stats.count;
+        item["total-ms"] = stats.totalNs / 1000000.0;
+        item["ns-per-" + countName.chopped(1)] = stats.count == 0 ? 0 : (double)stats.totalNs / stats.count;
+        out.append(item);
+    }
+    return out;
+}
+
+/*!
+ * \brief runStyleSheet
+ * Runs the benchmark on a single stylesheet and returns the results as JSON.
+ * The headline numbers are also added to the report.
+ */
+static QJsonObject runStyleSheet(
+    const StyleSheetInput &input,
+    const std::map<QString, std::vector<const AbstractLayerFeature*>> &featuresBySourceLayer,
+    Bach::Benchmark::Report &report)
+{
+    std::optional<StyleSheet> styleSheetResult = StyleSheet::fromJsonFile(input.path);
+    if (!styleSheetResult.has_value()) {
+        shutdown(QString("Failed to parse stylesheet '%1'.").arg(input.path));
+    }
+    const StyleSheet &styleSheet = styleSheetResult.value();
+
+    std::map<QString, TimingStats> operatorStats;
+    std::map<QString, TimingStats> layerStats;
+    std::map<QString, QString> layerTypes;
+    std::map<QString, TimingStats> getterStats;
+
+    static const std::vector<const AbstractLayerFeature*> noFeatures;
+
+    for (int i = 0; i < iterations; i++) {
+        for (const auto &layerStylePtr : styleSheet.m_layerStyles) {
+            const AbstractLayerStyle &layerStyle = *layerStylePtr;
+            layerTypes[layerStyle.m_id] = layerTypeName(layerStyle.type());
+
+            auto featuresIt = featuresBySourceLayer.find(layerStyle.m_sourceLayer);
+            const std::vector<const AbstractLayerFeature*> &features =
+                featuresIt != featuresBySourceLayer.end() ? featuresIt->second : noFeatures;
+
+            const QVector<PropertyGetter> getters = getPropertyGetters(layerStyle.type());
+
+            for (int zoom : benchmarkZooms) {
+                // Evaluate the filter.
+                if (!layerStyle.m_filter.isEmpty() && !features.empty()) {
+                    qint64 elapsedNs = timeExpression(layerStyle.m_filter, features, zoom);
+                    operatorStats[expressionOperator(layerStyle.m_filter)].add(features.size(), elapsedNs);
+                    layerStats[layerStyle.m_id].add(features.size(), elapsedNs);
+                }
+
+                for (const PropertyGetter &getter : getters) {
+                    // Measure the getter itself.
+                    QElapsedTimer timer;
+                    timer.start();
+                    int validResults = 0;
+                    for (int call = 0; call < getterCallsPerMeasurement; call++) {
+                        validResults += getter.get(layerStyle, zoom).isValid();
+                    }
+                    getterStats[getter.name].add(getterCallsPerMeasurement, timer.nsecsElapsed());
+                    evaluationSink = evaluationSink + validResults;
+
+                    // If the getter returns an expression, it is data-driven
+                    // and has to be evaluated for each feature.
+                    QVariant value = getter.get(layerStyle, zoom);
+                    if (value.typeId() != QMetaType::Type::QJsonArray || features.empty()) {
+                        continue;
+                    }
+                    const QJsonArray expression = value.toJsonArray();
+                    qint64 elapsedNs = timeExpression(expression, features, zoom);
+                    operatorStats[expressionOperator(expression)].add(features.size(), elapsedNs);
+                    layerStats[layerStyle.m_id].add(features.size(), elapsedNs);
+                }
+            }
+        }
+    }
+
+    auto sumStats = [](const std::map<QString, TimingStats> &statsMap) {
+        TimingStats sum;
+        for (const auto &[key, stats] : statsMap) {
+            sum.add(stats.count, stats.totalNs);
+        }
+        return sum;
+    };
+    const TimingStats allEvals = sumStats(operatorStats);
+    const TimingStats allGetterCalls = sumStats(getterStats);
+    if (allEvals.count > 0) {
+        report.addSample(input.name + "/ns-per-eval", (double)allEvals.totalNs / allEvals.count, "ns");
+    }
+    if (allGetterCalls.count > 0) {
+        report.addSample(input.name + "/ns-per-getter-call", (double)allGetterCalls.totalNs / allGetterCalls.count, "ns");
+    }
+
+    QJsonObject out;
+    out["name"] = input.name;
+    out["path"] = input.path;
+    out["layer-styles"] = (qint64)styleSheet.m_layerStyles.size();
+    out["operators"] = buildStatsJsonArray(operatorStats, "operator", "evals");
+    out["layers"] = buildStatsJsonArray(layerStats, "id", "evals", layerTypes);
+    out["getters"] = buildStatsJsonArray(getterStats, "property", "calls");
+    return out;
+}
+
+/*!
+ * \brief main
+ * Runs the benchmark on every stylesheet and prints the results as JSON.
+ * See Bach::Benchmark::parseOptions for the command line options.
+ */
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    const Bach::Benchmark::Options options = Bach::Benchmark::parseOptions(app.arguments());
+
+    const QString resourcesDir = BACH_EVALUATOR_BENCHMARK_RESOURCES_DIR;
+    const QVector<StyleSheetInput> styleSheets = {
+        { "styleTest", resourcesDir + "/styleTest.json" },
+        { "basic-v2", resourcesDir + "/RenderOutputTesterBaseline/input-files/styleSheet.json" },
+    };
+
+    const std::vector<VectorTile> tiles = loadTiles();
+    const auto featuresBySourceLayer = collectFeaturesBySourceLayer(tiles);
+
+    qDebug() << "Number of tiles: " << tiles.size();
+    qDebug() << "Number of test iterations: " << iterations;
+
+    Bach::Benchmark::Report report;
+    report.benchmark = "evaluator_benchmark";
+    report.profile = options.profile;
+
+    QJsonArray styleSheetsJson;
+    for (int run = 0; run < options.repeats; run++) {
+        Bach::Benchmark::resetAllocationCounts();
+        // Only the details of the last run are kept.
+        styleSheetsJson = {};
+        for (const StyleSheetInput &input : styleSheets) {
+            styleSheetsJson.append(runStyleSheet(input, featuresBySourceLayer, report));
+            qDebug() << "Finished stylesheet" << input.name;
+        }
+
+        Bach::Benchmark::addAllocationSamples(report);
+    }
+
+    QJsonArray zoomsJson;
+    for (int zoom : benchmarkZooms) {
+        zoomsJson.append(zoom);
+    }
+
+    QJsonObject detailsJson;
+    detailsJson["tiles"] = (qint64)tiles.size();
+    detailsJson["iterations"] = iterations;
+    detailsJson["zooms"] = zoomsJson;
+    detailsJson["stylesheets"] = styleSheetsJson;
+    report.details = detailsJson;
+
+    return Bach::Benchmark::finish(options, report);
+}
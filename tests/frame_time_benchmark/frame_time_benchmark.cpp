@@ -0,0 +1,372 @@
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QGuiApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPainter>
+#include <QRegularExpression>
+#include <QTextStream>
+#include <QtLogging>
+
+#include <Bach/Benchmark/Benchmark.h>
+#include <Bach/Merlin/Merlin.h>
+#include <Rendering.h>
+#include <VectorTiles.h>
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace Merlin = Bach::Merlin;
+
+// Helper function to let us do early shutdown.
+[[noreturn]] void shutdown(const QString &msg = "")
+{
+    if (msg != "") {
+        qCritical() << msg;
+    }
+    std::exit(EXIT_FAILURE);
+}
+
+/*!
+ * \brief
+ * Number of times each frame of a camera path is rendered.
+ */
+static constexpr int iterations = 3;
+
+/*!
+ * \brief
+ * Size of the offscreen image we render into, in pixels.
+ */
+static constexpr int imageSize = Merlin::baseImageSize;
+
+/*!
+ * \brief The CameraFrame class describes the viewport of a single frame in a camera path.
+ */
+struct CameraFrame {
+    double vpX = {};
+    double vpY = {};
+    double vpZoom = {};
+    int mapZoom = {};
+};
+
+/*!
+ * \brief The CameraPath class is a named sequence of frames
+ * that is replayed by the benchmark, like a user moving the map.
+ */
+struct CameraPath {
+    QString name;
+    QVector<CameraFrame> frames;
+};
+
+/*!
+ * \brief The Phase class describes one of the phases we measure.
+ * Each phase is measured by rendering the frame with only that phase turned on.
+ */
+struct Phase {
+    QString name;
+    bool drawFill = {};
+    bool drawLines = {};
+    bool drawText = {};
+};
+
+static const QVector<Phase> phases = {
+    { "total", true, true, true },
+    { "fill", true, false, false },
+    { "lines", false, true, false },
+    { "text", false, false, true },
+};
+
+// Helper to interpolate linearly between two values.
+static double lerp(double a, double b, double t)
+{
+    return a + (b - a) * t;
+}
+
+/*!
+ * \brief buildPanPath
+ * Builds a camera path that pans in a straight line between two coordinates
+ * at a fixed zoom level.
+ *
+ * Coordinates are given as longitude and latitude in degrees.
+ */
+static CameraPath buildPanPath(
+    const QString &name,
+    double lonStart,
+    double latStart,
+    double lonEnd,
+    double latEnd,
+    double vpZoom,
+    int mapZoom,
+    int frameCount)
+{
+    CameraPath path;
+    path.name = name;
+    for (int i = 0; i < frameCount; i++) {
+        double t = (double)i / (frameCount - 1);
+        Bach::MapCoordinate coord = Bach::lonLatToWorldNormCoordDegrees(
+            lerp(lonStart, lonEnd, t),
+            lerp(latStart, latEnd, t));
+        path.frames.push_back({ coord.x, coord.y, vpZoom, mapZoom });
+    }
+    return path;
+}
+
+/*!
+ * \brief buildZoomPath
+ * Builds a camera path that zooms between two viewport zoom levels
+ * around a fixed coordinate.
+ *
+ * Coordinates are given as longitude and latitude in degrees.
+ */
+static CameraPath buildZoomPath(
+    const QString &name,
+    double lon,
+    double lat,
+    double vpZoomStart,
+    double vpZoomEnd,
+    int mapZoom,
+    int frameCount)
+{
+    CameraPath path;
+    path.name = name;
+    Bach::MapCoordinate coord = Bach::lonLatToWorldNormCoordDegrees(lon, lat);
+    for (int i = 0; i < frameCount; i++) {
+        double t = (double)i / (frameCount - 1);
+        path.frames.push_back({ coord.x, coord.y, lerp(vpZoomStart, vpZoomEnd, t), mapZoom });
+    }
+    return path;
+}
+
+/*!
+ * \brief buildCameraPaths
+ * Builds all the camera paths we benchmark.
+ * They only move across areas that are covered by the Merlin input tiles.
+ */
+static QVector<CameraPath> buildCameraPaths()
+{
+    return {
+        buildPanPath("world-pan", -150, 20, 150, 20, 1.0, 1, 60),
+        buildZoomPath("world-zoom-sweep", 0, 0, 0.0, 2.0, 1, 40),
+        buildZoomPath("dense-city-zoom", 10.765248, 59.949584413, 12.0, 12.6, 12, 40),
+        buildPanPath("dense-city-pan", 10.755, 59.945, 10.775, 59.955, 12.3, 12, 40),
+        buildPanPath("open-ocean-pan", -45, 30, -35, 35, 2.5, 1, 30),
+    };
+}
+
+// Container that maps TileCoord to a uniquely owned and uniquely allocated VectorTile.
+using TileMapT = std::map<TileCoord, std::unique_ptr<VectorTile>>;
+
+/*!
+ * \brief loadAllTiles
+ * Loads every vector tile in the Merlin input folder.
+ */
+static TileMapT loadAllTiles()
+{
+    TileMapT out;
+
+    static const QRegularExpression re("z(\\d+)x(\\d+)y(\\d+)\\.mvt");
+
+    QDir dir{ Merlin::buildBaselineInputPath() };
+    for (const QString &fileName : dir.entryList({ "*.mvt" }, QDir::Filter::Files)) {
+        QRegularExpressionMatch match = re.match(fileName);
+        if (!match.hasMatch()) {
+            continue;
+        }
+        TileCoord coord;
+        coord.zoom = match.captured(1).toInt();
+        coord.x = match.captured(2).toInt();
+        coord.y = match.captured(3).toInt();
+
+        std::optional<VectorTile> tileResult = VectorTile::fromFile(dir.filePath(fileName));
+        if (!tileResult.has_value()) {
+            shutdown(QString("Failed to load file '%1' into VectorTile object.").arg(fileName));
+        }
+        out.insert({ coord, std::make_unique<VectorTile>(std::move(tileResult.value())) });
+    }
+
+    if (out.empty()) {
+        shutdown("No input tiles found.");
+    }
+    return out;
+}
+
+/*!
+ * \brief renderFrame
+ * Renders a single frame into the image and returns how long paintVectorTiles took.
+ *
+ * \return The frame time in milliseconds.
+ */
+static double renderFrame(
+    QImage &image,
+    const CameraFrame &frame,
+    const Phase &phase,
+    const TileMapT &allTiles,
+    const StyleSheet &styleSheet,
+    const QFont &font)
+{
+    // Only pass in the tiles that are visible in this frame.
+    QMap<TileCoord, const VectorTile*> visibleTiles;
+    const QVector<TileCoord> visibleCoords = Bach::calcVisibleTiles(
+        frame.vpX,
+        frame.vpY,
+        (double)image.width() / image.height(),
+        frame.vpZoom,
+        frame.mapZoom);
+    for (TileCoord coord : visibleCoords) {
+        auto it = allTiles.find(coord);
+        if (it != allTiles.end()) {
+            visibleTiles.insert(coord, it->second.get());
+        }
+    }
+
+    QPainter painter{ &image };
+    painter.setFont(font);
+
+    Bach::PaintVectorTileSettings paintSettings = Bach::PaintVectorTileSettings::getDefault();
+    paintSettings.drawFill = phase.drawFill;
+    paintSettings.drawLines = phase.drawLines;
+    paintSettings.drawText = phase.drawText;
+    paintSettings.forceNoChangeFontType = true;
+
+    QElapsedTimer timer;
+    timer.start();
+    Bach::paintVectorTiles(
+        painter,
+        frame.vpX,
+        frame.vpY,
+        frame.vpZoom,
+        frame.mapZoom,
+        visibleTiles,
+        styleSheet,
+        paintSettings,
+        false);
+    return timer.nsecsElapsed() / 1000000.0;
+}
+
+/*!
+ * \brief percentile
+ * Returns the nearest-rank percentile of the samples.
+ *
+ * \param sortedSamples The samples, sorted in ascending order.
+ * \param percent The percentile to return, range [0, 100].
+ */
+static double percentile(const std::vector<double> &sortedSamples, double percent)
+{
+    if (sortedSamples.empty()) {
+        return 0;
+    }
+    int rank = (int)std::ceil(percent / 100.0 * sortedSamples.size());
+    int index = std::clamp(rank - 1, 0, (int)sortedSamples.size() - 1);
+    return sortedSamples[index];
+}
+
+/*!
+ * \brief buildStatsJson
+ * Summarizes a set of frame times into a JSON object.
+ */
+static QJsonObject buildStatsJson(std::vector<double> samples)
+{
+    std::sort(samples.begin(), samples.end());
+
+    double sum = 0;
+    for (double sample : samples) {
+        sum += sample;
+    }
+
+    QJsonObject out;
+    out["samples"] = (qint64)samples.size();
+    out["mean-ms"] = samples.empty() ? 0 : sum / samples.size();
+    out["p50-ms"] = percentile(samples, 50);
+    out["p95-ms"] = percentile(samples, 95);
+    out["p99-ms"] = percentile(samples, 99);
+    out["max-ms"] = samples.empty() ? 0 : samples.back();
+    return out;
+}
+
+/*!
+ * \brief main
+ * Replays every camera path and prints the frame-time statistics as JSON.
+ * See Bach::Benchmark::parseOptions for the command line options.
+ */
+int main(int argc, char *argv[])
+{
+    // A QGuiApplication is required to do QPainter commands.
+    QGuiApplication app(argc, argv);
+    const Bach::Benchmark::Options options = Bach::Benchmark::parseOptions(app.arguments());
+
+    std::optional<QFont> fontResult = Merlin::loadFont();
+    if (!fontResult.has_value()) {
+        shutdown("Unable to load font.");
+    }
+    const QFont &font = fontResult.value();
+
+    Merlin::SimpleResult<StyleSheet> styleSheetResult = Merlin::loadStylesheet();
+    if (!styleSheetResult.success) {
+        shutdown(styleSheetResult.errorMsg);
+    }
+    const StyleSheet &styleSheet = styleSheetResult.value;
+
+    const TileMapT allTiles = loadAllTiles();
+    const QVector<CameraPath> cameraPaths = buildCameraPaths();
+
+    qDebug() << "Number of camera paths: " << cameraPaths.size();
+    qDebug() << "Number of test iterations: " << iterations;
+
+    QImage image{ imageSize, imageSize, QImage::Format_ARGB32_Premultiplied };
+
+    Bach::Benchmark::Report report;
+    report.benchmark = "frame_time_benchmark";
+    report.profile = options.profile;
+
+    QJsonArray pathsJson;
+    for (int run = 0; run < options.repeats; run++) {
+        Bach::Benchmark::resetAllocationCounts();
+        // Only the details of the last run are kept.
+        pathsJson = {};
+        for (const CameraPath &cameraPath : cameraPaths) {
+            QJsonObject phasesJson;
+            for (const Phase &phase : phases) {
+                // Render the first frame once without measuring it, so that
+                // one-time setup like font loading doesn't end up in the results.
+                renderFrame(image, cameraPath.frames.first(), phase, allTiles, styleSheet, font);
+
+                std::vector<double> samples;
+                for (int i = 0; i < iterations; i++) {
+                    for (const CameraFrame &frame : cameraPath.frames) {
+                        samples.push_back(renderFrame(image, frame, phase, allTiles, styleSheet, font));
+                    }
+                }
+                const QJsonObject statsJson = buildStatsJson(std::move(samples));
+                phasesJson[phase.name] = statsJson;
+
+                const QString metricPrefix = cameraPath.name + "/" + phase.name;
+                report.addSample(metricPrefix + "/p50", statsJson["p50-ms"].toDouble(), "ms");
+                report.addSample(metricPrefix + "/p95", statsJson["p95-ms"].toDouble(), "ms");
+            }
+
+            QJsonObject pathJson;
+            pathJson["name"] = cameraPath.name;
+            pathJson["frames"] = (qint64)cameraPath.frames.size();
+            pathJson["phases"] = phasesJson;
+            pathsJson.append(pathJson);
+
+            qDebug() << "Finished camera path" << cameraPath.name;
+        }
+
+        Bach::Benchmark::addAllocationSamples(report);
+    }
+
+    QJsonObject detailsJson;
+    detailsJson["image-width"] = imageSize;
+    detailsJson["image-height"] = imageSize;
+    detailsJson["iterations"] = iterations;
+    detailsJson["paths"] = pathsJson;
+    report.details = detailsJson;
+
+    return Bach::Benchmark::finish(options, report);
+}
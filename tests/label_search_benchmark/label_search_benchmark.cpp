@@ -0,0 +1,239 @@
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QRandomGenerator>
+#include <QtLogging>
+
+#include <Bach/Benchmark/Benchmark.h>
+#include <LabelSearchIndex.h>
+
+#include <algorithm>
+#include <set>
+
+using Bach::LabelSearchIndex;
+
+/*!
+ * \brief
+ * Number of distinct names in the index. Roughly the number of street
+ * and place names of a large city, like Oslo or Berlin.
+ */
+static constexpr int nameCount = 60000;
+
+/*!
+ * \brief
+ * The names are spread over a square of tiles this many tiles wide, at tileZoom.
+ */
+static constexpr int tileGridSize = 32;
+static constexpr int tileZoom = 14;
+
+/*!
+ * \brief
+ * Number of queries of each kind, and how many times every query is run.
+ */
+static constexpr int queryCount = 200;
+static constexpr int iterations = 5;
+
+/*!
+ * \brief
+ * Written to after each lookup, so the compiler can't remove the calls we are measuring.
+ */
+static volatile int resultSink = 0;
+
+static const QStringList syllables = {
+    "ber", "by", "dal", "eng", "fjell", "gran", "hau", "holm", "kirke", "kol",
+    "lien", "lund", "mar", "mo", "nor", "ny", "ru", "sand", "sko", "sol",
+    "stor", "sve", "tor", "ulle", "vest", "vik", "øster", "ås", "bjør", "hag" };
+static const QStringList suffixes = {
+    "gata", "gate", "veien", "vei", "plass", "stien", "allé", "torget", "parken", "bakken" };
+
+/*!
+ * \brief generateName
+ * Makes up a street or place name from a few syllables and a suffix.
+ */
+static QString generateName(QRandomGenerator &random)
+{
+    QString name;
+    const int syllableCount = random.bounded(2, 5);
+    for (int i = 0; i < syllableCount; i++)
+        name += syllables[random.bounded((int)syllables.size())];
+    name[0] = name[0].toUpper();
+    name += suffixes[random.bounded((int)suffixes.size())];
+    // Some names are two words, like "Nordre Holmgata".
+    if (random.bounded(4) == 0)
+        name = (random.bounded(2) == 0 ? "Nordre " : "Søndre ") + name;
+    return name;
+}
+
+/*!
+ * \brief buildIndex
+ * Fills the index with nameCount distinct names. Each name is found in one to three
+ * neighbouring tiles, like a street that crosses a tile border.
+ *
+ * \return The names that were inserted.
+ */
+static QStringList buildIndex(LabelSearchIndex &index)
+{
+    QRandomGenerator random{ 1 };
+    std::set<QString> keys;
+    QStringList names;
+    while ((int)keys.size() < nameCount) {
+        const QString name = generateName(random);
+        if (keys.insert(LabelSearchIndex::normalizeName(name)).second)
+            names.push_back(name);
+    }
+
+    std::map<TileCoord, Bach::TileLabels> tiles;
+    for (const QString &name : names) {
+        const int x = random.bounded(tileGridSize);
+        const int y = random.bounded(tileGridSize);
+        const int tileSpan = random.bounded(1, 4);
+        for (int i = 0; i < tileSpan; i++) {
+            const TileCoord coord{ tileZoom, std::min(x + i, tileGridSize - 1), y };
+            const QRectF bounds{ (double)random.bounded(4000), (double)random.bounded(4000), 96, 96 };
+            tiles[coord].labels.push_back({ LabelSearchIndex::normalizeName(name), name, "transportation_name", bounds });
+        }
+    }
+    for (auto &[coord, labels] : tiles)
+        index.insertTile(coord, std::move(labels));
+    return names;
+}
+
+/*!
+ * \brief addTypo
+ * Replaces, removes or inserts a single letter somewhere in the text.
+ */
+static QString addTypo(QString text, QRandomGenerator &random)
+{
+    const int position = random.bounded((int)text.size());
+    const QChar letter = QChar('a' + random.bounded(26));
+    switch (random.bounded(3)) {
+    case 0:
+        text[position] = letter;
+        break;
+    case 1:
+        text.remove(position, 1);
+        break;
+    default:
+        text.insert(position, letter);
+        break;
+    }
+    return text;
+}
+
+/*!
+ * \brief The QueryTiming class holds the time spent on one kind of lookup.
+ */
+struct QueryTiming {
+    qint64 count = 0;
+    qint64 totalNs = 0;
+    qint64 maxNs = 0;
+    qint64 results = 0;
+
+    double averageUs() const { return count == 0 ? 0 : totalNs / 1000.0 / count; }
+    double maxUs() const { return maxNs / 1000.0; }
+};
+
+/*!
+ * \brief timeQueries
+ * Runs every query iterations times through lookupFn and measures each call.
+ */
+template<typename LookupFn>
+static QueryTiming timeQueries(const QStringList &queries, LookupFn lookupFn)
+{
+    QueryTiming out;
+    for (int i = 0; i < iterations; i++) {
+        for (const QString &query : queries) {
+            QElapsedTimer timer;
+            timer.start();
+            const QVector<Bach::LabelSearchResult> results = lookupFn(query);
+            const qint64 elapsedNs = timer.nsecsElapsed();
+            out.count++;
+            out.totalNs += elapsedNs;
+            out.maxNs = std::max(out.maxNs, elapsedNs);
+            out.results += results.size();
+        }
+    }
+    resultSink = resultSink + (int)out.results;
+    return out;
+}
+
+/*!
+ * \brief main
+ * Runs the lookups on a city-scale index and prints the results as JSON.
+ * See Bach::Benchmark::parseOptions for the command line options.
+ */
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    const Bach::Benchmark::Options options = Bach::Benchmark::parseOptions(app.arguments());
+
+    LabelSearchIndex index;
+    const QStringList names = buildIndex(index);
+    qDebug() << "Number of names: " << index.nameCount();
+    qDebug() << "Number of tiles: " << index.tileCount();
+
+    // Queries are the first letters of existing names, as if the user is still typing.
+    // The fuzzy queries have a typing error in them.
+    QRandomGenerator random{ 2 };
+    QStringList prefixQueries;
+    QStringList typoQueries;
+    for (int i = 0; i < queryCount; i++) {
+        const QString &name = names[random.bounded((int)names.size())];
+        const QString prefix = name.left(random.bounded(4, 11));
+        prefixQueries.push_back(prefix);
+        typoQueries.push_back(addTypo(prefix, random));
+    }
+
+    Bach::Benchmark::Report report;
+    report.benchmark = "label_search_benchmark";
+    report.profile = options.profile;
+
+    struct LookupCase {
+        QString name;
+        const QStringList *queries;
+        int maxEdits;
+    };
+    const QVector<LookupCase> cases = {
+        { "findPrefix", &prefixQueries, 0 },
+        { "findFuzzy-1", &typoQueries, 1 },
+        { "findFuzzy-2", &typoQueries, 2 },
+        { "findFuzzy-3", &typoQueries, 3 },
+    };
+    const int maxResults = 10;
+
+    QJsonArray casesJson;
+    for (int run = 0; run < options.repeats; run++) {
+        Bach::Benchmark::resetAllocationCounts();
+        // Only the details of the last run are kept.
+        casesJson = {};
+        for (const LookupCase &lookupCase : cases) {
+            const QueryTiming timing = timeQueries(*lookupCase.queries, [&](const QString &query) {
+                return lookupCase.maxEdits == 0
+                    ? index.findPrefix(query, maxResults)
+                    : index.findFuzzy(query, lookupCase.maxEdits, maxResults);
+            });
+            report.addSample(lookupCase.name + "/us-per-query", timing.averageUs(), "us");
+
+            QJsonObject caseJson;
+            caseJson["name"] = lookupCase.name;
+            caseJson["queries"] = timing.count;
+            caseJson["average-us"] = timing.averageUs();
+            caseJson["max-us"] = timing.maxUs();
+            caseJson["results-per-query"] = timing.count == 0 ? 0 : (double)timing.results / timing.count;
+            casesJson.append(caseJson);
+            qDebug() << "Finished" << lookupCase.name;
+        }
+
+        Bach::Benchmark::addAllocationSamples(report);
+    }
+
+    QJsonObject detailsJson;
+    detailsJson["names"] = (qint64)index.nameCount();
+    detailsJson["tiles"] = (qint64)index.tileCount();
+    detailsJson["iterations"] = iterations;
+    detailsJson["cases"] = casesJson;
+    report.details = detailsJson;
+
+    return Bach::Benchmark::finish(options, report);
+}
@@ -0,0 +1,328 @@
+#include <QDir>
+#include <QEventLoop>
+#include <QFile>
+#include <QGuiApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPainter>
+#include <QRegularExpression>
+#include <QTemporaryDir>
+#include <QtLogging>
+
+#include <Bach/Benchmark/Benchmark.h>
+#include <Bach/Merlin/Merlin.h>
+#include <Metrics.h>
+#include <Rendering.h>
+#include <TileLoader.h>
+
+#include <functional>
+#include <memory>
+#include <set>
+
+namespace Merlin = Bach::Merlin;
+using Bach::TileLoader;
+
+// Helper function to let us do early shutdown.
+[[noreturn]] void shutdown(const QString &msg = "")
+{
+    if (msg != "") {
+        qCritical() << msg;
+    }
+    std::exit(EXIT_FAILURE);
+}
+
+/*!
+ * \brief
+ * Size of the offscreen image we render the first frame into, in pixels.
+ */
+static constexpr int imageSize = Merlin::baseImageSize;
+
+/*!
+ * \brief
+ * The viewport of the first frame. Nydalen in Oslo, which is covered
+ * by the z12 tiles in the Merlin input folder.
+ */
+static constexpr double startLon = 10.765248;
+static constexpr double startLat = 59.949584413;
+static constexpr double startVpZoom = 12.3;
+static constexpr int startMapZoom = 12;
+
+/*!
+ * \brief The StartupSource enum describes where the TileLoader reads the tiles from.
+ */
+enum class StartupSource {
+    // From the disk cache, after the files have been read once.
+    // Like starting the application a second time.
+    WarmDisk,
+    // From memory through the loadTileOverride of the TileLoader.
+    // Stands in for a local tile server without any network or file access.
+    LocalStandIn,
+};
+
+static QString startupSourceName(StartupSource source)
+{
+    switch (source) {
+    case StartupSource::WarmDisk:
+        return "warm-disk";
+    case StartupSource::LocalStandIn:
+        return "local-stand-in";
+    }
+    return {};
+}
+
+/*!
+ * \brief loadInputTiles
+ * Reads the bytes of every vector tile in the Merlin input folder.
+ */
+static QMap<TileCoord, QByteArray> loadInputTiles()
+{
+    QMap<TileCoord, QByteArray> out;
+
+    static const QRegularExpression re("z(\\d+)x(\\d+)y(\\d+)\\.mvt");
+
+    QDir dir{ Merlin::buildBaselineInputPath() };
+    for (const QString &fileName : dir.entryList({ "*.mvt" }, QDir::Filter::Files)) {
+        QRegularExpressionMatch match = re.match(fileName);
+        if (!match.hasMatch()) {
+            continue;
+        }
+        TileCoord coord;
+        coord.zoom = match.captured(1).toInt();
+        coord.x = match.captured(2).toInt();
+        coord.y = match.captured(3).toInt();
+
+        QFile file{ dir.filePath(fileName) };
+        if (!file.open(QFile::ReadOnly)) {
+            shutdown(QString("Unable to open file '%1'.").arg(fileName));
+        }
+        out.insert(coord, file.readAll());
+    }
+
+    if (out.isEmpty()) {
+        shutdown("No input tiles found.");
+    }
+    return out;
+}
+
+/*!
+ * \brief calcStartTiles
+ * Finds the tiles visible in the first frame. Only the tiles that exist
+ * in the Merlin input folder are returned, since there is nowhere to load the others from.
+ */
+static std::set<TileCoord> calcStartTiles(const QMap<TileCoord, QByteArray> &inputTiles)
+{
+    const Bach::MapCoordinate start = Bach::lonLatToWorldNormCoordDegrees(startLon, startLat);
+    const QVector<TileCoord> visibleCoords = Bach::calcVisibleTiles(
+        start.x,
+        start.y,
+        1.0,
+        startVpZoom,
+        startMapZoom);
+
+    std::set<TileCoord> out;
+    for (TileCoord coord : visibleCoords) {
+        if (inputTiles.contains(coord)) {
+            out.insert(coord);
+        }
+    }
+    if (out.empty()) {
+        shutdown("None of the visible tiles exist in the input folder.");
+    }
+    return out;
+}
+
+/*!
+ * \brief runStartup
+ * Runs the startup of the map headlessly, from reading the stylesheet until the
+ * first frame with every visible tile has been rendered, and records each phase
+ * through the startup functions in Metrics.h.
+ *
+ * \return The phases of this startup.
+ */
+static QVector<Bach::StartupPhase> runStartup(
+    StartupSource source,
+    const QString &cacheDir,
+    const QMap<TileCoord, QByteArray> &inputTiles,
+    const std::set<TileCoord> &startTiles,
+    const QFont &font,
+    QImage &image)
+{
+    Bach::beginStartup();
+
+    QFile styleSheetFile{ Merlin::getStyleSheetPath() };
+    if (!styleSheetFile.open(QFile::ReadOnly)) {
+        shutdown("Unable to open stylesheet.");
+    }
+    const QJsonDocument styleSheetJson = QJsonDocument::fromJson(styleSheetFile.readAll());
+    Bach::recordStartupPhase("load stylesheet");
+
+    std::optional<StyleSheet> styleSheetResult = StyleSheet::fromJson(styleSheetJson);
+    if (!styleSheetResult.has_value()) {
+        shutdown("Unable to parse stylesheet.");
+    }
+    const StyleSheet &styleSheet = styleSheetResult.value();
+    Bach::recordStartupPhase("parse stylesheet");
+
+    auto grabFileBytesFn = [&](TileCoord coord, TileType type) -> const QByteArray* {
+        if (type == TileType::Raster) {
+            return nullptr;
+        }
+        auto it = inputTiles.find(coord);
+        if (it == inputTiles.end()) {
+            return nullptr;
+        }
+        return &*it;
+    };
+    std::unique_ptr<TileLoader> tileLoaderPtr = TileLoader::newDummy(
+        cacheDir,
+        source == StartupSource::LocalStandIn ? std::function(grabFileBytesFn) : nullptr,
+        false); // Don't load raster tiles.
+    TileLoader &tileLoader = *tileLoaderPtr;
+    Bach::recordStartupPhase("create TileLoader");
+
+    // The TileLoader loads tiles in the background, so we
+    // block on an event-loop until all the tiles have arrived.
+    QEventLoop eventLoop;
+    int tileLoadedCounter = 0;
+    tileLoader.requestTiles(
+        startTiles,
+        [&](TileCoord) {
+            // Called on a TileLoader worker thread, so we
+            // dispatch the counting to the event-loop.
+            QMetaObject::invokeMethod(&eventLoop, [&]() {
+                tileLoadedCounter++;
+                if (tileLoadedCounter >= (int)startTiles.size()) {
+                    eventLoop.exit();
+                }
+            });
+        });
+    eventLoop.exec();
+    Bach::recordStartupPhase("load tiles");
+
+    {
+        QScopedPointer<Bach::RequestTilesResult> result = tileLoader.requestTiles(startTiles, false);
+        if (result->vectorMap().size() < (qsizetype)startTiles.size()) {
+            shutdown("Not all tiles were loaded.");
+        }
+
+        QPainter painter{ &image };
+        painter.setFont(font);
+        Bach::PaintVectorTileSettings paintSettings = Bach::PaintVectorTileSettings::getDefault();
+        paintSettings.forceNoChangeFontType = true;
+        const Bach::MapCoordinate start = Bach::lonLatToWorldNormCoordDegrees(startLon, startLat);
+        Bach::paintVectorTiles(
+            painter,
+            start.x,
+            start.y,
+            startVpZoom,
+            startMapZoom,
+            result->vectorMap(),
+            styleSheet,
+            paintSettings,
+            false);
+    }
+    Bach::recordStartupPhase("first complete frame");
+
+    Bach::finishStartup();
+    return Bach::getStartupPhases();
+}
+
+int main(int argc, char *argv[])
+{
+    // A QGuiApplication is required to do QPainter commands.
+    QGuiApplication app(argc, argv);
+    const Bach::Benchmark::Options options = Bach::Benchmark::parseOptions(app.arguments());
+
+    std::optional<QFont> fontResult = Merlin::loadFont();
+    if (!fontResult.has_value()) {
+        shutdown("Unable to load font.");
+    }
+    const QFont &font = fontResult.value();
+
+    const QMap<TileCoord, QByteArray> inputTiles = loadInputTiles();
+    const std::set<TileCoord> startTiles = calcStartTiles(inputTiles);
+
+    // The warm-disk runs read from a disk cache that already holds the tiles.
+    QTemporaryDir warmCacheDir;
+    if (!warmCacheDir.isValid()) {
+        shutdown("Unable to create temporary directory.");
+    }
+    for (const auto &[coord, fileBytes] : inputTiles.asKeyValueRange()) {
+        if (!Bach::writeTileToDiskCache_Vector(warmCacheDir.path(), coord, fileBytes)) {
+            shutdown("Unable to write file");
+        }
+    }
+
+    QImage image{ imageSize, imageSize, QImage::Format_ARGB32_Premultiplied };
+
+    const QVector<StartupSource> sources = { StartupSource::WarmDisk, StartupSource::LocalStandIn };
+
+    // Run every startup once without measuring it, so that the files are in the
+    // page cache and one-time setup like font loading doesn't end up in the results.
+    for (StartupSource source : sources) {
+        QTemporaryDir emptyCacheDir;
+        runStartup(
+            source,
+            source == StartupSource::WarmDisk ? warmCacheDir.path() : emptyCacheDir.path(),
+            inputTiles,
+            startTiles,
+            font,
+            image);
+    }
+
+    Bach::Benchmark::Report report;
+    report.benchmark = "startup_benchmark";
+    report.profile = options.profile;
+
+    QJsonObject sourcesJson;
+    for (int run = 0; run < options.repeats; run++) {
+        Bach::Benchmark::resetAllocationCounts();
+        for (StartupSource source : sources) {
+            // The local stand-in gets a new, empty disk cache every time,
+            // so that no tiles are found on the disk.
+            QTemporaryDir emptyCacheDir;
+            const QVector<Bach::StartupPhase> phases = runStartup(
+                source,
+                source == StartupSource::WarmDisk ? warmCacheDir.path() : emptyCacheDir.path(),
+                inputTiles,
+                startTiles,
+                font,
+                image);
+
+            const QString sourceName = startupSourceName(source);
+            // Only the details of the last run are kept.
+            QJsonArray phasesJson;
+            for (const Bach::StartupPhase &phase : phases) {
+                report.addSample(sourceName + "/" + phase.name, phase.durationMs(), "ms");
+                QJsonObject phaseJson;
+                phaseJson["name"] = phase.name;
+                phaseJson["start-ms"] = phase.startNs / 1000000.0;
+                phaseJson["end-ms"] = phase.endNs / 1000000.0;
+                phasesJson.append(phaseJson);
+            }
+            report.addSample(
+                sourceName + "/time-to-first-frame",
+                phases.last().endNs / 1000000.0,
+                "ms");
+            sourcesJson[sourceName] = phasesJson;
+
+            qDebug() << "Finished startup from" << sourceName;
+        }
+        Bach::Benchmark::addAllocationSamples(report);
+    }
+
+    QJsonArray tilesJson;
+    for (TileCoord coord : startTiles) {
+        tilesJson.append(coord.toString());
+    }
+
+    QJsonObject detailsJson;
+    detailsJson["image-width"] = imageSize;
+    detailsJson["image-height"] = imageSize;
+    detailsJson["tiles"] = tilesJson;
+    detailsJson["sources"] = sourcesJson;
+    report.details = detailsJson;
+
+    return Bach::Benchmark::finish(options, report);
+}
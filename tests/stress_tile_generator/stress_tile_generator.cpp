@@ -0,0 +1,294 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QRandomGenerator>
+#include <QtLogging>
+#include <QtMath>
+
+#include <VectorTileWriter.h>
+#include <VectorTiles.h>
+
+#include <algorithm>
+#include <cmath>
+
+/*
+ * Writes synthetic vector tiles for scale testing.
+ *
+ * The tiles use the layer names and attributes of the OpenMapTiles schema, so they
+ * can be rendered with the same stylesheets as real tiles. The content is random,
+ * but the same seed and options always give the same tiles.
+ *
+ * The files are named z{zoom}x{x}y{y}.mvt, like the benchmark resources, so the
+ * output folder can be passed to the benchmarks with --tile-dir.
+ */
+
+// Helper function to let us do early shutdown.
+[[noreturn]] void shutdown(const QString &msg = "")
+{
+    if (msg != "") {
+        qCritical() << msg;
+    }
+    std::exit(EXIT_FAILURE);
+}
+
+/*!
+ * \brief The GeneratorSettings class holds how big the generated tiles should be.
+ */
+struct GeneratorSettings {
+    int layers = 10;
+    int featuresPerLayer = 400;
+    int verticesPerFeature = 12;
+    int attributesPerFeature = 4;
+    // Fraction of the features in label layers that get a name.
+    double labelDensity = 0.3;
+    int extent = 4096;
+};
+
+/*!
+ * \brief presets are named starting points for the settings.
+ * Every value can still be overridden on the command line.
+ */
+static const QMap<QString, GeneratorSettings> presets = {
+    // Roughly the size of a dense z14 city tile.
+    { "realistic", { 10, 400, 12, 4, 0.3, 4096 } },
+    // Far denser than any real tile, to find where things break down.
+    { "worst-case", { 10, 4000, 64, 16, 1.0, 4096 } },
+};
+
+enum class LayerKind {
+    Polygon,
+    Line,
+    Point,
+};
+
+/*!
+ * \brief The LayerTemplate class describes one of the layers we can generate.
+ */
+struct LayerTemplate {
+    QString name;
+    LayerKind kind;
+    // Whether features in this layer can have a name, and so get labels.
+    bool isLabelLayer;
+    QStringList classes;
+};
+
+static const QList<LayerTemplate> layerTemplates = {
+    { "water", LayerKind::Polygon, false, { "lake", "river", "ocean" } },
+    { "landcover", LayerKind::Polygon, false, { "grass", "wood", "farmland" } },
+    { "landuse", LayerKind::Polygon, false, { "residential", "commercial", "industrial" } },
+    { "building", LayerKind::Polygon, false, { "building" } },
+    { "transportation", LayerKind::Line, false, { "motorway", "primary", "secondary", "minor", "path" } },
+    { "boundary", LayerKind::Line, false, { "country", "state" } },
+    { "transportation_name", LayerKind::Line, true, { "primary", "secondary", "minor" } },
+    { "place", LayerKind::Point, true, { "city", "town", "village", "suburb" } },
+    { "poi", LayerKind::Point, true, { "shop", "restaurant", "school", "park" } },
+    { "water_name", LayerKind::Point, true, { "lake", "bay" } },
+};
+
+/*!
+ * \brief The TileGenerator class generates the content of tiles from a seeded random generator.
+ */
+class TileGenerator {
+public:
+    TileGenerator(const GeneratorSettings &settings, quint32 seed) :
+        settings{ settings },
+        random{ seed } {}
+
+    QByteArray generateTile()
+    {
+        Bach::VectorTileWriter writer;
+        for (int layerIndex = 0; layerIndex < settings.layers; layerIndex++) {
+            const LayerTemplate &layerTemplate = layerTemplates[layerIndex % layerTemplates.size()];
+            // Make the names unique when there are more layers than templates.
+            QString layerName = layerTemplate.name;
+            if (layerIndex >= layerTemplates.size()) {
+                layerName += QString("_%1").arg(layerIndex / layerTemplates.size());
+            }
+            writer.beginLayer(layerName, settings.extent);
+
+            for (int i = 0; i < settings.featuresPerLayer; i++) {
+                const QMap<QString, QVariant> attributes = generateAttributes(layerTemplate);
+                switch (layerTemplate.kind) {
+                case LayerKind::Polygon:
+                    writer.addPolygon({ generateRing() }, attributes);
+                    break;
+                case LayerKind::Line:
+                    writer.addLines({ generateLine() }, attributes);
+                    break;
+                case LayerKind::Point:
+                    writer.addPoints({ generatePoint() }, attributes);
+                    break;
+                }
+            }
+        }
+        return writer.toByteArray();
+    }
+
+private:
+    GeneratorSettings settings;
+    QRandomGenerator random;
+
+    QPoint generatePoint()
+    {
+        return QPoint(random.bounded(settings.extent), random.bounded(settings.extent));
+    }
+
+    /*!
+     * \brief generateRing
+     * Generates a simple polygon by walking around a random center with a random radius.
+     * The angle increases for every point, which makes the ring clockwise in tile
+     * coordinates, as the format expects for exterior rings.
+     */
+    QPolygon generateRing()
+    {
+        const int vertexCount = std::max(3, settings.verticesPerFeature);
+        const QPoint center = generatePoint();
+        const double maxRadius = settings.extent / 16.0;
+
+        QPolygon out;
+        for (int i = 0; i < vertexCount; i++) {
+            const double angle = 2 * M_PI * i / vertexCount;
+            const double radius = maxRadius * (0.5 + 0.5 * random.generateDouble());
+            out.append(QPoint(
+                center.x() + (int)(radius * std::cos(angle)),
+                center.y() + (int)(radius * std::sin(angle))));
+        }
+        return out;
+    }
+
+    /*!
+     * \brief generateLine
+     * Generates a random walk that keeps mostly the same direction, like a road.
+     */
+    QPolygon generateLine()
+    {
+        const int vertexCount = std::max(2, settings.verticesPerFeature);
+        const double stepLength = settings.extent / 32.0;
+        double direction = 2 * M_PI * random.generateDouble();
+
+        QPolygon out;
+        QPointF position = generatePoint();
+        for (int i = 0; i < vertexCount; i++) {
+            out.append(position.toPoint());
+            direction += (random.generateDouble() - 0.5) * 0.8;
+            position += QPointF(std::cos(direction), std::sin(direction)) * stepLength;
+        }
+        return out;
+    }
+
+    QMap<QString, QVariant> generateAttributes(const LayerTemplate &layerTemplate)
+    {
+        QMap<QString, QVariant> out;
+        if (settings.attributesPerFeature <= 0) {
+            return out;
+        }
+
+        out.insert("class", layerTemplate.classes[random.bounded(layerTemplate.classes.size())]);
+        if (layerTemplate.isLabelLayer && random.generateDouble() < settings.labelDensity) {
+            const QString name = QString("Name %1").arg(random.bounded(100000));
+            out.insert("name", name);
+            out.insert("name:latin", name);
+            out.insert("rank", random.bounded(1, 20));
+        }
+        // Fill up with extra attributes until we reach the requested count.
+        for (int i = 0; out.size() < settings.attributesPerFeature; i++) {
+            out.insert(QString("attribute_%1").arg(i), random.bounded(1000));
+        }
+        return out;
+    }
+};
+
+/*!
+ * \brief parseNonNegativeInt
+ * \return The value of the option, or defaultValue if the option wasn't given and has no default.
+ */
+static int parseNonNegativeInt(const QCommandLineParser &parser, const QString &option, int defaultValue)
+{
+    if (parser.value(option).isEmpty()) {
+        return defaultValue;
+    }
+    bool valid = false;
+    const int value = parser.value(option).toInt(&valid);
+    if (!valid || value < 0) {
+        shutdown(QString("--%1 must be a non-negative number.").arg(option));
+    }
+    return value;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Writes synthetic vector tiles for scale testing.");
+    parser.addHelpOption();
+    parser.addOptions({
+        { "output", "Folder to write the tiles to.", "path", "stress-tiles" },
+        { "preset", "Starting point for the settings: realistic or worst-case.", "name", "realistic" },
+        { "tiles", "Number of tiles to write.", "count", "16" },
+        { "zoom", "Zoom level of the tiles.", "zoom", "14" },
+        { "x", "X coordinate of the first tile. Defaults to Oslo at zoom 14.", "x", "8682" },
+        { "y", "Y coordinate of the first tile. Defaults to Oslo at zoom 14.", "y", "4762" },
+        { "layers", "Number of layers per tile.", "count" },
+        { "features", "Number of features per layer.", "count" },
+        { "vertices", "Number of vertices per line or polygon.", "count" },
+        { "attributes", "Number of attributes per feature.", "count" },
+        { "label-density", "Fraction of the features in label layers that get a name, from 0 to 1.", "fraction" },
+        { "extent", "Size of the tiles in tile coordinates.", "extent" },
+        { "seed", "Seed for the random generator.", "seed", "1" },
+    });
+    parser.process(app);
+
+    if (!presets.contains(parser.value("preset"))) {
+        shutdown("Unknown preset " + parser.value("preset"));
+    }
+    GeneratorSettings settings = presets[parser.value("preset")];
+    settings.layers = parseNonNegativeInt(parser, "layers", settings.layers);
+    settings.featuresPerLayer = parseNonNegativeInt(parser, "features", settings.featuresPerLayer);
+    settings.verticesPerFeature = parseNonNegativeInt(parser, "vertices", settings.verticesPerFeature);
+    settings.attributesPerFeature = parseNonNegativeInt(parser, "attributes", settings.attributesPerFeature);
+    settings.extent = std::max(1, parseNonNegativeInt(parser, "extent", settings.extent));
+    if (parser.isSet("label-density")) {
+        settings.labelDensity = std::clamp(parser.value("label-density").toDouble(), 0.0, 1.0);
+    }
+
+    const int tileCount = parseNonNegativeInt(parser, "tiles", 0);
+    const int zoom = std::min(parseNonNegativeInt(parser, "zoom", 0), 30);
+    const int firstX = parseNonNegativeInt(parser, "x", 0);
+    const int firstY = parseNonNegativeInt(parser, "y", 0);
+    const quint32 seed = parseNonNegativeInt(parser, "seed", 0);
+
+    const QString outputDir = parser.value("output");
+    if (!QDir().mkpath(outputDir)) {
+        shutdown("Unable to create output folder " + outputDir);
+    }
+
+    // Lay the tiles out in a square, so they can be viewed together.
+    const int tilesPerRow = std::max(1, (int)std::ceil(std::sqrt(tileCount)));
+    const int tilesAtZoom = 1 << zoom;
+
+    TileGenerator generator { settings, seed };
+    qint64 totalBytes = 0;
+    for (int i = 0; i < tileCount; i++) {
+        const int x = (firstX + i % tilesPerRow) % tilesAtZoom;
+        const int y = (firstY + i / tilesPerRow) % tilesAtZoom;
+        const QByteArray bytes = generator.generateTile();
+
+        // Make sure we only ever write tiles that we can read back.
+        if (!Bach::tileFromByteArray(bytes).has_value()) {
+            shutdown("Generated a tile that could not be parsed.");
+        }
+
+        const QString path = QString("%1/z%2x%3y%4.mvt").arg(outputDir).arg(zoom).arg(x).arg(y);
+        QFile file { path };
+        if (!file.open(QFile::WriteOnly)) {
+            shutdown("Unable to write " + path);
+        }
+        file.write(bytes);
+        totalBytes += bytes.size();
+    }
+
+    qInfo() << "Wrote" << tileCount << "tiles," << totalBytes / 1024 << "KiB, to" << outputDir;
+    return 0;
+}
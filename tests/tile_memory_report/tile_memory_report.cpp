@@ -0,0 +1,157 @@
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+
+#include <VectorTiles.h>
+
+#include <algorithm>
+#include <vector>
+
+/*
+ * Prints how much memory the decoded vector tiles use, split by layer and category.
+ *
+ * Usage: tile_memory_report [--json] [file or directory...]
+ *
+ * Directories are searched recursively for .mvt and .pbf files.
+ * Without any paths, the tiles of the tile parsing benchmark are used.
+ */
+
+// Helper function to let us do early shutdown.
+[[noreturn]] void shutdown(const QString &msg = "")
+{
+    if (msg != "") {
+        qCritical() << msg;
+    }
+    std::exit(EXIT_FAILURE);
+}
+
+static QStringList findTileFiles(const QStringList &paths)
+{
+    QStringList out;
+    for (const QString &path : paths) {
+        QFileInfo info { path };
+        if (info.isDir()) {
+            QDirIterator it { path, { "*.mvt", "*.pbf" }, QDir::Files, QDirIterator::Subdirectories };
+            while (it.hasNext())
+                out.append(it.next());
+        } else if (info.isFile()) {
+            out.append(path);
+        } else {
+            shutdown(QString("No such file or directory: %1").arg(path));
+        }
+    }
+    out.sort();
+    return out;
+}
+
+static QJsonObject toJson(const Bach::MemoryUsage &usage)
+{
+    QJsonObject out;
+    out["featureCount"] = usage.featureCount;
+    out["objectBytes"] = usage.objectBytes;
+    out["geometryBytes"] = usage.geometryBytes;
+    out["metaDataBytes"] = usage.metaDataBytes;
+    out["tagBytes"] = usage.tagBytes;
+    out["indexBytes"] = usage.indexBytes;
+    out["totalBytes"] = usage.totalBytes();
+    return out;
+}
+
+static QString formatKiB(qint64 bytes)
+{
+    return QString::number(bytes / 1024.0, 'f', 1);
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QStringList arguments = app.arguments().mid(1);
+    const bool outputJson = arguments.removeAll("--json") > 0;
+    if (arguments.isEmpty())
+        arguments.append(BACH_TILE_MEMORY_REPORT_DEFAULT_DIR);
+
+    const QStringList tilePaths = findTileFiles(arguments);
+    if (tilePaths.isEmpty())
+        shutdown("Found no tile files.");
+
+    Bach::VectorTileMemoryUsage usage;
+    qint64 encodedBytes = 0;
+    for (const QString &path : tilePaths) {
+        QFile file { path };
+        if (!file.open(QFile::ReadOnly))
+            shutdown(QString("Unable to open file: %1").arg(path));
+        const QByteArray bytes = file.readAll();
+        std::optional<VectorTile> tile = Bach::tileFromByteArray(bytes);
+        if (!tile.has_value())
+            shutdown(QString("Unable to parse tile: %1").arg(path));
+        encodedBytes += bytes.size();
+        usage += Bach::calcMemoryUsage(*tile);
+    }
+
+    // Sort layers by how much memory they use, largest first.
+    std::vector<std::pair<QString, Bach::MemoryUsage>> layers { usage.layers.begin(), usage.layers.end() };
+    std::stable_sort(layers.begin(), layers.end(), [](const auto &a, const auto &b) {
+        return a.second.totalBytes() > b.second.totalBytes();
+    });
+
+    const Bach::MemoryUsage total = usage.total();
+    QTextStream out { stdout };
+
+    if (outputJson) {
+        QJsonArray layersJson;
+        for (const auto &[layerName, layerUsage] : layers) {
+            QJsonObject layerJson = toJson(layerUsage);
+            layerJson["name"] = layerName;
+            layersJson.append(layerJson);
+        }
+        QJsonObject root;
+        root["tileCount"] = usage.tileCount;
+        root["encodedBytes"] = encodedBytes;
+        root["total"] = toJson(total);
+        root["layers"] = layersJson;
+        out << QJsonDocument(root).toJson();
+        return 0;
+    }
+
+    out << "Tiles: " << usage.tileCount << "\n";
+    out << "Encoded size: " << formatKiB(encodedBytes) << " KiB\n";
+    out << "Decoded size: " << formatKiB(total.totalBytes()) << " KiB\n\n";
+
+    auto printRow = [&](const QString &name, const Bach::MemoryUsage &row) {
+        const double share = total.totalBytes() == 0 ? 0 : 100.0 * row.totalBytes() / total.totalBytes();
+        out << qSetFieldWidth(24) << Qt::left << name
+            << qSetFieldWidth(10) << Qt::right << row.featureCount
+            << qSetFieldWidth(12) << formatKiB(row.objectBytes)
+            << qSetFieldWidth(12) << formatKiB(row.geometryBytes)
+            << qSetFieldWidth(12) << formatKiB(row.metaDataBytes)
+            << qSetFieldWidth(12) << formatKiB(row.tagBytes)
+            << qSetFieldWidth(12) << formatKiB(row.indexBytes)
+            << qSetFieldWidth(12) << formatKiB(row.totalBytes())
+            << qSetFieldWidth(8) << QString::number(share, 'f', 1)
+            << qSetFieldWidth(0) << "\n";
+    };
+
+    out << qSetFieldWidth(24) << Qt::left << "Layer"
+        << qSetFieldWidth(10) << Qt::right << "Features"
+        << qSetFieldWidth(12) << "Objects"
+        << qSetFieldWidth(12) << "Geometry"
+        << qSetFieldWidth(12) << "Metadata"
+        << qSetFieldWidth(12) << "Tags"
+        << qSetFieldWidth(12) << "Index"
+        << qSetFieldWidth(12) << "Total KiB"
+        << qSetFieldWidth(8) << "%"
+        << qSetFieldWidth(0) << "\n";
+    for (const auto &[layerName, layerUsage] : layers)
+        printRow(layerName, layerUsage);
+    printRow("(all layers)", total);
+
+    return 0;
+}
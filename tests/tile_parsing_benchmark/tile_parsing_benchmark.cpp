@@ -1,8 +1,12 @@
+#include <QCoreApplication>
+#include <QDir>
 #include <QtLogging>
 #include <QDebug>
 
 #include <VectorTiles.h>
 
+#include <Bach/Benchmark/Benchmark.h>
+
 #include <chrono>
 #include <vector>
 
@@ -15,23 +19,37 @@
     std::exit(EXIT_FAILURE);
 }
 
-static std::vector<QByteArray> loadTestFilesIntoMemory() {
-    std::vector<QByteArray> out;
-    for (int x = 0; x < 4; x++) {
-        for (int y = 0; y < 4; y++) {
-            QString path = QString(":z2x%1y%2.mvt").arg(x).arg(y);
-            QFile file{ path };
-            bool fileOpenSuccess = file.open(QFile::ReadOnly);
-            if (!fileOpenSuccess) {
-                shutdown("Unable to open file");
+static std::vector<QByteArray> loadTestFilesIntoMemory(const QString &tileDir) {
+    QStringList paths;
+    if (tileDir.isEmpty()) {
+        for (int x = 0; x < 4; x++) {
+            for (int y = 0; y < 4; y++) {
+                paths.append(QString(":z2x%1y%2.mvt").arg(x).arg(y));
             }
+        }
+    } else {
+        QDir dir{ tileDir };
+        for (const QString &fileName : dir.entryList({ "*.mvt" }, QDir::Filter::Files)) {
+            paths.append(dir.filePath(fileName));
+        }
+        if (paths.isEmpty()) {
+            shutdown("No tiles found in " + tileDir);
+        }
+    }
 
-            QByteArray bytes = file.readAll();
-            if (bytes.isEmpty()) {
-                shutdown("Expected all files to not be empty.");
-            }
-            out.push_back(bytes);
+    std::vector<QByteArray> out;
+    for (const QString &path : paths) {
+        QFile file{ path };
+        bool fileOpenSuccess = file.open(QFile::ReadOnly);
+        if (!fileOpenSuccess) {
+            shutdown("Unable to open file");
         }
+
+        QByteArray bytes = file.readAll();
+        if (bytes.isEmpty()) {
+            shutdown("Expected all files to not be empty.");
+        }
+        out.push_back(bytes);
     }
     return out;
 }
@@ -42,37 +60,52 @@ static std::vector<QByteArray> loadTestFilesIntoMemory() {
  */
 static constexpr int iterations = 5;
 
-int main() {
-    std::vector<QByteArray> testFiles = loadTestFilesIntoMemory();
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    const Bach::Benchmark::Options options = Bach::Benchmark::parseOptions(app.arguments());
+
+    std::vector<QByteArray> testFiles = loadTestFilesIntoMemory(options.tileDir);
 
     // Basic info about the test.
     qDebug() << "Parsing number of files: " << testFiles.size();
     qDebug() << "Number of test iterations: " << iterations;
 
-    auto timeStart = std::chrono::high_resolution_clock::now();
-
-    // Iterate over the entire N times.
-    for (int i = 0; i < iterations; i++) {
-        // Iterate over every file we have preloaded into memory.
-        for (const QByteArray& bytes : testFiles) {
-            std::optional<VectorTile> newTileOpt = VectorTile::fromByteArray(bytes);
-            if (!newTileOpt.has_value()) {
-                shutdown("Benchmark expects all files to be parsed successfully.");
+    Bach::Benchmark::Report report;
+    report.benchmark = "tile_parsing_benchmark";
+    report.profile = options.profile;
+
+    for (int run = 0; run < options.repeats; run++) {
+        Bach::Benchmark::resetAllocationCounts();
+        auto timeStart = std::chrono::high_resolution_clock::now();
+
+        // Iterate over the entire N times.
+        for (int i = 0; i < iterations; i++) {
+            // Iterate over every file we have preloaded into memory.
+            for (const QByteArray& bytes : testFiles) {
+                std::optional<VectorTile> newTileOpt = VectorTile::fromByteArray(bytes);
+                if (!newTileOpt.has_value()) {
+                    shutdown("Benchmark expects all files to be parsed successfully.");
+                }
             }
         }
-    }
 
-    auto timeEnd = std::chrono::high_resolution_clock::now();
+        auto timeEnd = std::chrono::high_resolution_clock::now();
+
+        // Calculate the total time it took to load.
+        double totalTimeMilli = std::chrono::duration<double, std::milli>(timeEnd - timeStart).count();
 
+        qDebug() << "Total time: " << totalTimeMilli << " millisec";
 
-    // Calculate the total time it took to load.
-    double totalTimeMilli = std::chrono::duration<double, std::milli>(timeEnd - timeStart).count();
+        // Total amount of tiles we parsed.
+        int tilesParsedTotal = testFiles.size() * iterations;
 
+        qDebug() << "Average time per file: " << (totalTimeMilli / tilesParsedTotal) << " millisec";
 
-    qDebug() << "Total time: " << totalTimeMilli << " millisec";
+        report.addSample("parse/ms-per-tile", totalTimeMilli / tilesParsedTotal, "ms");
+        report.addSample("parse/tiles-per-second", tilesParsedTotal / (totalTimeMilli / 1000.0), "tiles/s", true);
 
-    // Total amount of tiles we parsed.ns
-    int tilesParsedTotal = testFiles.size() * iterations;
+        Bach::Benchmark::addAllocationSamples(report);
+    }
 
-    qDebug() << "Average time per file: " << (totalTimeMilli / tilesParsedTotal) << " millisec";
+    return Bach::Benchmark::finish(options, report);
 }
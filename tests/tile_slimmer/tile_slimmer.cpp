@@ -0,0 +1,142 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QtLogging>
+
+#include <TileSlimming.h>
+#include <VectorTiles.h>
+
+#include <algorithm>
+
+/*
+ * Writes a copy of a folder of vector tiles, slimmed down to the layers and
+ * attributes a stylesheet uses. The output can be used as a tile archive, or
+ * copied into the tile cache.
+ *
+ * Usage: tile_slimmer [--stylesheet path] [--input path] [--output path]
+ *
+ * The input folder is searched recursively for .mvt and .pbf files, and the files
+ * keep their path relative to it. Prints the size and parsing time before and after.
+ */
+
+// Helper function to let us do early shutdown.
+[[noreturn]] void shutdown(const QString &msg = "")
+{
+    if (msg != "") {
+        qCritical() << msg;
+    }
+    std::exit(EXIT_FAILURE);
+}
+
+static QByteArray readFile(const QString &path)
+{
+    QFile file { path };
+    if (!file.open(QFile::ReadOnly)) {
+        shutdown("Unable to read " + path);
+    }
+    return file.readAll();
+}
+
+// Parses the tile the given number of times, and returns the total time in nanoseconds.
+static qint64 measureParsing(const QByteArray &bytes, int iterations)
+{
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < iterations; i++) {
+        if (!Bach::tileFromByteArray(bytes).has_value()) {
+            shutdown("Unable to parse a tile.");
+        }
+    }
+    return timer.nsecsElapsed();
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Slims vector tiles down to what a stylesheet uses.");
+    parser.addHelpOption();
+    parser.addOptions({
+        { "stylesheet", "The stylesheet the tiles are rendered with.", "path", BACH_TILE_SLIMMER_DEFAULT_STYLESHEET },
+        { "input", "Folder to read the tiles from.", "path", BACH_TILE_SLIMMER_DEFAULT_TILE_DIR },
+        { "output", "Folder to write the slimmed tiles to.", "path", "slim-tiles" },
+        { "iterations", "Number of times each tile is parsed when measuring.", "count", "10" },
+    });
+    parser.process(app);
+
+    QJsonParseError parseError;
+    const QJsonDocument styleSheetJson = QJsonDocument::fromJson(readFile(parser.value("stylesheet")), &parseError);
+    if (parseError.error != QJsonParseError::NoError) {
+        shutdown("Unable to parse the stylesheet: " + parseError.errorString());
+    }
+    const Bach::TileContentUsage usage = Bach::TileContentUsage::fromStyleSheetJson(styleSheetJson);
+    const int iterations = std::max(1, parser.value("iterations").toInt());
+
+    const QDir inputDir { parser.value("input") };
+    const QDir outputDir { parser.value("output") };
+    if (!inputDir.exists()) {
+        shutdown("No such directory: " + inputDir.path());
+    }
+
+    int tileCount = 0;
+    qint64 bytesBefore = 0;
+    qint64 bytesAfter = 0;
+    qint64 parseNsBefore = 0;
+    qint64 parseNsAfter = 0;
+    Bach::SlimTileStats totalStats;
+    QDirIterator it { inputDir.path(), { "*.mvt", "*.pbf" }, QDir::Files, QDirIterator::Subdirectories };
+    while (it.hasNext()) {
+        const QString inputPath = it.next();
+        const QByteArray bytes = readFile(inputPath);
+
+        Bach::SlimTileStats stats;
+        const std::optional<QByteArray> slimBytes = Bach::slimVectorTile(bytes, usage, &stats);
+        if (!slimBytes.has_value()) {
+            qWarning() << "Skipping" << inputPath << "since it could not be parsed.";
+            continue;
+        }
+
+        const QString outputPath = outputDir.filePath(inputDir.relativeFilePath(inputPath));
+        if (!QDir().mkpath(QFileInfo(outputPath).absolutePath())) {
+            shutdown("Unable to create the folder of " + outputPath);
+        }
+        QFile outputFile { outputPath };
+        if (!outputFile.open(QFile::WriteOnly)) {
+            shutdown("Unable to write " + outputPath);
+        }
+        outputFile.write(slimBytes.value());
+
+        tileCount++;
+        bytesBefore += bytes.size();
+        bytesAfter += slimBytes->size();
+        parseNsBefore += measureParsing(bytes, iterations);
+        parseNsAfter += measureParsing(slimBytes.value(), iterations);
+        totalStats.layersRemoved += stats.layersRemoved;
+        totalStats.keysRemoved += stats.keysRemoved;
+        totalStats.valuesRemoved += stats.valuesRemoved;
+    }
+
+    if (tileCount == 0) {
+        shutdown("Found no tiles in " + inputDir.path());
+    }
+
+    qInfo().noquote() << QString("Slimmed %1 tiles into %2").arg(tileCount).arg(outputDir.path());
+    qInfo().noquote() << QString("Removed %1 layers, %2 keys and %3 values")
+        .arg(totalStats.layersRemoved)
+        .arg(totalStats.keysRemoved)
+        .arg(totalStats.valuesRemoved);
+    qInfo().noquote() << QString("Size: %1 KiB -> %2 KiB (%3%)")
+        .arg(bytesBefore / 1024.0, 0, 'f', 1)
+        .arg(bytesAfter / 1024.0, 0, 'f', 1)
+        .arg(100.0 * bytesAfter / std::max(bytesBefore, (qint64)1), 0, 'f', 1);
+    qInfo().noquote() << QString("Parsing per tile: %1 ms -> %2 ms")
+        .arg(parseNsBefore / 1e6 / tileCount / iterations, 0, 'f', 3)
+        .arg(parseNsAfter / 1e6 / tileCount / iterations, 0, 'f', 3);
+    return 0;
+}
@@ -1,11 +1,21 @@
 #include <QCoreApplication>
 #include <QDir>
+#include <QDirIterator>
+#include <QJsonArray>
+#include <QJsonObject>
 
 #include <TileLoader.h>
 
+#include <Bach/Benchmark/Benchmark.h>
+
 #include <chrono>
 #include <iostream>
 
+#if defined(Q_OS_LINUX)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 
 /*!
  * \brief iterations
@@ -13,7 +23,11 @@
  */
 constexpr int iterations = 5;
 
-constexpr bool loadFromMemory = false;
+/*!
+ * \brief tilesPerMix
+ * Number of tiles in each of the small and large tile mixes.
+ */
+constexpr int tilesPerMix = 16;
 
 namespace Bach::TestUtils {
     /*!
@@ -65,11 +79,17 @@ using Bach::TileLoader;
     std::exit(EXIT_FAILURE);
 }
 
+/*!
+ * \brief tileSourceDir
+ * Folder the tiles are read from. The built-in resources unless --tile-dir is given.
+ */
+static QString tileSourceDir = ":";
+
 static QMap<TileCoord, QString> loadTilePaths() {
     QMap<TileCoord, QString> out;
 
-    QDir dir{":"};
-    QList<QString> fileList = dir.entryList(QDir::Filter::Files);
+    QDir dir{ tileSourceDir };
+    QList<QString> fileList = dir.entryList({ "*.mvt" }, QDir::Filter::Files);
     if (fileList.isEmpty()) {
         shutdown("No files found");
     }
@@ -88,7 +108,7 @@ static QMap<TileCoord, QString> loadTilePaths() {
         coord.x = match.captured(2).toInt();
         coord.y = match.captured(3).toInt();
 
-        out.insert(coord, ":" + filePath);
+        out.insert(coord, dir.filePath(filePath));
     }
 
     return out;
@@ -146,29 +166,6 @@ static QMap<TileCoord, QByteArray> loadTileFiles()
     return out;
 }
 
-static QMap<TileCoord, QByteArray> loadTileFiles_Dummy()
-{
-    QMap<TileCoord, QByteArray> out;
-
-    QMap<TileCoord, QString> filePaths = loadTilePaths();
-    for (const auto &[coord, path] : filePaths.asKeyValueRange()) {
-        QFile file{ path };
-        if (!file.open(QFile::ReadOnly)) {
-            shutdown("Unable to open vector file");
-        }
-
-        QByteArray fileBytes = file.readAll();
-
-        if (fileBytes.isEmpty()) {
-            shutdown("Vector file was empty");
-        }
-
-        out.insert(coord, fileBytes);
-    }
-
-    return out;
-}
-
 void writeTestFilesToCacheDir(const QString &outPath)
 {
     QMap<TileCoord, QByteArray> tileFiles = loadTileFiles();
@@ -185,115 +182,6 @@ void writeTestFilesToCacheDir(const QString &outPath)
     }
 }
 
-// Write our vector tile files to temp directory.
-static void writeTestFilesToCacheDir_Dummy(
-    const QString &path)
-{
-    // Load the biggest file.
-    QVector<TileCoord> allCoords = loadFullTileCoordList_Sorted();
-
-    QMap<TileCoord, QByteArray> tileFiles = loadTileFiles();
-
-    TileCoord biggestTileCoord = allCoords[0];
-    QByteArray biggestTileFile = tileFiles[biggestTileCoord];
-
-    for (TileCoord coord : allCoords) {
-        bool writeSuccess = Bach::writeTileToDiskCache_Vector(
-            path,
-            coord,
-            biggestTileFile);
-        if (!writeSuccess) {
-            shutdown("Unable to write file");
-        }
-    }
-}
-
-/*!
- * \class
- * \brief The TestItem class is a helper class to
- * define a single test-configuration. It holds values as to what
- * tile-coords we should load and whether we should do so single or
- * multi-threadedly.
- */
-struct TestItem {
-    int threadCount;
-    std::set<TileCoord> tileCoords;
-};
-
-/*!
- * \brief setupTestItems
- * Helper function to set up our list of
- * test items.
- * \return
- */
-static QVector<TestItem> setupTestItems()
-{
-    QVector<TileCoord> coordsSortedBySize = loadFullTileCoordList_Sorted();
-
-    auto grabFirst = [&](int n) {
-        std::set<TileCoord> out;
-        for (TileCoord item : coordsSortedBySize.first(n)) {
-            out.insert(item);
-        }
-        return out;
-    };
-
-    QVector<TestItem> out;
-
-    // Single thread, 1
-    out.push_back({
-        1,
-        grabFirst(1) });
-
-    // Single thread, 4 tiles
-    out.push_back({
-        1,
-        grabFirst(4) });
-
-    // Single thread, 8 tiles
-    out.push_back({
-        1,
-        grabFirst(8) });
-
-    // Single thread, 16 tiles
-    out.push_back({
-        1,
-        grabFirst(16) });
-
-    // Single thread, 32 tiles
-    out.push_back({
-        1,
-        grabFirst(32) });
-
-    // Now duplicate the test cases but make them use 4 threads.
-    int oldItemCount = out.size();
-    for (int i = 0; i < oldItemCount; i++) {
-        TestItem temp = out[i];
-        temp.threadCount = 4;
-        out.push_back(temp);
-    }
-
-    // Now duplicate the test cases but make them use 8 threads.
-    for (int i = 0; i < oldItemCount; i++) {
-        TestItem temp = out[i];
-        temp.threadCount = 8;
-        out.push_back(temp);
-    }
-    if (QThread::idealThreadCount() > 8) {
-        // Now duplicate the test cases but make them use 16 threads.
-        for (int i = 0; i < oldItemCount; i++) {
-            TestItem temp = out[i];
-            temp.threadCount = QThread::idealThreadCount();
-            out.push_back(temp);
-        }
-    }
-
-
-
-    return out;
-}
-
-
 /*!
  * \brief runSingleCase
  * Runs the benchmark for a single test case and returns
@@ -302,7 +190,8 @@ static QVector<TestItem> setupTestItems()
  * \return Time spent in milliseconds.
  */
 static double runSingleCase(
-    const TestItem &testItem,
+    int threadCount,
+    const std::set<TileCoord> &tileCoords,
     const QMap<TileCoord, QByteArray> *fileBytes,
     QString cacheDir)
 {
@@ -328,7 +217,7 @@ static double runSingleCase(
         cacheDir,
         fileBytes == nullptr ? nullptr : std::function(grabFileBytesFn),
         false, // Don't load raster tiles.
-        testItem.threadCount);
+        threadCount);
     TileLoader& tileLoader = *tileLoaderPtr;
 
     // Time critical portion
@@ -344,7 +233,7 @@ static double runSingleCase(
     int tileLoadedCounter = 0;
 
     tileLoader.requestTiles(
-        testItem.tileCoords,
+        tileCoords,
         [&](TileCoord) {
             // This lambda is called on the TileLoader worker thread.
             // We don't have atomic access to the integer counter here.
@@ -355,7 +244,7 @@ static double runSingleCase(
                 tileLoadedCounter++;
                 //static int counter = 0;
                 //std::cout << "tile loaded " << counter++ << std::endl;
-                if (tileLoadedCounter >= testItem.tileCoords.size()) {
+                if (tileLoadedCounter >= tileCoords.size()) {
                     eventLoop.exit();
                 }
             });
@@ -371,95 +260,273 @@ static double runSingleCase(
     return timeDurMilli;
 }
 
-int main(int argc, char *argv[])
+/*!
+ * \brief canDropPageCache
+ * \return Whether this platform lets us evict files from the OS page cache,
+ * which is needed for the cold-cache runs.
+ */
+static bool canDropPageCache()
 {
-    QCoreApplication a(argc, argv);
+#if defined(Q_OS_LINUX)
+    return true;
+#else
+    return false;
+#endif
+}
+
+/*!
+ * \brief dropPageCache
+ * Asks the OS to evict every file in the folder from the page cache,
+ * so that the next read has to go to the disk.
+ */
+static void dropPageCache(const QString &dirPath)
+{
+#if defined(Q_OS_LINUX)
+    QDirIterator it { dirPath, QDir::Files, QDirIterator::Subdirectories };
+    while (it.hasNext()) {
+        const QByteArray path = QFile::encodeName(it.next());
+        int fd = ::open(path.constData(), O_RDONLY);
+        if (fd < 0) {
+            continue;
+        }
+        // Pages that have not been written back to the disk yet can't be evicted.
+        ::fdatasync(fd);
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        ::close(fd);
+    }
+#else
+    Q_UNUSED(dirPath);
+#endif
+}
 
+/*!
+ * \brief The TileSource enum describes where the TileLoader reads the tiles from.
+ */
+enum class TileSource {
+    // From the disk cache, after the files have been read once.
+    DiskWarm,
+    // From the disk cache, with the files evicted from the page cache before every iteration.
+    DiskCold,
+    // From memory through the loadTileOverride of the TileLoader. Measures decoding and
+    // the TileLoader itself without any file access.
+    Memory,
+};
 
-    std::cout << "Iterations per test case: " << iterations << std::endl;
-    if (loadFromMemory) {
-        std::cout << "Loading tiles from memory" << std::endl;
-    } else {
-        std::cout << "Loading tiles from files" << std::endl;
+static QString tileSourceName(TileSource source)
+{
+    switch (source) {
+    case TileSource::DiskWarm:
+        return "disk-warm";
+    case TileSource::DiskCold:
+        return "disk-cold";
+    case TileSource::Memory:
+        return "memory";
     }
+    return {};
+}
 
-    std::cout << std::endl;
+/*!
+ * \class
+ * \brief The TestConfig class describes one curve of the sweep:
+ * a tile source and a set of tiles, which is then loaded with an
+ * increasing number of worker threads.
+ */
+struct TestConfig {
+    TileSource source;
+    QString mixName;
+    std::set<TileCoord> tileCoords;
+};
 
-    QMap<TileCoord, QString> tileFilePaths = loadTilePaths();
-    // Sorted by size of the corresponding file.
-    QVector<TileCoord> tileCoordsSorted = loadFullTileCoordList_Sorted();
-    std::pair<TileCoord, QString> biggestTile = {
-        tileCoordsSorted.first(),
-        tileFilePaths[tileCoordsSorted.first()]
+/*!
+ * \brief setupTestConfigs
+ * Helper function to set up every combination of tile source and tile mix.
+ */
+static QVector<TestConfig> setupTestConfigs()
+{
+    QVector<TileCoord> coordsSortedBySize = loadFullTileCoordList_Sorted();
+
+    auto toSet = [](const QVector<TileCoord> &coords) {
+        return std::set<TileCoord>{ coords.begin(), coords.end() };
+    };
+    const int mixSize = std::min(tilesPerMix, (int)coordsSortedBySize.size());
+    const QVector<std::pair<QString, std::set<TileCoord>>> mixes = {
+        { "large", toSet(coordsSortedBySize.first(mixSize)) },
+        { "small", toSet(coordsSortedBySize.last(mixSize)) },
     };
 
-    QVector<TestItem> testItems = setupTestItems();
+    QVector<TileSource> sources = { TileSource::DiskWarm, TileSource::Memory };
+    if (canDropPageCache()) {
+        sources.insert(1, TileSource::DiskCold);
+    } else {
+        std::cerr << "Skipping cold-cache runs, this platform can't evict files from the page cache." << std::endl;
+    }
 
-    {
-        // Create the temp-dir that we want to store
-        // our files into.
-        Bach::TestUtils::TempDir tempDir;
-        writeTestFilesToCacheDir(tempDir.path());
+    QVector<TestConfig> out;
+    for (TileSource source : sources) {
+        for (const auto &[mixName, coords] : mixes) {
+            out.push_back({ source, mixName, coords });
+        }
+    }
+    return out;
+}
 
-        QMap<TileCoord, QByteArray> memoryFiles = loadTileFiles();
+/*!
+ * \brief setupThreadCounts
+ * \return The worker counts to sweep over. Powers of two from 1, up to and
+ * including the number of hardware threads.
+ */
+static QVector<int> setupThreadCounts()
+{
+    const int maxThreads = std::max(1, QThread::idealThreadCount());
+    QVector<int> out;
+    for (int threads = 1; threads < maxThreads; threads *= 2) {
+        out.push_back(threads);
+    }
+    out.push_back(maxThreads);
+    return out;
+}
 
-        // Iterate over all test-items and run the benchmark on each of them.
-        for (const TestItem &testItem : testItems) {
-            double totalTestItemTime = 0;
+/*!
+ * \brief runTestConfig
+ * Loads the tiles of a config once for every worker count
+ * and returns the average time of each, in milliseconds.
+ */
+static QVector<double> runTestConfig(
+    const TestConfig &config,
+    const QVector<int> &threadCounts,
+    const QMap<TileCoord, QByteArray> &memoryFiles,
+    const QString &cacheDir)
+{
+    const bool fromMemory = config.source == TileSource::Memory;
 
-            // Perform each test case N amount of times and calc the average.
-            for (int iter = 0; iter < iterations; iter++) {
-                double timeMilli = runSingleCase(
-                    testItem,
-                    loadFromMemory ? &memoryFiles : nullptr,
-                    tempDir.path());
-                totalTestItemTime += timeMilli;
-            }
+    QVector<double> out;
+    for (int threadCount : threadCounts) {
+        if (config.source == TileSource::DiskWarm) {
+            // Make sure every file has been read at least once.
+            runSingleCase(threadCount, config.tileCoords, nullptr, cacheDir);
+        }
 
-            // Print out the average time it took for this test case.
-            // We print it out in seconds
-            QString lineOut = QString("%1 thread(s), %2 tiles: avg. %3 millisec")
-                .arg(testItem.threadCount)
-                .arg(testItem.tileCoords.size())
-                .arg(totalTestItemTime / iterations);
-            std::cout << lineOut.toStdString() << std::endl;;
+        double totalTime = 0;
+        // Perform each test case N amount of times and calc the average.
+        for (int iter = 0; iter < iterations; iter++) {
+            if (config.source == TileSource::DiskCold) {
+                dropPageCache(cacheDir);
+            }
+            totalTime += runSingleCase(
+                threadCount,
+                config.tileCoords,
+                fromMemory ? &memoryFiles : nullptr,
+                cacheDir);
         }
+        out.push_back(totalTime / iterations);
     }
+    return out;
+}
 
-    std::cout << std::endl;
-    std::cout << "Same-tile test" << std::endl;
-    {
-        // Create the temp-dir that we want to store
-        // our files into.
-        Bach::TestUtils::TempDir tempDir;
-
-        QMap<TileCoord, QByteArray> memoryFiles = loadTileFiles_Dummy();
-
-        // Write our vector tile files to temp directory.
-        writeTestFilesToCacheDir_Dummy(tempDir.path());
+/*!
+ * \brief buildScalingCurveJson
+ * Turns the average times of a config into a scaling curve.
+ *
+ * The speedup is relative to a single worker thread. The efficiency is the
+ * speedup divided by the number of threads, where 1 means perfect scaling.
+ */
+static QJsonObject buildScalingCurveJson(
+    const TestConfig &config,
+    const QVector<int> &threadCounts,
+    const QVector<double> &averageTimes)
+{
+    QJsonArray pointsJson;
+    for (int i = 0; i < threadCounts.size(); i++) {
+        const double speedup = averageTimes[0] / averageTimes[i];
+        QJsonObject pointJson;
+        pointJson["threads"] = threadCounts[i];
+        pointJson["avg-ms"] = averageTimes[i];
+        pointJson["tiles-per-second"] = config.tileCoords.size() / (averageTimes[i] / 1000.0);
+        pointJson["speedup"] = speedup;
+        pointJson["efficiency"] = speedup / threadCounts[i];
+        pointsJson.append(pointJson);
+    }
 
-        QVector<TestItem> testItems = setupTestItems();
+    QJsonObject out;
+    out["source"] = tileSourceName(config.source);
+    out["mix"] = config.mixName;
+    out["tiles"] = (qint64)config.tileCoords.size();
+    out["points"] = pointsJson;
+    return out;
+}
 
-        // Iterate over all test-items and run the benchmark on each of them.
-        for (const TestItem &testItem : testItems) {
-            double totalTestItemTime = 0;
+/*!
+ * \brief main
+ * Loads every tile mix from every tile source with an increasing number of
+ * worker threads, and prints the scaling curves as JSON.
+ * See Bach::Benchmark::parseOptions for the command line options.
+ */
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    const Bach::Benchmark::Options options = Bach::Benchmark::parseOptions(a.arguments());
+    if (!options.tileDir.isEmpty()) {
+        tileSourceDir = options.tileDir;
+    }
 
-            // Perform each test case N amount of times and calc the average.
-            for (int iter = 0; iter < iterations; iter++) {
-                double timeMilli = runSingleCase(
-                    testItem,
-                    loadFromMemory ? &memoryFiles : nullptr,
-                    tempDir.path());
-                totalTestItemTime += timeMilli;
+    const QVector<TestConfig> testConfigs = setupTestConfigs();
+    const QVector<int> threadCounts = setupThreadCounts();
+
+    // Standard output is reserved for the JSON report, so progress goes to standard error.
+    std::cerr << "Iterations per test case: " << iterations << std::endl;
+    std::cerr << std::endl;
+
+    Bach::Benchmark::Report report;
+    report.benchmark = "tileloader_threaded_benchmark";
+    report.profile = options.profile;
+
+    // Create the temp-dir that we want to store
+    // our files into.
+    Bach::TestUtils::TempDir tempDir;
+    writeTestFilesToCacheDir(tempDir.path());
+
+    const QMap<TileCoord, QByteArray> memoryFiles = loadTileFiles();
+
+    QJsonArray curvesJson;
+    for (int run = 0; run < options.repeats; run++) {
+        Bach::Benchmark::resetAllocationCounts();
+        // Only the curves of the last run are kept.
+        curvesJson = {};
+        for (const TestConfig &config : testConfigs) {
+            const QVector<double> averageTimes = runTestConfig(config, threadCounts, memoryFiles, tempDir.path());
+            const QJsonObject curveJson = buildScalingCurveJson(config, threadCounts, averageTimes);
+            curvesJson.append(curveJson);
+
+            const QString curveName = tileSourceName(config.source) + "/" + config.mixName;
+            std::cerr << curveName.toStdString() << ", " << config.tileCoords.size() << " tiles:" << std::endl;
+            for (const QJsonValue &point : curveJson["points"].toArray()) {
+                QString lineOut = QString("  %1 thread(s): avg. %2 millisec, speedup %3, efficiency %4")
+                    .arg(point["threads"].toInt())
+                    .arg(point["avg-ms"].toDouble(), 0, 'f', 2)
+                    .arg(point["speedup"].toDouble(), 0, 'f', 2)
+                    .arg(point["efficiency"].toDouble(), 0, 'f', 2);
+                std::cerr << lineOut.toStdString() << std::endl;
+
+                report.addSample(
+                    QString("%1/%2-threads").arg(curveName).arg(point["threads"].toInt()),
+                    point["avg-ms"].toDouble(),
+                    "ms");
             }
-
-            // Print out the average time it took for this test case.
-            // We print it out in seconds
-            QString lineOut = QString("%1 thread(s), %2 tiles: avg. %3 millisec")
-                .arg(testItem.threadCount)
-                .arg(testItem.tileCoords.size())
-                .arg(totalTestItemTime / iterations);
-            std::cout << lineOut.toStdString() << std::endl;;
         }
+
+        Bach::Benchmark::addAllocationSamples(report);
     }
+
+    QJsonArray threadCountsJson;
+    for (int threadCount : threadCounts) {
+        threadCountsJson.append(threadCount);
+    }
+
+    QJsonObject detailsJson;
+    detailsJson["iterations"] = iterations;
+    detailsJson["thread-counts"] = threadCountsJson;
+    detailsJson["curves"] = curvesJson;
+    report.details = detailsJson;
+
+    return Bach::Benchmark::finish(options, report);
 }
@@ -1,6 +1,10 @@
 // Qt header files
+#include <QBuffer>
+#include <QImage>
 #include <QJsonDocument>
+#include <QMutex>
 #include <QObject>
+#include <QSemaphore>
 #include <QtEnvironmentVariables>
 #include <QTest>
 #include <QTimer>
@@ -8,6 +12,11 @@
 // Other header files
 #include "TileLoader.h"
 #include "Utilities.h"
+#include "VectorTileWriter.h"
+#include "WarmStart.h"
+
+// STL header files
+#include <atomic>
 
 using TileLoader = Bach::TileLoader;
 
@@ -27,6 +36,11 @@ private slots:
     void loadTileFromCache_fails_on_broken_file();
     void loadTileFromCache_parses_cached_file_successfully();
     void check_new_tileLoader_has_no_tiles();
+    void views_share_workers_fairly_and_keep_their_tiles_in_memory();
+    void warmStart_round_trips_and_preloads_in_order();
+    void requestTiles_only_loads_the_requested_tile_types();
+    void requestTiles_queues_a_failed_tile_again();
+    void getTileDiskPath_keeps_slimmed_tiles_apart();
 };
 
 QTEST_MAIN(UnitTesting)
@@ -332,4 +346,252 @@ void UnitTesting::check_new_tileLoader_has_no_tiles()
     QVERIFY(rasterMap.size() == 0);
 }
 
+void UnitTesting::views_share_workers_fairly_and_keep_their_tiles_in_memory()
+{
+    // Every tile has a name, so we can check that evicted tiles leave the search index.
+    Bach::VectorTileWriter writer;
+    writer.beginLayer("place");
+    writer.addPoints({ QPoint(100, 100) }, { { "name", "Nydalen" } });
+    const QByteArray tileBytes = writer.toByteArray();
+
+    // The first load waits until both views have queued their tiles,
+    // then we can see in which order the rest are loaded.
+    QSemaphore gate;
+    std::atomic<bool> gateUsed = false;
+    QMutex loadOrderLock;
+    QVector<TileCoord> loadOrder;
+    auto loadTileOverride = [&](TileCoord coord, TileType) -> const QByteArray* {
+        if (!gateUsed.exchange(true))
+            gate.acquire();
+        QMutexLocker lock(&loadOrderLock);
+        loadOrder.push_back(coord);
+        return &tileBytes;
+    };
+
+    // A single worker thread, so only one tile loads at a time.
+    std::unique_ptr<TileLoader> tileLoaderPtr = TileLoader::newDummy("", loadTileOverride, false, 1);
+    TileLoader &tileLoader = *tileLoaderPtr;
+    const TileLoader::ViewId overviewView = tileLoader.registerView();
+    const TileLoader::ViewId detailView = tileLoader.registerView();
+
+    std::set<TileCoord> overviewTiles;
+    for (int x = 0; x < 20; x++)
+        overviewTiles.insert({ 10, x, 0 });
+    const TileCoord detailTile = { 14, 0, 0 };
+    auto tileLoadedFn = [](TileCoord) {};
+    tileLoader.requestTiles(overviewView, overviewTiles, tileLoadedFn, true);
+    tileLoader.requestTiles(detailView, { detailTile }, tileLoadedFn, true);
+    gate.release();
+
+    auto allTilesLoaded = [&]() {
+        if (tileLoader.getTileState_Vector(detailTile) != Bach::LoadedTileState::Ok)
+            return false;
+        for (TileCoord coord : overviewTiles) {
+            if (tileLoader.getTileState_Vector(coord) != Bach::LoadedTileState::Ok)
+                return false;
+        }
+        return true;
+    };
+    QTRY_VERIFY(allTilesLoaded());
+
+    // The detail view gets the next turn, instead of waiting for all the overview tiles.
+    {
+        QMutexLocker lock(&loadOrderLock);
+        QCOMPARE(loadOrder.size(), 21);
+        QVERIFY(loadOrder[1] == detailTile);
+    }
+
+    // Both views show their tiles, so nothing can be evicted.
+    tileLoader.setVectorMemoryBudget(1);
+    QCOMPARE(tileLoader.getMetrics().vectorTilesEvicted, (quint64)0);
+
+    // A result keeps its tiles in memory even when no view shows them.
+    const TileCoord heldTile = { 10, 5, 0 };
+    QScopedPointer<Bach::RequestTilesResult> heldResult = tileLoader.requestTiles({ heldTile }, false);
+    QCOMPARE(heldResult->vectorMap().size(), 1);
+
+    tileLoader.unregisterView(overviewView);
+    QVERIFY(tileLoader.getTileState_Vector({ 10, 0, 0 }) == std::nullopt);
+    QVERIFY(tileLoader.getTileState_Vector(heldTile) == Bach::LoadedTileState::Ok);
+    QVERIFY(tileLoader.getTileState_Vector(detailTile) == Bach::LoadedTileState::Ok);
+    QCOMPARE(tileLoader.getMetrics().vectorTilesEvicted, (quint64)19);
+    QCOMPARE(tileLoader.getLabelSearchIndex().tileCount(), (qsizetype)2);
+
+    heldResult.reset();
+    QVERIFY(tileLoader.getTileState_Vector(heldTile) == std::nullopt);
+    QCOMPARE(tileLoader.getLabelSearchIndex().tileCount(), (qsizetype)1);
+}
+
+void UnitTesting::warmStart_round_trips_and_preloads_in_order()
+{
+    Bach::UnitTesting::TempDir tempDir;
+    const QString path = tempDir.path() + QDir::separator() + "warm_start.json";
+    QVERIFY(Bach::readWarmStartFile(path) == std::nullopt);
+
+    Bach::WarmStartState state;
+    state.x = 0.53;
+    state.y = 0.28;
+    state.zoom = 12.3;
+    // The last tile doesn't exist at its zoom level, and is dropped when read.
+    state.tiles = { { 12, 2172, 1192 }, { 12, 2171, 1192 }, { 3, 8, 0 } };
+    QVERIFY(Bach::writeWarmStartFile(path, state));
+
+    std::optional<Bach::WarmStartState> readState = Bach::readWarmStartFile(path);
+    QVERIFY(readState.has_value());
+    QCOMPARE(readState->x, state.x);
+    QCOMPARE(readState->y, state.y);
+    QCOMPARE(readState->zoom, state.zoom);
+    QCOMPARE(readState->tiles.size(), 2);
+    QVERIFY(readState->tiles[0] == state.tiles[0]);
+    QVERIFY(readState->tiles[1] == state.tiles[1]);
+
+    // Visible tiles closest to the center come first, then the recent tiles.
+    const QVector<TileCoord> orderedTiles = Bach::orderWarmStartTiles(
+        { { 2, 0, 0 }, { 2, 1, 1 } },
+        0.375,
+        0.375,
+        { { 2, 1, 1 }, { 3, 0, 0 }, { 3, 1, 0 } },
+        3);
+    QCOMPARE(orderedTiles.size(), 3);
+    QVERIFY(orderedTiles[0] == TileCoord({ 2, 1, 1 }));
+    QVERIFY(orderedTiles[1] == TileCoord({ 2, 0, 0 }));
+    QVERIFY(orderedTiles[2] == TileCoord({ 3, 0, 0 }));
+
+    // Preloaded tiles are loaded in the given order.
+    Bach::VectorTileWriter writer;
+    writer.beginLayer("water");
+    writer.addPoints({ QPoint(100, 100) });
+    const QByteArray tileBytes = writer.toByteArray();
+    QMutex loadOrderLock;
+    QVector<TileCoord> loadOrder;
+    auto loadTileOverride = [&](TileCoord coord, TileType) -> const QByteArray* {
+        QMutexLocker lock(&loadOrderLock);
+        loadOrder.push_back(coord);
+        return &tileBytes;
+    };
+    std::unique_ptr<TileLoader> tileLoaderPtr = TileLoader::newDummy("", loadTileOverride, false, 1);
+    TileLoader &tileLoader = *tileLoaderPtr;
+    tileLoader.preloadTiles_Vector(orderedTiles);
+    auto allTilesLoaded = [&]() {
+        for (TileCoord coord : orderedTiles) {
+            if (tileLoader.getTileState_Vector(coord) != Bach::LoadedTileState::Ok)
+                return false;
+        }
+        return true;
+    };
+    QTRY_VERIFY(allTilesLoaded());
+    {
+        QMutexLocker lock(&loadOrderLock);
+        QVERIFY(loadOrder == orderedTiles);
+    }
+    QCOMPARE(tileLoader.getRecentVectorTiles(10).size(), 3);
+}
 
+void UnitTesting::requestTiles_only_loads_the_requested_tile_types()
+{
+    Bach::VectorTileWriter writer;
+    writer.beginLayer("water");
+    writer.addPoints({ QPoint(100, 100) });
+    const QByteArray vectorBytes = writer.toByteArray();
+
+    QImage image(4, 4, QImage::Format_RGB32);
+    image.fill(Qt::blue);
+    QByteArray rasterBytes;
+    QBuffer rasterBuffer(&rasterBytes);
+    QVERIFY(rasterBuffer.open(QBuffer::WriteOnly));
+    QVERIFY(image.save(&rasterBuffer, "PNG"));
+
+    std::atomic<int> vectorLoadCount = 0;
+    std::atomic<int> rasterLoadCount = 0;
+    auto loadTileOverride = [&](TileCoord, TileType type) -> const QByteArray* {
+        if (type == TileType::Vector) {
+            vectorLoadCount++;
+            return &vectorBytes;
+        }
+        rasterLoadCount++;
+        return &rasterBytes;
+    };
+    std::unique_ptr<TileLoader> tileLoaderPtr = TileLoader::newDummy("", loadTileOverride, true, 1);
+    TileLoader &tileLoader = *tileLoaderPtr;
+    const TileCoord coord = { 1, 0, 1 };
+    auto tileLoadedFn = [](TileCoord) {};
+
+    // A view showing vector tiles never loads the raster tile.
+    tileLoader.requestTiles(TileLoader::defaultViewId, { coord }, tileLoadedFn, true, TileTypeFlag::Vector);
+    QTRY_VERIFY(tileLoader.getTileState_Vector(coord) == Bach::LoadedTileState::Ok);
+    QCOMPARE(vectorLoadCount.load(), 1);
+    QCOMPARE(rasterLoadCount.load(), 0);
+    {
+        QScopedPointer<Bach::RequestTilesResult> result = tileLoader.requestTiles(
+            TileLoader::defaultViewId, { coord }, nullptr, false, allTileTypes);
+        QCOMPARE(result->vectorMap().size(), 1);
+        QVERIFY(result->rasterImageMap().isEmpty());
+    }
+
+    // Switching to raster tiles loads them when they are first requested,
+    // and only returns the raster tiles.
+    tileLoader.requestTiles(TileLoader::defaultViewId, { coord }, tileLoadedFn, true, TileTypeFlag::Raster);
+    auto rasterTileLoaded = [&]() {
+        QScopedPointer<Bach::RequestTilesResult> result = tileLoader.requestTiles(
+            TileLoader::defaultViewId, { coord }, nullptr, false, TileTypeFlag::Raster);
+        return result->vectorMap().isEmpty() && result->rasterImageMap().size() == 1;
+    };
+    QTRY_VERIFY(rasterTileLoaded());
+    QCOMPARE(vectorLoadCount.load(), 1);
+    QCOMPARE(rasterLoadCount.load(), 1);
+}
+
+void UnitTesting::requestTiles_queues_a_failed_tile_again()
+{
+    Bach::VectorTileWriter writer;
+    writer.beginLayer("water");
+    writer.addPoints({ QPoint(100, 100) });
+    const QByteArray tileBytes = writer.toByteArray();
+
+    // The first load fails, the next ones succeed.
+    std::atomic<int> loadCount = 0;
+    auto loadTileOverride = [&](TileCoord, TileType) -> const QByteArray* {
+        if (loadCount++ == 0)
+            return nullptr;
+        return &tileBytes;
+    };
+    std::unique_ptr<TileLoader> tileLoaderPtr = TileLoader::newDummy("", loadTileOverride, false, 1);
+    TileLoader &tileLoader = *tileLoaderPtr;
+    const TileCoord coord = { 1, 0, 1 };
+    auto tileLoadedFn = [](TileCoord) {};
+
+    // The failed tile is no longer pending, so it isn't waited for forever.
+    tileLoader.requestTiles(TileLoader::defaultViewId, { coord }, tileLoadedFn, true);
+    QTRY_VERIFY(tileLoader.getTileState_Vector(coord) == std::nullopt);
+    QCOMPARE(loadCount.load(), 1);
+
+    tileLoader.requestTiles(TileLoader::defaultViewId, { coord }, tileLoadedFn, true);
+    QTRY_VERIFY(tileLoader.getTileState_Vector(coord) == Bach::LoadedTileState::Ok);
+    QCOMPARE(loadCount.load(), 2);
+}
+
+// Checks that vector tiles slimmed for different content are cached in different places.
+void UnitTesting::getTileDiskPath_keeps_slimmed_tiles_apart()
+{
+    std::unique_ptr<TileLoader> tileLoaderPtr = TileLoader::newDummy("cache");
+    TileLoader &tileLoader = *tileLoaderPtr;
+    const TileCoord coord = { 3, 2, 1 };
+    const QString wholeVectorPath = tileLoader.getTileDiskPath(coord, TileType::Vector);
+    const QString rasterPath = tileLoader.getTileDiskPath(coord, TileType::Raster);
+
+    Bach::TileContentUsage usage = Bach::TileContentUsage::fromStyleSheetJson(QJsonDocument::fromJson(R"({
+        "layers": [ { "id": "water", "type": "fill", "source-layer": "water" } ]
+    })"));
+    tileLoader.setTileContentUsage(usage);
+    const QString slimVectorPath = tileLoader.getTileDiskPath(coord, TileType::Vector);
+    QVERIFY(slimVectorPath != wholeVectorPath);
+    QVERIFY(slimVectorPath.contains(usage.cacheKey()));
+    QCOMPARE(tileLoader.getTileDiskPath(coord, TileType::Raster), rasterPath);
+
+    usage.keepAllAttributes = true;
+    tileLoader.setTileContentUsage(usage);
+    QVERIFY(tileLoader.getTileDiskPath(coord, TileType::Vector) != slimVectorPath);
+
+    tileLoader.setTileContentUsage(std::nullopt);
+    QCOMPARE(tileLoader.getTileDiskPath(coord, TileType::Vector), wholeVectorPath);
+}
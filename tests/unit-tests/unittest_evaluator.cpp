@@ -48,6 +48,8 @@ private slots:
     void resolveExpression_with_match_value();
     void resolveExpression_with_interpolate_value();
     void resolveExpression_with_compound_value();
+    void resolveExpression_with_fractional_zoom();
+    void isZoomOnly_returns_expected_results();
     void cleanupTestCase();
 };
 
@@ -493,6 +495,39 @@ void UnitTesting::resolveExpression_with_interpolate_value()
     QVERIFY2(validDoubleError, errorMessage.toUtf8());
 }
 
+// Test resolve expression function when the `interpolate` expression is resolved at a fractional zoom.
+// The result should lie between the results of the integer zoom levels around it.
+void UnitTesting::resolveExpression_with_fractional_zoom()
+{
+    PolygonFeature feature;
+    QJsonArray expression = expressionsObject().value("interpolate").toArray();
+
+    double expectedInterpolationResult = 11 + (2.*2.5/5);
+    QVariant result = Evaluator::resolveExpression(expression, &feature, 5.5, 0);
+    QString errorMessage = QString("Wrong result from \"interpolate\" function for zoom level 5.5, expected %1 but got %2")
+                               .arg(expectedInterpolationResult)
+                               .arg(result.toDouble());
+    QVERIFY2(validDoubleRange(result.toDouble(), expectedInterpolationResult), errorMessage.toUtf8());
+
+    double below = Evaluator::resolveExpression(expression, &feature, 10, 0).toDouble();
+    double above = Evaluator::resolveExpression(expression, &feature, 11, 0).toDouble();
+    double between = Evaluator::resolveExpression(expression, &feature, 10.25, 0).toDouble();
+    QVERIFY2(below < between && between < above, "Fractional zoom should interpolate between the integer zoom levels");
+}
+
+// Test that only expressions that don't depend on the feature are counted as zoom-only.
+void UnitTesting::isZoomOnly_returns_expected_results()
+{
+    QJsonArray interpolate = expressionsObject().value("interpolate").toArray();
+    QVERIFY2(Evaluator::isZoomOnly(interpolate), "An interpolation over zoom with number outputs is zoom-only");
+
+    QJsonArray compound = expressionsObject().value("compound").toObject().value("expression1").toArray();
+    QVERIFY2(!Evaluator::isZoomOnly(compound), "An expression that reads feature data is not zoom-only");
+
+    QJsonArray step = { "step", QJsonArray{ "zoom" }, 1, 5, 2 };
+    QVERIFY2(!Evaluator::isZoomOnly(step), "Only interpolations are counted as zoom-only");
+}
+
 // Test resolve expression function when the `compound` expression object value is passed in.
 // This function checks that the function returns expected values.
 void UnitTesting::resolveExpression_with_compound_value()
@@ -0,0 +1,124 @@
+// Qt header files
+#include <QObject>
+#include <QTest>
+
+// STL header files
+#include <cmath>
+
+// Other header files
+#include "Bach/Benchmark/Benchmark.h"
+
+namespace Benchmark = Bach::Benchmark;
+
+class UnitTesting : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void compare_ignores_changes_within_the_noise();
+    void compare_reports_real_regressions_and_improvements();
+    void compare_with_zero_min_change_uses_only_the_noise();
+};
+
+QTEST_MAIN(UnitTesting)
+#include "unittesting_benchmark.moc"
+
+/*!
+ * \brief makeReport creates a report with a single metric with the given samples.
+ */
+static Benchmark::Report makeReport(const std::vector<double> &samples, bool higherIsBetter = false)
+{
+    Benchmark::Report report;
+    report.benchmark = "test";
+    for (double sample : samples)
+        report.addSample("metric", sample, "ms", higherIsBetter);
+    return report;
+}
+
+/*!
+ * \brief compareMetric compares two reports made by makeReport.
+ */
+static Benchmark::MetricComparison compareMetric(
+    const Benchmark::Report &baseline,
+    const Benchmark::Report &current,
+    double minRelativeChange)
+{
+    const Benchmark::Comparison comparison = Benchmark::compare(baseline, current, minRelativeChange);
+    if (comparison.metrics.size() != 1)
+        return {};
+    return comparison.metrics[0];
+}
+
+void UnitTesting::compare_ignores_changes_within_the_noise()
+{
+    // Both runs spread about 5% around their medians.
+    const Benchmark::Report baseline = makeReport({ 100, 110, 90, 105, 95 });
+    const double baselineSpread = 1.4826 * 5 / 100;
+    QVERIFY(qFuzzyCompare(baseline.metrics.at("metric").relativeSpread(), baselineSpread));
+
+    Benchmark::MetricComparison result = compareMetric(baseline, makeReport({ 104, 94, 112, 98, 101 }), 0.05);
+    QCOMPARE(result.baselineMedian, 100.0);
+    QCOMPARE(result.currentMedian, 101.0);
+    QVERIFY(!result.isRegression);
+    QVERIFY(!result.isImprovement);
+
+    // The threshold is three times the combined spread of both runs, which is above --min-change here.
+    const double currentSpread = 1.4826 * 3 / 101;
+    QVERIFY(qFuzzyCompare(result.threshold, 3 * std::hypot(baselineSpread, currentSpread)));
+    QVERIFY(result.threshold > 0.05);
+
+    // A 10% slowdown is larger than --min-change, but not than the noise.
+    result = compareMetric(baseline, makeReport({ 114, 104, 122, 108, 111 }), 0.05);
+    QVERIFY(result.relativeSlowdown > 0.1);
+    QVERIFY(!result.isRegression);
+    QVERIFY(!Benchmark::compare(baseline, makeReport({ 114, 104, 122, 108, 111 }), 0.05).hasRegressions());
+}
+
+void UnitTesting::compare_reports_real_regressions_and_improvements()
+{
+    // Quiet runs, so the threshold falls back to --min-change.
+    const Benchmark::Report baseline = makeReport({ 100, 101, 99, 100, 100 });
+    Benchmark::MetricComparison result = compareMetric(baseline, makeReport({ 120, 121, 119, 120, 120 }), 0.05);
+    QCOMPARE(result.threshold, 0.05);
+    QVERIFY(qFuzzyCompare(result.relativeSlowdown, 0.2));
+    QVERIFY(result.isRegression);
+    QVERIFY(!result.isImprovement);
+    QVERIFY(Benchmark::compare(baseline, makeReport({ 120, 121, 119, 120, 120 }), 0.05).hasRegressions());
+
+    result = compareMetric(baseline, makeReport({ 80, 81, 79, 80, 80 }), 0.05);
+    QVERIFY(!result.isRegression);
+    QVERIFY(result.isImprovement);
+
+    // Below --min-change, even though the runs are quiet.
+    result = compareMetric(baseline, makeReport({ 103, 104, 102, 103, 103 }), 0.05);
+    QVERIFY(!result.isRegression);
+
+    // For throughput, a lower number is the slowdown.
+    const Benchmark::Report throughputBaseline = makeReport({ 1000, 1000, 1000 }, true);
+    result = compareMetric(throughputBaseline, makeReport({ 800, 800, 800 }, true), 0.05);
+    QVERIFY(qFuzzyCompare(result.relativeSlowdown, 0.25));
+    QVERIFY(result.isRegression);
+    result = compareMetric(throughputBaseline, makeReport({ 1200, 1200, 1200 }, true), 0.05);
+    QVERIFY(result.isImprovement);
+}
+
+void UnitTesting::compare_with_zero_min_change_uses_only_the_noise()
+{
+    // Without any noise, every change counts.
+    const Benchmark::Report quietBaseline = makeReport({ 100, 100, 100 });
+    Benchmark::MetricComparison result = compareMetric(quietBaseline, makeReport({ 101, 101, 101 }), 0);
+    QCOMPARE(result.threshold, 0.0);
+    QVERIFY(result.isRegression);
+
+    // An unchanged metric is neither a regression nor an improvement.
+    result = compareMetric(quietBaseline, makeReport({ 100, 100, 100 }), 0);
+    QVERIFY(!result.isRegression);
+    QVERIFY(!result.isImprovement);
+
+    // With noise, the threshold is only the noise.
+    const Benchmark::Report noisyBaseline = makeReport({ 100, 110, 90, 105, 95 });
+    result = compareMetric(noisyBaseline, makeReport({ 100, 100, 100, 100, 100 }), 0);
+    QVERIFY(qFuzzyCompare(result.threshold, 3 * 1.4826 * 5 / 100));
+    QVERIFY(!compareMetric(noisyBaseline, makeReport({ 120, 120, 120 }), 0).isRegression);
+    QVERIFY(compareMetric(noisyBaseline, makeReport({ 130, 130, 130 }), 0).isRegression);
+}
@@ -22,6 +22,7 @@ private:
 private slots:
     void initTestCase();
     void getStopOutput_returns_basic_values();
+    void getStopOutput_interpolates_with_base();
     void parseSheet_returns_basic_values();
     void test_background_layer_parsing();
     void test_fill_layer_parsing();
@@ -71,17 +72,38 @@ void UnitTesting::initTestCase()
 void UnitTesting::getStopOutput_returns_basic_values(){
     QList<QPair<int, float>> stops({{4,0.8},{9, 1.1}, {11, 1.75}, {18, 2.5},{22, 2.72}});
     //List of pairs that represent the zoom level and the expected output for it.
-    QList<QPair<int, float>> values({{0, 0.8}, {3, 0.8}, {4, 0.8}, {8, 0.8}, {9, 0.8}, {10, 1.1}, {16, 1.75}, {18, 1.75}, {20, 2.5}, {23, 2.72}});
+    //Values between two stops are interpolated linearly.
+    QList<QPair<double, float>> values({{0, 0.8}, {3, 0.8}, {4, 0.8}, {6.5, 0.95}, {9, 1.1}, {10, 1.425}, {16, 2.285714}, {18, 2.5}, {20, 2.61}, {23, 2.72}});
     for(auto value : values){
         auto result = getStopOutput(stops, value.first);
         auto errorMsg = QString("At value #%1. Expected %2, but got %3")
                             .arg(value.first)
                             .arg(value.second)
                             .arg(result);
-        QVERIFY2(result == value.second, errorMsg.toUtf8());
+        QVERIFY2(qAbs(result - value.second) < 0.0001, errorMsg.toUtf8());
     }
 }
 
+//Test that stops with a base other than 1 are interpolated exponentially.
+void UnitTesting::getStopOutput_interpolates_with_base(){
+    QList<QPair<int, float>> stops({{0, 0}, {2, 3}});
+    //List of pairs that represent the zoom level and the expected output for it, with a base of 2.
+    QList<QPair<double, float>> values({{0, 0}, {0.5, 0.414214}, {1, 1}, {1.5, 1.828427}, {2, 3}, {3, 3}});
+    for(auto value : values){
+        auto result = getStopOutput(stops, value.first, 2);
+        auto errorMsg = QString("At value #%1. Expected %2, but got %3")
+                            .arg(value.first)
+                            .arg(value.second)
+                            .arg(result);
+        QVERIFY2(qAbs(result - value.second) < 0.0001, errorMsg.toUtf8());
+    }
+
+    //Integer outputs are rounded to the nearest value.
+    QList<QPair<int, int>> intStops({{0, 0}, {2, 3}});
+    QVERIFY(getStopOutput(intStops, 1.0, 2) == 1);
+    QVERIFY(getStopOutput(intStops, 1.5, 2) == 2);
+}
+
 
 void UnitTesting::test_background_layer_parsing()
 {
@@ -284,7 +306,7 @@ void UnitTesting::test_line_layer_parsing()
     QVERIFY2(hueMatch && saturationMatch && lightnessMatch && alphaMatch == true, testError.toUtf8());
 
 
-    for(int i = 0; i < 19; i++){
+    for(int i = 0; i < 10; i++){
         int lineWidth = lineLayerStyle.getLineWidthAtZoom(i).toInt();
         testError =  QString("The line width does not match at zoom %1, expected %2 but got %3")
                         .arg(i)
@@ -293,11 +315,21 @@ void UnitTesting::test_line_layer_parsing()
         QVERIFY2(lineWidth == expectedLineWidthStop1, testError.toUtf8());
     }
 
-    int lineWidth = lineLayerStyle.getLineWidthAtZoom(19).toInt();
-    testError =  QString("The line width does not match at zoom 19, expected %1 but got %2")
-                    .arg(expectedLineWidthStop2)
+    // Halfway between the stops the width is halfway between the stop widths.
+    int lineWidth = lineLayerStyle.getLineWidthAtZoom(13.5).toInt();
+    testError =  QString("The line width does not match at zoom 13.5, expected %1 but got %2")
+                    .arg(2)
                     .arg(lineWidth);
-    QVERIFY2(lineWidth == expectedLineWidthStop2, testError.toUtf8());
+    QVERIFY2(lineWidth == 2, testError.toUtf8());
+
+    for(int i = 18; i < 21; i++){
+        lineWidth = lineLayerStyle.getLineWidthAtZoom(i).toInt();
+        testError =  QString("The line width does not match at zoom %1, expected %2 but got %3")
+                        .arg(i)
+                        .arg(expectedLineWidthStop2)
+                        .arg(lineWidth);
+        QVERIFY2(lineWidth == expectedLineWidthStop2, testError.toUtf8());
+    }
 
     testError =  QString("The line opacity variable type is not correct");
     QVERIFY2(lineLayerStyle.getLineOpacityAtZoom(1).typeId() == QMetaType::Type::QJsonArray, testError.toUtf8());
@@ -373,7 +405,7 @@ void UnitTesting::test_symbol_layer_parsing()
     testError =  QString("The layerStyle text font does not match");
     QVERIFY2(symbolLayerStyle.m_textFont == expectedFont, testError.toUtf8());
 
-    for(int i = 0; i < 15; i++){
+    for(int i = 0; i < 11; i++){
         int size = symbolLayerStyle.getTextSizeAtZoom(i).toInt();
         testError =  QString("The layerStyle text size does not match, expected %1 but got %2")
                         .arg(expectedTextSizeStop1)
@@ -381,15 +413,18 @@ void UnitTesting::test_symbol_layer_parsing()
         QVERIFY2(size == expectedTextSizeStop1, testError.toUtf8());
     }
 
-    for(int i = 15; i < 17; i++){
-        int size = symbolLayerStyle.getTextSizeAtZoom(i).toInt();
-        testError =  QString("The layerStyle text size does not match, expected %1 but got %2")
-                        .arg(expectedTextSizeStop2)
+    // Between two stops the size is interpolated.
+    QList<QPair<int, int>> expectedSizes({{12, 11}, {14, expectedTextSizeStop2}, {15, 13}});
+    for(auto expectedSize : expectedSizes){
+        int size = symbolLayerStyle.getTextSizeAtZoom(expectedSize.first).toInt();
+        testError =  QString("The layerStyle text size does not match at zoom %1, expected %2 but got %3")
+                        .arg(expectedSize.first)
+                        .arg(expectedSize.second)
                         .arg(size);
-        QVERIFY2(size == expectedTextSizeStop2, testError.toUtf8());
+        QVERIFY2(size == expectedSize.second, testError.toUtf8());
     }
 
-    for(int i = 17; i < 21; i++){
+    for(int i = 16; i < 21; i++){
         int size = symbolLayerStyle.getTextSizeAtZoom(i).toInt();
         testError =  QString("The layerStyle text size does not match, expected %1 but got %2")
                         .arg(expectedTextSizeStop3)
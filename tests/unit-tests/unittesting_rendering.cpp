@@ -1,9 +1,13 @@
 // Qt header files
+#include <QImage>
+#include <QJsonDocument>
 #include <QObject>
+#include <QPainter>
 #include <QTest>
 
 // Other header files
 #include "Rendering.h"
+#include "VectorTileWriter.h"
 
 class UnitTesting : public QObject
 {
@@ -11,11 +15,20 @@ class UnitTesting : public QObject
 
 private slots:
     void calcVisibleTiles_returns_expected_basic_cases();
+    void calcVisibleTilesWrapped_wraps_across_the_antimeridian();
     void calcViewportSizeNorm_returns_expected_basic_cases();
     void calcMapZoomLevelForTileSizePixels_returns_expected_basic_values();
+    void calcFractionalMapZoomLevel_returns_expected_basic_values();
     void longLatToWorldNormCoordDegrees_returns_expected_basic_values();
     void normalizeValueToZeroOneRange_returns_zero_when_small_divisor();
     void normalizeValueToZeroOneRange_returns_number_when_large_divisor();
+    void queryRenderedFeaturesAt_returns_features_under_point();
+    void queryRenderedFeatures_reports_split_features_once();
+    void analyzeSolidTile_detects_tiles_of_a_single_color();
+    void prioritizeLabelRequests_orders_labels_across_tiles();
+    void findPossibleDuplicateLabels_flags_only_nearby_repeats();
+    void paintVectorTiles_suppresses_duplicate_labels_across_tiles();
+    void paintVectorTiles_places_the_same_labels_in_parallel();
 };
 
 QTEST_MAIN(UnitTesting)
@@ -124,6 +137,58 @@ void UnitTesting::calcMapZoomLevelForTileSizePixels_returns_expected_basic_value
     }
 }
 
+void UnitTesting::calcFractionalMapZoomLevel_returns_expected_basic_values()
+{
+    struct TestItem {
+        struct Input {
+            int vpWidth;
+            int vpHeight;
+            double vpZoom;
+            int pixelSize;
+        };
+        Input input;
+        double expectedOut;
+    };
+    QVector<TestItem> testItems = {
+        {   { 512, 512, 0.0, 512},
+            0.0 },
+        {   { 512, 512, 0.25, 512},
+            0.25 },
+        {   { 512, 512, 1.5, 512},
+            1.5 },
+        {   { 1024, 1024, 0.5, 512},
+            1.5 },
+        {   { 512, 512, -1.0, 512},
+            0.0 },
+        {   { 512, 512, 30.0, 512},
+            (double)Bach::maxZoomLevel },
+    };
+
+    for (int i = 0; i < testItems.size(); i++) {
+        const auto &item = testItems[i];
+        const auto &input = item.input;
+        auto result = Bach::calcFractionalMapZoomLevel(
+            input.vpWidth,
+            input.vpHeight,
+            input.vpZoom,
+            input.pixelSize);
+
+        auto descr = QString("At item %1: Expected %2, but got %3.")
+            .arg(i)
+            .arg(item.expectedOut)
+            .arg(result);
+        QVERIFY2(std::abs(item.expectedOut - result) < 0.001, descr.toUtf8());
+
+        // The map zoom level used for the tiles is the same value, rounded.
+        auto mapZoom = Bach::calcMapZoomLevelForTileSizePixels(
+            input.vpWidth,
+            input.vpHeight,
+            input.vpZoom,
+            input.pixelSize);
+        QCOMPARE(mapZoom, (int)std::round(result));
+    }
+}
+
 void UnitTesting::longLatToWorldNormCoordDegrees_returns_expected_basic_values()
 {
     constexpr double epsilon = 0.001;
@@ -246,3 +311,411 @@ void UnitTesting::calcVisibleTiles_returns_expected_basic_cases()
         QVERIFY2(success, errorMsg.toUtf8());
     }
 }
+
+void UnitTesting::calcVisibleTilesWrapped_wraps_across_the_antimeridian()
+{
+    // Centered on the antimeridian, the left half of the viewport shows the
+    // eastern tile of the copy of the world to the left.
+    QVector<Bach::WrappedTileCoord> result = Bach::calcVisibleTilesWrapped(0.0, 0.5, 1.0, 1, 1);
+    QCOMPARE(result.size(), 4);
+    const QVector<QPair<TileCoord, int>> expected = {
+        { { 1, 1, 0 }, -1 },
+        { { 1, 0, 0 }, 0 },
+        { { 1, 1, 1 }, -1 },
+        { { 1, 0, 1 }, 0 },
+    };
+    for (int i = 0; i < expected.size(); i++) {
+        QCOMPARE(result[i].coord, expected[i].first);
+        QCOMPARE(result[i].worldCopy, expected[i].second);
+    }
+
+    // Zoomed out far enough to show the world three times,
+    // every copy refers to the same tile.
+    result = Bach::calcVisibleTilesWrapped(0.5, 0.5, 1.0, -1, 0);
+    QCOMPARE(result.size(), 3);
+    for (int i = 0; i < result.size(); i++) {
+        QCOMPARE(result[i].coord, (TileCoord{ 0, 0, 0 }));
+        QCOMPARE(result[i].worldCopy, i - 1);
+    }
+
+    // The tiles inside the map are the same as without wrapping.
+    result = Bach::calcVisibleTilesWrapped(0.5, 0.5, 1.0, 2, 2);
+    const QVector<TileCoord> unwrapped = Bach::calcVisibleTiles(0.5, 0.5, 1.0, 2, 2);
+    QCOMPARE(result.size(), unwrapped.size());
+    for (int i = 0; i < result.size(); i++) {
+        QCOMPARE(result[i].coord, unwrapped[i]);
+        QCOMPARE(result[i].worldCopy, 0);
+    }
+}
+
+void UnitTesting::queryRenderedFeaturesAt_returns_features_under_point()
+{
+    Bach::VectorTileWriter writer;
+    writer.beginLayer("water");
+    QPolygon lake;
+    lake << QPoint(1024, 1024) << QPoint(2048, 1024) << QPoint(2048, 2048) << QPoint(1024, 2048);
+    writer.addPolygon({ lake }, { { "class", "lake" } });
+    QPolygon ocean;
+    ocean << QPoint(2560, 2560) << QPoint(3072, 2560) << QPoint(3072, 3072) << QPoint(2560, 3072);
+    writer.addPolygon({ ocean }, { { "class", "ocean" } });
+    std::optional<VectorTile> tile = Bach::tileFromByteArray(writer.toByteArray());
+    QVERIFY2(tile != std::nullopt, "Could not parse the written tile");
+
+    std::optional<StyleSheet> styleSheet = StyleSheet::fromJson(QJsonDocument::fromJson(R"({
+        "layers": [
+            { "id": "lakes", "type": "fill", "source-layer": "water",
+              "filter": ["==", "class", "lake"], "layout": { "visibility": "visible" } },
+            { "id": "all-water", "type": "fill", "source-layer": "water",
+              "layout": { "visibility": "visible" } }
+        ]
+    })"));
+    QVERIFY(styleSheet.has_value());
+
+    // At zoom 0 the single tile covers the whole 512x512 viewport,
+    // so one pixel is 8 tile units.
+    const TileCoord coord { 0, 0, 0 };
+    const QMap<TileCoord, const VectorTile*> tiles { { coord, &tile.value() } };
+    auto query = [&](QPointF pos, const Bach::RenderedFeatureSet *renderedFeatures) {
+        return Bach::queryRenderedFeaturesAt(
+            pos, 2.0, 512, 512, 0.5, 0.5, 0.0, 0, tiles, styleSheet.value(), renderedFeatures);
+    };
+
+    // Without a recorded frame, the filters decide what is drawn.
+    QVector<Bach::RenderedFeatureHit> hits = query({ 192, 192 }, nullptr);
+    QCOMPARE(hits.size(), 2);
+    QCOMPARE(hits[0].styleLayerId, QString("all-water"));
+    QCOMPARE(hits[1].styleLayerId, QString("lakes"));
+    QCOMPARE(hits[0].sourceLayer, QString("water"));
+    QCOMPARE(hits[0].attributes.value("class").toString(), QString("lake"));
+    QCOMPARE(hits[0].distancePixels, 0.0);
+
+    hits = query({ 352, 352 }, nullptr);
+    QCOMPARE(hits.size(), 1);
+    QCOMPARE(hits[0].styleLayerId, QString("all-water"));
+
+    // Within the radius of the edge of the lake.
+    hits = query({ 257, 192 }, nullptr);
+    QCOMPARE(hits.size(), 2);
+    QCOMPARE(hits[0].distancePixels, 1.0);
+
+    QCOMPARE(query({ 100, 100 }, nullptr).size(), 0);
+
+    // With a recorded frame, only what was drawn is returned.
+    Bach::RenderedFeatureSet renderedFeatures;
+    renderedFeatures.tiles.insert(coord, &tile.value());
+    renderedFeatures.features.insert({ tile->m_layers.at("water")->m_features[0].get(), 0 });
+    hits = query({ 192, 192 }, &renderedFeatures);
+    QCOMPARE(hits.size(), 1);
+    QCOMPARE(hits[0].styleLayerId, QString("lakes"));
+
+    // Tiles that were not drawn are skipped.
+    renderedFeatures.tiles.clear();
+    QCOMPARE(query({ 192, 192 }, &renderedFeatures).size(), 0);
+}
+
+void UnitTesting::queryRenderedFeatures_reports_split_features_once()
+{
+    // A road crossing from tile 0/0/0 into tile 1/1/0, and a building inside the first tile.
+    Bach::VectorTileWriter leftWriter;
+    leftWriter.beginLayer("transportation");
+    QPolygon leftRoad;
+    leftRoad << QPoint(2048, 2048) << QPoint(4200, 2048);
+    leftWriter.addLines({ leftRoad }, { { "class", "primary" } }, 7);
+    leftWriter.beginLayer("building");
+    QPolygon building;
+    building << QPoint(1000, 1000) << QPoint(1200, 1000) << QPoint(1200, 1200) << QPoint(1000, 1200);
+    leftWriter.addPolygon({ building }, {}, 8);
+
+    Bach::VectorTileWriter rightWriter;
+    rightWriter.beginLayer("transportation");
+    QPolygon rightRoad;
+    rightRoad << QPoint(-100, 2048) << QPoint(2048, 2048);
+    rightWriter.addLines({ rightRoad }, { { "class", "primary" } }, 7);
+
+    std::optional<VectorTile> leftTile = Bach::tileFromByteArray(leftWriter.toByteArray());
+    std::optional<VectorTile> rightTile = Bach::tileFromByteArray(rightWriter.toByteArray());
+    QVERIFY(leftTile.has_value() && rightTile.has_value());
+    QCOMPARE(leftTile->m_layers.at("transportation")->m_features[0]->id(), (quint64)7);
+
+    std::optional<StyleSheet> styleSheet = StyleSheet::fromJson(QJsonDocument::fromJson(R"({
+        "layers": [
+            { "id": "buildings", "type": "fill", "source-layer": "building",
+              "layout": { "visibility": "visible" } },
+            { "id": "roads", "type": "line", "source-layer": "transportation",
+              "layout": { "visibility": "visible" } }
+        ]
+    })"));
+    QVERIFY(styleSheet.has_value());
+
+    // At viewport zoom 0 and map zoom 1, each tile is 256x256 pixels of the 512x512 viewport.
+    const QMap<TileCoord, const VectorTile*> tiles {
+        { TileCoord{ 1, 0, 0 }, &leftTile.value() },
+        { TileCoord{ 1, 1, 0 }, &rightTile.value() } };
+    auto query = [&](const auto &selection, const QStringList &styleLayerIds, int maxResults) {
+        QStringList out;
+        Bach::queryRenderedFeatures(
+            selection, styleLayerIds, 512, 512, 0.5, 0.5, 0.0, 1, tiles, styleSheet.value(), nullptr,
+            [&](const Bach::RenderedFeatureHit &hit) {
+                out << hit.styleLayerId;
+                return out.size() < maxResults;
+            });
+        out.sort();
+        return out;
+    };
+
+    const QRectF topHalf { 0, 0, 512, 256 };
+    QCOMPARE(query(topHalf, {}, 100), QStringList({ "buildings", "roads" }));
+    QCOMPARE(query(topHalf, { "roads" }, 100), QStringList({ "roads" }));
+    QCOMPARE(query(topHalf, {}, 1).size(), 1);
+    // Only the part of the road in the right tile is selected.
+    QCOMPARE(query(QRectF(300, 100, 100, 100), {}, 100), QStringList({ "roads" }));
+    QCOMPARE(query(QRectF(0, 200, 512, 56), {}, 100), QStringList());
+
+    QPolygonF lasso;
+    lasso << QPointF(40, 40) << QPointF(120, 40) << QPointF(40, 120);
+    QCOMPARE(query(lasso, {}, 100), QStringList({ "buildings" }));
+}
+
+void UnitTesting::analyzeSolidTile_detects_tiles_of_a_single_color()
+{
+    // An ocean tile: a rectangle reaching into the buffer, with a small island below it.
+    Bach::VectorTileWriter writer;
+    writer.beginLayer("landcover");
+    QPolygon island;
+    island << QPoint(1000, 1000) << QPoint(1200, 1000) << QPoint(1200, 1200) << QPoint(1000, 1200);
+    writer.addPolygon({ island });
+    writer.beginLayer("water");
+    QPolygon ocean;
+    ocean << QPoint(-64, -64) << QPoint(4160, -64) << QPoint(4160, 4160) << QPoint(-64, 4160);
+    writer.addPolygon({ ocean }, { { "class", "ocean" } });
+    writer.beginLayer("transportation");
+    QPolygon ferry;
+    ferry << QPoint(500, 500) << QPoint(3000, 3000);
+    writer.addLines({ ferry });
+    std::optional<VectorTile> tile = Bach::tileFromByteArray(writer.toByteArray());
+    QVERIFY2(tile != std::nullopt, "Could not parse the written tile");
+
+    auto parseStyleSheet = [](const QByteArray &json) {
+        return StyleSheet::fromJson(QJsonDocument::fromJson(json));
+    };
+    std::optional<StyleSheet> styleSheet = parseStyleSheet(R"({
+        "layers": [
+            { "id": "background", "type": "background", "layout": { "visibility": "visible" },
+              "paint": { "background-color": "#ffffff" } },
+            { "id": "land", "type": "fill", "source-layer": "landcover",
+              "layout": { "visibility": "visible" }, "paint": { "fill-color": "#00ff00" } },
+            { "id": "water", "type": "fill", "source-layer": "water",
+              "layout": { "visibility": "visible" }, "paint": { "fill-color": "#0000ff" } },
+            { "id": "ferry", "type": "line", "source-layer": "transportation", "minzoom": 5,
+              "layout": { "visibility": "visible" }, "paint": { "line-color": "#000000" } }
+        ]
+    })");
+    QVERIFY(styleSheet.has_value());
+
+    // The ferry line is only drawn from zoom 5.
+    Bach::SolidTileInfo solidTile = Bach::analyzeSolidTile(*tile, *styleSheet, 0);
+    QVERIFY(solidTile.isSolid);
+    QCOMPARE(solidTile.color, QColor(0, 0, 255));
+    QCOMPARE(solidTile.styleLayerIndex, 2);
+    QVERIFY(solidTile.feature == tile->m_layers.at("water")->m_features[0].get());
+    QVERIFY(!Bach::analyzeSolidTile(*tile, *styleSheet, 5).isSolid);
+
+    // Transparent water shows what is below it.
+    std::optional<StyleSheet> transparentStyleSheet = parseStyleSheet(R"({
+        "layers": [
+            { "id": "water", "type": "fill", "source-layer": "water", "layout": { "visibility": "visible" },
+              "paint": { "fill-color": "#0000ff", "fill-opacity": { "stops": [[0, 0.5]] } } }
+        ]
+    })");
+    QVERIFY(transparentStyleSheet.has_value());
+    QVERIFY(!Bach::analyzeSolidTile(*tile, *transparentStyleSheet, 0).isSolid);
+
+    // The solid tile is filled with its color, and the covering feature counts as rendered.
+    QImage image(256, 256, QImage::Format_ARGB32);
+    image.fill(Qt::red);
+    QPainter painter(&image);
+    Bach::RenderedFeatureSet renderedFeatures;
+    const QMap<TileCoord, const VectorTile*> tiles { { { 0, 0, 0 }, &tile.value() } };
+    Bach::paintVectorTiles(
+        painter,
+        0.5,
+        0.5,
+        0.0,
+        0,
+        tiles,
+        *styleSheet,
+        Bach::PaintVectorTileSettings::getDefault(),
+        false,
+        &renderedFeatures);
+    painter.end();
+    QCOMPARE(image.pixelColor(0, 0), QColor(0, 0, 255));
+    QCOMPARE(image.pixelColor(128, 128), QColor(0, 0, 255));
+    QCOMPARE(image.pixelColor(255, 255), QColor(0, 0, 255));
+    QVERIFY(renderedFeatures.contains(solidTile.feature, 2));
+    QVERIFY(Bach::getSolidTileInfo(*tile, *styleSheet, 0).isSolid);
+}
+
+void UnitTesting::prioritizeLabelRequests_orders_labels_across_tiles()
+{
+    auto makeRequest = [](int styleLayerIndex, int rank, const QString &text) {
+        Bach::LabelRequest request;
+        request.styleLayerIndex = styleLayerIndex;
+        request.rank = rank;
+        request.text = text;
+        return request;
+    };
+    const QVector<QVector<Bach::LabelRequest>> tileRequests {
+        { makeRequest(1, 5, "A"), makeRequest(0, 9, "B"), makeRequest(1, 1, "C") },
+        {},
+        { makeRequest(1, 5, "D"), makeRequest(0, 2, "E"), makeRequest(1, 1, "F") },
+    };
+
+    // Earlier layer styles first, then lower ranks, and otherwise tile and feature order.
+    QStringList order;
+    for (const Bach::LabelRequest &request : Bach::prioritizeLabelRequests(tileRequests))
+        order << request.text;
+    QCOMPARE(order, QStringList({ "E", "B", "C", "F", "A", "D" }));
+}
+
+void UnitTesting::findPossibleDuplicateLabels_flags_only_nearby_repeats()
+{
+    auto makeRequest = [](int styleLayerIndex, const QString &text, QPointF anchor) {
+        Bach::LabelRequest request;
+        request.styleLayerIndex = styleLayerIndex;
+        request.text = text;
+        request.anchor = anchor;
+        request.duplicateDistance = 100;
+        return request;
+    };
+    const QVector<Bach::LabelRequest> queue {
+        makeRequest(0, "Main St", { 0, 0 }),
+        // Same text and layer style, within the duplicate distance.
+        makeRequest(0, "Main St", { 60, 60 }),
+        // Too far away from both of the above.
+        makeRequest(0, "Main St", { 300, 0 }),
+        // Another text, or another layer style, is never a duplicate.
+        makeRequest(0, "High St", { 10, 0 }),
+        makeRequest(1, "Main St", { 10, 0 }),
+        // Close to the request at 300, 0.
+        makeRequest(0, "Main St", { 350, 0 }),
+    };
+    const QVector<bool> expected { false, true, false, false, false, true };
+    QCOMPARE(Bach::findPossibleDuplicateLabels(queue), expected);
+    QCOMPARE(Bach::findPossibleDuplicateLabels({}), QVector<bool>());
+}
+
+void UnitTesting::paintVectorTiles_suppresses_duplicate_labels_across_tiles()
+{
+    // A town name in each of two neighbouring tiles, about 190 pixels apart on screen.
+    // The one in the right tile has the better rank, and another name is far away from both.
+    Bach::VectorTileWriter leftWriter;
+    leftWriter.beginLayer("place");
+    leftWriter.addPoints({ QPoint(4000, 500) }, { { "name", "Oslo" } }, 1);
+    leftWriter.addPoints({ QPoint(500, 3500) }, { { "name", "Bergen" } }, 2);
+    Bach::VectorTileWriter rightWriter;
+    rightWriter.beginLayer("place");
+    rightWriter.addPoints({ QPoint(100, 3500) }, { { "name", "Oslo" }, { "rank", 1 } }, 3);
+    std::optional<VectorTile> leftTile = Bach::tileFromByteArray(leftWriter.toByteArray());
+    std::optional<VectorTile> rightTile = Bach::tileFromByteArray(rightWriter.toByteArray());
+    QVERIFY(leftTile.has_value() && rightTile.has_value());
+
+    std::optional<StyleSheet> styleSheet = StyleSheet::fromJson(QJsonDocument::fromJson(R"({
+        "layers": [
+            { "id": "places", "type": "symbol", "source-layer": "place",
+              "layout": { "visibility": "visible", "text-field": "{name}", "symbol-spacing": 250 } }
+        ]
+    })"));
+    QVERIFY(styleSheet.has_value());
+
+    const AbstractLayerFeature *leftOslo = leftTile->m_layers.at("place")->m_features[0].get();
+    const AbstractLayerFeature *bergen = leftTile->m_layers.at("place")->m_features[1].get();
+    const AbstractLayerFeature *rightOslo = rightTile->m_layers.at("place")->m_features[0].get();
+
+    // At viewport zoom 0 and map zoom 1, each tile is 256x256 pixels of the 512x512 viewport.
+    const QMap<TileCoord, const VectorTile*> tiles {
+        { TileCoord{ 1, 0, 0 }, &leftTile.value() },
+        { TileCoord{ 1, 1, 0 }, &rightTile.value() } };
+    auto render = [&](bool suppressDuplicateLabels) {
+        Bach::PaintVectorTileSettings settings = Bach::PaintVectorTileSettings::getDefault();
+        settings.suppressDuplicateLabels = suppressDuplicateLabels;
+        QImage image(512, 512, QImage::Format_ARGB32);
+        image.fill(Qt::white);
+        QPainter painter(&image);
+        Bach::RenderedFeatureSet renderedFeatures;
+        Bach::paintVectorTiles(painter, 0.5, 0.5, 0.0, 1, tiles, *styleSheet, settings, false, &renderedFeatures);
+        return renderedFeatures;
+    };
+
+    // The better ranked label wins, even though its tile comes later.
+    Bach::RenderedFeatureSet rendered = render(true);
+    QVERIFY(rendered.contains(rightOslo, 0));
+    QVERIFY(!rendered.contains(leftOslo, 0));
+    QVERIFY(rendered.contains(bergen, 0));
+
+    rendered = render(false);
+    QVERIFY(rendered.contains(rightOslo, 0));
+    QVERIFY(rendered.contains(leftOslo, 0));
+    QVERIFY(rendered.contains(bergen, 0));
+}
+
+void UnitTesting::paintVectorTiles_places_the_same_labels_in_parallel()
+{
+    // A grid of point labels close enough to collide, and roads with curved labels,
+    // spread over four tiles so that the label jobs finish in any order.
+    QMap<TileCoord, const VectorTile*> tiles;
+    std::vector<VectorTile> tileStorage;
+    tileStorage.reserve(4);
+    for (int tileX = 0; tileX < 2; tileX++) {
+        for (int tileY = 0; tileY < 2; tileY++) {
+            Bach::VectorTileWriter writer;
+            writer.beginLayer("place");
+            for (int i = 0; i < 64; i++) {
+                const QPoint point(200 + (i % 8) * 480, 200 + (i / 8) * 480);
+                writer.addPoints(
+                    { point },
+                    { { "name", QString("Place %1").arg(i % 5) }, { "rank", (i * 7) % 4 } });
+            }
+            writer.beginLayer("transportation");
+            for (int i = 0; i < 4; i++) {
+                QPolygon road;
+                road << QPoint(0, 500 + i * 900) << QPoint(2000, 700 + i * 900) << QPoint(4096, 500 + i * 900);
+                writer.addLines({ road }, { { "name", QString("Road %1").arg(i % 2) } });
+            }
+            std::optional<VectorTile> tile = Bach::tileFromByteArray(writer.toByteArray());
+            QVERIFY(tile.has_value());
+            tileStorage.push_back(std::move(tile.value()));
+            tiles.insert(TileCoord{ 1, tileX, tileY }, &tileStorage.back());
+        }
+    }
+
+    std::optional<StyleSheet> styleSheet = StyleSheet::fromJson(QJsonDocument::fromJson(R"({
+        "layers": [
+            { "id": "roads", "type": "symbol", "source-layer": "transportation",
+              "layout": { "visibility": "visible", "text-field": "{name}", "symbol-spacing": 200 } },
+            { "id": "places", "type": "symbol", "source-layer": "place",
+              "layout": { "visibility": "visible", "text-field": "{name}", "symbol-spacing": 100 } }
+        ]
+    })"));
+    QVERIFY(styleSheet.has_value());
+
+    auto render = [&](bool generateLabelsInParallel, Bach::RenderedFeatureSet &renderedFeatures) {
+        Bach::PaintVectorTileSettings settings = Bach::PaintVectorTileSettings::getDefault();
+        settings.generateLabelsInParallel = generateLabelsInParallel;
+        QImage image(512, 512, QImage::Format_ARGB32);
+        image.fill(Qt::white);
+        QPainter painter(&image);
+        Bach::paintVectorTiles(painter, 0.5, 0.5, 0.0, 1, tiles, *styleSheet, settings, false, &renderedFeatures);
+        painter.end();
+        return image;
+    };
+
+    Bach::RenderedFeatureSet sequentialFeatures;
+    const QImage sequentialImage = render(false, sequentialFeatures);
+    QVERIFY(!sequentialFeatures.features.isEmpty());
+    for (int run = 0; run < 5; run++) {
+        Bach::RenderedFeatureSet parallelFeatures;
+        const QImage parallelImage = render(true, parallelFeatures);
+        QVERIFY(parallelFeatures.features == sequentialFeatures.features);
+        QCOMPARE(parallelImage, sequentialImage);
+    }
+}
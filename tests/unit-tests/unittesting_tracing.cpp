@@ -0,0 +1,141 @@
+// Qt header files
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QObject>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QThread>
+
+// Other header files
+#include "Tracing.h"
+
+class UnitTesting : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void recordSpan_is_exported_as_chrome_trace();
+    void recordSpan_keeps_the_newest_spans_when_the_ring_wraps();
+    void exited_threads_keep_their_spans_until_cleared();
+};
+
+QTEST_MAIN(UnitTesting)
+#include "unittesting_tracing.moc"
+
+/*!
+ * \brief spanEvents returns the complete ("X") events of an exported trace with the given name.
+ */
+static QJsonArray spanEvents(const QByteArray &traceJson, const QString &name)
+{
+    QJsonArray out;
+    const QJsonArray events = QJsonDocument::fromJson(traceJson).object().value("traceEvents").toArray();
+    for (const QJsonValue &value : events) {
+        const QJsonObject event = value.toObject();
+        if (event.value("ph").toString() == "X" && event.value("name").toString() == name)
+            out.append(event);
+    }
+    return out;
+}
+
+/*!
+ * \brief threadNames returns the names of the threads in an exported trace.
+ */
+static QStringList threadNames(const QByteArray &traceJson)
+{
+    QStringList out;
+    const QJsonArray events = QJsonDocument::fromJson(traceJson).object().value("traceEvents").toArray();
+    for (const QJsonValue &value : events) {
+        const QJsonObject event = value.toObject();
+        if (event.value("ph").toString() == "M" && event.value("name").toString() == "thread_name")
+            out << event.value("args").toObject().value("name").toString();
+    }
+    return out;
+}
+
+void UnitTesting::init()
+{
+    Bach::Tracing::setEnabled(true);
+    Bach::Tracing::clear();
+}
+
+void UnitTesting::recordSpan_is_exported_as_chrome_trace()
+{
+    Bach::Tracing::recordSpan("recorded", 2000, 5000);
+    {
+        const Bach::Tracing::ScopedSpan span { "scoped" };
+    }
+    Bach::Tracing::setEnabled(false);
+    {
+        const Bach::Tracing::ScopedSpan span { "disabled" };
+    }
+    Bach::Tracing::setEnabled(true);
+
+    const QByteArray json = Bach::Tracing::exportChromeTraceJson();
+    QVERIFY(QJsonDocument::fromJson(json).isObject());
+
+    const QJsonArray recorded = spanEvents(json, "recorded");
+    QCOMPARE(recorded.size(), 1);
+    // The times are exported in microseconds.
+    QCOMPARE(recorded[0].toObject().value("ts").toDouble(), 2.0);
+    QCOMPARE(recorded[0].toObject().value("dur").toDouble(), 3.0);
+    QCOMPARE(recorded[0].toObject().value("pid").toInt(), 1);
+    QCOMPARE(spanEvents(json, "scoped").size(), 1);
+    QVERIFY(spanEvents(json, "scoped")[0].toObject().value("dur").toDouble() >= 0);
+    QCOMPARE(spanEvents(json, "disabled").size(), 0);
+
+    // The same trace is written to file.
+    QTemporaryDir tempDir;
+    QVERIFY(tempDir.isValid());
+    const QString path = tempDir.filePath("trace.json");
+    QVERIFY(Bach::Tracing::writeChromeTrace(path));
+    QFile file { path };
+    QVERIFY(file.open(QFile::ReadOnly));
+    QCOMPARE(spanEvents(file.readAll(), "recorded").size(), 1);
+
+    Bach::Tracing::clear();
+    QCOMPARE(spanEvents(Bach::Tracing::exportChromeTraceJson(), "recorded").size(), 0);
+}
+
+void UnitTesting::recordSpan_keeps_the_newest_spans_when_the_ring_wraps()
+{
+    const int extraSpans = 10;
+    for (int i = 0; i < Bach::Tracing::eventsPerThread + extraSpans; i++)
+        Bach::Tracing::recordSpan("wrapping", i * 1000, i * 1000 + 500);
+
+    const QJsonArray events = spanEvents(Bach::Tracing::exportChromeTraceJson(), "wrapping");
+    QCOMPARE(events.size(), Bach::Tracing::eventsPerThread);
+    double minTs = events[0].toObject().value("ts").toDouble();
+    double maxTs = minTs;
+    for (const QJsonValue &event : events) {
+        minTs = qMin(minTs, event.toObject().value("ts").toDouble());
+        maxTs = qMax(maxTs, event.toObject().value("ts").toDouble());
+    }
+    // The oldest spans were overwritten.
+    QCOMPARE(minTs, (double)extraSpans);
+    QCOMPARE(maxTs, (double)(Bach::Tracing::eventsPerThread + extraSpans - 1));
+}
+
+void UnitTesting::exited_threads_keep_their_spans_until_cleared()
+{
+    QThread *thread = QThread::create([]() {
+        Bach::Tracing::recordSpan("on worker", 1000, 2000);
+    });
+    thread->setObjectName("Tracing test worker");
+    thread->start();
+    QVERIFY(thread->wait(5000));
+    delete thread;
+
+    // The spans of the thread outlive it.
+    QByteArray json = Bach::Tracing::exportChromeTraceJson();
+    QCOMPARE(spanEvents(json, "on worker").size(), 1);
+    QVERIFY(threadNames(json).contains("Tracing test worker"));
+
+    // Clearing frees the buffer of the thread.
+    Bach::Tracing::clear();
+    json = Bach::Tracing::exportChromeTraceJson();
+    QCOMPARE(spanEvents(json, "on worker").size(), 0);
+    QVERIFY(!threadNames(json).contains("Tracing test worker"));
+}
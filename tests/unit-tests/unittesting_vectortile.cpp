@@ -1,9 +1,14 @@
 // Qt header files
+#include <QJsonDocument>
 #include <QObject>
 #include <QTest>
 
 // Other header files
+#include "FeatureIndex.h"
+#include "LabelSearchIndex.h"
+#include "TileSlimming.h"
 #include "VectorTiles.h"
+#include "VectorTileWriter.h"
 
 class UnitTesting : public QObject
 {
@@ -11,6 +16,13 @@ class UnitTesting : public QObject
 
 private slots:
     void tileFromByteArray_returns_basic_values();
+    void calcMemoryUsage_sums_layers();
+    void vectorTileWriter_output_can_be_parsed();
+    void featureIndex_query_returns_overlapping_features_once();
+    void calcFeatureDistance_returns_expected_basic_values();
+    void labelSearchIndex_finds_names_by_prefix_and_with_typos();
+    void slimVectorTile_keeps_only_used_layers_and_attributes();
+    void tileContentUsage_cacheKey_changes_with_the_kept_content();
 };
 
 QTEST_MAIN(UnitTesting)
@@ -91,3 +103,352 @@ void UnitTesting::tileFromByteArray_returns_basic_values()
     QVERIFY2(tile != std::nullopt, readError.toUtf8());
     testTileLayers(tile.value());
 }
+
+void UnitTesting::calcMemoryUsage_sums_layers()
+{
+    QString path = ":/unitTestResources/000testTile.pbf";
+    QFile tileFile(path);
+    bool fileOpened = tileFile.open(QIODevice::ReadOnly);
+    QVERIFY2(fileOpened == true, "Could not open file");
+
+    std::optional<VectorTile> tile = Bach::tileFromByteArray(tileFile.readAll());
+    QVERIFY2(tile != std::nullopt, "Could not read file data");
+
+    Bach::VectorTileMemoryUsage usage = Bach::calcMemoryUsage(tile.value());
+    QCOMPARE(usage.tileCount, (qint64)1);
+    QCOMPARE(usage.layers.size(), (size_t)6);
+    QCOMPARE(usage.layers["boundary"].featureCount, (qint64)717);
+    QVERIFY(usage.layers["boundary"].geometryBytes > 0);
+
+    QVERIFY(usage.layers["boundary"].indexBytes > 0);
+    QVERIFY(usage.tileIndexBytes > 0);
+
+    // The total should be the sum of every layer, and of the parts of the tile's index
+    // that don't belong to a layer.
+    qint64 sumOfLayers = 0;
+    for (const auto &[layerName, layerUsage] : usage.layers)
+        sumOfLayers += layerUsage.totalBytes();
+    QCOMPARE(usage.total().totalBytes(), sumOfLayers + usage.tileIndexBytes);
+
+    // Adding and then removing the same tile should leave nothing behind.
+    Bach::VectorTileMemoryUsage combined;
+    combined += usage;
+    combined += usage;
+    QCOMPARE(combined.total().totalBytes(), 2 * usage.total().totalBytes());
+    combined -= usage;
+    combined -= usage;
+    QCOMPARE(combined.tileCount, (qint64)0);
+    QCOMPARE(combined.tileIndexBytes, (qint64)0);
+    QVERIFY(combined.layers.empty());
+}
+
+void UnitTesting::vectorTileWriter_output_can_be_parsed()
+{
+    Bach::VectorTileWriter writer;
+
+    writer.beginLayer("water");
+    QPolygon square;
+    square << QPoint(10, 10) << QPoint(100, 10) << QPoint(100, 100) << QPoint(10, 100);
+    writer.addPolygon({ square }, { { "class", "lake" } });
+
+    writer.beginLayer("transportation", 512);
+    QPolygon road;
+    road << QPoint(0, 0) << QPoint(-20, 30) << QPoint(40, 50);
+    writer.addLines({ road }, { { "class", "primary" }, { "layer", -1 } });
+
+    writer.beginLayer("place");
+    writer.addPoints({ QPoint(5, 6) }, { { "name", "Oslo" }, { "rank", 1 }, { "capital", true } });
+    writer.addPoints({ QPoint(7, 8) }, { { "name", "Bergen" }, { "rank", 2 } });
+
+    std::optional<VectorTile> tile = Bach::tileFromByteArray(writer.toByteArray());
+    QVERIFY2(tile != std::nullopt, "Could not parse the written tile");
+    QCOMPARE(tile->m_layers.size(), (size_t)3);
+
+    const TileLayer &water = *tile->m_layers.at("water");
+    QCOMPARE(water.extent(), 4096);
+    QCOMPARE(water.m_features.size(), (size_t)1);
+    QCOMPARE(water.m_features[0]->type(), AbstractLayerFeature::featureType::polygon);
+    const auto &polygon = static_cast<const PolygonFeature&>(*water.m_features[0]).polygon();
+    QCOMPARE(polygon.boundingRect(), QRectF(10, 10, 90, 90));
+    QCOMPARE(water.m_features[0]->featureMetaData["class"].toString(), QString("lake"));
+
+    const TileLayer &transportation = *tile->m_layers.at("transportation");
+    QCOMPARE(transportation.extent(), 512);
+    const auto &line = static_cast<const LineFeature&>(*transportation.m_features[0]).line();
+    QCOMPARE(line.elementCount(), 3);
+    QCOMPARE(QPointF(line.elementAt(1)), QPointF(-20, 30));
+    QCOMPARE(QPointF(line.elementAt(2)), QPointF(40, 50));
+    QVERIFY(transportation.m_features[0]->featureMetaData.contains("layer"));
+
+    const TileLayer &place = *tile->m_layers.at("place");
+    QCOMPARE(place.m_features.size(), (size_t)2);
+    const auto &point = static_cast<const PointFeature&>(*place.m_features[1]);
+    QCOMPARE(point.points(), QList<QPoint>{ QPoint(7, 8) });
+    QCOMPARE(place.m_features[0]->featureMetaData["name"].toString(), QString("Oslo"));
+    QCOMPARE(place.m_features[0]->featureMetaData["capital"].toBool(), true);
+    QVERIFY(place.m_features[1]->featureMetaData.contains("rank"));
+}
+
+void UnitTesting::featureIndex_query_returns_overlapping_features_once()
+{
+    Bach::VectorTileWriter writer;
+    writer.beginLayer("water");
+    QPolygon lake;
+    lake << QPoint(100, 100) << QPoint(200, 100) << QPoint(200, 200) << QPoint(100, 200);
+    writer.addPolygon({ lake }, { { "class", "lake" } });
+    // Covers every cell of the grid, and goes outside the tile.
+    QPolygon ocean;
+    ocean << QPoint(-50, -50) << QPoint(4200, -50) << QPoint(4200, 4200) << QPoint(-50, 4200);
+    writer.addPolygon({ ocean }, { { "class", "ocean" } });
+    writer.beginLayer("place");
+    writer.addPoints({ QPoint(3000, 3000) }, { { "name", "Oslo" } });
+
+    std::optional<VectorTile> tile = Bach::tileFromByteArray(writer.toByteArray());
+    QVERIFY2(tile != std::nullopt, "Could not parse the written tile");
+
+    const Bach::TileFeatureIndex &index = tile->featureIndex();
+    QCOMPARE(index.entryCount(), (qsizetype)3);
+    // The index is only built once.
+    QCOMPARE(&tile->featureIndex(), &index);
+
+    auto queryClasses = [&](QRectF rect) {
+        QStringList out;
+        index.query(rect, [&](const Bach::FeatureIndexEntry &entry) {
+            out << entry.feature->featureMetaData.value("class", entry.feature->featureMetaData.value("name")).toString();
+        });
+        out.sort();
+        return out;
+    };
+    QCOMPARE(queryClasses(QRectF(150, 150, 10, 10)), QStringList({ "lake", "ocean" }));
+    QCOMPARE(queryClasses(QRectF(0, 0, 4096, 4096)), QStringList({ "Oslo", "lake", "ocean" }));
+    QCOMPARE(queryClasses(QRectF(3000, 3000, 0, 0)), QStringList({ "Oslo", "ocean" }));
+    QCOMPARE(queryClasses(QRectF(5000, 5000, 10, 10)), QStringList());
+}
+
+void UnitTesting::calcFeatureDistance_returns_expected_basic_values()
+{
+    Bach::VectorTileWriter writer;
+    writer.beginLayer("water");
+    // A square with a square hole in it.
+    QPolygon outer;
+    outer << QPoint(0, 0) << QPoint(100, 0) << QPoint(100, 100) << QPoint(0, 100);
+    QPolygon hole;
+    hole << QPoint(40, 40) << QPoint(40, 60) << QPoint(60, 60) << QPoint(60, 40);
+    writer.addPolygon({ outer, hole });
+    writer.beginLayer("transportation");
+    QPolygon road;
+    road << QPoint(0, 200) << QPoint(100, 200);
+    writer.addLines({ road });
+
+    std::optional<VectorTile> tile = Bach::tileFromByteArray(writer.toByteArray());
+    QVERIFY2(tile != std::nullopt, "Could not parse the written tile");
+    const AbstractLayerFeature &polygon = *tile->m_layers.at("water")->m_features[0];
+    const AbstractLayerFeature &line = *tile->m_layers.at("transportation")->m_features[0];
+
+    QCOMPARE(Bach::calcFeatureDistance(polygon, QPointF(20, 20)), 0.0);
+    QCOMPARE(Bach::calcFeatureDistance(polygon, QPointF(50, 50)), 10.0);
+    QCOMPARE(Bach::calcFeatureDistance(polygon, QPointF(110, 50)), 10.0);
+    QCOMPARE(Bach::calcFeatureDistance(line, QPointF(50, 190)), 10.0);
+    QCOMPARE(Bach::calcFeatureDistance(line, QPointF(103, 204)), 5.0);
+}
+
+void UnitTesting::labelSearchIndex_finds_names_by_prefix_and_with_typos()
+{
+    auto collectLabels = [](const Bach::VectorTileWriter &writer) {
+        std::optional<VectorTile> tile = Bach::tileFromByteArray(writer.toByteArray());
+        if (!tile.has_value())
+            return Bach::TileLabels{};
+        return Bach::LabelSearchIndex::collectLabels(*tile);
+    };
+
+    // A road that crosses from one tile into the next,
+    // and a town in the first tile.
+    Bach::VectorTileWriter westWriter;
+    westWriter.beginLayer("transportation_name");
+    QPolygon westRoad;
+    westRoad << QPoint(2000, 2000) << QPoint(4096, 2000);
+    westWriter.addLines({ westRoad }, { { "name", "Storgata" } });
+    westWriter.beginLayer("place");
+    westWriter.addPoints({ QPoint(3000, 1000) }, { { "name", "Gjøvik" }, { "name:latin", "Gjøvik" } });
+
+    Bach::VectorTileWriter eastWriter;
+    eastWriter.beginLayer("transportation_name");
+    QPolygon eastRoad;
+    eastRoad << QPoint(0, 2000) << QPoint(1000, 2000);
+    eastWriter.addLines({ eastRoad }, { { "name", "Storgata" } });
+
+    // A road with the same name in another town.
+    Bach::VectorTileWriter farWriter;
+    farWriter.beginLayer("transportation_name");
+    QPolygon farRoad;
+    farRoad << QPoint(100, 100) << QPoint(200, 100);
+    farWriter.addLines({ farRoad }, { { "name", "Storgata" } });
+    farWriter.beginLayer("place");
+    farWriter.addPoints({ QPoint(100, 100) }, { { "name", "Ålesund" } });
+
+    const TileCoord westCoord = { 14, 8000, 4000 };
+    const TileCoord eastCoord = { 14, 8001, 4000 };
+    const TileCoord farCoord = { 14, 8010, 4000 };
+    Bach::LabelSearchIndex index;
+    index.insertTile(westCoord, collectLabels(westWriter));
+    index.insertTile(eastCoord, collectLabels(eastWriter));
+    index.insertTile(farCoord, collectLabels(farWriter));
+    QCOMPARE(index.tileCount(), (qsizetype)3);
+    QCOMPARE(index.nameCount(), (qsizetype)3);
+
+    // The pieces of the road in touching tiles are one place, the other town's road another.
+    QVector<Bach::LabelSearchResult> roads = index.findPrefix("stor", 10);
+    QCOMPARE(roads.size(), 2);
+    QCOMPARE(roads[0].name, QString("Storgata"));
+    QCOMPARE(roads[0].sourceLayer, QString("transportation_name"));
+    QCOMPARE(roads[0].editDistance, 0);
+    const double tileCount = 1 << 14;
+    QVERIFY(roads[0].worldX > 8000 / tileCount && roads[0].worldX < 8002 / tileCount);
+    QVERIFY(roads[1].worldX > 8010 / tileCount && roads[1].worldX < 8011 / tileCount);
+    // The short road gets a closer zoom than the long one.
+    QVERIFY(roads[0].zoom < roads[1].zoom);
+
+    // Points are placed exactly.
+    QVector<Bach::LabelSearchResult> towns = index.findPrefix("GJØ", 10);
+    QCOMPARE(towns.size(), 1);
+    QCOMPARE(towns[0].name, QString("Gjøvik"));
+    QCOMPARE(towns[0].worldX, (8000 + 3000 / 4096.0) / tileCount);
+    QCOMPARE(towns[0].worldY, (4000 + 1000 / 4096.0) / tileCount);
+
+    // Accents are ignored.
+    QCOMPARE(index.findPrefix("ales", 10).size(), 1);
+    // Typing errors are only accepted by the fuzzy lookup.
+    QCOMPARE(index.findPrefix("Gjovik", 10).size(), 0);
+    QVector<Bach::LabelSearchResult> fuzzyTowns = index.findFuzzy("Gjovik", 1, 10);
+    QCOMPARE(fuzzyTowns.size(), 1);
+    QCOMPARE(fuzzyTowns[0].editDistance, 1);
+    QCOMPARE(index.findFuzzy("Storgta", 1, 10).size(), 2);
+    QCOMPARE(index.findFuzzy("Strogata", 1, 10).size(), 0);
+    QCOMPARE(index.findFuzzy("Strogata", 2, 10).size(), 2);
+    QCOMPARE(index.findFuzzy("Storgata", 2, 1).size(), 1);
+
+    // Removing tiles removes their names.
+    index.removeTile(farCoord);
+    QCOMPARE(index.findPrefix("stor", 10).size(), 1);
+    QCOMPARE(index.findPrefix("ales", 10).size(), 0);
+    index.removeTile(westCoord);
+    index.removeTile(eastCoord);
+    QCOMPARE(index.nameCount(), (qsizetype)0);
+    QCOMPARE(index.tileCount(), (qsizetype)0);
+}
+
+void UnitTesting::slimVectorTile_keeps_only_used_layers_and_attributes()
+{
+    const Bach::TileContentUsage usage = Bach::TileContentUsage::fromStyleSheetJson(QJsonDocument::fromJson(R"({
+        "layers": [
+            { "id": "background", "type": "background" },
+            { "id": "water", "type": "fill", "source-layer": "water",
+              "filter": ["==", "class", "lake"] },
+            { "id": "roads", "type": "line", "source-layer": "transportation",
+              "paint": { "line-width": ["match", ["get", "rank"], 1, 4, 1] } },
+            { "id": "places", "type": "symbol", "source-layer": "place",
+              "layout": { "text-field": "{ref}" } }
+        ]
+    })"));
+    QVERIFY(usage.usesLayer("water"));
+    QVERIFY(!usage.usesLayer("building"));
+    QVERIFY(usage.usesAttribute("water", "class"));
+    QVERIFY(usage.usesAttribute("transportation", "rank"));
+    QVERIFY(usage.usesAttribute("place", "ref"));
+    QVERIFY(usage.usesAttribute("place", "name:latin"));
+    QVERIFY(!usage.usesAttribute("water", "rank"));
+
+    Bach::VectorTileWriter writer;
+    writer.beginLayer("water");
+    QPolygon lake;
+    lake << QPoint(100, 100) << QPoint(400, 100) << QPoint(400, 400) << QPoint(100, 400);
+    writer.addPolygon({ lake }, { { "class", "lake" }, { "brunnel", "bridge" }, { "osm_id", 1234 } }, 7);
+    writer.beginLayer("building");
+    writer.addPolygon({ lake }, { { "render_height", 20 } });
+    writer.beginLayer("place");
+    writer.addPoints({ QPoint(200, 200) }, { { "name", "Nydalen" }, { "ref", "A" }, { "rank", 3 } });
+    const QByteArray bytes = writer.toByteArray();
+
+    Bach::SlimTileStats stats;
+    std::optional<QByteArray> slimBytes = Bach::slimVectorTile(bytes, usage, &stats);
+    QVERIFY(slimBytes.has_value());
+    QVERIFY(slimBytes->size() < bytes.size());
+    QCOMPARE(stats.layersRemoved, 1);
+    QCOMPARE(stats.keysRemoved, 3);
+    QCOMPARE(stats.valuesRemoved, 3);
+
+    std::optional<VectorTile> tile = Bach::tileFromByteArray(slimBytes.value());
+    QVERIFY(tile.has_value());
+    QCOMPARE(tile->m_layers.size(), (size_t)2);
+    QVERIFY(tile->m_layers.count("building") == 0);
+
+    // The geometry and id are kept as they are.
+    const AbstractLayerFeature &water = *tile->m_layers.at("water")->m_features[0];
+    QCOMPARE(water.id(), (quint64)7);
+    QCOMPARE(water.featureMetaData.size(), 1);
+    QCOMPARE(water.featureMetaData.value("class").toString(), QString("lake"));
+    const QRectF lakeBounds = static_cast<const PolygonFeature&>(water).polygon().boundingRect();
+    QCOMPARE(lakeBounds, QRectF(100, 100, 300, 300));
+
+    const AbstractLayerFeature &place = *tile->m_layers.at("place")->m_features[0];
+    QCOMPARE(place.featureMetaData.size(), 2);
+    QCOMPARE(place.featureMetaData.value("name").toString(), QString("Nydalen"));
+    QCOMPARE(place.featureMetaData.value("ref").toString(), QString("A"));
+
+    QVERIFY(Bach::slimVectorTile("not a tile", usage) == std::nullopt);
+}
+
+void UnitTesting::tileContentUsage_cacheKey_changes_with_the_kept_content()
+{
+    auto parse = [](const QByteArray &json) {
+        return Bach::TileContentUsage::fromStyleSheetJson(QJsonDocument::fromJson(json));
+    };
+    const Bach::TileContentUsage usage = parse(R"({
+        "layers": [
+            { "id": "water", "type": "fill", "source-layer": "water", "filter": ["==", "class", "lake"] },
+            { "id": "roads", "type": "line", "source-layer": "transportation" }
+        ]
+    })");
+    // The order of the layer styles doesn't change what is kept.
+    const Bach::TileContentUsage reordered = parse(R"({
+        "layers": [
+            { "id": "roads", "type": "line", "source-layer": "transportation" },
+            { "id": "lakes", "type": "fill", "source-layer": "water", "filter": ["==", "class", "lake"] }
+        ]
+    })");
+    const Bach::TileContentUsage otherKeys = parse(R"({
+        "layers": [
+            { "id": "water", "type": "fill", "source-layer": "water", "filter": ["==", "class", "ocean"],
+              "paint": { "fill-color": ["get", "colour"] } },
+            { "id": "roads", "type": "line", "source-layer": "transportation" }
+        ]
+    })");
+    QCOMPARE(usage.cacheKey(), reordered.cacheKey());
+    QVERIFY(usage.cacheKey() != otherKeys.cacheKey());
+    QCOMPARE(usage.cacheKey().size(), 16);
+
+    // With every attribute kept, only the layers matter.
+    Bach::TileContentUsage allAttributes = usage;
+    allAttributes.keepAllAttributes = true;
+    Bach::TileContentUsage otherKeysAllAttributes = otherKeys;
+    otherKeysAllAttributes.keepAllAttributes = true;
+    QVERIFY(allAttributes.cacheKey() != usage.cacheKey());
+    QCOMPARE(allAttributes.cacheKey(), otherKeysAllAttributes.cacheKey());
+
+    QVERIFY(allAttributes.usesAttribute("water", "osm_id"));
+    QVERIFY(!allAttributes.usesAttribute("building", "osm_id"));
+
+    Bach::VectorTileWriter writer;
+    writer.beginLayer("water");
+    QPolygon lake;
+    lake << QPoint(100, 100) << QPoint(400, 100) << QPoint(400, 400) << QPoint(100, 400);
+    writer.addPolygon({ lake }, { { "class", "lake" }, { "osm_id", 1234 } });
+    writer.beginLayer("building");
+    writer.addPolygon({ lake }, { { "render_height", 20 } });
+    std::optional<QByteArray> slimBytes = Bach::slimVectorTile(writer.toByteArray(), allAttributes);
+    QVERIFY(slimBytes.has_value());
+    std::optional<VectorTile> tile = Bach::tileFromByteArray(slimBytes.value());
+    QVERIFY(tile.has_value());
+    QVERIFY(tile->m_layers.count("building") == 0);
+    QCOMPARE(tile->m_layers.at("water")->m_features[0]->featureMetaData.size(), 2);
+}